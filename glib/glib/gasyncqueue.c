@@ -29,15 +29,40 @@
 #include "glib.h"
 
 
+typedef struct _GAsyncQueueCell GAsyncQueueCell;
+
+/* A cell of the ring of a bounded queue. The cell at index i is free
+ * for the producer claiming position pos when sequence == pos, and it
+ * holds data for the consumer claiming position pos when sequence ==
+ * pos + 1. */
+struct _GAsyncQueueCell
+{
+  gint sequence;
+  gpointer data;
+};
+
 struct _GAsyncQueue
 {
   GMutex *mutex;
   GCond *cond;
   GQueue *queue;
-  guint waiting_threads;
+  gint waiting_threads;
   guint ref_count;
+
+  /* Only used for queues created by g_async_queue_new_bounded(). The
+   * positions are free running counters, the cell of a position is
+   * cells[pos & cell_mask]. */
+  GAsyncQueueCell *cells;
+  guint cell_mask;
+  gint enqueue_pos;
+  gint dequeue_pos;
 };
 
+#define G_ASYNC_QUEUE_IS_BOUNDED(queue) ((queue)->cells != NULL)
+
+#define POS_ADD(pos, n) ((gint) ((guint) (pos) + (guint) (n)))
+#define POS_DIFF(a, b)  ((gint) ((guint) (a) - (guint) (b)))
+
 /**
  * g_async_queue_new:
  * 
@@ -54,9 +79,165 @@ g_async_queue_new ()
   retval->queue = g_queue_new ();
   retval->waiting_threads = 0;
   retval->ref_count = 1;
+  retval->cells = NULL;
+  retval->cell_mask = 0;
+  retval->enqueue_pos = 0;
+  retval->dequeue_pos = 0;
   return retval;
 }
 
+/**
+ * g_async_queue_new_bounded:
+ * @max_length: the number of entries the queue can hold at a time.
+ * 
+ * Creates a new asynchronous queue with the initial reference count
+ * of 1, that holds at most @max_length entries (rounded up to the
+ * next power of two).
+ *
+ * Entries are kept in a ring, that producers and consumers claim
+ * cells of with atomic operations, so g_async_queue_push(),
+ * g_async_queue_try_pop() and a g_async_queue_pop() that finds data
+ * do not take the @queue's lock. The lock is only taken by consumers,
+ * that have to wait for data, and by producers, that have to wake
+ * them up. If the queue is full, pushing yields the processor until
+ * a consumer makes room.
+ * 
+ * Return value: the new #GAsyncQueue.
+ **/
+GAsyncQueue*
+g_async_queue_new_bounded (guint max_length)
+{
+  GAsyncQueue* retval;
+  guint size, i;
+
+  g_return_val_if_fail (max_length > 0, NULL);
+  g_return_val_if_fail (max_length <= G_MAXINT / 2, NULL);
+
+  for (size = 2; size < max_length; size <<= 1)
+    ;
+
+  retval = g_async_queue_new ();
+  retval->cells = g_new (GAsyncQueueCell, size);
+  retval->cell_mask = size - 1;
+  for (i = 0; i < size; i++)
+    {
+      retval->cells[i].sequence = i;
+      retval->cells[i].data = NULL;
+    }
+
+  return retval;
+}
+
+/* Claims the cell at the enqueue position and fills it, returns FALSE
+ * if the ring is full. Never blocks, the lock doesn't need to be
+ * held. */
+static gboolean
+g_async_queue_ring_push (GAsyncQueue *queue,
+			 gpointer     data)
+{
+  GAsyncQueueCell *cell;
+  gint pos = g_atomic_int_get (&queue->enqueue_pos);
+
+  while (TRUE)
+    {
+      gint diff;
+
+      cell = &queue->cells[pos & queue->cell_mask];
+      diff = POS_DIFF (g_atomic_int_get (&cell->sequence), pos);
+
+      if (diff == 0)
+	{
+	  if (g_atomic_int_compare_and_exchange (&queue->enqueue_pos, 
+						 pos, POS_ADD (pos, 1)))
+	    break;
+	}
+      else if (diff < 0)
+	/* The consumer of the previous round has not freed the cell */
+	return FALSE;
+
+      pos = g_atomic_int_get (&queue->enqueue_pos);
+    }
+
+  cell->data = data;
+  /* Publishes the data, sequence is pos here */
+  g_atomic_int_add (&cell->sequence, 1);
+
+  return TRUE;
+}
+
+/* Claims the cell at the dequeue position and empties it, returns
+ * NULL if the ring is empty. Never blocks, the lock doesn't need to be
+ * held. */
+static gpointer
+g_async_queue_ring_pop (GAsyncQueue *queue)
+{
+  GAsyncQueueCell *cell;
+  gpointer retval;
+  gint pos = g_atomic_int_get (&queue->dequeue_pos);
+
+  while (TRUE)
+    {
+      gint diff;
+
+      cell = &queue->cells[pos & queue->cell_mask];
+      diff = POS_DIFF (g_atomic_int_get (&cell->sequence), POS_ADD (pos, 1));
+
+      if (diff == 0)
+	{
+	  if (g_atomic_int_compare_and_exchange (&queue->dequeue_pos, 
+						 pos, POS_ADD (pos, 1)))
+	    break;
+	}
+      else if (diff < 0)
+	/* The producer of this round has not filled the cell yet */
+	return NULL;
+
+      pos = g_atomic_int_get (&queue->dequeue_pos);
+    }
+
+  retval = cell->data;
+  /* Hands the cell to the producer of the next round, sequence is
+   * pos + 1 here */
+  g_atomic_int_add (&cell->sequence, queue->cell_mask);
+
+  return retval;
+}
+
+static void
+g_async_queue_ring_push_and_wake (GAsyncQueue *queue,
+				  gpointer     data,
+				  gboolean     locked)
+{
+  while (!g_async_queue_ring_push (queue, data))
+    {
+      if (locked)
+	{
+	  /* Consumers might be blocked on the lock, let them drain
+	   * the ring */
+	  g_mutex_unlock (queue->mutex);
+	  g_thread_yield ();
+	  g_mutex_lock (queue->mutex);
+	}
+      else
+	g_thread_yield ();
+    }
+
+  /* Consumers increment waiting_threads before they check the ring
+   * for the last time and go to sleep, both under the lock, so this
+   * can't miss a consumer, that is about to wait */
+  if (g_atomic_int_get (&queue->waiting_threads) > 0)
+    {
+      if (locked)
+	g_cond_signal (queue->cond);
+      else
+	{
+	  g_mutex_lock (queue->mutex);
+	  g_cond_signal (queue->cond);
+	  g_mutex_unlock (queue->mutex);
+	}
+    }
+}
+
 /**
  * g_async_queue_ref:
  * @queue: a #GAsyncQueue.
@@ -121,6 +302,7 @@ g_async_queue_unref_and_unlock (GAsyncQueue *queue)
       g_mutex_free (queue->mutex);
       g_cond_free (queue->cond);
       g_queue_free (queue->queue);
+      g_free (queue->cells);
       g_free (queue);
     }
 }
@@ -190,6 +372,12 @@ g_async_queue_push (GAsyncQueue* queue, gpointer data)
   g_return_if_fail (queue->ref_count > 0);
   g_return_if_fail (data);
 
+  if (G_ASYNC_QUEUE_IS_BOUNDED (queue))
+    {
+      g_async_queue_ring_push_and_wake (queue, data, FALSE);
+      return;
+    }
+
   g_mutex_lock (queue->mutex);
   g_async_queue_push_unlocked (queue, data);
   g_mutex_unlock (queue->mutex);
@@ -201,7 +389,9 @@ g_async_queue_push (GAsyncQueue* queue, gpointer data)
  * @data: @data to push into the @queue.
  * 
  * Pushes the @data into the @queue. @data must not be %NULL. This
- * function must be called while holding the @queue's lock.
+ * function must be called while holding the @queue's lock. If a
+ * bounded @queue is full, the lock is released while waiting for
+ * room.
  **/
 void
 g_async_queue_push_unlocked (GAsyncQueue* queue, gpointer data)
@@ -210,6 +400,12 @@ g_async_queue_push_unlocked (GAsyncQueue* queue, gpointer data)
   g_return_if_fail (queue->ref_count > 0);
   g_return_if_fail (data);
 
+  if (G_ASYNC_QUEUE_IS_BOUNDED (queue))
+    {
+      g_async_queue_ring_push_and_wake (queue, data, TRUE);
+      return;
+    }
+
   g_queue_push_head (queue->queue, data);
   g_cond_signal (queue->cond);
 }
@@ -220,6 +416,28 @@ g_async_queue_pop_intern_unlocked (GAsyncQueue* queue, gboolean try,
 {
   gpointer retval;
 
+  if (G_ASYNC_QUEUE_IS_BOUNDED (queue))
+    {
+      retval = g_async_queue_ring_pop (queue);
+      if (retval || try)
+	return retval;
+
+      g_atomic_int_add (&queue->waiting_threads, 1);
+      while (!(retval = g_async_queue_ring_pop (queue)))
+	{
+	  if (!end_time)
+	    g_cond_wait (queue->cond, queue->mutex);
+	  else if (!g_cond_timed_wait (queue->cond, queue->mutex, end_time))
+	    {
+	      retval = g_async_queue_ring_pop (queue);
+	      break;
+	    }
+	}
+      g_atomic_int_add (&queue->waiting_threads, -1);
+
+      return retval;
+    }
+
   if (!g_queue_peek_tail (queue->queue))
     {
       if (try)
@@ -267,6 +485,13 @@ g_async_queue_pop (GAsyncQueue* queue)
   g_return_val_if_fail (queue, NULL);
   g_return_val_if_fail (queue->ref_count > 0, NULL);
 
+  if (G_ASYNC_QUEUE_IS_BOUNDED (queue))
+    {
+      retval = g_async_queue_ring_pop (queue);
+      if (retval)
+	return retval;
+    }
+
   g_mutex_lock (queue->mutex);
   retval = g_async_queue_pop_intern_unlocked (queue, FALSE, NULL);
   g_mutex_unlock (queue->mutex);
@@ -311,6 +536,9 @@ g_async_queue_try_pop (GAsyncQueue* queue)
   g_return_val_if_fail (queue, NULL);
   g_return_val_if_fail (queue->ref_count > 0, NULL);
 
+  if (G_ASYNC_QUEUE_IS_BOUNDED (queue))
+    return g_async_queue_ring_pop (queue);
+
   g_mutex_lock (queue->mutex);
   retval = g_async_queue_pop_intern_unlocked (queue, TRUE, NULL);
   g_mutex_unlock (queue->mutex);
@@ -360,6 +588,13 @@ g_async_queue_timed_pop (GAsyncQueue* queue, GTimeVal *end_time)
   g_return_val_if_fail (queue, NULL);
   g_return_val_if_fail (queue->ref_count > 0, NULL);
 
+  if (G_ASYNC_QUEUE_IS_BOUNDED (queue))
+    {
+      retval = g_async_queue_ring_pop (queue);
+      if (retval)
+	return retval;
+    }
+
   g_mutex_lock (queue->mutex);
   retval = g_async_queue_pop_intern_unlocked (queue, FALSE, end_time);
   g_mutex_unlock (queue->mutex);
@@ -413,6 +648,9 @@ g_async_queue_length (GAsyncQueue* queue)
   g_return_val_if_fail (queue, 0);
   g_return_val_if_fail (queue->ref_count > 0, 0);
 
+  if (G_ASYNC_QUEUE_IS_BOUNDED (queue))
+    return g_async_queue_length_unlocked (queue);
+
   g_mutex_lock (queue->mutex);
   retval = queue->queue->length - queue->waiting_threads;
   g_mutex_unlock (queue->mutex);
@@ -441,6 +679,15 @@ g_async_queue_length_unlocked (GAsyncQueue* queue)
   g_return_val_if_fail (queue, 0);
   g_return_val_if_fail (queue->ref_count > 0, 0);
 
+  if (G_ASYNC_QUEUE_IS_BOUNDED (queue))
+    {
+      gint dequeue_pos = g_atomic_int_get (&queue->dequeue_pos);
+      gint enqueue_pos = g_atomic_int_get (&queue->enqueue_pos);
+
+      return POS_DIFF (enqueue_pos, dequeue_pos) - 
+	g_atomic_int_get (&queue->waiting_threads);
+    }
+
   return queue->queue->length - queue->waiting_threads;
 }
 
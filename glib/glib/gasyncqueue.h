@@ -39,6 +39,10 @@ typedef struct _GAsyncQueue     GAsyncQueue;
 /* Get a new GAsyncQueue with the ref_count 1 */
 GAsyncQueue*  g_async_queue_new                (void);
 
+/* Get a new GAsyncQueue, that holds at most max_length entries. Pushing
+ * and popping available entries doesn't take the queue's lock. */
+GAsyncQueue*  g_async_queue_new_bounded        (guint        max_length);
+
 /* Lock and unlock a GAsyncQueue. All functions lock the queue for
  * themselves, but in certain cirumstances you want to hold the lock longer,
  * thus you lock the queue, call the *_unlocked functions and unlock it again.
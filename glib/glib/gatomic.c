@@ -0,0 +1,209 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * gatomic.c: atomic integer and pointer operations
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include "glib.h"
+
+#ifdef G_OS_WIN32
+#include <windows.h>
+#endif
+
+#if defined (__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+/* gcc provides full barrier atomic builtins */
+#  define G_ATOMIC_USE_GCC_BUILTINS
+#elif defined (G_OS_WIN32)
+#  define G_ATOMIC_USE_INTERLOCKED
+#else
+/* everything else goes through a global lock */
+#  define G_ATOMIC_USE_LOCK
+#endif
+
+#ifdef G_ATOMIC_USE_LOCK
+G_LOCK_DEFINE_STATIC (g_atomic);
+#endif
+
+/**
+ * g_atomic_int_exchange_and_add:
+ * @atomic: a pointer to an integer
+ * @val: the value to add to *@atomic
+ *
+ * Atomically adds @val to the integer pointed to by @atomic.
+ *
+ * Return value: the value of *@atomic before the addition.
+ **/
+gint
+g_atomic_int_exchange_and_add (gint *atomic,
+			       gint  val)
+{
+#if defined (G_ATOMIC_USE_GCC_BUILTINS)
+  return __sync_fetch_and_add (atomic, val);
+#elif defined (G_ATOMIC_USE_INTERLOCKED)
+  return InterlockedExchangeAdd ((LONG volatile *) atomic, val);
+#else
+  gint result;
+
+  G_LOCK (g_atomic);
+  result = *atomic;
+  *atomic += val;
+  G_UNLOCK (g_atomic);
+
+  return result;
+#endif
+}
+
+/**
+ * g_atomic_int_add:
+ * @atomic: a pointer to an integer
+ * @val: the value to add to *@atomic
+ *
+ * Atomically adds @val to the integer pointed to by @atomic.
+ **/
+void
+g_atomic_int_add (gint *atomic,
+		  gint  val)
+{
+  g_atomic_int_exchange_and_add (atomic, val);
+}
+
+/**
+ * g_atomic_int_compare_and_exchange:
+ * @atomic: a pointer to an integer
+ * @oldval: the assumed old value of *@atomic
+ * @newval: the new value of *@atomic
+ *
+ * Compares @oldval with the integer pointed to by @atomic and, if
+ * they are equal, atomically exchanges *@atomic with @newval.
+ *
+ * Return value: %TRUE, if *@atomic was equal to @oldval.
+ **/
+gboolean
+g_atomic_int_compare_and_exchange (gint *atomic,
+				   gint  oldval,
+				   gint  newval)
+{
+#if defined (G_ATOMIC_USE_GCC_BUILTINS)
+  return __sync_bool_compare_and_swap (atomic, oldval, newval);
+#elif defined (G_ATOMIC_USE_INTERLOCKED)
+  return InterlockedCompareExchange ((LONG volatile *) atomic,
+				     newval, oldval) == oldval;
+#else
+  gboolean result;
+
+  G_LOCK (g_atomic);
+  result = *atomic == oldval;
+  if (result)
+    *atomic = newval;
+  G_UNLOCK (g_atomic);
+
+  return result;
+#endif
+}
+
+/**
+ * g_atomic_pointer_compare_and_exchange:
+ * @atomic: a pointer to a #gpointer
+ * @oldval: the assumed old value of *@atomic
+ * @newval: the new value of *@atomic
+ *
+ * Compares @oldval with the pointer pointed to by @atomic and, if
+ * they are equal, atomically exchanges *@atomic with @newval.
+ *
+ * Return value: %TRUE, if *@atomic was equal to @oldval.
+ **/
+gboolean
+g_atomic_pointer_compare_and_exchange (gpointer *atomic,
+				       gpointer  oldval,
+				       gpointer  newval)
+{
+#if defined (G_ATOMIC_USE_GCC_BUILTINS)
+  return __sync_bool_compare_and_swap (atomic, oldval, newval);
+#elif defined (G_ATOMIC_USE_INTERLOCKED)
+  return InterlockedCompareExchangePointer (atomic, newval, oldval) == oldval;
+#else
+  gboolean result;
+
+  G_LOCK (g_atomic);
+  result = *atomic == oldval;
+  if (result)
+    *atomic = newval;
+  G_UNLOCK (g_atomic);
+
+  return result;
+#endif
+}
+
+/**
+ * g_atomic_int_get:
+ * @atomic: a pointer to an integer
+ *
+ * Reads the value of the integer pointed to by @atomic. Memory
+ * operations issued before this call are completed before the read.
+ *
+ * Return value: the value of *@atomic.
+ **/
+gint
+g_atomic_int_get (gint *atomic)
+{
+#if defined (G_ATOMIC_USE_GCC_BUILTINS)
+  __sync_synchronize ();
+  return *(volatile gint *) atomic;
+#elif defined (G_ATOMIC_USE_INTERLOCKED)
+  return InterlockedExchangeAdd ((LONG volatile *) atomic, 0);
+#else
+  gint result;
+
+  G_LOCK (g_atomic);
+  result = *atomic;
+  G_UNLOCK (g_atomic);
+
+  return result;
+#endif
+}
+
+/**
+ * g_atomic_pointer_get:
+ * @atomic: a pointer to a #gpointer
+ *
+ * Reads the value of the pointer pointed to by @atomic. Memory
+ * operations issued before this call are completed before the read.
+ *
+ * Return value: the value of *@atomic.
+ **/
+gpointer
+g_atomic_pointer_get (gpointer *atomic)
+{
+#if defined (G_ATOMIC_USE_GCC_BUILTINS)
+  __sync_synchronize ();
+  return *(gpointer volatile *) atomic;
+#elif defined (G_ATOMIC_USE_INTERLOCKED)
+  return InterlockedCompareExchangePointer (atomic, NULL, NULL);
+#else
+  gpointer result;
+
+  G_LOCK (g_atomic);
+  result = *atomic;
+  G_UNLOCK (g_atomic);
+
+  return result;
+#endif
+}
@@ -0,0 +1,51 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * gatomic.h: atomic integer and pointer operations
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __G_ATOMIC_H__
+#define __G_ATOMIC_H__
+
+#include <glib/gtypes.h>
+
+G_BEGIN_DECLS
+
+/* All operations imply a full memory barrier. Where the compiler or
+ * the platform provides no atomic primitives, they are emulated with
+ * a global lock. */
+gint     g_atomic_int_exchange_and_add         (gint     *atomic,
+						gint      val);
+void     g_atomic_int_add                      (gint     *atomic,
+						gint      val);
+gboolean g_atomic_int_compare_and_exchange     (gint     *atomic,
+						gint      oldval,
+						gint      newval);
+gboolean g_atomic_pointer_compare_and_exchange (gpointer *atomic,
+						gpointer  oldval,
+						gpointer  newval);
+gint     g_atomic_int_get                      (gint     *atomic);
+gpointer g_atomic_pointer_get                  (gpointer *atomic);
+
+#define g_atomic_int_inc(atomic) (g_atomic_int_add ((atomic), 1))
+#define g_atomic_int_dec_and_test(atomic)				\
+  (g_atomic_int_exchange_and_add ((atomic), -1) == 1)
+
+G_END_DECLS
+
+#endif /* __G_ATOMIC_H__ */
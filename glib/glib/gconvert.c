@@ -91,6 +91,305 @@ try_to_aliases (const char **to_aliases,
 
 extern const char **_g_charset_get_aliases (const char *canonical_name);
 
+/* Built-in converters between the most common charsets. They are
+ * stateless, so every pair of charsets has a single static converter
+ * that can be shared freely; converters are told apart from iconv
+ * descriptors by their address. Everything else goes through iconv.
+ */
+typedef enum
+{
+  BUILTIN_ASCII,
+  BUILTIN_LATIN1,
+  BUILTIN_CP1252,
+  BUILTIN_UTF8,
+  N_BUILTIN_CHARSETS
+} BuiltinCharset;
+
+typedef struct
+{
+  guint8 from;
+  guint8 to;
+} BuiltinConverter;
+
+#define BC(from)	{ from, BUILTIN_ASCII }, { from, BUILTIN_LATIN1 }, \
+			{ from, BUILTIN_CP1252 }, { from, BUILTIN_UTF8 }
+static const BuiltinConverter builtin_converters[N_BUILTIN_CHARSETS * N_BUILTIN_CHARSETS] = {
+  BC (BUILTIN_ASCII), BC (BUILTIN_LATIN1), BC (BUILTIN_CP1252), BC (BUILTIN_UTF8)
+};
+#undef BC
+
+#define IS_BUILTIN_CONVERTER(cd) \
+  ((const BuiltinConverter*) (cd) >= builtin_converters && \
+   (const BuiltinConverter*) (cd) < builtin_converters + G_N_ELEMENTS (builtin_converters))
+
+static const struct {
+  const gchar   *name;		/* uppercase, without '-' and '_' */
+  BuiltinCharset charset;
+} builtin_charset_names[] = {
+  { "UTF8",		BUILTIN_UTF8 },
+  { "ISO88591",		BUILTIN_LATIN1 },
+  { "LATIN1",		BUILTIN_LATIN1 },
+  { "L1",		BUILTIN_LATIN1 },
+  { "CP819",		BUILTIN_LATIN1 },
+  { "IBM819",		BUILTIN_LATIN1 },
+  { "CP1252",		BUILTIN_CP1252 },
+  { "WINDOWS1252",	BUILTIN_CP1252 },
+  { "MSANSI",		BUILTIN_CP1252 },
+  { "ASCII",		BUILTIN_ASCII },
+  { "USASCII",		BUILTIN_ASCII },
+  { "ANSIX3.41968",	BUILTIN_ASCII },
+};
+
+/* 0x80 - 0x9f of CP1252, 0 marks the unassigned positions */
+static const guint16 cp1252_to_unicode[32] = {
+  0x20ac, 0,      0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021,
+  0x02c6, 0x2030, 0x0160, 0x2039, 0x0152, 0,      0x017d, 0,
+  0,      0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+  0x02dc, 0x2122, 0x0161, 0x203a, 0x0153, 0,      0x017e, 0x0178
+};
+
+static gint
+builtin_charset_lookup (const gchar *codeset)
+{
+  gchar name[16];
+  guint i, n = 0;
+
+  for (; *codeset; codeset++)
+    {
+      if (*codeset == '-' || *codeset == '_')
+	continue;
+      if (n >= sizeof (name) - 1)
+	return -1;
+      name[n++] = g_ascii_toupper (*codeset);
+    }
+  name[n] = 0;
+
+  for (i = 0; i < G_N_ELEMENTS (builtin_charset_names); i++)
+    if (strcmp (name, builtin_charset_names[i].name) == 0)
+      return builtin_charset_names[i].charset;
+
+  return -1;
+}
+
+static GIConv
+builtin_converter_open (const gchar *to_codeset,
+			const gchar *from_codeset)
+{
+  gint to = builtin_charset_lookup (to_codeset);
+  gint from = to < 0 ? -1 : builtin_charset_lookup (from_codeset);
+
+  if (from < 0)
+    return (GIConv) -1;
+
+  return (GIConv) &builtin_converters[from * N_BUILTIN_CHARSETS + to];
+}
+
+/* Like iconv, this accepts noncharacters but no surrogates, overlong
+ * forms or values beyond U+10FFFF. Returns (gunichar) -2 for a
+ * truncated and (gunichar) -1 for an invalid sequence.
+ */
+static gunichar
+builtin_utf8_decode (const guchar *p,
+		     gsize         max_len,
+		     guint        *len)
+{
+  gunichar c, min;
+  guint i, n;
+
+  if (*p < 0xc2)
+    return (gunichar) -1;
+  else if (*p < 0xe0)
+    {
+      n = 2;
+      c = *p & 0x1f;
+      min = 0x80;
+    }
+  else if (*p < 0xf0)
+    {
+      n = 3;
+      c = *p & 0x0f;
+      min = 0x800;
+    }
+  else if (*p < 0xf8)
+    {
+      n = 4;
+      c = *p & 0x07;
+      min = 0x10000;
+    }
+  else if (*p < 0xfe)
+    {
+      /* obsolete 5 and 6 byte forms, always beyond U+10FFFF
+       * but like iconv, tell truncated ones apart
+       */
+      n = *p < 0xfc ? 5 : 6;
+      c = 0;
+      min = 0;
+    }
+  else
+    return (gunichar) -1;
+
+  for (i = 1; i < n; i++)
+    {
+      if (i >= max_len)
+	return (gunichar) -2;
+      if ((p[i] & 0xc0) != 0x80)
+	return (gunichar) -1;
+      c = (c << 6) | (p[i] & 0x3f);
+    }
+  if (n > 4 || c < min || c > 0x10ffff || (c & 0xfffff800) == 0xd800)
+    return (gunichar) -1;
+
+  *len = n;
+  return c;
+}
+
+/* Follows iconv() semantics: stops with EILSEQ in front of invalid or
+ * unconvertible input, with EINVAL in front of a truncated UTF-8
+ * sequence and with E2BIG in front of a character that doesn't fit.
+ */
+static size_t
+builtin_converter_convert (const BuiltinConverter *bc,
+			   gchar                 **inbuf,
+			   gsize                  *inbytes_left,
+			   gchar                 **outbuf,
+			   gsize                  *outbytes_left)
+{
+  const guchar *in, *in_end;
+  guchar *out, *out_end;
+  gint errnum = 0;
+
+  if (!inbuf || !*inbuf)
+    return 0;	/* reset, there's no shift state */
+
+  in = (const guchar*) *inbuf;
+  in_end = in + *inbytes_left;
+  out = (guchar*) *outbuf;
+  out_end = out + *outbytes_left;
+
+  while (in < in_end)
+    {
+      gunichar c;
+      guint in_len, out_len;
+      gchar utf8[6];
+
+      /* all of the builtin charsets are ASCII supersets */
+      if (*in < 0x80)
+	{
+	  const guchar *run_end = in + MIN (in_end - in, out_end - out);
+
+	  if (out == out_end)
+	    {
+	      errnum = E2BIG;
+	      break;
+	    }
+	  while (in < run_end && *in < 0x80)
+	    *out++ = *in++;
+	  continue;
+	}
+
+      /* decode */
+      in_len = 1;
+      switch (bc->from)
+	{
+	case BUILTIN_ASCII:
+	  errnum = EILSEQ;
+	  goto out;
+	case BUILTIN_LATIN1:
+	  c = *in;
+	  break;
+	case BUILTIN_CP1252:
+	  c = *in < 0xa0 ? cp1252_to_unicode[*in - 0x80] : *in;
+	  if (!c)
+	    {
+	      errnum = EILSEQ;
+	      goto out;
+	    }
+	  break;
+	default: /* BUILTIN_UTF8 */
+	  c = builtin_utf8_decode (in, in_end - in, &in_len);
+	  if (c == (gunichar) -2)
+	    {
+	      errnum = EINVAL;
+	      goto out;
+	    }
+	  if (c == (gunichar) -1)
+	    {
+	      errnum = EILSEQ;
+	      goto out;
+	    }
+	  break;
+	}
+
+      /* like iconv, check for space before checking if c is representable */
+      if (out == out_end)
+	{
+	  errnum = E2BIG;
+	  break;
+	}
+
+      /* encode */
+      switch (bc->to)
+	{
+	case BUILTIN_ASCII:
+	  errnum = EILSEQ;
+	  goto out;
+	case BUILTIN_LATIN1:
+	  if (c > 0xff)
+	    {
+	      errnum = EILSEQ;
+	      goto out;
+	    }
+	  utf8[0] = c;
+	  out_len = 1;
+	  break;
+	case BUILTIN_CP1252:
+	  if (c >= 0x80 && (c < 0xa0 || c > 0xff))
+	    {
+	      guint i;
+
+	      for (i = 0; i < G_N_ELEMENTS (cp1252_to_unicode); i++)
+		if (cp1252_to_unicode[i] == c && c)
+		  break;
+	      if (i == G_N_ELEMENTS (cp1252_to_unicode))
+		{
+		  errnum = EILSEQ;
+		  goto out;
+		}
+	      c = 0x80 + i;
+	    }
+	  utf8[0] = c;
+	  out_len = 1;
+	  break;
+	default: /* BUILTIN_UTF8 */
+	  out_len = g_unichar_to_utf8 (c, utf8);
+	  break;
+	}
+
+      if (out_len > (guint) (out_end - out))
+	{
+	  errnum = E2BIG;
+	  break;
+	}
+      memcpy (out, utf8, out_len);
+      out += out_len;
+      in += in_len;
+    }
+
+ out:
+  *inbytes_left = in_end - in;
+  *inbuf = (gchar*) in;
+  *outbytes_left = out_end - out;
+  *outbuf = (gchar*) out;
+
+  if (errnum)
+    {
+      errno = errnum;
+      return (size_t) -1;
+    }
+
+  return 0;
+}
+
 /**
  * g_iconv_open:
  * @to_codeset: destination codeset
@@ -102,6 +401,10 @@ extern const char **_g_charset_get_aliases (const char *canonical_name);
  * 
  * GLib provides g_convert() and g_locale_to_utf8() which are likely
  * more convenient than the raw iconv wrappers.
+ *
+ * Conversions between ASCII, ISO-8859-1, CP1252 and UTF-8 are done
+ * by GLib itself without involving iconv, so the returned descriptor
+ * must only be used with g_iconv() and g_iconv_close().
  * 
  * Return value: a "conversion descriptor", or (GIConv)-1 if
  *  opening the converter failed.
@@ -111,6 +414,11 @@ g_iconv_open (const gchar  *to_codeset,
 	      const gchar  *from_codeset)
 {
   iconv_t cd;
+  GIConv builtin;
+
+  builtin = builtin_converter_open (to_codeset, from_codeset);
+  if (builtin != (GIConv) -1)
+    return builtin;
   
   if (!try_conversion (to_codeset, from_codeset, &cd))
     {
@@ -166,6 +474,10 @@ g_iconv (GIConv   converter,
 {
   iconv_t cd = (iconv_t)converter;
 
+  if (IS_BUILTIN_CONVERTER (converter))
+    return builtin_converter_convert ((const BuiltinConverter*) converter,
+				      inbuf, inbytes_left, outbuf, outbytes_left);
+
   return iconv (cd, inbuf, inbytes_left, outbuf, outbytes_left);
 }
 
@@ -189,6 +501,9 @@ g_iconv_close (GIConv converter)
 {
   iconv_t cd = (iconv_t)converter;
 
+  if (IS_BUILTIN_CONVERTER (converter))
+    return 0;
+
   return iconv_close (cd);
 }
 
@@ -336,6 +651,11 @@ open_converter (const gchar *to_codeset,
   struct _iconv_cache_bucket *bucket;
   gchar *key;
   GIConv cd;
+
+  /* builtin converters are shared, they don't need caching */
+  cd = builtin_converter_open (to_codeset, from_codeset);
+  if (cd != (GIConv) -1)
+    return cd;
   
   /* create our key */
   key = g_alloca (strlen (from_codeset) + strlen (to_codeset) + 2);
@@ -417,7 +737,7 @@ close_converter (GIConv converter)
   
   cd = converter;
   
-  if (cd == (GIConv) -1)
+  if (cd == (GIConv) -1 || IS_BUILTIN_CONVERTER (cd))
     return 0;
   
   G_LOCK (iconv_cache_lock);
@@ -40,6 +40,7 @@
 
 /* --- defines --- */
 #define	G_QUARK_BLOCK_SIZE			(512)
+#define	G_QUARK_ARENA_SIZE			(4096)
 #define	G_DATA_MEM_CHUNK_PREALLOC		(128)
 #define	G_DATA_CACHE_MAX			(512)
 #define	G_DATASET_MEM_CHUNK_PREALLOC		(32)
@@ -61,6 +62,21 @@ struct _GDataset
   GData        *datalist;
 };
 
+typedef struct _GQuarkSlot GQuarkSlot;
+typedef struct _GQuarkTable GQuarkTable;
+struct _GQuarkSlot
+{
+  gchar  *string;		/* set last, NULL for free slots */
+  guint   hash;
+  GQuark  quark;
+};
+
+struct _GQuarkTable
+{
+  guint      mask;
+  GQuarkSlot slots[1];
+};
+
 
 /* --- prototypes --- */
 static inline GDataset*	g_dataset_lookup		(gconstpointer	  dataset_location);
@@ -72,7 +88,8 @@ static inline gpointer	g_data_set_internal		(GData     	**datalist,
 							 GDestroyNotify   destroy_func,
 							 GDataset	 *dataset);
 static void		g_data_initialize		(void);
-static inline GQuark	g_quark_new			(gchar  	*string);
+static inline GQuark	g_quark_new			(gchar  	*string,
+							 guint		  hash);
 
 
 /* --- variables --- */
@@ -85,10 +102,19 @@ static GMemChunk    *g_data_mem_chunk = NULL;
 static GData	    *g_data_cache = NULL;
 static guint	     g_data_cache_length = 0;
 
+/* Quarks are looked up without taking g_quark_global. Entries are
+ * only ever added, and the quark table and string array are never
+ * freed when they get replaced by larger copies, so readers holding
+ * an old pointer still see consistent data. Quark strings are copied
+ * into a string arena.
+ */
 G_LOCK_DEFINE_STATIC (g_quark_global);
-static GHashTable   *g_quark_ht = NULL;
+static GQuarkTable  *g_quark_table = NULL;
 static gchar       **g_quarks = NULL;
 static GQuark        g_quark_seq_id = 0;
+static guint         g_quarks_size = 0;
+static gchar        *g_quark_arena = NULL;
+static gsize         g_quark_arena_left = 0;
 
 
 /* --- functions --- */
@@ -543,40 +569,79 @@ g_data_initialize (void)
 		     G_ALLOC_AND_FREE);
 }
 
+static GQuark
+g_quark_lookup (const gchar *string,
+		guint        hash)
+{
+  GQuarkTable *table = g_atomic_pointer_get ((gpointer*) &g_quark_table);
+  guint i;
+
+  if (!table)
+    return 0;
+
+  for (i = hash & table->mask; ; i = (i + 1) & table->mask)
+    {
+      GQuarkSlot *slot = &table->slots[i];
+      gchar *slot_string = g_atomic_pointer_get ((gpointer*) &slot->string);
+
+      if (!slot_string)
+	return 0;
+      if (slot->hash == hash && strcmp (slot_string, string) == 0)
+	return slot->quark;
+    }
+}
+
 GQuark
 g_quark_try_string (const gchar *string)
 {
-  GQuark quark = 0;
   g_return_val_if_fail (string != NULL, 0);
   
-  G_LOCK (g_quark_global);
-  if (g_quark_ht)
-    quark = GPOINTER_TO_UINT (g_hash_table_lookup (g_quark_ht, string));
-  G_UNLOCK (g_quark_global);
-  
-  return quark;
+  return g_quark_lookup (string, g_str_hash (string));
+}
+
+/* HOLDS: g_quark_global_lock */
+static gchar*
+g_quark_arena_strdup (const gchar *string)
+{
+  gsize length = strlen (string) + 1;
+  gchar *copy;
+
+  if (length > G_QUARK_ARENA_SIZE / 4)
+    return g_strdup (string);
+
+  if (length > g_quark_arena_left)
+    {
+      g_quark_arena = g_malloc (G_QUARK_ARENA_SIZE);
+      g_quark_arena_left = G_QUARK_ARENA_SIZE;
+    }
+
+  copy = g_quark_arena;
+  memcpy (copy, string, length);
+  g_quark_arena += length;
+  g_quark_arena_left -= length;
+
+  return copy;
 }
 
 GQuark
 g_quark_from_string (const gchar *string)
 {
   GQuark quark;
+  guint hash;
   
   g_return_val_if_fail (string != NULL, 0);
   
-  G_LOCK (g_quark_global);
-  if (g_quark_ht)
-    quark = (gulong) g_hash_table_lookup (g_quark_ht, string);
-  else
+  hash = g_str_hash (string);
+  quark = g_quark_lookup (string, hash);
+  if (!quark)
     {
-      g_quark_ht = g_hash_table_new (g_str_hash, g_str_equal);
-      quark = 0;
+      G_LOCK (g_quark_global);
+      quark = g_quark_lookup (string, hash);
+      if (!quark)
+	quark = g_quark_new (g_quark_arena_strdup (string), hash);
+      G_UNLOCK (g_quark_global);
     }
   
-  if (!quark)
-    quark = g_quark_new (g_strdup (string));
-  G_UNLOCK (g_quark_global);
-  
   return quark;
 }
 
@@ -584,21 +649,20 @@ GQuark
 g_quark_from_static_string (const gchar *string)
 {
   GQuark quark;
+  guint hash;
   
   g_return_val_if_fail (string != NULL, 0);
   
-  G_LOCK (g_quark_global);
-  if (g_quark_ht)
-    quark = (gulong) g_hash_table_lookup (g_quark_ht, string);
-  else
+  hash = g_str_hash (string);
+  quark = g_quark_lookup (string, hash);
+  if (!quark)
     {
-      g_quark_ht = g_hash_table_new (g_str_hash, g_str_equal);
-      quark = 0;
+      G_LOCK (g_quark_global);
+      quark = g_quark_lookup (string, hash);
+      if (!quark)
+	quark = g_quark_new ((gchar*) string, hash);
+      G_UNLOCK (g_quark_global);
     }
-
-  if (!quark)
-    quark = g_quark_new ((gchar*) string);
-  G_UNLOCK (g_quark_global);
  
   return quark;
 }
@@ -607,27 +671,86 @@ G_CONST_RETURN gchar*
 g_quark_to_string (GQuark quark)
 {
   gchar* result = NULL;
-  G_LOCK (g_quark_global);
-  if (quark > 0 && quark <= g_quark_seq_id)
-    result = g_quarks[quark - 1];
-  G_UNLOCK (g_quark_global);
+
+  if (quark > 0 && quark <= (GQuark) g_atomic_int_get ((gint*) &g_quark_seq_id))
+    {
+      gchar **quarks = g_atomic_pointer_get ((gpointer*) &g_quarks);
+
+      result = quarks[quark - 1];
+    }
 
   return result;
 }
 
+/* HOLDS: g_quark_global_lock */
+static void
+g_quark_table_insert (GQuarkTable *table,
+		      gchar       *string,
+		      guint        hash,
+		      GQuark       quark)
+{
+  guint i = hash & table->mask;
+
+  while (table->slots[i].string)
+    i = (i + 1) & table->mask;
+
+  table->slots[i].hash = hash;
+  table->slots[i].quark = quark;
+  /* publishes the slot, after hash and quark are visible */
+  g_atomic_pointer_compare_and_exchange ((gpointer*) &table->slots[i].string,
+					 NULL, string);
+}
+
+/* HOLDS: g_quark_global_lock */
+static void
+g_quark_table_resize (void)
+{
+  GQuarkTable *table;
+  guint size = g_quark_table ? (g_quark_table->mask + 1) * 2 : G_QUARK_BLOCK_SIZE;
+  GQuark quark;
+
+  table = g_malloc0 (sizeof (GQuarkTable) + (size - 1) * sizeof (GQuarkSlot));
+  table->mask = size - 1;
+  for (quark = 1; quark <= g_quark_seq_id; quark++)
+    g_quark_table_insert (table, g_quarks[quark - 1],
+			  g_str_hash (g_quarks[quark - 1]), quark);
+
+  /* the old table stays around for readers still using it */
+  g_atomic_pointer_compare_and_exchange ((gpointer*) &g_quark_table,
+					 g_quark_table, table);
+}
+
 /* HOLDS: g_quark_global_lock */
 static inline GQuark
-g_quark_new (gchar *string)
+g_quark_new (gchar *string,
+	     guint  hash)
 {
   GQuark quark;
   
-  if (g_quark_seq_id % G_QUARK_BLOCK_SIZE == 0)
-    g_quarks = g_renew (gchar*, g_quarks, g_quark_seq_id + G_QUARK_BLOCK_SIZE);
+  if (g_quark_seq_id == g_quarks_size)
+    {
+      guint size = g_quarks_size ? g_quarks_size * 2 : G_QUARK_BLOCK_SIZE;
+      gchar **quarks = g_new (gchar*, size);
+
+      if (g_quark_seq_id)
+	memcpy (quarks, g_quarks, g_quark_seq_id * sizeof (gchar*));
+      /* the old array stays around for readers still using it */
+      g_atomic_pointer_compare_and_exchange ((gpointer*) &g_quarks,
+					     g_quarks, quarks);
+      g_quarks_size = size;
+    }
+
+  /* keep the table at most half full */
+  if (!g_quark_table || (g_quark_seq_id + 1) * 2 > g_quark_table->mask + 1)
+    g_quark_table_resize ();
   
   g_quarks[g_quark_seq_id] = string;
-  g_quark_seq_id++;
+  g_atomic_int_add ((gint*) &g_quark_seq_id, 1);
   quark = g_quark_seq_id;
-  g_hash_table_insert (g_quark_ht, string, GUINT_TO_POINTER (quark));
+
+  /* only now that g_quark_to_string() knows the quark, let lookups
+   * find it */
+  g_quark_table_insert (g_quark_table, string, hash, quark);
   
   return quark;
 }
@@ -33,8 +33,23 @@
 #include "glib.h"
 
 
-#define HASH_TABLE_MIN_SIZE 11
-#define HASH_TABLE_MAX_SIZE 13845163
+/* notes on the implementation:
+ * the table is a flat array of nodes using open addressing with
+ * linear probing. the size is always a power of two, the slot of a
+ * key is picked from its (scrambled) hash value. every node caches
+ * the hash value of its key, so probing only calls key_equal_func on
+ * hash matches, and resizing never calls hash_func again.
+ * a key_hash of 0 marks an unused slot and 1 marks a node removed by
+ * g_hash_table_foreach_remove(), real hash values are remapped to
+ * 2 or above. removal shifts the following nodes of the probe
+ * sequence back, so no tombstones are left in the table.
+ */
+#define HASH_TABLE_MIN_SHIFT 3	/* 1 << 3 == 8 slots */
+#define HASH_TABLE_MAX_SHIFT 30
+
+#define UNUSED_HASH_VALUE    0
+#define REMOVED_HASH_VALUE   1
+#define HASH_IS_REAL(h)      ((h) >= 2)
 
 
 typedef struct _GHashNode      GHashNode;
@@ -43,53 +58,47 @@ struct _GHashNode
 {
   gpointer   key;
   gpointer   value;
-  GHashNode *next;
+  guint      key_hash;
 };
 
 struct _GHashTable
 {
   gint             size;
+  gint             shift;
   gint             nnodes;
-  GHashNode      **nodes;
+  GHashNode       *nodes;
   GHashFunc        hash_func;
   GEqualFunc       key_equal_func;
   GDestroyNotify   key_destroy_func;
   GDestroyNotify   value_destroy_func;
 };
 
+/* grow above 3/4 load, shrink below 1/8 load */
 #define G_HASH_TABLE_RESIZE(hash_table)				\
    G_STMT_START {						\
-     if ((hash_table->size >= 3 * hash_table->nnodes &&	        \
-	  hash_table->size > HASH_TABLE_MIN_SIZE) ||		\
-	 (3 * hash_table->size <= hash_table->nnodes &&	        \
-	  hash_table->size < HASH_TABLE_MAX_SIZE))		\
+     if ((hash_table->size > 8 * hash_table->nnodes &&	        \
+	  hash_table->shift > HASH_TABLE_MIN_SHIFT) ||		\
+	 (4 * hash_table->nnodes > 3 * hash_table->size &&	\
+	  hash_table->shift < HASH_TABLE_MAX_SHIFT))		\
 	   g_hash_table_resize (hash_table);			\
    } G_STMT_END
 
+#define G_HASH_TABLE_SLOT(hash_table, key_hash)			\
+   (((key_hash) * 2654435769U) >> (32 - (hash_table)->shift))
+
 static void		g_hash_table_resize	  (GHashTable	  *hash_table);
-static GHashNode**	g_hash_table_lookup_node  (GHashTable     *hash_table,
-                                                   gconstpointer   key);
-static GHashNode*	g_hash_node_new		  (gpointer	   key,
-                                                   gpointer        value);
-static void		g_hash_node_destroy	  (GHashNode	  *hash_node,
-                                                   GDestroyNotify  key_destroy_func,
-                                                   GDestroyNotify  value_destroy_func);
-static void		g_hash_nodes_destroy	  (GHashNode	  *hash_node,
-						  GDestroyNotify   key_destroy_func,
-						  GDestroyNotify   value_destroy_func);
+static GHashNode*	g_hash_table_lookup_node  (GHashTable     *hash_table,
+                                                   gconstpointer   key,
+                                                   guint          *hash_return);
+static void		g_hash_table_remove_node  (GHashTable     *hash_table,
+                                                   GHashNode      *node,
+                                                   gboolean        notify);
 static guint g_hash_table_foreach_remove_or_steal (GHashTable     *hash_table,
                                                    GHRFunc	   func,
                                                    gpointer	   user_data,
                                                    gboolean        notify);
 
 
-#ifndef DISABLE_MEM_POOLS
-G_LOCK_DEFINE_STATIC (g_hash_global);
-
-static GMemChunk *node_mem_chunk = NULL;
-static GHashNode *node_free_list = NULL;
-#endif
-
 /**
  * g_hash_table_new:
  * @hash_func: a function to create a hash value from a key.
@@ -140,19 +149,16 @@ g_hash_table_new_full (GHashFunc       hash_func,
 		       GDestroyNotify  value_destroy_func)
 {
   GHashTable *hash_table;
-  guint i;
   
   hash_table = g_new (GHashTable, 1);
-  hash_table->size               = HASH_TABLE_MIN_SIZE;
+  hash_table->shift              = HASH_TABLE_MIN_SHIFT;
+  hash_table->size               = 1 << hash_table->shift;
   hash_table->nnodes             = 0;
   hash_table->hash_func          = hash_func ? hash_func : g_direct_hash;
   hash_table->key_equal_func     = key_equal_func;
   hash_table->key_destroy_func   = key_destroy_func;
   hash_table->value_destroy_func = value_destroy_func;
-  hash_table->nodes              = g_new (GHashNode*, hash_table->size);
-  
-  for (i = 0; i < hash_table->size; i++)
-    hash_table->nodes[i] = NULL;
+  hash_table->nodes              = g_new0 (GHashNode, hash_table->size);
   
   return hash_table;
 }
@@ -170,27 +176,49 @@ g_hash_table_new_full (GHashFunc       hash_func,
 void
 g_hash_table_destroy (GHashTable *hash_table)
 {
-  guint i;
+  gint i;
   
   g_return_if_fail (hash_table != NULL);
   
-  for (i = 0; i < hash_table->size; i++)
-    g_hash_nodes_destroy (hash_table->nodes[i], 
-			  hash_table->key_destroy_func,
-			  hash_table->value_destroy_func);
+  if (hash_table->key_destroy_func || hash_table->value_destroy_func)
+    for (i = 0; i < hash_table->size; i++)
+      {
+	GHashNode *node = &hash_table->nodes[i];
+
+	if (!HASH_IS_REAL (node->key_hash))
+	  continue;
+	if (hash_table->key_destroy_func)
+	  hash_table->key_destroy_func (node->key);
+	if (hash_table->value_destroy_func)
+	  hash_table->value_destroy_func (node->value);
+      }
   
   g_free (hash_table->nodes);
   g_free (hash_table);
 }
 
-static inline GHashNode**
+/* returns the node holding @key, or the unused node at the end of
+ * its probe sequence if it isn't in the table. the hash value of
+ * @key is stored in @hash_return.
+ */
+static inline GHashNode*
 g_hash_table_lookup_node (GHashTable	*hash_table,
-			  gconstpointer	 key)
+			  gconstpointer	 key,
+			  guint         *hash_return)
 {
-  GHashNode **node;
+  GHashNode *node;
+  guint key_hash;
+  guint mask;
+  guint i;
   
-  node = &hash_table->nodes
-    [(* hash_table->hash_func) (key) % hash_table->size];
+  key_hash = (* hash_table->hash_func) (key);
+  if (!HASH_IS_REAL (key_hash))
+    key_hash = 2;
+  *hash_return = key_hash;
+
+  mask = hash_table->size - 1;
+  i = G_HASH_TABLE_SLOT (hash_table, key_hash);
+  node = &hash_table->nodes[i];
   
   /* Hash table lookup needs to be fast.
    *  We therefore remove the extra conditional of testing
@@ -198,11 +226,20 @@ g_hash_table_lookup_node (GHashTable	*hash_table,
    *  the inner loop.
    */
   if (hash_table->key_equal_func)
-    while (*node && !(*hash_table->key_equal_func) ((*node)->key, key))
-      node = &(*node)->next;
+    while (node->key_hash != UNUSED_HASH_VALUE &&
+	   (node->key_hash != key_hash ||
+	    !(*hash_table->key_equal_func) (node->key, key)))
+      {
+	i = (i + 1) & mask;
+	node = &hash_table->nodes[i];
+      }
   else
-    while (*node && (*node)->key != key)
-      node = &(*node)->next;
+    while (node->key_hash != UNUSED_HASH_VALUE &&
+	   (!HASH_IS_REAL (node->key_hash) || node->key != key))
+      {
+	i = (i + 1) & mask;
+	node = &hash_table->nodes[i];
+      }
   
   return node;
 }
@@ -221,12 +258,13 @@ g_hash_table_lookup (GHashTable	  *hash_table,
 		     gconstpointer key)
 {
   GHashNode *node;
+  guint key_hash;
   
   g_return_val_if_fail (hash_table != NULL, NULL);
   
-  node = *g_hash_table_lookup_node (hash_table, key);
+  node = g_hash_table_lookup_node (hash_table, key, &key_hash);
   
-  return node ? node->value : NULL;
+  return HASH_IS_REAL (node->key_hash) ? node->value : NULL;
 }
 
 /**
@@ -250,12 +288,13 @@ g_hash_table_lookup_extended (GHashTable    *hash_table,
 			      gpointer	    *value)
 {
   GHashNode *node;
+  guint key_hash;
   
   g_return_val_if_fail (hash_table != NULL, FALSE);
   
-  node = *g_hash_table_lookup_node (hash_table, lookup_key);
+  node = g_hash_table_lookup_node (hash_table, lookup_key, &key_hash);
   
-  if (node)
+  if (HASH_IS_REAL (node->key_hash))
     {
       if (orig_key)
 	*orig_key = node->key;
@@ -286,31 +325,37 @@ g_hash_table_insert (GHashTable *hash_table,
 		     gpointer	 key,
 		     gpointer	 value)
 {
-  GHashNode **node;
+  GHashNode *node;
+  guint key_hash;
   
   g_return_if_fail (hash_table != NULL);
   
-  node = g_hash_table_lookup_node (hash_table, key);
+  node = g_hash_table_lookup_node (hash_table, key, &key_hash);
   
-  if (*node)
+  if (HASH_IS_REAL (node->key_hash))
     {
+      gpointer old_value = node->value;
+
       /* do not reset node->key in this place, keeping
        * the old key is the intended behaviour. 
        * g_hash_table_replace() can be used instead.
        */
+      node->value = value;
 
-      /* free the passed key */
+      /* free the passed key and the old value once the node is
+       * updated, the notifiers may modify the table.
+       */
       if (hash_table->key_destroy_func)
 	hash_table->key_destroy_func (key);
       
       if (hash_table->value_destroy_func)
-	hash_table->value_destroy_func ((*node)->value);
-
-      (*node)->value = value;
+	hash_table->value_destroy_func (old_value);
     }
   else
     {
-      *node = g_hash_node_new (key, value);
+      node->key = key;
+      node->value = value;
+      node->key_hash = key_hash;
       hash_table->nnodes++;
       G_HASH_TABLE_RESIZE (hash_table);
     }
@@ -334,26 +379,32 @@ g_hash_table_replace (GHashTable *hash_table,
 		      gpointer	  key,
 		      gpointer	  value)
 {
-  GHashNode **node;
+  GHashNode *node;
+  guint key_hash;
   
   g_return_if_fail (hash_table != NULL);
   
-  node = g_hash_table_lookup_node (hash_table, key);
+  node = g_hash_table_lookup_node (hash_table, key, &key_hash);
   
-  if (*node)
+  if (HASH_IS_REAL (node->key_hash))
     {
+      gpointer old_key = node->key;
+      gpointer old_value = node->value;
+
+      node->key   = key;
+      node->value = value;
+
       if (hash_table->key_destroy_func)
-	hash_table->key_destroy_func ((*node)->key);
+	hash_table->key_destroy_func (old_key);
       
       if (hash_table->value_destroy_func)
-	hash_table->value_destroy_func ((*node)->value);
-
-      (*node)->key   = key;
-      (*node)->value = value;
+	hash_table->value_destroy_func (old_value);
     }
   else
     {
-      *node = g_hash_node_new (key, value);
+      node->key = key;
+      node->value = value;
+      node->key_hash = key_hash;
       hash_table->nnodes++;
       G_HASH_TABLE_RESIZE (hash_table);
     }
@@ -377,19 +428,15 @@ gboolean
 g_hash_table_remove (GHashTable	   *hash_table,
 		     gconstpointer  key)
 {
-  GHashNode **node, *dest;
+  GHashNode *node;
+  guint key_hash;
   
   g_return_val_if_fail (hash_table != NULL, FALSE);
   
-  node = g_hash_table_lookup_node (hash_table, key);
-  if (*node)
+  node = g_hash_table_lookup_node (hash_table, key, &key_hash);
+  if (HASH_IS_REAL (node->key_hash))
     {
-      dest = *node;
-      (*node) = dest->next;
-      g_hash_node_destroy (dest, 
-			   hash_table->key_destroy_func,
-			   hash_table->value_destroy_func);
-      hash_table->nnodes--;
+      g_hash_table_remove_node (hash_table, node, TRUE);
   
       G_HASH_TABLE_RESIZE (hash_table);
 
@@ -413,17 +460,15 @@ gboolean
 g_hash_table_steal (GHashTable    *hash_table,
                     gconstpointer  key)
 {
-  GHashNode **node, *dest;
+  GHashNode *node;
+  guint key_hash;
   
   g_return_val_if_fail (hash_table != NULL, FALSE);
   
-  node = g_hash_table_lookup_node (hash_table, key);
-  if (*node)
+  node = g_hash_table_lookup_node (hash_table, key, &key_hash);
+  if (HASH_IS_REAL (node->key_hash))
     {
-      dest = *node;
-      (*node) = dest->next;
-      g_hash_node_destroy (dest, NULL, NULL);
-      hash_table->nnodes--;
+      g_hash_table_remove_node (hash_table, node, FALSE);
   
       G_HASH_TABLE_RESIZE (hash_table);
 
@@ -481,51 +526,79 @@ g_hash_table_foreach_steal (GHashTable *hash_table,
   return g_hash_table_foreach_remove_or_steal (hash_table, func, user_data, FALSE);
 }
 
+/* removes @node and closes the gap in its probe sequence by moving
+ * back the following nodes which may not live behind it anymore.
+ * the destroy notifiers run last, so they may modify the table.
+ */
+static void
+g_hash_table_remove_node (GHashTable *hash_table,
+			  GHashNode  *node,
+			  gboolean    notify)
+{
+  GHashNode *nodes = hash_table->nodes;
+  guint mask = hash_table->size - 1;
+  gpointer key = node->key;
+  gpointer value = node->value;
+  guint i, j;
+
+  i = node - nodes;
+  for (j = (i + 1) & mask; nodes[j].key_hash != UNUSED_HASH_VALUE; j = (j + 1) & mask)
+    {
+      guint k = G_HASH_TABLE_SLOT (hash_table, nodes[j].key_hash);
+
+      /* nodes whose home slot is cyclically in (i, j] stay put */
+      if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+	continue;
+
+      nodes[i] = nodes[j];
+      i = j;
+    }
+
+  nodes[i].key = NULL;
+  nodes[i].value = NULL;
+  nodes[i].key_hash = UNUSED_HASH_VALUE;
+  hash_table->nnodes--;
+
+  if (notify && hash_table->key_destroy_func)
+    hash_table->key_destroy_func (key);
+  if (notify && hash_table->value_destroy_func)
+    hash_table->value_destroy_func (value);
+}
+
 static guint
 g_hash_table_foreach_remove_or_steal (GHashTable *hash_table,
                                       GHRFunc	  func,
                                       gpointer	  user_data,
                                       gboolean    notify)
 {
-  GHashNode *node, *prev;
-  guint i;
+  gint i;
   guint deleted = 0;
   
+  /* removed nodes are only marked during the walk, so the remaining
+   * nodes stay where they are and are visited exactly once. the
+   * table is compacted by rebuilding it afterwards.
+   */
   for (i = 0; i < hash_table->size; i++)
     {
-    restart:
-      
-      prev = NULL;
-      
-      for (node = hash_table->nodes[i]; node; prev = node, node = node->next)
+      GHashNode *node = &hash_table->nodes[i];
+
+      if (HASH_IS_REAL (node->key_hash) &&
+	  (* func) (node->key, node->value, user_data))
 	{
-	  if ((* func) (node->key, node->value, user_data))
-	    {
-	      deleted += 1;
-	      
-	      hash_table->nnodes -= 1;
-	      
-	      if (prev)
-		{
-		  prev->next = node->next;
-		  g_hash_node_destroy (node,
-				       notify ? hash_table->key_destroy_func : NULL,
-				       notify ? hash_table->value_destroy_func : NULL);
-		  node = prev;
-		}
-	      else
-		{
-		  hash_table->nodes[i] = node->next;
-		  g_hash_node_destroy (node,
-				       notify ? hash_table->key_destroy_func : NULL,
-				       notify ? hash_table->value_destroy_func : NULL);
-		  goto restart;
-		}
-	    }
+	  node->key_hash = REMOVED_HASH_VALUE;
+	  if (notify && hash_table->key_destroy_func)
+	    hash_table->key_destroy_func (node->key);
+	  if (notify && hash_table->value_destroy_func)
+	    hash_table->value_destroy_func (node->value);
+	  deleted += 1;
 	}
     }
   
-  G_HASH_TABLE_RESIZE (hash_table);
+  if (deleted)
+    {
+      hash_table->nnodes -= deleted;
+      g_hash_table_resize (hash_table);
+    }
   
   return deleted;
 }
@@ -555,8 +628,11 @@ g_hash_table_foreach (GHashTable *hash_table,
   g_return_if_fail (func != NULL);
   
   for (i = 0; i < hash_table->size; i++)
-    for (node = hash_table->nodes[i]; node; node = node->next)
-      (* func) (node->key, node->value, user_data);
+    {
+      node = &hash_table->nodes[i];
+      if (HASH_IS_REAL (node->key_hash))
+	(* func) (node->key, node->value, user_data);
+    }
 }
 
 /**
@@ -575,148 +651,44 @@ g_hash_table_size (GHashTable *hash_table)
   return hash_table->nnodes;
 }
 
+/* rebuilds the node array for the current number of nodes, this
+ * also drops nodes marked by g_hash_table_foreach_remove().
+ */
 static void
 g_hash_table_resize (GHashTable *hash_table)
 {
-  GHashNode **new_nodes;
-  GHashNode *node;
-  GHashNode *next;
-  guint hash_val;
+  GHashNode *new_nodes;
+  guint mask;
+  gint new_shift;
   gint new_size;
   gint i;
 
-  new_size = g_spaced_primes_closest (hash_table->nnodes);
-  new_size = CLAMP (new_size, HASH_TABLE_MIN_SIZE, HASH_TABLE_MAX_SIZE);
+  /* aim for a load of at most 1/2 after resizing */
+  new_shift = HASH_TABLE_MIN_SHIFT;
+  while (new_shift < HASH_TABLE_MAX_SHIFT &&
+	 (1 << new_shift) < 2 * hash_table->nnodes)
+    new_shift++;
+  new_size = 1 << new_shift;
+  mask = new_size - 1;
  
-  new_nodes = g_new0 (GHashNode*, new_size);
+  new_nodes = g_new0 (GHashNode, new_size);
+  hash_table->shift = new_shift;
   
   for (i = 0; i < hash_table->size; i++)
-    for (node = hash_table->nodes[i]; node; node = next)
-      {
-	next = node->next;
+    {
+      GHashNode *node = &hash_table->nodes[i];
+      guint j;
 
-	hash_val = (* hash_table->hash_func) (node->key) % new_size;
+      if (!HASH_IS_REAL (node->key_hash))
+	continue;
 
-	node->next = new_nodes[hash_val];
-	new_nodes[hash_val] = node;
-      }
+      j = G_HASH_TABLE_SLOT (hash_table, node->key_hash);
+      while (new_nodes[j].key_hash != UNUSED_HASH_VALUE)
+	j = (j + 1) & mask;
+      new_nodes[j] = *node;
+    }
   
   g_free (hash_table->nodes);
   hash_table->nodes = new_nodes;
   hash_table->size = new_size;
 }
-
-static GHashNode*
-g_hash_node_new (gpointer key,
-		 gpointer value)
-{
-  GHashNode *hash_node;
-  
-#ifdef DISABLE_MEM_POOLS
-  hash_node = g_new (GHashNode, 1);
-#else
-  G_LOCK (g_hash_global);
-  if (node_free_list)
-    {
-      hash_node = node_free_list;
-      node_free_list = node_free_list->next;
-    }
-  else
-    {
-      if (!node_mem_chunk)
-	node_mem_chunk = g_mem_chunk_new ("hash node mem chunk",
-					  sizeof (GHashNode),
-					  1024, G_ALLOC_ONLY);
-      
-      hash_node = g_chunk_new (GHashNode, node_mem_chunk);
-    }
-  G_UNLOCK (g_hash_global);
-#endif
-  
-  hash_node->key = key;
-  hash_node->value = value;
-  hash_node->next = NULL;
-  
-  return hash_node;
-}
-
-static void
-g_hash_node_destroy (GHashNode      *hash_node,
-		     GDestroyNotify  key_destroy_func,
-		     GDestroyNotify  value_destroy_func)
-{
-  if (key_destroy_func)
-    key_destroy_func (hash_node->key);
-  if (value_destroy_func)
-    value_destroy_func (hash_node->value);
-  
-#ifdef ENABLE_GC_FRIENDLY
-  hash_node->key = NULL;
-  hash_node->value = NULL;
-#endif /* ENABLE_GC_FRIENDLY */
-
-#ifdef DISABLE_MEM_POOLS
-  g_free (hash_node);
-#else
-  G_LOCK (g_hash_global);
-  hash_node->next = node_free_list;
-  node_free_list = hash_node;
-  G_UNLOCK (g_hash_global);
-#endif
-}
-
-static void
-g_hash_nodes_destroy (GHashNode *hash_node,
-		      GFreeFunc  key_destroy_func,
-		      GFreeFunc  value_destroy_func)
-{
-#ifdef DISABLE_MEM_POOLS
-  while (hash_node)
-    {
-      GHashNode *next = hash_node->next;
-
-      if (key_destroy_func)
-	key_destroy_func (hash_node->key);
-      if (value_destroy_func)
-	value_destroy_func (hash_node->value);
-
-      g_free (hash_node);
-      hash_node = next;
-    }  
-#else
-  if (hash_node)
-    {
-      GHashNode *node = hash_node;
-  
-      while (node->next)
-	{
-	  if (key_destroy_func)
-	    key_destroy_func (node->key);
-	  if (value_destroy_func)
-	    value_destroy_func (node->value);
-
-#ifdef ENABLE_GC_FRIENDLY
-	  node->key = NULL;
-	  node->value = NULL;
-#endif /* ENABLE_GC_FRIENDLY */
-
-	  node = node->next;
-	}
-
-      if (key_destroy_func)
-	key_destroy_func (node->key);
-      if (value_destroy_func)
-	value_destroy_func (node->value);
-
-#ifdef ENABLE_GC_FRIENDLY
-      node->key = NULL;
-      node->value = NULL;
-#endif /* ENABLE_GC_FRIENDLY */
- 
-      G_LOCK (g_hash_global);
-      node->next = node_free_list;
-      node_free_list = hash_node;
-      G_UNLOCK (g_hash_global);
-    }
-#endif
-}
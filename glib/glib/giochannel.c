@@ -61,6 +61,28 @@
 				 : (channel)->read_buf)
 #define BUF_LEN(string)		((string) ? (string)->len : 0)
 
+/* Bytes that may start an autodetected line terminator:
+ * '\0', '\n', '\r' and the lead byte of U+2029
+ */
+static const guchar line_term_start[256] = {
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, /* 0x00 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x10 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x20 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x30 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x40 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x50 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x60 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x70 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x80 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0x90 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0xa0 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0xb0 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0xc0 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0xd0 */
+  0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0xe0 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* 0xf0 */
+};
+
 static GIOError		g_io_error_get_from_g_error	(GIOStatus    status,
 							 GError      *err);
 static void		g_io_channel_purge		(GIOChannel  *channel);
@@ -1458,6 +1480,77 @@ g_io_channel_read_line_string (GIOChannel *channel,
 }
 
 
+/**
+ * g_io_channel_peek_line:
+ * @channel: a #GIOChannel
+ * @line_return: location to store a pointer to the line, including
+ *               the line terminator. The line is not copied, it points
+ *               into the channel's read buffer and is not nul-terminated.
+ *               It stays valid until the next operation on @channel.
+ * @length: location to store length of the line
+ * @terminator_pos: location to store position of line terminator, or %NULL
+ * @error: A location to return an error of type #GConvertError
+ *         or #GIOChannelError
+ *
+ * Like g_io_channel_read_line(), but returns the line in place
+ * instead of copying it, and leaves it in the channel. Use
+ * g_io_channel_consume() to remove it once it has been processed.
+ * This avoids an allocation per line for line oriented protocols.
+ *
+ * Return value: the status of the operation.
+ **/
+GIOStatus
+g_io_channel_peek_line (GIOChannel   *channel,
+			const gchar **line_return,
+			gsize        *length,
+			gsize        *terminator_pos,
+			GError      **error)
+{
+  GIOStatus status;
+  gsize got_length;
+
+  g_return_val_if_fail (channel != NULL, G_IO_STATUS_ERROR);
+  g_return_val_if_fail (line_return != NULL, G_IO_STATUS_ERROR);
+  g_return_val_if_fail (length != NULL, G_IO_STATUS_ERROR);
+  g_return_val_if_fail ((error == NULL) || (*error == NULL),
+			G_IO_STATUS_ERROR);
+  g_return_val_if_fail (channel->is_readable, G_IO_STATUS_ERROR);
+
+  status = g_io_channel_read_line_backend (channel, &got_length, terminator_pos, error);
+
+  *length = got_length;
+
+  if (status == G_IO_STATUS_NORMAL)
+    {
+      g_assert (USE_BUF (channel));
+      *line_return = USE_BUF (channel)->str;
+    }
+  else
+    *line_return = NULL;
+
+  return status;
+}
+
+/**
+ * g_io_channel_consume:
+ * @channel: a #GIOChannel
+ * @count: the number of bytes to remove
+ *
+ * Removes @count bytes from the start of the channel's read buffer,
+ * usually the length of a line previously returned by
+ * g_io_channel_peek_line().
+ **/
+void
+g_io_channel_consume (GIOChannel *channel,
+		      gsize       count)
+{
+  g_return_if_fail (channel != NULL);
+  g_return_if_fail (count <= BUF_LEN (USE_BUF (channel)));
+
+  if (count > 0)
+    g_string_erase (USE_BUF (channel), 0, count);
+}
+
 static GIOStatus
 g_io_channel_read_line_backend	(GIOChannel *channel,
 				 gsize      *length,
@@ -1541,20 +1634,47 @@ read_again:
 
       lastchar = use_buf->str + use_buf->len;
 
-      for (nextchar = use_buf->str + checked_to; nextchar < lastchar;
-           channel->encoding ? nextchar = g_utf8_next_char (nextchar) : nextchar++)
+      /* Terminators are ASCII or start with a UTF-8 lead byte, and
+       * continuation bytes never match those, so even with an encoding
+       * the buffer can be scanned bytewise.
+       */
+      nextchar = use_buf->str + checked_to;
+      if (channel->line_term)
         {
-          if (channel->line_term)
+          gchar first = channel->line_term[0];
+
+          while (nextchar < lastchar)
             {
+              nextchar = memchr (nextchar, first, lastchar - nextchar);
+              if (!nextchar)
+                {
+                  nextchar = lastchar;
+                  break;
+                }
+              if (nextchar + line_term_len > lastchar)
+                {
+                  /* Partial match at the end, recheck with more data */
+                  nextchar = lastchar;
+                  break;
+                }
               if (memcmp (channel->line_term, nextchar, line_term_len) == 0)
                 {
                   line_length = nextchar - use_buf->str;
                   got_term_len = line_term_len;
                   goto done;
                 }
+              nextchar++;
             }
-          else /* auto detect */
+        }
+      else /* auto detect */
+        {
+          while (nextchar < lastchar)
             {
+              while (nextchar < lastchar && !line_term_start[(guchar) *nextchar])
+                nextchar++;
+              if (nextchar == lastchar)
+                break;
+
               switch (*nextchar)
                 {
                   case '\n': /* unix */
@@ -1586,6 +1706,7 @@ read_again:
                   default: /* no match */
                     break;
                 }
+              nextchar++;
             }
         }
 
@@ -1972,6 +2093,41 @@ g_io_channel_write_chars (GIOChannel	*channel,
         }
     }
 
+  /* Large writes without encoding bypass the buffer. Whatever is
+   * buffered goes out first, then the data is handed to the backend
+   * directly instead of being copied through the buffer in buf_size
+   * pieces. A remainder smaller than the buffer, or anything left
+   * after G_IO_STATUS_AGAIN, goes through the buffer as usual.
+   */
+  if (!channel->encoding && count >= channel->buf_size)
+    {
+      status = g_io_channel_flush (channel, error);
+      if (status == G_IO_STATUS_ERROR)
+        {
+          if (bytes_written)
+            *bytes_written = 0;
+          return status;
+        }
+
+      while (status == G_IO_STATUS_NORMAL &&
+             count - wrote_bytes >= channel->buf_size)
+        {
+          gsize this_time;
+
+          status = channel->funcs->io_write (channel, buf, count - wrote_bytes,
+                                             &this_time, error);
+          buf += this_time;
+          wrote_bytes += this_time;
+        }
+
+      if (status == G_IO_STATUS_ERROR)
+        {
+          if (bytes_written)
+            *bytes_written = wrote_bytes;
+          return status;
+        }
+    }
+
   if (!channel->write_buf)
     channel->write_buf = g_string_sized_new (channel->buf_size);
 
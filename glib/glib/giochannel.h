@@ -236,6 +236,13 @@ GIOStatus   g_io_channel_read_line_string (GIOChannel   *channel,
 					   GString      *buffer,
 					   gsize        *terminator_pos,
 					   GError      **error);
+GIOStatus   g_io_channel_peek_line        (GIOChannel   *channel,
+					   const gchar **line_return,
+					   gsize        *length,
+					   gsize        *terminator_pos,
+					   GError      **error);
+void        g_io_channel_consume          (GIOChannel   *channel,
+					   gsize         count);
 GIOStatus   g_io_channel_read_to_end      (GIOChannel   *channel,
 					   gchar       **str_return,
 					   gsize        *length,
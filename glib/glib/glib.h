@@ -30,6 +30,7 @@
 #include <glib/galloca.h>
 #include <glib/garray.h>
 #include <glib/gasyncqueue.h>
+#include <glib/gatomic.h>
 #include <glib/gbacktrace.h>
 #include <glib/gcache.h>
 #include <glib/gcompletion.h>
@@ -56,8 +57,10 @@
 #include <glib/gqueue.h>
 #include <glib/grand.h>
 #include <glib/grel.h>
+#include <glib/grope.h>
 #include <glib/gscanner.h>
 #include <glib/gshell.h>
+#include <glib/gslice.h>
 #include <glib/gslist.h>
 #include <glib/gspawn.h>
 #include <glib/gstrfuncs.h>
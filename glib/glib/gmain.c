@@ -50,6 +50,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif /* HAVE_UNISTD_H */
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif /* HAVE_SYS_EPOLL_H */
 #include <errno.h>
 
 #ifdef G_OS_WIN32
@@ -66,6 +69,9 @@
 typedef struct _GTimeoutSource GTimeoutSource;
 typedef struct _GPollRec GPollRec;
 typedef struct _GSourceCallback GSourceCallback;
+#ifdef HAVE_SYS_EPOLL_H
+typedef struct _GEpollRec GEpollRec;
+#endif
 
 typedef enum
 {
@@ -105,6 +111,18 @@ struct _GMainContext
   GSource *source_list;
   gint in_check_or_prepare;
 
+  /* timeout sources are kept out of source_list; they live in their
+   * own unsorted list, and the unblocked ones in a binary min-heap
+   * ordered by expiration, so only due timeouts are looked at per
+   * iteration
+   */
+  GSource *timeout_list;
+  GPtrArray *timeout_heap;
+  GTimeVal timeout_time;	/* time of the last timeout scan */
+  GPtrArray *due_timeouts;	/* scratch array for g_main_context_check() */
+
+  GHashTable *source_ids;	/* source_id -> GSource */
+
   GPollRec *poll_records;
   GPollRec *poll_free_list;
   GMemChunk *poll_chunk;
@@ -112,6 +130,17 @@ struct _GMainContext
   GPollFD *cached_poll_array;
   guint cached_poll_array_size;
 
+#ifdef HAVE_SYS_EPOLL_H
+  /* with the default poll function, poll records are also
+   * registered with an epoll instance as they are added, so
+   * an iteration doesn't need to hand all of them to the kernel
+   */
+  gint epoll_fd;		/* -1 if epoll is unavailable */
+  GHashTable *epoll_records;	/* fd -> GEpollRec */
+  GArray *epoll_ready;		/* fds which got revents in the last wait */
+  GSList *epoll_unpollable;	/* GEpollRecs epoll_ctl() refused */
+#endif
+
 #ifdef G_THREADS_ENABLED  
 #ifndef G_OS_WIN32
 /* this pipe is used to wake up the main loop when a source is added.
@@ -154,6 +183,7 @@ struct _GTimeoutSource
   GSource     source;
   GTimeVal    expiration;
   guint       interval;
+  gint        heap_index;	/* -1 if not in the context's timeout_heap */
 };
 
 struct _GPollRec
@@ -163,6 +193,20 @@ struct _GPollRec
   GPollRec *next;
 };
 
+#ifdef HAVE_SYS_EPOLL_H
+struct _GEpollRec
+{
+  gint fd;
+  gushort events;		/* union of the events of all pollfds */
+  guint registered : 1;		/* fd was passed to epoll_ctl() */
+  guint unpollable : 1;		/* epoll_ctl() refused fd */
+  guint invalid : 1;		/* ... because fd is not open */
+  GSList *pollfds;		/* the GPollFDs registered for fd */
+};
+
+#define G_MAIN_EPOLL_MAX_EVENTS 64
+#endif
+
 #ifdef G_THREADS_ENABLED
 #define LOCK_CONTEXT(context) g_static_mutex_lock (&context->mutex)
 #define UNLOCK_CONTEXT(context) g_static_mutex_unlock (&context->mutex)
@@ -174,6 +218,7 @@ struct _GPollRec
 #endif
 
 #define SOURCE_DESTROYED(source) (((source)->flags & G_HOOK_FLAG_ACTIVE) == 0)
+#define SOURCE_IS_TIMEOUT(source) ((source)->source_funcs == &g_timeout_funcs)
 #define SOURCE_BLOCKED(source) (((source)->flags & G_HOOK_FLAG_IN_CALL) != 0 && \
 		                ((source)->flags & G_SOURCE_CAN_RECURSE) == 0)
 
@@ -205,6 +250,35 @@ static void g_main_context_add_poll_unlocked    (GMainContext *context,
 static void g_main_context_remove_poll_unlocked (GMainContext *context,
 						 GPollFD      *fd);
 static void g_main_context_wakeup_unlocked      (GMainContext *context);
+static void g_main_context_get_time_unlocked    (GMainContext *context,
+						 GTimeVal     *timeval);
+#ifdef HAVE_SYS_EPOLL_H
+static void     g_main_context_epoll_init   (GMainContext *context);
+static void     g_main_context_epoll_free   (GMainContext *context);
+static void     g_main_context_epoll_add    (GMainContext *context,
+					     GPollFD      *fd);
+static void     g_main_context_epoll_remove (GMainContext *context,
+					     GPollFD      *fd);
+static gboolean g_main_context_epoll_query  (GMainContext *context,
+					     gint         *timeout);
+static void     g_main_context_epoll_wait   (GMainContext *context,
+					     gint          timeout);
+#endif /* HAVE_SYS_EPOLL_H */
+
+static void g_timeout_heap_insert  (GMainContext   *context,
+				    GTimeoutSource *timeout_source);
+static void g_timeout_heap_remove  (GMainContext   *context,
+				    GTimeoutSource *timeout_source);
+static void g_timeout_heap_update  (GMainContext   *context,
+				    GTimeoutSource *timeout_source);
+static void g_timeout_heap_scan    (GMainContext   *context,
+				    guint           index,
+				    GTimeVal       *current_time,
+				    GPtrArray      *ready,
+				    gint           *n_ready,
+				    gint           *ready_priority);
+static gint g_timeout_heap_next    (GMainContext   *context,
+				    GTimeVal       *current_time);
 
 static gboolean g_timeout_prepare  (GSource     *source,
 				    gint        *timeout);
@@ -219,6 +293,12 @@ static gboolean g_idle_dispatch    (GSource     *source,
 				    GSourceFunc  callback,
 				    gpointer     user_data);
 
+#ifdef HAVE_POLL
+#define G_MAIN_DEFAULT_POLL_FUNC ((GPollFunc) poll)
+#else
+#define G_MAIN_DEFAULT_POLL_FUNC ((GPollFunc) g_poll)
+#endif
+
 G_LOCK_DEFINE_STATIC (main_loop);
 static GMainContext *default_main_context;
 static GSList *main_contexts_without_pipe = NULL;
@@ -674,6 +754,13 @@ g_main_context_unref_and_unlock (GMainContext *context)
     }
 
   source = context->source_list;
+  while (source)
+    {
+      GSource *next = source->next;
+      g_source_destroy_internal (source, context, TRUE);
+      source = next;
+    }
+  source = context->timeout_list;
   while (source)
     {
       GSource *next = source->next;
@@ -687,6 +774,9 @@ g_main_context_unref_and_unlock (GMainContext *context)
 #endif
 
   g_ptr_array_free (context->pending_dispatches, TRUE);
+  g_ptr_array_free (context->timeout_heap, TRUE);
+  g_ptr_array_free (context->due_timeouts, TRUE);
+  g_hash_table_destroy (context->source_ids);
   g_free (context->cached_poll_array);
   
 #ifdef DISABLE_MEM_POLLS
@@ -697,6 +787,10 @@ g_main_context_unref_and_unlock (GMainContext *context)
   if (context->poll_chunk)
     g_mem_chunk_destroy (context->poll_chunk);
 
+#ifdef HAVE_SYS_EPOLL_H
+  g_main_context_epoll_free (context);
+#endif
+
 #ifdef G_THREADS_ENABLED
   if (g_thread_supported())
     {
@@ -795,12 +889,12 @@ g_main_context_new ()
   context->next_id = 1;
   
   context->source_list = NULL;
+  context->timeout_list = NULL;
+  context->timeout_heap = g_ptr_array_new ();
+  context->due_timeouts = g_ptr_array_new ();
+  context->source_ids = g_hash_table_new (NULL, NULL);
   
-#if HAVE_POLL
-  context->poll_func = (GPollFunc)poll;
-#else
-  context->poll_func = g_poll;
-#endif
+  context->poll_func = G_MAIN_DEFAULT_POLL_FUNC;
   
   context->cached_poll_array = NULL;
   context->cached_poll_array_size = 0;
@@ -809,6 +903,10 @@ g_main_context_new ()
   
   context->time_is_current = FALSE;
   
+#ifdef HAVE_SYS_EPOLL_H
+  g_main_context_epoll_init (context);
+#endif
+
 #ifdef G_THREADS_ENABLED
   if (g_thread_supported ())
     g_main_context_init_pipe (context);
@@ -894,6 +992,19 @@ g_source_list_add (GSource      *source,
 {
   GSource *tmp_source, *last_source;
   
+  if (SOURCE_IS_TIMEOUT (source))
+    {
+      source->prev = NULL;
+      source->next = context->timeout_list;
+      if (context->timeout_list)
+	context->timeout_list->prev = source;
+      context->timeout_list = source;
+
+      if (!SOURCE_BLOCKED (source))
+	g_timeout_heap_insert (context, (GTimeoutSource *)source);
+      return;
+    }
+
   last_source = NULL;
   tmp_source = context->source_list;
   while (tmp_source && tmp_source->priority <= source->priority)
@@ -919,8 +1030,13 @@ static void
 g_source_list_remove (GSource      *source,
 		      GMainContext *context)
 {
+  if (SOURCE_IS_TIMEOUT (source))
+    g_timeout_heap_remove (context, (GTimeoutSource *)source);
+
   if (source->prev)
     source->prev->next = source->next;
+  else if (SOURCE_IS_TIMEOUT (source))
+    context->timeout_list = source->next;
   else
     context->source_list = source->next;
 
@@ -961,6 +1077,7 @@ g_source_attach (GSource      *source,
 
   source->ref_count++;
   g_source_list_add (source, context);
+  g_hash_table_insert (context->source_ids, GUINT_TO_POINTER (result), source);
 
   tmp_list = source->poll_fds;
   while (tmp_list)
@@ -995,6 +1112,10 @@ g_source_destroy_internal (GSource      *source,
       
       source->flags &= ~G_HOOK_FLAG_ACTIVE;
 
+      g_hash_table_remove (context->source_ids, GUINT_TO_POINTER (source->source_id));
+      if (SOURCE_IS_TIMEOUT (source))
+	g_timeout_heap_remove (context, (GTimeoutSource *)source);
+
       old_cb_data = source->callback_data;
       old_cb_funcs = source->callback_funcs;
 
@@ -1519,14 +1640,7 @@ g_main_context_find_source_by_id (GMainContext *context,
   
   LOCK_CONTEXT (context);
   
-  source = context->source_list;
-  while (source)
-    {
-      if (!SOURCE_DESTROYED (source) &&
-	  source->source_id == source_id)
-	break;
-      source = source->next;
-    }
+  source = g_hash_table_lookup (context->source_ids, GUINT_TO_POINTER (source_id));
 
   UNLOCK_CONTEXT (context);
 
@@ -1559,7 +1673,7 @@ g_main_context_find_source_by_funcs_user_data (GMainContext *context,
   
   LOCK_CONTEXT (context);
 
-  source = context->source_list;
+  source = funcs == &g_timeout_funcs ? context->timeout_list : context->source_list;
   while (source)
     {
       if (!SOURCE_DESTROYED (source) &&
@@ -1598,6 +1712,7 @@ g_main_context_find_source_by_user_data (GMainContext *context,
 					 gpointer      user_data)
 {
   GSource *source;
+  gboolean in_timeouts = FALSE;
   
   if (context == NULL)
     context = g_main_context_default ();
@@ -1605,8 +1720,15 @@ g_main_context_find_source_by_user_data (GMainContext *context,
   LOCK_CONTEXT (context);
 
   source = context->source_list;
-  while (source)
+  while (source || !in_timeouts)
     {
+      if (!source)
+	{
+	  source = context->timeout_list;
+	  in_timeouts = TRUE;
+	  continue;
+	}
+
       if (!SOURCE_DESTROYED (source) &&
 	  source->callback_funcs)
 	{
@@ -1765,6 +1887,9 @@ block_source (GSource *source)
 
   g_return_if_fail (!SOURCE_BLOCKED (source));
 
+  if (SOURCE_IS_TIMEOUT (source))
+    g_timeout_heap_remove (source->context, (GTimeoutSource *)source);
+
   tmp_list = source->poll_fds;
   while (tmp_list)
     {
@@ -1782,6 +1907,9 @@ unblock_source (GSource *source)
   g_return_if_fail (!SOURCE_BLOCKED (source)); /* Source already unblocked */
   g_return_if_fail (!SOURCE_DESTROYED (source));
   
+  if (SOURCE_IS_TIMEOUT (source))
+    g_timeout_heap_insert (source->context, (GTimeoutSource *)source);
+
   tmp_list = source->poll_fds;
   while (tmp_list)
     {
@@ -1850,6 +1978,8 @@ g_main_dispatch (GMainContext *context)
 	  if ((source->flags & G_SOURCE_CAN_RECURSE) == 0 &&
 	      !SOURCE_DESTROYED (source))
 	    unblock_source (source);
+	  else if (SOURCE_IS_TIMEOUT (source))
+	    g_timeout_heap_update (context, (GTimeoutSource *)source);
 	  
 	  /* Note: this depends on the fact that we can't switch
 	   * sources from one main context to another
@@ -1867,6 +1997,24 @@ g_main_dispatch (GMainContext *context)
   g_ptr_array_set_size (context->pending_dispatches, 0);
 }
 
+/* orders sources the way they are kept in source_list: by priority,
+ * then by the order they were attached in
+ */
+static gint
+g_source_compare_position (gconstpointer a,
+			   gconstpointer b)
+{
+  const GSource *source_a = *(GSource * const *)a;
+  const GSource *source_b = *(GSource * const *)b;
+
+  if (source_a->priority != source_b->priority)
+    return source_a->priority < source_b->priority ? -1 : 1;
+  if (source_a->source_id != source_b->source_id)
+    return source_a->source_id < source_b->source_id ? -1 : 1;
+
+  return 0;
+}
+
 /* Holds context's lock */
 static inline GSource *
 next_valid_source (GMainContext *context,
@@ -2077,6 +2225,7 @@ g_main_context_prepare (GMainContext *context,
   gint n_ready = 0;
   gint current_priority = G_MAXINT;
   GSource *source;
+  GTimeVal current_time;
 
   if (context == NULL)
     context = g_main_context_default ();
@@ -2125,10 +2274,15 @@ g_main_context_prepare (GMainContext *context,
     }
   g_ptr_array_set_size (context->pending_dispatches, 0);
   
-  /* Prepare all sources */
+  /* Prepare the timeouts, only due ones are visited */
+
+  g_main_context_get_time_unlocked (context, &current_time);
+  context->timeout = g_timeout_heap_next (context, &current_time);
+  g_timeout_heap_scan (context, 0, &current_time,
+		       NULL, &n_ready, &current_priority);
+
+  /* Prepare all other sources */
 
-  context->timeout = -1;
-  
   source = next_valid_source (context, NULL);
   while (source)
     {
@@ -2272,8 +2426,14 @@ g_main_context_check (GMainContext *context,
 		      gint          n_fds)
 {
   GSource *source;
+  GSource *current;
   GPollRec *pollrec;
+  GPtrArray *due_timeouts;
+  GTimeVal current_time;
+  gint timeout_priority = G_MAXINT;
+  gint n_due = 0;
   gint n_ready = 0;
+  guint t;
   gint i;
   
   LOCK_CONTEXT (context);
@@ -2319,53 +2479,82 @@ g_main_context_check (GMainContext *context,
       pollrec = pollrec->next;
     }
 
+  /* The due timeouts are merged into the walk over source_list in
+   * the place they would have there, so they are checked against
+   * @max_priority and queued in the same order as other sources.
+   */
+  due_timeouts = context->due_timeouts;
+  g_main_context_get_time_unlocked (context, &current_time);
+  g_timeout_heap_scan (context, 0, &current_time,
+		       due_timeouts, &n_due, &timeout_priority);
+  g_ptr_array_sort (due_timeouts, g_source_compare_position);
+  t = 0;
+
   source = next_valid_source (context, NULL);
-  while (source)
+  while (TRUE)
     {
-      if ((n_ready > 0) && (source->priority > max_priority))
+      if (t < due_timeouts->len &&
+	  (!source || g_source_compare_position (&due_timeouts->pdata[t], &source) < 0))
+	current = due_timeouts->pdata[t++];
+      else if (source)
+	current = source;
+      else
+	break;
+      
+      if ((n_ready > 0) && (current->priority > max_priority))
 	{
-	  SOURCE_UNREF (source, context);
+	  if (current != source)
+	    SOURCE_UNREF (current, context);
 	  break;
 	}
-      if (SOURCE_BLOCKED (source))
+      if (SOURCE_BLOCKED (current))
 	goto next;
 
-      if (!(source->flags & G_SOURCE_READY))
+      if (!(current->flags & G_SOURCE_READY))
 	{
 	  gboolean result;
 	  gboolean (*check) (GSource  *source);
 
-	  check = source->source_funcs->check;
+	  check = current->source_funcs->check;
 	  
 	  context->in_check_or_prepare++;
 	  UNLOCK_CONTEXT (context);
 	  
-	  result = (*check) (source);
+	  result = (*check) (current);
 	  
 	  LOCK_CONTEXT (context);
 	  context->in_check_or_prepare--;
 	  
 	  if (result)
-	    source->flags |= G_SOURCE_READY;
+	    current->flags |= G_SOURCE_READY;
 	}
 
-      if (source->flags & G_SOURCE_READY)
+      if (current->flags & G_SOURCE_READY)
 	{
-	  source->ref_count++;
-	  g_ptr_array_add (context->pending_dispatches, source);
+	  current->ref_count++;
+	  g_ptr_array_add (context->pending_dispatches, current);
 
 	  n_ready++;
 
           /* never dispatch sources with less priority than the first
            * one we choose to dispatch
            */
-          max_priority = source->priority;
+          max_priority = current->priority;
 	}
 
     next:
-      source = next_valid_source (context, source);
+      if (current == source)
+	source = next_valid_source (context, source);
+      else
+	SOURCE_UNREF (current, context);
     }
 
+  if (source)
+    SOURCE_UNREF (source, context);
+  for (; t < due_timeouts->len; t++)
+    SOURCE_UNREF ((GSource *)due_timeouts->pdata[t], context);
+  g_ptr_array_set_size (due_timeouts, 0);
+
   UNLOCK_CONTEXT (context);
 
   return n_ready > 0;
@@ -2447,22 +2636,36 @@ g_main_context_iterate (GMainContext *context,
 
   some_ready = g_main_context_prepare (context, &max_priority); 
   
-  while ((nfds = g_main_context_query (context, max_priority, &timeout, fds, 
-				       allocated_nfds)) > allocated_nfds)
+#ifdef HAVE_SYS_EPOLL_H
+  if (g_main_context_epoll_query (context, &timeout))
     {
-      LOCK_CONTEXT (context);
-      g_free (fds);
-      context->cached_poll_array_size = allocated_nfds = nfds;
-      context->cached_poll_array = fds = g_new (GPollFD, nfds);
-      UNLOCK_CONTEXT (context);
+      if (!block)
+	timeout = 0;
+
+      g_main_context_epoll_wait (context, timeout);
+
+      g_main_context_check (context, max_priority, NULL, 0);
     }
+  else
+#endif /* HAVE_SYS_EPOLL_H */
+    {
+      while ((nfds = g_main_context_query (context, max_priority, &timeout, fds, 
+					   allocated_nfds)) > allocated_nfds)
+	{
+	  LOCK_CONTEXT (context);
+	  g_free (fds);
+	  context->cached_poll_array_size = allocated_nfds = nfds;
+	  context->cached_poll_array = fds = g_new (GPollFD, nfds);
+	  UNLOCK_CONTEXT (context);
+	}
 
-  if (!block)
-    timeout = 0;
+      if (!block)
+	timeout = 0;
   
-  g_main_context_poll (context, timeout, max_priority, fds, nfds);
+      g_main_context_poll (context, timeout, max_priority, fds, nfds);
   
-  g_main_context_check (context, max_priority, fds, nfds);
+      g_main_context_check (context, max_priority, fds, nfds);
+    }
   
   if (dispatch)
     g_main_context_dispatch (context);
@@ -2899,6 +3102,10 @@ g_main_context_add_poll_unlocked (GMainContext *context,
 
   context->n_poll_records++;
 
+#ifdef HAVE_SYS_EPOLL_H
+  g_main_context_epoll_add (context, fd);
+#endif
+
 #ifdef G_THREADS_ENABLED
   context->poll_changed = TRUE;
 
@@ -2907,6 +3114,256 @@ g_main_context_add_poll_unlocked (GMainContext *context,
 #endif
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+
+/* G_IO_IN, G_IO_PRI, G_IO_OUT, G_IO_ERR and G_IO_HUP have the
+ * values of their EPOLL* counterparts on Linux, G_IO_NVAL has none.
+ */
+#define G_MAIN_EPOLL_EVENTS (G_IO_IN | G_IO_PRI | G_IO_OUT | G_IO_ERR | G_IO_HUP)
+
+static void
+g_epoll_rec_free (gpointer data)
+{
+  GEpollRec *rec = data;
+
+  g_slist_free (rec->pollfds);
+  g_free (rec);
+}
+
+static void
+g_main_context_epoll_init (GMainContext *context)
+{
+  context->epoll_fd = epoll_create (G_MAIN_EPOLL_MAX_EVENTS);
+  context->epoll_records = g_hash_table_new_full (NULL, NULL, NULL, g_epoll_rec_free);
+  context->epoll_ready = g_array_new (FALSE, FALSE, sizeof (gint));
+  context->epoll_unpollable = NULL;
+}
+
+static void
+g_main_context_epoll_free (GMainContext *context)
+{
+  if (context->epoll_fd >= 0)
+    close (context->epoll_fd);
+  g_hash_table_destroy (context->epoll_records);
+  g_array_free (context->epoll_ready, TRUE);
+  g_slist_free (context->epoll_unpollable);
+}
+
+/* HOLDS: context's lock
+ * brings the kernel's registration of rec->fd in sync with the
+ * GPollFDs that are left for it.
+ */
+static void
+g_main_context_epoll_update (GMainContext *context,
+			     GEpollRec    *rec)
+{
+  struct epoll_event event;
+  gushort events = 0;
+  gint op;
+  gint result;
+  GSList *tmp_list;
+
+  for (tmp_list = rec->pollfds; tmp_list; tmp_list = tmp_list->next)
+    events |= ((GPollFD *)tmp_list->data)->events;
+  events &= G_MAIN_EPOLL_EVENTS;
+
+  if (!rec->pollfds)
+    {
+      /* the fd may already be closed, in which case the kernel
+       * dropped it by itself
+       */
+      if (rec->unpollable)
+	context->epoll_unpollable = g_slist_remove (context->epoll_unpollable, rec);
+      else
+	epoll_ctl (context->epoll_fd, EPOLL_CTL_DEL, rec->fd, &event);
+      g_hash_table_remove (context->epoll_records, GINT_TO_POINTER (rec->fd));
+      return;
+    }
+
+  if (rec->unpollable ||
+      (rec->registered && events == rec->events))
+    {
+      rec->events = events;
+      return;
+    }
+
+  op = rec->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  rec->events = events;
+  rec->registered = TRUE;
+
+  event.events = events;
+  event.data.fd = rec->fd;
+
+  /* a closed and reused fd number can leave the registration
+   * out of sync with our records, retry with the other operation
+   */
+  result = epoll_ctl (context->epoll_fd, op, rec->fd, &event);
+  if (result < 0 && op == EPOLL_CTL_ADD && errno == EEXIST)
+    result = epoll_ctl (context->epoll_fd, EPOLL_CTL_MOD, rec->fd, &event);
+  else if (result < 0 && op == EPOLL_CTL_MOD && errno == ENOENT)
+    result = epoll_ctl (context->epoll_fd, EPOLL_CTL_ADD, rec->fd, &event);
+
+  /* epoll refuses fds which never block, like regular files and
+   * /dev/null (EPERM). poll() reports those as always ready and
+   * fds which aren't open as G_IO_NVAL, g_main_context_epoll_wait()
+   * does the same for the fds on the unpollable list.
+   */
+  if (result < 0)
+    {
+      rec->registered = FALSE;
+      rec->unpollable = TRUE;
+      rec->invalid = (errno == EBADF);
+      context->epoll_unpollable = g_slist_prepend (context->epoll_unpollable, rec);
+    }
+}
+
+/* HOLDS: context's lock */
+static void
+g_main_context_epoll_add (GMainContext *context,
+			  GPollFD      *fd)
+{
+  GEpollRec *rec;
+
+  if (context->epoll_fd < 0)
+    return;
+
+  rec = g_hash_table_lookup (context->epoll_records, GINT_TO_POINTER (fd->fd));
+  if (!rec)
+    {
+      rec = g_new0 (GEpollRec, 1);
+      rec->fd = fd->fd;
+      g_hash_table_insert (context->epoll_records, GINT_TO_POINTER (fd->fd), rec);
+    }
+  rec->pollfds = g_slist_prepend (rec->pollfds, fd);
+
+  g_main_context_epoll_update (context, rec);
+}
+
+/* HOLDS: context's lock */
+static void
+g_main_context_epoll_remove (GMainContext *context,
+			     GPollFD      *fd)
+{
+  GEpollRec *rec;
+
+  if (context->epoll_fd < 0)
+    return;
+
+  rec = g_hash_table_lookup (context->epoll_records, GINT_TO_POINTER (fd->fd));
+  if (!rec)
+    return;
+  rec->pollfds = g_slist_remove (rec->pollfds, fd);
+
+  g_main_context_epoll_update (context, rec);
+}
+
+/* returns %FALSE if the iteration has to go through
+ * g_main_context_query() and the poll function instead.
+ */
+static gboolean
+g_main_context_epoll_query (GMainContext *context,
+			    gint         *timeout)
+{
+  LOCK_CONTEXT (context);
+
+  if (context->epoll_fd < 0 ||
+      context->poll_func != G_MAIN_DEFAULT_POLL_FUNC)
+    {
+      UNLOCK_CONTEXT (context);
+      return FALSE;
+    }
+
+#ifdef G_THREADS_ENABLED
+  context->poll_changed = FALSE;
+#endif
+  
+  *timeout = context->timeout;
+  context->time_is_current = FALSE;
+
+  UNLOCK_CONTEXT (context);
+
+  return TRUE;
+}
+
+/* waits for events on the registered fds and hands the revents
+ * to the GPollFDs of the fds which are ready, the counterpart of
+ * g_main_context_poll() plus the revents part of
+ * g_main_context_check().
+ */
+static void
+g_main_context_epoll_wait (GMainContext *context,
+			   gint          timeout)
+{
+  struct epoll_event events[G_MAIN_EPOLL_MAX_EVENTS];
+  GEpollRec *rec;
+  GSList *tmp_list;
+  gint n_events;
+  gint epoll_fd;
+  gint i;
+
+  LOCK_CONTEXT (context);
+
+  /* revents of the last wait are stale now */
+  for (i = 0; i < context->epoll_ready->len; i++)
+    {
+      rec = g_hash_table_lookup (context->epoll_records,
+				 GINT_TO_POINTER (g_array_index (context->epoll_ready, gint, i)));
+      if (rec)
+	for (tmp_list = rec->pollfds; tmp_list; tmp_list = tmp_list->next)
+	  ((GPollFD *)tmp_list->data)->revents = 0;
+    }
+  g_array_set_size (context->epoll_ready, 0);
+  epoll_fd = context->epoll_fd;
+
+  /* unpollable fds are always ready, so don't block */
+  if (context->epoll_unpollable)
+    timeout = 0;
+
+  UNLOCK_CONTEXT (context);
+
+  n_events = epoll_wait (epoll_fd, events, G_MAIN_EPOLL_MAX_EVENTS, timeout);
+
+  LOCK_CONTEXT (context);
+
+  for (tmp_list = context->epoll_unpollable; tmp_list; tmp_list = tmp_list->next)
+    {
+      GSList *fd_list;
+
+      rec = tmp_list->data;
+      for (fd_list = rec->pollfds; fd_list; fd_list = fd_list->next)
+	{
+	  GPollFD *fd = fd_list->data;
+
+	  if (rec->invalid)
+	    fd->revents = G_IO_NVAL;
+	  else
+	    fd->revents = fd->events & (G_IO_IN | G_IO_OUT);
+	}
+      g_array_append_val (context->epoll_ready, rec->fd);
+    }
+
+  for (i = 0; i < n_events; i++)
+    {
+      rec = g_hash_table_lookup (context->epoll_records,
+				 GINT_TO_POINTER (events[i].data.fd));
+      if (!rec)
+	continue;
+
+      for (tmp_list = rec->pollfds; tmp_list; tmp_list = tmp_list->next)
+	{
+	  GPollFD *fd = tmp_list->data;
+
+	  if (fd->events)
+	    fd->revents = events[i].events & (fd->events | G_IO_ERR | G_IO_HUP);
+	}
+      g_array_append_val (context->epoll_ready, rec->fd);
+    }
+
+  UNLOCK_CONTEXT (context);
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
+
 /**
  * g_main_context_remove_poll:
  * @context:a #GMainContext 
@@ -2956,6 +3413,10 @@ g_main_context_remove_poll_unlocked (GMainContext *context,
 	  context->poll_free_list = pollrec;
 
 	  context->n_poll_records--;
+
+#ifdef HAVE_SYS_EPOLL_H
+	  g_main_context_epoll_remove (context, fd);
+#endif
 	  break;
 	}
       lastrec = pollrec;
@@ -2992,7 +3453,15 @@ g_source_get_current_time (GSource  *source,
   context = source->context;
 
   LOCK_CONTEXT (context);
+  g_main_context_get_time_unlocked (context, timeval);
+  UNLOCK_CONTEXT (context);
+}
 
+/* HOLDS: context's lock */
+static void
+g_main_context_get_time_unlocked (GMainContext *context,
+				  GTimeVal     *timeval)
+{
   if (!context->time_is_current)
     {
       g_get_current_time (&context->current_time);
@@ -3000,8 +3469,6 @@ g_source_get_current_time (GSource  *source,
     }
   
   *timeval = context->current_time;
-  
-  UNLOCK_CONTEXT (context);
 }
 
 /**
@@ -3016,6 +3483,10 @@ g_source_get_current_time (GSource  *source,
  *
  * This function could possibly be used to integrate the GLib event
  * loop with an external event loop.
+ *
+ * Where epoll is available, the main loop does not call the default
+ * poll function at all but waits on an epoll instance instead; setting
+ * another function makes it fall back to polling all file descriptors.
  **/
 void
 g_main_context_set_poll_func (GMainContext *context,
@@ -3031,13 +3502,7 @@ g_main_context_set_poll_func (GMainContext *context,
   if (func)
     context->poll_func = func;
   else
-    {
-#ifdef HAVE_POLL
-      context->poll_func = (GPollFunc) poll;
-#else
-      context->poll_func = (GPollFunc) g_poll;
-#endif
-    }
+    context->poll_func = G_MAIN_DEFAULT_POLL_FUNC;
 
   UNLOCK_CONTEXT (context);
 }
@@ -3123,57 +3588,229 @@ g_timeout_set_expiration (GTimeoutSource *timeout_source,
     }
 }
 
-static gboolean
-g_timeout_prepare  (GSource  *source,
-		    gint     *timeout)
+#define TIMEVAL_BEFORE(a, b) ((a)->tv_sec < (b)->tv_sec || \
+			      ((a)->tv_sec == (b)->tv_sec && (a)->tv_usec < (b)->tv_usec))
+#define TIMEOUT_HEAP_NTH(context, i) ((GTimeoutSource *)(context)->timeout_heap->pdata[i])
+
+/* returns the number of milliseconds until @timeout_source expires,
+ * 0 if it is due.
+ */
+static glong
+g_timeout_remaining (GTimeoutSource *timeout_source,
+		     GTimeVal       *current_time)
 {
   glong sec;
   glong msec;
-  GTimeVal current_time;
-  
-  GTimeoutSource *timeout_source = (GTimeoutSource *)source;
-
-  g_source_get_current_time (source, &current_time);
 
-  sec = timeout_source->expiration.tv_sec - current_time.tv_sec;
-  msec = (timeout_source->expiration.tv_usec - current_time.tv_usec) / 1000;
+  sec = timeout_source->expiration.tv_sec - current_time->tv_sec;
+  msec = (timeout_source->expiration.tv_usec - current_time->tv_usec) / 1000;
 
   /* We do the following in a rather convoluted fashion to deal with
    * the fact that we don't have an integral type big enough to hold
    * the difference of two timevals in millseconds.
    */
-  if (sec < 0 || (sec == 0 && msec < 0))
-    msec = 0;
-  else
+  if (sec < 0 || (sec == 0 && msec <= 0))
+    return 0;
+
+  if (msec < 0)
     {
-      glong interval_sec = timeout_source->interval / 1000;
-      glong interval_msec = timeout_source->interval % 1000;
+      msec += 1000;
+      sec -= 1;
+    }
+  if (sec > G_MAXINT / 1000 - 1)
+    return G_MAXINT;
 
-      if (msec < 0)
-	{
-	  msec += 1000;
-	  sec -= 1;
-	}
-      
-      if (sec > interval_sec ||
-	  (sec == interval_sec && msec > interval_msec))
-	{
-	  /* The system time has been set backwards, so we
-	   * reset the expiration time to now + timeout_source->interval;
-	   * this at least avoids hanging for long periods of time.
-	   */
-	  g_timeout_set_expiration (timeout_source, &current_time);
-	  msec = MIN (G_MAXINT, timeout_source->interval);
-	}
-      else
+  return msec + 1000 * sec;
+}
+
+/* HOLDS: context's lock */
+static void
+g_timeout_heap_place (GMainContext   *context,
+		      GTimeoutSource *timeout_source,
+		      guint           i)
+{
+  context->timeout_heap->pdata[i] = timeout_source;
+  timeout_source->heap_index = i;
+}
+
+/* HOLDS: context's lock */
+static void
+g_timeout_heap_sift_up (GMainContext *context,
+			guint         i)
+{
+  GTimeoutSource *timeout_source = TIMEOUT_HEAP_NTH (context, i);
+
+  while (i > 0)
+    {
+      GTimeoutSource *parent = TIMEOUT_HEAP_NTH (context, (i - 1) / 2);
+
+      if (!TIMEVAL_BEFORE (&timeout_source->expiration, &parent->expiration))
+	break;
+      g_timeout_heap_place (context, parent, i);
+      i = (i - 1) / 2;
+    }
+  g_timeout_heap_place (context, timeout_source, i);
+}
+
+/* HOLDS: context's lock */
+static void
+g_timeout_heap_sift_down (GMainContext *context,
+			  guint         i)
+{
+  GTimeoutSource *timeout_source = TIMEOUT_HEAP_NTH (context, i);
+  guint n = context->timeout_heap->len;
+
+  while (2 * i + 1 < n)
+    {
+      guint child = 2 * i + 1;
+
+      if (child + 1 < n &&
+	  TIMEVAL_BEFORE (&TIMEOUT_HEAP_NTH (context, child + 1)->expiration,
+			  &TIMEOUT_HEAP_NTH (context, child)->expiration))
+	child++;
+      if (!TIMEVAL_BEFORE (&TIMEOUT_HEAP_NTH (context, child)->expiration,
+			   &timeout_source->expiration))
+	break;
+      g_timeout_heap_place (context, TIMEOUT_HEAP_NTH (context, child), i);
+      i = child;
+    }
+  g_timeout_heap_place (context, timeout_source, i);
+}
+
+/* HOLDS: context's lock */
+static void
+g_timeout_heap_insert (GMainContext   *context,
+		       GTimeoutSource *timeout_source)
+{
+  if (timeout_source->heap_index >= 0)
+    return;
+
+  g_ptr_array_add (context->timeout_heap, timeout_source);
+  g_timeout_heap_sift_up (context, context->timeout_heap->len - 1);
+}
+
+/* HOLDS: context's lock */
+static void
+g_timeout_heap_remove (GMainContext   *context,
+		       GTimeoutSource *timeout_source)
+{
+  guint i = timeout_source->heap_index;
+  GTimeoutSource *last;
+
+  if (timeout_source->heap_index < 0)
+    return;
+
+  timeout_source->heap_index = -1;
+  last = g_ptr_array_remove_index (context->timeout_heap, context->timeout_heap->len - 1);
+  if (last != timeout_source)
+    {
+      g_timeout_heap_place (context, last, i);
+      g_timeout_heap_update (context, last);
+    }
+}
+
+/* HOLDS: context's lock */
+static void
+g_timeout_heap_update (GMainContext   *context,
+		       GTimeoutSource *timeout_source)
+{
+  if (timeout_source->heap_index < 0)
+    return;
+
+  g_timeout_heap_sift_up (context, timeout_source->heap_index);
+  g_timeout_heap_sift_down (context, timeout_source->heap_index);
+}
+
+/* HOLDS: context's lock
+ * visits the subtree at @index for timeouts which are due at
+ * @current_time. they are flagged ready and, if @ready is given,
+ * appended to it with an extra reference. only due nodes and their
+ * direct children are touched.
+ */
+static void
+g_timeout_heap_scan (GMainContext *context,
+		     guint         index,
+		     GTimeVal     *current_time,
+		     GPtrArray    *ready,
+		     gint         *n_ready,
+		     gint         *ready_priority)
+{
+  GTimeoutSource *timeout_source;
+  GSource *source;
+
+  if (index >= context->timeout_heap->len)
+    return;
+
+  timeout_source = TIMEOUT_HEAP_NTH (context, index);
+  if (TIMEVAL_BEFORE (current_time, &timeout_source->expiration))
+    return;
+
+  source = (GSource *)timeout_source;
+  source->flags |= G_SOURCE_READY;
+  if (ready)
+    {
+      source->ref_count++;
+      g_ptr_array_add (ready, source);
+    }
+  *n_ready += 1;
+  *ready_priority = MIN (*ready_priority, source->priority);
+
+  g_timeout_heap_scan (context, 2 * index + 1, current_time,
+		       ready, n_ready, ready_priority);
+  g_timeout_heap_scan (context, 2 * index + 2, current_time,
+		       ready, n_ready, ready_priority);
+}
+
+/* HOLDS: context's lock
+ * returns the poll timeout needed for the earliest timeout, or -1.
+ * if the system time was set backwards, timeouts which are further
+ * away than their interval are reset to now + interval first; this
+ * at least avoids hanging for long periods of time.
+ */
+static gint
+g_timeout_heap_next (GMainContext *context,
+		     GTimeVal     *current_time)
+{
+  GPtrArray *heap = context->timeout_heap;
+
+  if (TIMEVAL_BEFORE (current_time, &context->timeout_time))
+    {
+      gint i;
+
+      for (i = 0; i < heap->len; i++)
 	{
-	  msec = MIN (G_MAXINT, (guint)msec + 1000 * (guint)sec);
+	  GTimeoutSource *timeout_source = TIMEOUT_HEAP_NTH (context, i);
+
+	  if (g_timeout_remaining (timeout_source, current_time) > timeout_source->interval)
+	    g_timeout_set_expiration (timeout_source, current_time);
 	}
+      for (i = heap->len / 2 - 1; i >= 0; i--)
+	g_timeout_heap_sift_down (context, i);
     }
+  context->timeout_time = *current_time;
+
+  if (heap->len == 0)
+    return -1;
+
+  return g_timeout_remaining (TIMEOUT_HEAP_NTH (context, 0), current_time);
+}
+
+/* the main loop takes timeouts from the context's timeout_heap, the
+ * prepare and check functions are only used if someone calls them
+ * directly.
+ */
+static gboolean
+g_timeout_prepare  (GSource  *source,
+		    gint     *timeout)
+{
+  GTimeVal current_time;
+  GTimeoutSource *timeout_source = (GTimeoutSource *)source;
+
+  g_source_get_current_time (source, &current_time);
 
-  *timeout = (gint)msec;
+  *timeout = g_timeout_remaining (timeout_source, &current_time);
   
-  return msec == 0;
+  return *timeout == 0;
 }
 
 static gboolean 
@@ -3236,6 +3873,7 @@ g_timeout_source_new (guint interval)
   GTimeVal current_time;
 
   timeout_source->interval = interval;
+  timeout_source->heap_index = -1;
 
   g_get_current_time (&current_time);
   g_timeout_set_expiration (timeout_source, &current_time);
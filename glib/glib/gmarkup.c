@@ -81,9 +81,22 @@ struct _GMarkupParseContext
   GSList *tag_stack;
   gchar **attr_names;
   gchar **attr_values;
+  gsize *attr_offsets;
   gint cur_attr;
   gint alloc_attrs;
 
+  /* Element and attribute names are interned here for the lifetime
+   * of the context; the tag stack and attr_names point into it.
+   */
+  GHashTable *names;
+  GString *name_buffer;
+
+  /* Unescaped attribute values of the current start tag, each
+   * nul-terminated and located through attr_offsets; between tags,
+   * the unescaped character data if it contained entities.
+   */
+  GString *value_buffer;
+
   const gchar *current_text;
   gssize       current_text_len;      
   const gchar *current_text_end;
@@ -95,6 +108,11 @@ struct _GMarkupParseContext
 
   const gchar *iter;
 
+  /* line_number and char_number are only brought up to date with
+   * iter on demand; this is how far they have been counted.
+   */
+  const gchar *position_iter;
+
   guint document_empty : 1;
   guint parsing : 1;
   gint balance;
@@ -141,9 +159,15 @@ g_markup_parse_context_new (const GMarkupParser *parser,
   context->tag_stack = NULL;
   context->attr_names = NULL;
   context->attr_values = NULL;
+  context->attr_offsets = NULL;
   context->cur_attr = -1;
   context->alloc_attrs = 0;
 
+  context->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, NULL);
+  context->name_buffer = g_string_new (NULL);
+  context->value_buffer = g_string_new (NULL);
+
   context->current_text = NULL;
   context->current_text_len = -1;
   context->current_text_end = NULL;
@@ -151,6 +175,7 @@ g_markup_parse_context_new (const GMarkupParser *parser,
 
   context->start = NULL;
   context->iter = NULL;
+  context->position_iter = NULL;
 
   context->document_empty = TRUE;
   context->parsing = FALSE;
@@ -177,12 +202,16 @@ g_markup_parse_context_free (GMarkupParseContext *context)
   if (context->dnotify)
     (* context->dnotify) (context->user_data);
 
-  g_strfreev (context->attr_names);
-  g_strfreev (context->attr_values);
+  g_free (context->attr_names);
+  g_free (context->attr_values);
+  g_free (context->attr_offsets);
 
-  g_slist_foreach (context->tag_stack, (GFunc)g_free, NULL);
   g_slist_free (context->tag_stack);
 
+  g_hash_table_destroy (context->names);
+  g_string_free (context->name_buffer, TRUE);
+  g_string_free (context->value_buffer, TRUE);
+
   if (context->partial_chunk)
     g_string_free (context->partial_chunk, TRUE);
 
@@ -192,6 +221,37 @@ g_markup_parse_context_free (GMarkupParseContext *context)
   g_free (context);
 }
 
+static void
+update_position (GMarkupParseContext *context)
+{
+  const gchar *p = context->position_iter;
+  const gchar *end = context->iter;
+  const gchar *last;
+  const gchar *nl;
+
+  if (p == NULL || p == end)
+    return;
+
+  /* A newline moves to the next line once the position steps onto
+   * it, so the one at the old position and the end of the text don't
+   * count.
+   */
+  last = end == context->current_text_end ? end - 1 : end;
+  nl = p;
+  while (nl < last && (nl = memchr (nl + 1, '\n', last - nl)) != NULL)
+    {
+      context->line_number += 1;
+      context->char_number = 1;
+      p = nl;
+    }
+
+  for (; p < end; p++)
+    if ((*p & 0xc0) != 0x80)
+      context->char_number += 1;
+
+  context->position_iter = end;
+}
+
 static void
 mark_error (GMarkupParseContext *context,
             GError              *error)
@@ -217,6 +277,8 @@ set_error (GMarkupParseContext *context,
   s = g_strdup_vprintf (format, args);
   va_end (args);
 
+  update_position (context);
+
   tmp_error = g_error_new (G_MARKUP_ERROR,
                            code,
                            _("Error on line %d char %d: %s"),
@@ -273,6 +335,20 @@ utf8_str (const gchar *utf8,
   return buf;
 }
 
+/* Returns a nul-terminated copy of a token, valid until the next
+ * call.
+ */
+static const gchar*
+token_string (GMarkupParseContext *context,
+              const gchar         *token,
+              gsize                length)
+{
+  g_string_truncate (context->name_buffer, 0);
+  g_string_append_len (context->name_buffer, token, length);
+
+  return context->name_buffer->str;
+}
+
 static void
 set_unescape_error (GMarkupParseContext *context,
                     GError             **error,
@@ -301,6 +377,8 @@ set_unescape_error (GMarkupParseContext *context,
   s = g_strdup_vprintf (format, args);
   va_end (args);
 
+  update_position (context);
+
   tmp_error = g_error_new (G_MARKUP_ERROR,
                            code,
                            _("Error on line %d: %s"),
@@ -322,21 +400,21 @@ typedef enum
   USTATE_AFTER_CHARREF_HASH
 } UnescapeState;
 
+/* Appends the unescaped form of the text to @str. On failure @str
+ * is left with some unspecified part of it appended.
+ */
 static gboolean
 unescape_text (GMarkupParseContext *context,
                const gchar         *text,
                const gchar         *text_end,
-               gchar              **unescaped,
+               GString             *str,
                GError             **error)
 {
 #define MAX_ENT_LEN 5
-  GString *str;
   const gchar *p;
   UnescapeState state;
   const gchar *start;
 
-  str = g_string_new (NULL);
-
   state = USTATE_INSIDE_TEXT;
   p = text;
   start = p;
@@ -348,8 +426,9 @@ unescape_text (GMarkupParseContext *context,
         {
         case USTATE_INSIDE_TEXT:
           {
-            while (p != text_end && *p != '&')
-              p = g_utf8_next_char (p);
+            p = memchr (p, '&', text_end - p);
+            if (p == NULL)
+              p = text_end;
 
             if (p != start)
               {
@@ -442,10 +521,12 @@ unescape_text (GMarkupParseContext *context,
                 if (p != text_end)
                   {
                     const gchar *src;
+                    const gchar *name = start;
+                    const gchar *name_end = p;
                 
                     src = start;
                     dest = buf;
-                    while (src != p)
+                    while (src != p && dest - buf < MAX_ENT_LEN)
                       {
                         *dest = *src;
                         ++dest;
@@ -473,7 +554,8 @@ unescape_text (GMarkupParseContext *context,
                                             p, text_end,
                                             G_MARKUP_ERROR_PARSE,
                                             _("Entity name '%s' is not known"),
-                                            buf);
+                                            token_string (context, name,
+                                                          name_end - name));
                       }
                   }
                 else
@@ -617,17 +699,7 @@ unescape_text (GMarkupParseContext *context,
 	}
     }
 
-  if (context->state == STATE_ERROR)
-    {
-      g_string_free (str, TRUE);
-      *unescaped = NULL;
-      return FALSE;
-    }
-  else
-    {
-      *unescaped = g_string_free (str, FALSE);
-      return TRUE;
-    }
+  return context->state != STATE_ERROR;
 
 #undef MAX_ENT_LEN
 }
@@ -635,22 +707,9 @@ unescape_text (GMarkupParseContext *context,
 static gboolean
 advance_char (GMarkupParseContext *context)
 {
-
   context->iter = g_utf8_next_char (context->iter);
-  context->char_number += 1;
 
-  if (context->iter != context->current_text_end)
-    {
-      if (*context->iter == '\n')
-        {
-          context->line_number += 1;
-          context->char_number = 1;
-        }
-
-      return TRUE;
-    }
-  else
-    return FALSE;
+  return context->iter != context->current_text_end;
 }
 
 static gboolean
@@ -662,23 +721,55 @@ xml_isspace (char c)
 static void
 skip_spaces (GMarkupParseContext *context)
 {
-  do
-    {
-      if (!xml_isspace (*context->iter))
-        return;
-    }
-  while (advance_char (context));
+  const gchar *p = context->iter;
+  const gchar *end = context->current_text_end;
+
+  while (p != end && xml_isspace (*p))
+    ++p;
+
+  context->iter = p;
+}
+
+/* Names are nearly always ASCII, which doesn't need the Unicode tables */
+#define IS_ASCII_NAME_CHAR(c) \
+  (g_ascii_isalnum (c) || (c) == '.' || (c) == '-' || (c) == '_' || (c) == ':')
+
+static gboolean
+is_name_start_utf8 (const gchar *p)
+{
+  guchar c = *p;
+
+  if (c < 0x80)
+    return g_ascii_isalpha (c) || c == '_' || c == ':';
+  else
+    return is_name_start_char (g_utf8_get_char (p));
 }
 
 static void
 advance_to_name_end (GMarkupParseContext *context)
 {
-  do
+  const gchar *p = context->iter;
+  const gchar *end = context->current_text_end;
+
+  while (p != end)
     {
-      if (!is_name_char (g_utf8_get_char (context->iter)))
-        return;
+      guchar c = *p;
+
+      if (c < 0x80)
+        {
+          if (!IS_ASCII_NAME_CHAR (c))
+            break;
+          ++p;
+        }
+      else
+        {
+          if (!is_name_char (g_utf8_get_char (p)))
+            break;
+          p = g_utf8_next_char (p);
+        }
     }
-  while (advance_char (context));
+
+  context->iter = p;
 }
 
 static void
@@ -705,6 +796,45 @@ truncate_partial (GMarkupParseContext *context)
     }
 }
 
+/* Returns the text from context->start to context->iter, prefixed
+ * with whatever part of it earlier chunks left in the partial chunk.
+ * Unless the token crossed a chunk boundary, this points straight
+ * into the text being parsed. Call truncate_partial() when done.
+ */
+static const gchar*
+get_token (GMarkupParseContext *context,
+           gsize               *length)
+{
+  if (context->partial_chunk == NULL || context->partial_chunk->len == 0)
+    {
+      *length = context->iter - context->start;
+      return context->start;
+    }
+
+  add_to_partial (context, context->start, context->iter);
+  *length = context->partial_chunk->len;
+
+  return context->partial_chunk->str;
+}
+
+static const gchar*
+intern_name (GMarkupParseContext *context,
+             const gchar         *name,
+             gsize                length)
+{
+  gchar *interned;
+
+  interned = g_hash_table_lookup (context->names,
+                                  token_string (context, name, length));
+  if (interned == NULL)
+    {
+      interned = g_strndup (name, length);
+      g_hash_table_insert (context->names, interned, interned);
+    }
+
+  return interned;
+}
+
 static const gchar*
 current_element (GMarkupParseContext *context)
 {
@@ -728,24 +858,18 @@ find_current_text_end (GMarkupParseContext *context)
 
   g_assert (context->current_text_len > 0);
 
-  p = context->current_text;
-  next = g_utf8_find_next_char (p, end);
-
-  while (next && *next)
-    {
-      if (p == next)
-	next++;
-      p = next;
-      next = g_utf8_find_next_char (p, end);
-    }
+  /* Only the last character can be incomplete; step back over its
+   * continuation bytes to where it starts.
+   */
+  p = end - 1;
+  while (p != context->current_text && end - p < 6 && (*p & 0xc0) == 0x80)
+    --p;
 
-  /* p is now the start of the last character or character portion. */
-  g_assert (p != end);
   next = g_utf8_next_char (p); /* this only touches *p, nothing beyond */
 
-  if (next == end)
+  if (next <= end)
     {
-      /* whole character */
+      /* whole character, or invalid text that validation will catch */
       context->current_text_end = end;
     }
   else
@@ -758,16 +882,17 @@ find_current_text_end (GMarkupParseContext *context)
 }
 
 static void
-add_attribute (GMarkupParseContext *context, char *name)
+add_attribute (GMarkupParseContext *context, const gchar *name)
 {
   if (context->cur_attr + 2 >= context->alloc_attrs)
     {
       context->alloc_attrs += 5; /* silly magic number */
       context->attr_names = g_realloc (context->attr_names, sizeof(char*)*context->alloc_attrs);
       context->attr_values = g_realloc (context->attr_values, sizeof(char*)*context->alloc_attrs);
+      context->attr_offsets = g_realloc (context->attr_offsets, sizeof(gsize)*context->alloc_attrs);
     }
   context->cur_attr++;
-  context->attr_names[context->cur_attr] = name;
+  context->attr_names[context->cur_attr] = (gchar *) name;
   context->attr_values[context->cur_attr] = NULL;
   context->attr_names[context->cur_attr+1] = NULL;
   context->attr_values[context->cur_attr+1] = NULL;
@@ -874,6 +999,7 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
   context->current_text_len = text_len;
   context->iter = context->current_text;
   context->start = context->iter;
+  context->position_iter = context->iter;
 
   /* Nothing left after finishing the leftover char, or nothing
    * passed in to begin with.
@@ -984,7 +1110,7 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
 
               context->state = STATE_AFTER_CLOSE_TAG_SLASH;
             }
-          else if (is_name_start_char (g_utf8_get_char (context->iter)))
+          else if (is_name_start_utf8 (context->iter))
             {
               context->state = STATE_INSIDE_OPEN_TAG_NAME;
 
@@ -1067,7 +1193,6 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
                   }
               }
 
-            g_free (context->tag_stack->data);
             context->tag_stack = g_slist_delete_link (context->tag_stack,
                                                       context->tag_stack);
           }
@@ -1095,13 +1220,15 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
               /* The name has ended. Combine it with the partial chunk
                * if any; push it on the stack; enter next state.
                */
-              add_to_partial (context, context->start, context->iter);
+              const gchar *name;
+              gsize length;
+
+              name = get_token (context, &length);
               context->tag_stack =
                 g_slist_prepend (context->tag_stack,
-                                 g_string_free (context->partial_chunk,
-                                                FALSE));
+                                 (gchar *) intern_name (context, name, length));
 
-              context->partial_chunk = NULL;
+              truncate_partial (context);
 
               context->state = STATE_BETWEEN_ATTRIBUTES;
               context->start = NULL;
@@ -1129,11 +1256,13 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
               /* The name has ended. Combine it with the partial chunk
                * if any; push it on the stack; enter next state.
                */
-              add_to_partial (context, context->start, context->iter);
+              const gchar *name;
+              gsize length;
 
-              add_attribute (context, g_string_free (context->partial_chunk, FALSE));
+              name = get_token (context, &length);
+              add_attribute (context, intern_name (context, name, length));
 
-              context->partial_chunk = NULL;
+              truncate_partial (context);
               context->start = NULL;
 
               if (*context->iter == '=')
@@ -1176,7 +1305,7 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
                   advance_char (context);
                   context->state = STATE_AFTER_CLOSE_ANGLE;
                 }
-              else if (is_name_start_char (g_utf8_get_char (context->iter)))
+              else if (is_name_start_utf8 (context->iter))
                 {
                   context->state = STATE_INSIDE_ATTRIBUTE_NAME;
                   /* start of attribute name */
@@ -1215,6 +1344,15 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
 
 		  if (context->cur_attr >= 0)
 		    {
+		      gint i;
+
+		      /* The values are only placed once the buffer
+		       * holding them has stopped growing.
+		       */
+		      for (i = 0; i <= context->cur_attr; i++)
+			context->attr_values[i] = context->value_buffer->str +
+						  context->attr_offsets[i];
+
 		      attr_names = (const gchar**)context->attr_names;
 		      attr_values = (const gchar**)context->attr_values;
 		    }
@@ -1228,19 +1366,13 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
                                                         context->user_data,
                                                         &tmp_error);
 
-                  /* Go ahead and free the attributes. */
-		  for (; context->cur_attr >= 0; context->cur_attr--)
+                  /* Go ahead and clear the attributes. */
+		  if (context->cur_attr >= 0)
 		    {
-		      int pos = context->cur_attr;
-		      g_free (context->attr_names[pos]);
-		      g_free (context->attr_values[pos]);
-		      context->attr_names[pos] = context->attr_values[pos] = NULL;
+		      context->attr_names[0] = context->attr_values[0] = NULL;
+		      context->cur_attr = -1;
+		      g_string_truncate (context->value_buffer, 0);
 		    }
-                  g_assert (context->cur_attr == -1);
-                  g_assert (context->attr_names == NULL ||
-                            context->attr_names[0] == NULL);
-                  g_assert (context->attr_values == NULL ||
-                            context->attr_values[0] == NULL);
                   
                   if (tmp_error != NULL)
                     {
@@ -1295,12 +1427,10 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
 		delim = '"';
 	      }
 
-	    do
-	      {
-		if (*context->iter == delim)
-		  break;
-	      }
-	    while (advance_char (context));
+	    context->iter = memchr (context->iter, delim,
+				    context->current_text_end - context->iter);
+	    if (context->iter == NULL)
+	      context->iter = context->current_text_end;
 	  }
           if (context->iter == context->current_text_end)
             {
@@ -1315,17 +1445,29 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
                * with the partial chunk if any; set it for the current
                * attribute.
                */
-              add_to_partial (context, context->start, context->iter);
+              const gchar *value;
+              gsize length;
+              gboolean unescaped;
 
               g_assert (context->cur_attr >= 0);
-              
-              if (unescape_text (context,
-                                 context->partial_chunk->str,
-                                 context->partial_chunk->str +
-                                 context->partial_chunk->len,
-                                 &context->attr_values[context->cur_attr],
-                                 error))
+
+              value = get_token (context, &length);
+              context->attr_offsets[context->cur_attr] = context->value_buffer->len;
+
+              if (memchr (value, '&', length) == NULL)
+                {
+                  g_string_append_len (context->value_buffer, value, length);
+                  unescaped = TRUE;
+                }
+              else
+                unescaped = unescape_text (context, value, value + length,
+                                           context->value_buffer, error);
+
+              if (unescaped)
                 {
+                  /* keep each value nul-terminated */
+                  g_string_append_c (context->value_buffer, '\0');
+
                   /* success, advance past quote and set state. */
                   advance_char (context);
                   context->state = STATE_BETWEEN_ATTRIBUTES;
@@ -1338,44 +1480,48 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
 
         case STATE_INSIDE_TEXT:
           /* Possible next states: AFTER_OPEN_ANGLE */
-          do
+          context->iter = memchr (context->iter, '<',
+                                  context->current_text_end - context->iter);
+          if (context->iter == NULL)
+            context->iter = context->current_text_end;
+
+          if (context->iter == context->current_text_end)
             {
-              if (*context->iter == '<')
-                break;
+              /* The text hasn't necessarily ended. Merge with
+               * partial chunk, leave state unchanged.
+               */
+              add_to_partial (context, context->start, context->iter);
             }
-          while (advance_char (context));
-
-          /* The text hasn't necessarily ended. Merge with
-           * partial chunk, leave state unchanged.
-           */
-
-          add_to_partial (context, context->start, context->iter);
-
-          if (context->iter != context->current_text_end)
+          else
             {
-              gchar *unescaped = NULL;
+              const gchar *text;
+              gsize length;
+              gboolean unescaped = TRUE;
 
               /* The text has ended at the open angle. Call the text
-               * callback.
+               * callback, with the text itself unless it has entities.
                */
-              
-              if (unescape_text (context,
-                                 context->partial_chunk->str,
-                                 context->partial_chunk->str +
-                                 context->partial_chunk->len,
-                                 &unescaped,
-                                 error))
+              text = get_token (context, &length);
+
+              if (memchr (text, '&', length) != NULL)
+                {
+                  g_string_truncate (context->value_buffer, 0);
+                  unescaped = unescape_text (context, text, text + length,
+                                             context->value_buffer, error);
+                  text = context->value_buffer->str;
+                  length = context->value_buffer->len;
+                }
+
+              if (unescaped)
                 {
                   GError *tmp_error = NULL;
 
                   if (context->parser->text)
                     (*context->parser->text) (context,
-                                              unescaped,
-                                              strlen (unescaped),
+                                              text,
+                                              length,
                                               context->user_data,
                                               &tmp_error);
-                  
-                  g_free (unescaped);
 
                   if (tmp_error == NULL)
                     {
@@ -1398,7 +1544,7 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
 
         case STATE_AFTER_CLOSE_TAG_SLASH:
           /* Possible next state: INSIDE_CLOSE_TAG_NAME */
-          if (is_name_start_char (g_utf8_get_char (context->iter)))
+          if (is_name_start_utf8 (context->iter))
             {
               context->state = STATE_INSIDE_CLOSE_TAG_NAME;
 
@@ -1436,13 +1582,11 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
                * if any; check that it matches stack top and pop
                * stack; invoke proper callback; enter next state.
                */
-              gchar *close_name;
+              const gchar *close_name;
+              gsize length;
 
-              add_to_partial (context, context->start, context->iter);
+              close_name = get_token (context, &length);
 
-              close_name = g_string_free (context->partial_chunk, FALSE);
-              context->partial_chunk = NULL;
-              
               if (*context->iter != '>')
                 {
                   gchar buf[7];
@@ -1453,7 +1597,7 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
                                "the close element name '%s'; the allowed "
                                "character is '>'"),
                              utf8_str (context->iter, buf),
-                             close_name);
+                             token_string (context, close_name, length));
                 }
               else if (context->tag_stack == NULL)
                 {
@@ -1462,16 +1606,17 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
                              G_MARKUP_ERROR_PARSE,
                              _("Element '%s' was closed, no element "
                                "is currently open"),
-                             close_name);
+                             token_string (context, close_name, length));
                 }
-              else if (strcmp (close_name, current_element (context)) != 0)
+              else if (strncmp (close_name, current_element (context), length) != 0 ||
+                       current_element (context)[length] != '\0')
                 {
                   set_error (context,
                              error,
                              G_MARKUP_ERROR_PARSE,
                              _("Element '%s' was closed, but the currently "
                                "open element is '%s'"),
-                             close_name,
+                             token_string (context, close_name, length),
                              current_element (context));
                 }
               else
@@ -1485,13 +1630,12 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
                   tmp_error = NULL;
                   if (context->parser->end_element)
                     (* context->parser->end_element) (context,
-                                                      close_name,
+                                                      current_element (context),
                                                       context->user_data,
                                                       &tmp_error);
 
                   
                   /* Pop the tag stack */
-                  g_free (context->tag_stack->data);
                   context->tag_stack = g_slist_delete_link (context->tag_stack,
                                                             context->tag_stack);
                   
@@ -1502,14 +1646,15 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
                     }
                 }
 
-              g_free (close_name);
+              truncate_partial (context);
             }
           break;
 	  
         case STATE_INSIDE_PASSTHROUGH:
           /* Possible next state: AFTER_CLOSE_ANGLE */
-          do
+          for (; context->iter != context->current_text_end; context->iter++)
             {
+	      /* neither angle can be part of a multibyte character */
 	      if (*context->iter == '<') 
 		context->balance++;
               if (*context->iter == '>') 
@@ -1528,7 +1673,6 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
 		    break;
 		}
             }
-          while (advance_char (context));
 
           if (context->iter == context->current_text_end)
             {
@@ -1582,6 +1726,9 @@ g_markup_parse_context_parse (GMarkupParseContext *context,
     }
 
  finished:
+  update_position (context);
+  context->position_iter = NULL;
+
   context->parsing = FALSE;
 
   return context->state != STATE_ERROR;
@@ -1750,6 +1897,8 @@ g_markup_parse_context_get_position (GMarkupParseContext *context,
 {
   g_return_if_fail (context != NULL);
 
+  update_position (context);
+
   if (line_number)
     *line_number = context->line_number;
 
@@ -33,78 +33,65 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "glib.h"
 
-#ifndef DISABLE_MEM_POOLS
-/* node allocation
+/* nodes allocated from an arena have a few more fields, allowing
+ * constant time access to their child counts, last and nth children.
+ * they are only kept up to date by the functions in this file, which
+ * is why nodes from g_node_new(), that may be linked by hand, don't
+ * get them.
  */
-struct _GAllocator /* from gmem.c */
-{
-  gchar         *name;
-  guint16        n_preallocs;
-  guint          is_unused : 1;
-  guint          type : 4;
-  GAllocator    *last;
-  GMemChunk     *mem_chunk;
-  GNode         *free_nodes; /* implementation specific */
-};
+#define	G_NODE_INDEX_THRESHOLD	(8)
 
-G_LOCK_DEFINE_STATIC (current_allocator);
-static GAllocator *current_allocator = NULL;
+typedef struct _GRealNode	GRealNode;
+typedef struct _GNodeArenaBlock	GNodeArenaBlock;
 
-/* HOLDS: current_allocator_lock */
-static void
-g_node_validate_allocator (GAllocator *allocator)
+struct _GRealNode
 {
-  g_return_if_fail (allocator != NULL);
-  g_return_if_fail (allocator->is_unused == TRUE);
+  GNode		   node;
+  GNodeArenaBlock *block;	/* NULL for nodes from g_node_new() */
+};
 
-  if (allocator->type != G_ALLOCATOR_NODE)
-    {
-      allocator->type = G_ALLOCATOR_NODE;
-      if (allocator->mem_chunk)
-	{
-	  g_mem_chunk_destroy (allocator->mem_chunk);
-	  allocator->mem_chunk = NULL;
-	}
-    }
+/* the per node fields are kept apart from the nodes, which stay as
+ * small as slices of a GNode and so are as quick to walk
+ */
+struct _GNodeArenaBlock
+{
+  GNodeArenaBlock *next;
+  GNodeArena	  *arena;
+  guint		   n_used;
+  GNode		 **last_child;
+  guint		  *n_children;
+  GRealNode	   nodes[1];
+};
 
-  if (!allocator->mem_chunk)
-    {
-      allocator->mem_chunk = g_mem_chunk_new (allocator->name,
-					      sizeof (GNode),
-					      sizeof (GNode) * allocator->n_preallocs,
-					      G_ALLOC_ONLY);
-      allocator->free_nodes = NULL;
-    }
+struct _GNodeArena
+{
+  GNodeArenaBlock *blocks;
+  guint		   n_preallocs;
+  GNode		  *free_nodes;		/* linked through ->next */
+  GHashTable	  *child_indices;	/* parent -> GPtrArray of children */
+};
+
+#define	G_NODE_BLOCK(node)	(((GRealNode*) (node))->block)
+#define	G_NODE_SLOT(block, node) ((GRealNode*) (node) - (block)->nodes)
+#define	G_NODE_LAST_CHILD(node)	(G_NODE_BLOCK (node)->last_child[G_NODE_SLOT (G_NODE_BLOCK (node), node)])
+#define	G_NODE_N_CHILDREN(node)	(G_NODE_BLOCK (node)->n_children[G_NODE_SLOT (G_NODE_BLOCK (node), node)])
 
-  allocator->is_unused = FALSE;
-}
 
+/* nodes are allocated through the slice allocator or from an arena,
+ * so the GAllocator stack is no longer consulted.
+ */
 void
 g_node_push_allocator (GAllocator *allocator)
 {
-  G_LOCK (current_allocator);
-  g_node_validate_allocator (allocator);
-  allocator->last = current_allocator;
-  current_allocator = allocator;
-  G_UNLOCK (current_allocator);
 }
 
 void
 g_node_pop_allocator (void)
 {
-  G_LOCK (current_allocator);
-  if (current_allocator)
-    {
-      GAllocator *allocator;
-
-      allocator = current_allocator;
-      current_allocator = allocator->last;
-      allocator->last = NULL;
-      allocator->is_unused = TRUE;
-    }
-  G_UNLOCK (current_allocator);
 }
 
 
@@ -112,93 +99,229 @@ g_node_pop_allocator (void)
 GNode*
 g_node_new (gpointer data)
 {
-  GNode *node;
+  GRealNode *rnode;
+
+  rnode = g_slice_new0 (GRealNode);
+  rnode->node.data = data;
+  
+  return &rnode->node;
+}
+
+GNodeArena*
+g_node_arena_new (guint n_preallocs)
+{
+  GNodeArena *arena;
+
+  arena = g_new0 (GNodeArena, 1);
+  arena->n_preallocs = n_preallocs ? n_preallocs : 1024;
+
+  return arena;
+}
 
-  G_LOCK (current_allocator);
-  if (!current_allocator)
+GNode*
+g_node_arena_new_node (GNodeArena *arena,
+		       gpointer    data)
+{
+  GNodeArenaBlock *block;
+  GRealNode *rnode;
+
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  if (arena->free_nodes)
     {
-       GAllocator *allocator = g_allocator_new ("GLib default GNode allocator",
-						128);
-       g_node_validate_allocator (allocator);
-       allocator->last = NULL;
-       current_allocator = allocator;
+      rnode = (GRealNode*) arena->free_nodes;
+      arena->free_nodes = rnode->node.next;
+      block = rnode->block;
     }
-  if (!current_allocator->free_nodes)
-    node = g_chunk_new (GNode, current_allocator->mem_chunk);
   else
     {
-      node = current_allocator->free_nodes;
-      current_allocator->free_nodes = node->next;
+      guint n = arena->n_preallocs;
+
+      block = arena->blocks;
+      if (!block || block->n_used == n)
+	{
+	  block = g_malloc (G_STRUCT_OFFSET (GNodeArenaBlock, nodes) +
+			    n * (sizeof (GRealNode) + sizeof (GNode*) + sizeof (guint)));
+	  block->next = arena->blocks;
+	  block->arena = arena;
+	  block->n_used = 0;
+	  block->last_child = (GNode**) (block->nodes + n);
+	  block->n_children = (guint*) (block->last_child + n);
+	  arena->blocks = block;
+	}
+      rnode = &block->nodes[block->n_used++];
+      rnode->block = block;
     }
-  G_UNLOCK (current_allocator);
-  
-  node->data = data;
-  node->next = NULL;
-  node->prev = NULL;
-  node->parent = NULL;
-  node->children = NULL;
-  
-  return node;
+
+  rnode->node.data = data;
+  rnode->node.next = NULL;
+  rnode->node.prev = NULL;
+  rnode->node.parent = NULL;
+  rnode->node.children = NULL;
+  block->last_child[G_NODE_SLOT (block, rnode)] = NULL;
+  block->n_children[G_NODE_SLOT (block, rnode)] = 0;
+
+  return &rnode->node;
+}
+
+void
+g_node_arena_free (GNodeArena *arena)
+{
+  g_return_if_fail (arena != NULL);
+
+  while (arena->blocks)
+    {
+      GNodeArenaBlock *block = arena->blocks;
+
+      arena->blocks = block->next;
+      g_free (block);
+    }
+  if (arena->child_indices)
+    g_hash_table_destroy (arena->child_indices);
+  g_free (arena);
 }
 
 static void
-g_nodes_free (GNode *node)
+g_node_index_free (gpointer index)
+{
+  g_ptr_array_free (index, TRUE);
+}
+
+static inline GPtrArray*
+g_node_index_lookup (GNodeArena *arena,
+		     GNode	*parent)
 {
-  GNode *parent;
+  return arena->child_indices ? g_hash_table_lookup (arena->child_indices, parent) : NULL;
+}
 
-  parent = node;
-  while (1)
+static inline void
+g_node_index_drop (GNodeArena *arena,
+		   GNode      *parent)
+{
+  if (arena->child_indices)
+    g_hash_table_remove (arena->child_indices, parent);
+}
+
+/* returns the children of an arena node as an array, built on first use
+ * and kept until the children are changed other than by appending
+ */
+static GPtrArray*
+g_node_index_get (GNode *parent)
+{
+  GNodeArena *arena = G_NODE_BLOCK (parent)->arena;
+  GPtrArray *index;
+  GNode *child;
+
+  index = g_node_index_lookup (arena, parent);
+  if (index)
+    return index;
+
+  if (!arena->child_indices)
+    arena->child_indices = g_hash_table_new_full (NULL, NULL, NULL, g_node_index_free);
+  index = g_ptr_array_sized_new (G_NODE_N_CHILDREN (parent));
+  for (child = parent->children; child; child = child->next)
+    g_ptr_array_add (index, child);
+  g_hash_table_insert (arena->child_indices, parent, index);
+
+  return index;
+}
+
+/* @node has just been linked into the children of the arena node @parent */
+static void
+g_node_arena_linked (GNode *parent,
+		     GNode *node)
+{
+  GNodeArena *arena = G_NODE_BLOCK (parent)->arena;
+  GPtrArray *index;
+
+  G_NODE_N_CHILDREN (parent)++;
+  if (!node->next)
+    G_NODE_LAST_CHILD (parent) = node;
+
+  index = g_node_index_lookup (arena, parent);
+  if (index)
     {
-      if (parent->children)
-	g_nodes_free (parent->children);
+      if (!node->next)
+	g_ptr_array_add (index, node);
+      else
+	g_node_index_drop (arena, parent);
+    }
+}
 
-#ifdef ENABLE_GC_FRIENDLY
-      parent->data = NULL;
-      parent->prev = NULL;
-      parent->parent = NULL;
-      parent->children = NULL;
-#endif /* ENABLE_GC_FRIENDLY */
+/* @node is about to be unlinked from the children of the arena node @parent */
+static void
+g_node_arena_unlinked (GNode *parent,
+		       GNode *node)
+{
+  GNodeArena *arena = G_NODE_BLOCK (parent)->arena;
+  GPtrArray *index;
 
-      if (parent->next)
-	parent = parent->next;
+  G_NODE_N_CHILDREN (parent)--;
+  if (G_NODE_LAST_CHILD (parent) == node)
+    G_NODE_LAST_CHILD (parent) = node->prev;
+
+  index = g_node_index_lookup (arena, parent);
+  if (index)
+    {
+      if (!node->next)
+	g_ptr_array_set_size (index, index->len - 1);
       else
-	break;
+	g_node_index_drop (arena, parent);
     }
-  
-  G_LOCK (current_allocator);
-  parent->next = current_allocator->free_nodes;
-  current_allocator->free_nodes = node;
-  G_UNLOCK (current_allocator);
 }
-#else /* DISABLE_MEM_POOLS */
 
-GNode*
-g_node_new (gpointer data)
+static inline void
+g_node_free_1 (GNode *node)
 {
-  GNode *node;
+  GNodeArenaBlock *block = G_NODE_BLOCK (node);
 
-  node = g_new0 (GNode, 1);
-  
-  node->data = data;
-  
-  return node;
+#ifdef ENABLE_GC_FRIENDLY
+  node->data = NULL;
+  node->prev = NULL;
+  node->parent = NULL;
+  node->children = NULL;
+#endif /* ENABLE_GC_FRIENDLY */
+
+  if (block)
+    {
+      g_node_index_drop (block->arena, node);
+      node->next = block->arena->free_nodes;
+      block->arena->free_nodes = node;
+    }
+  else
+    g_slice_free (GRealNode, (GRealNode*) node);
 }
 
+/* frees @root, which has no siblings, and all of its descendants,
+ * leaves first so no stack is needed
+ */
 static void
 g_nodes_free (GNode *root)
 {
-  GNode *node, *next;
-  
-  node = root;
-  while (node != NULL)
+  GNode *node = root;
+
+  while (TRUE)
     {
+      GNode *parent, *next;
+
+      while (node->children)
+	node = node->children;
+      if (node == root)
+	break;
+
+      parent = node->parent;
       next = node->next;
-      g_nodes_free (node->children);
-      g_free (node);
-      node = next;
+      g_node_free_1 (node);
+      if (next)
+	node = next;
+      else
+	{
+	  parent->children = NULL;
+	  node = parent;
+	}
     }
+  g_node_free_1 (root);
 }
-#endif
 
 void
 g_node_destroy (GNode *root)
@@ -216,6 +339,9 @@ g_node_unlink (GNode *node)
 {
   g_return_if_fail (node != NULL);
   
+  if (node->parent && G_NODE_BLOCK (node->parent))
+    g_node_arena_unlinked (node->parent, node);
+  
   if (node->prev)
     node->prev->next = node->next;
   else if (node->parent)
@@ -238,7 +364,10 @@ g_node_copy (GNode *node)
     {
       GNode *child;
       
-      new_node = g_node_new (node->data);
+      if (G_NODE_BLOCK (node))
+	new_node = g_node_arena_new_node (G_NODE_BLOCK (node)->arena, node->data);
+      else
+	new_node = g_node_new (node->data);
       
       for (child = g_node_last_child (node); child; child = child->prev)
 	g_node_prepend (new_node, g_node_copy (child));
@@ -299,9 +428,14 @@ g_node_insert_before (GNode *parent,
     {
       if (parent->children)
 	{
-	  sibling = parent->children;
-	  while (sibling->next)
-	    sibling = sibling->next;
+	  if (G_NODE_BLOCK (parent))
+	    sibling = G_NODE_LAST_CHILD (parent);
+	  else
+	    {
+	      sibling = parent->children;
+	      while (sibling->next)
+		sibling = sibling->next;
+	    }
 	  node->prev = sibling;
 	  sibling->next = node;
 	}
@@ -309,6 +443,9 @@ g_node_insert_before (GNode *parent,
 	node->parent->children = node;
     }
 
+  if (G_NODE_BLOCK (parent))
+    g_node_arena_linked (parent, node);
+
   return node;
 }
 
@@ -345,6 +482,9 @@ g_node_insert_after (GNode *parent,
       parent->children = node;
     }
 
+  if (G_NODE_BLOCK (parent))
+    g_node_arena_linked (parent, node);
+
   return node;
 }
 
@@ -420,311 +560,343 @@ g_node_reverse_children (GNode *node)
       last->next = last->prev;
       last->prev = child;
     }
+  
+  if (G_NODE_BLOCK (node))
+    {
+      G_NODE_LAST_CHILD (node) = node->children;
+      g_node_index_drop (G_NODE_BLOCK (node)->arena, node);
+    }
   node->children = last;
 }
 
 guint
 g_node_max_height (GNode *root)
 {
-  register GNode *child;
+  register GNode *node;
+  register guint depth = 1;
   register guint max_height = 0;
   
   if (!root)
     return 0;
   
-  child = root->children;
-  while (child)
+  node = root;
+  while (TRUE)
     {
-      register guint tmp_height;
+      if (depth > max_height)
+	max_height = depth;
       
-      tmp_height = g_node_max_height (child);
-      if (tmp_height > max_height)
-	max_height = tmp_height;
-      child = child->next;
+      if (node->children)
+	{
+	  node = node->children;
+	  depth++;
+	  continue;
+	}
+      
+      while (node != root && !node->next)
+	{
+	  node = node->parent;
+	  depth--;
+	}
+      if (node == root)
+	break;
+      node = node->next;
     }
   
-  return max_height + 1;
+  return max_height;
 }
 
-static gboolean
-g_node_traverse_pre_order (GNode	    *node,
-			   GTraverseFlags    flags,
-			   GNodeTraverseFunc func,
-			   gpointer	     data)
+/* the traversals keep their own stack of children still to be
+ * visited. like the recursive versions they replace, they read the
+ * next sibling before visiting a node, so @func may destroy it.
+ */
+typedef struct _GNodeFrame GNodeFrame;
+typedef struct _GNodeStack GNodeStack;
+
+struct _GNodeFrame
 {
-  if (node->children)
+  GNode	   *parent;
+  GNode	   *next;		/* next child of parent to visit */
+  gboolean  parent_pending;	/* in-order: parent not visited yet */
+};
+
+struct _GNodeStack
+{
+  GNodeFrame *frames;
+  guint	      n_frames;
+  guint	      n_alloced;
+  GNodeFrame  prealloced[32];
+};
+
+static inline void
+g_node_stack_init (GNodeStack *stack)
+{
+  stack->frames = stack->prealloced;
+  stack->n_frames = 0;
+  stack->n_alloced = G_N_ELEMENTS (stack->prealloced);
+}
+
+static inline void
+g_node_stack_push (GNodeStack *stack,
+		   GNode      *parent,
+		   GNode      *next,
+		   gboolean    parent_pending)
+{
+  GNodeFrame *frame;
+  
+  if (stack->n_frames == stack->n_alloced)
     {
-      GNode *child;
-      
-      if ((flags & G_TRAVERSE_NON_LEAFS) &&
-	  func (node, data))
-	return TRUE;
-      
-      child = node->children;
-      while (child)
+      stack->n_alloced *= 2;
+      if (stack->frames == stack->prealloced)
 	{
-	  register GNode *current;
-	  
-	  current = child;
-	  child = current->next;
-	  if (g_node_traverse_pre_order (current, flags, func, data))
-	    return TRUE;
+	  stack->frames = g_new (GNodeFrame, stack->n_alloced);
+	  memcpy (stack->frames, stack->prealloced, sizeof (stack->prealloced));
 	}
+      else
+	stack->frames = g_renew (GNodeFrame, stack->frames, stack->n_alloced);
     }
-  else if ((flags & G_TRAVERSE_LEAFS) &&
-	   func (node, data))
-    return TRUE;
   
-  return FALSE;
+  frame = &stack->frames[stack->n_frames++];
+  frame->parent = parent;
+  frame->next = next;
+  frame->parent_pending = parent_pending;
 }
 
-static gboolean
-g_node_depth_traverse_pre_order (GNode		  *node,
-				 GTraverseFlags	   flags,
-				 guint		   depth,
-				 GNodeTraverseFunc func,
-				 gpointer	   data)
+static inline void
+g_node_stack_free (GNodeStack *stack)
+{
+  if (stack->frames != stack->prealloced)
+    g_free (stack->frames);
+}
+
+static inline gboolean
+g_node_visit (GNode		*node,
+	      GTraverseFlags	 flags,
+	      GNodeTraverseFunc	 func,
+	      gpointer		 data)
 {
   if (node->children)
+    return (flags & G_TRAVERSE_NON_LEAFS) && func (node, data);
+  else
+    return (flags & G_TRAVERSE_LEAFS) && func (node, data);
+}
+
+/* the node being visited is at depth stack.n_frames + 1, its children
+ * are only visited if that is less than @max_depth
+ */
+static gboolean
+g_node_traverse_pre_order (GNode	    *root,
+			   GTraverseFlags    flags,
+			   guint	     max_depth,
+			   GNodeTraverseFunc func,
+			   gpointer	     data)
+{
+  GNodeStack stack;
+  GNode *node = root;
+  gboolean result = FALSE;
+  
+  g_node_stack_init (&stack);
+  while (node)
     {
-      GNode *child;
-      
-      if ((flags & G_TRAVERSE_NON_LEAFS) &&
-	  func (node, data))
-	return TRUE;
-      
-      depth--;
-      if (!depth)
-	return FALSE;
+      if (g_node_visit (node, flags, func, data))
+	{
+	  result = TRUE;
+	  break;
+	}
+      if (node->children && stack.n_frames + 1 < max_depth)
+	g_node_stack_push (&stack, node, node->children, FALSE);
       
-      child = node->children;
-      while (child)
+      node = NULL;
+      while (stack.n_frames)
 	{
-	  register GNode *current;
+	  GNodeFrame *frame = &stack.frames[stack.n_frames - 1];
 	  
-	  current = child;
-	  child = current->next;
-	  if (g_node_depth_traverse_pre_order (current, flags, depth, func, data))
-	    return TRUE;
+	  if (frame->next)
+	    {
+	      node = frame->next;
+	      frame->next = node->next;
+	      break;
+	    }
+	  stack.n_frames--;
 	}
     }
-  else if ((flags & G_TRAVERSE_LEAFS) &&
-	   func (node, data))
-    return TRUE;
+  g_node_stack_free (&stack);
   
-  return FALSE;
+  return result;
 }
 
 static gboolean
-g_node_traverse_post_order (GNode	     *node,
+g_node_traverse_post_order (GNode	     *root,
 			    GTraverseFlags    flags,
+			    guint	      max_depth,
 			    GNodeTraverseFunc func,
 			    gpointer	      data)
 {
-  if (node->children)
+  GNodeStack stack;
+  GNode *node = root;
+  gboolean result = FALSE;
+  
+  g_node_stack_init (&stack);
+  while (node)
     {
-      GNode *child;
-      
-      child = node->children;
-      while (child)
+      if (node->children && stack.n_frames + 1 < max_depth)
+	g_node_stack_push (&stack, node, node->children, FALSE);
+      else if (g_node_visit (node, flags, func, data))
 	{
-	  register GNode *current;
-	  
-	  current = child;
-	  child = current->next;
-	  if (g_node_traverse_post_order (current, flags, func, data))
-	    return TRUE;
+	  result = TRUE;
+	  break;
 	}
       
-      if ((flags & G_TRAVERSE_NON_LEAFS) &&
-	  func (node, data))
-	return TRUE;
-      
-    }
-  else if ((flags & G_TRAVERSE_LEAFS) &&
-	   func (node, data))
-    return TRUE;
-  
-  return FALSE;
-}
-
-static gboolean
-g_node_depth_traverse_post_order (GNode		   *node,
-				  GTraverseFlags    flags,
-				  guint		    depth,
-				  GNodeTraverseFunc func,
-				  gpointer	    data)
-{
-  if (node->children)
-    {
-      depth--;
-      if (depth)
+      node = NULL;
+      while (stack.n_frames)
 	{
-	  GNode *child;
+	  GNodeFrame *frame = &stack.frames[stack.n_frames - 1];
 	  
-	  child = node->children;
-	  while (child)
+	  if (frame->next)
 	    {
-	      register GNode *current;
-	      
-	      current = child;
-	      child = current->next;
-	      if (g_node_depth_traverse_post_order (current, flags, depth, func, data))
-		return TRUE;
+	      node = frame->next;
+	      frame->next = node->next;
+	      break;
+	    }
+	  stack.n_frames--;
+	  if ((flags & G_TRAVERSE_NON_LEAFS) &&
+	      func (frame->parent, data))
+	    {
+	      result = TRUE;
+	      break;
 	    }
 	}
-      
-      if ((flags & G_TRAVERSE_NON_LEAFS) &&
-	  func (node, data))
-	return TRUE;
-      
+      if (result)
+	break;
     }
-  else if ((flags & G_TRAVERSE_LEAFS) &&
-	   func (node, data))
-    return TRUE;
+  g_node_stack_free (&stack);
   
-  return FALSE;
+  return result;
 }
 
 static gboolean
-g_node_traverse_in_order (GNode		   *node,
+g_node_traverse_in_order (GNode		   *root,
 			  GTraverseFlags    flags,
+			  guint		    max_depth,
 			  GNodeTraverseFunc func,
 			  gpointer	    data)
 {
-  if (node->children)
-    {
-      GNode *child;
-      register GNode *current;
-      
-      child = node->children;
-      current = child;
-      child = current->next;
-      
-      if (g_node_traverse_in_order (current, flags, func, data))
-	return TRUE;
-      
-      if ((flags & G_TRAVERSE_NON_LEAFS) &&
-	  func (node, data))
-	return TRUE;
-      
-      while (child)
-	{
-	  current = child;
-	  child = current->next;
-	  if (g_node_traverse_in_order (current, flags, func, data))
-	    return TRUE;
-	}
-    }
-  else if ((flags & G_TRAVERSE_LEAFS) &&
-	   func (node, data))
-    return TRUE;
+  GNodeStack stack;
+  GNode *node = root;
+  gboolean result = FALSE;
   
-  return FALSE;
-}
-
-static gboolean
-g_node_depth_traverse_in_order (GNode		 *node,
-				GTraverseFlags	  flags,
-				guint		  depth,
-				GNodeTraverseFunc func,
-				gpointer	  data)
-{
-  if (node->children)
+  g_node_stack_init (&stack);
+  while (node)
     {
-      depth--;
-      if (depth)
+      /* the first child is visited before its parent */
+      while (node->children && stack.n_frames + 1 < max_depth)
 	{
-	  GNode *child;
-	  register GNode *current;
-	  
-	  child = node->children;
-	  current = child;
-	  child = current->next;
-	  
-	  if (g_node_depth_traverse_in_order (current, flags, depth, func, data))
-	    return TRUE;
+	  GNode *child = node->children;
 	  
-	  if ((flags & G_TRAVERSE_NON_LEAFS) &&
-	      func (node, data))
-	    return TRUE;
+	  g_node_stack_push (&stack, node, child->next, TRUE);
+	  node = child;
+	}
+      if (g_node_visit (node, flags, func, data))
+	{
+	  result = TRUE;
+	  break;
+	}
+      
+      node = NULL;
+      while (stack.n_frames)
+	{
+	  GNodeFrame *frame = &stack.frames[stack.n_frames - 1];
 	  
-	  while (child)
+	  if (frame->parent_pending)
 	    {
-	      current = child;
-	      child = current->next;
-	      if (g_node_depth_traverse_in_order (current, flags, depth, func, data))
-		return TRUE;
+	      frame->parent_pending = FALSE;
+	      if ((flags & G_TRAVERSE_NON_LEAFS) &&
+		  func (frame->parent, data))
+		{
+		  result = TRUE;
+		  break;
+		}
 	    }
+	  else if (frame->next)
+	    {
+	      node = frame->next;
+	      frame->next = node->next;
+	      break;
+	    }
+	  else
+	    stack.n_frames--;
 	}
-      else if ((flags & G_TRAVERSE_NON_LEAFS) &&
-	       func (node, data))
-	return TRUE;
+      if (result)
+	break;
     }
-  else if ((flags & G_TRAVERSE_LEAFS) &&
-	   func (node, data))
-    return TRUE;
+  g_node_stack_free (&stack);
   
-  return FALSE;
+  return result;
 }
 
+/* visits a level at a time, walking the children of the nodes of the
+ * previous level that had any
+ */
 static gboolean
-g_node_traverse_level (GNode		 *node,
-		       GTraverseFlags	  flags,
-		       guint		  level,
-		       GNodeTraverseFunc func,
-		       gpointer	  data,
-		       gboolean         *more_levels)
-{
-  if (level == 0) 
+g_node_traverse_level_order (GNode	      *root,
+			     GTraverseFlags    flags,
+			     guint	       max_depth,
+			     GNodeTraverseFunc func,
+			     gpointer	       data)
+{
+  GPtrArray *parents, *next_parents;
+  gboolean result;
+  guint depth;
+  
+  result = g_node_visit (root, flags, func, data);
+  if (result || !root->children || max_depth < 2)
+    return result;
+  
+  parents = g_ptr_array_new ();
+  next_parents = g_ptr_array_new ();
+  g_ptr_array_add (parents, root);
+  
+  for (depth = 2; parents->len; depth++)
     {
-      if (node->children)
-	{
-	  *more_levels = TRUE;
-	  return (flags & G_TRAVERSE_NON_LEAFS) && func (node, data);
-	}
-      else
+      GPtrArray *tmp;
+      guint i;
+      
+      for (i = 0; i < parents->len && !result; i++)
 	{
-	  return (flags & G_TRAVERSE_LEAFS) && func (node, data);
+	  GNode *node = ((GNode*) parents->pdata[i])->children;
+	  
+	  while (node)
+	    {
+	      GNode *current = node;
+	      
+	      node = current->next;
+	      if (g_node_visit (current, flags, func, data))
+		{
+		  result = TRUE;
+		  break;
+		}
+	    }
 	}
-    }
-  else 
-    {
-      node = node->children;
+      if (result || depth >= max_depth)
+	break;
       
-      while (node)
+      g_ptr_array_set_size (next_parents, 0);
+      for (i = 0; i < parents->len; i++)
 	{
-	  if (g_node_traverse_level (node, flags, level - 1, func, data, more_levels))
-	    return TRUE;
-
-	  node = node->next;
+	  GNode *node;
+	  
+	  for (node = ((GNode*) parents->pdata[i])->children; node; node = node->next)
+	    if (node->children)
+	      g_ptr_array_add (next_parents, node);
 	}
+      tmp = parents;
+      parents = next_parents;
+      next_parents = tmp;
     }
-
-  return FALSE;
-}
-
-static gboolean
-g_node_depth_traverse_level (GNode		 *node,
-			     GTraverseFlags	  flags,
-			     guint		  depth,
-			     GNodeTraverseFunc func,
-			     gpointer	  data)
-{
-  gint level;
-  gboolean more_levels;
-
-  level = 0;  
-  while (level != depth) 
-    {
-      more_levels = FALSE;
-      if (g_node_traverse_level (node, flags, level, func, data, &more_levels))
-	return TRUE;
-      if (!more_levels)
-	break;
-      level++;
-    }
-  return FALSE;
+  
+  g_ptr_array_free (parents, TRUE);
+  g_ptr_array_free (next_parents, TRUE);
+  
+  return result;
 }
 
 void
@@ -735,34 +907,29 @@ g_node_traverse (GNode		  *root,
 		 GNodeTraverseFunc func,
 		 gpointer	   data)
 {
+  guint max_depth;
+  
   g_return_if_fail (root != NULL);
   g_return_if_fail (func != NULL);
   g_return_if_fail (order <= G_LEVEL_ORDER);
   g_return_if_fail (flags <= G_TRAVERSE_MASK);
   g_return_if_fail (depth == -1 || depth > 0);
   
+  max_depth = depth < 0 ? G_MAXUINT : depth;
+  
   switch (order)
     {
     case G_PRE_ORDER:
-      if (depth < 0)
-	g_node_traverse_pre_order (root, flags, func, data);
-      else
-	g_node_depth_traverse_pre_order (root, flags, depth, func, data);
+      g_node_traverse_pre_order (root, flags, max_depth, func, data);
       break;
     case G_POST_ORDER:
-      if (depth < 0)
-	g_node_traverse_post_order (root, flags, func, data);
-      else
-	g_node_depth_traverse_post_order (root, flags, depth, func, data);
+      g_node_traverse_post_order (root, flags, max_depth, func, data);
       break;
     case G_IN_ORDER:
-      if (depth < 0)
-	g_node_traverse_in_order (root, flags, func, data);
-      else
-	g_node_depth_traverse_in_order (root, flags, depth, func, data);
+      g_node_traverse_in_order (root, flags, max_depth, func, data);
       break;
     case G_LEVEL_ORDER:
-      g_node_depth_traverse_level (root, flags, depth, func, data);
+      g_node_traverse_level_order (root, flags, max_depth, func, data);
       break;
     }
 }
@@ -801,39 +968,35 @@ g_node_find (GNode	       *root,
   return d[1];
 }
 
-static void
-g_node_count_func (GNode	 *node,
-		   GTraverseFlags flags,
-		   guint	 *n)
-{
-  if (node->children)
-    {
-      GNode *child;
-      
-      if (flags & G_TRAVERSE_NON_LEAFS)
-	(*n)++;
-      
-      child = node->children;
-      while (child)
-	{
-	  g_node_count_func (child, flags, n);
-	  child = child->next;
-	}
-    }
-  else if (flags & G_TRAVERSE_LEAFS)
-    (*n)++;
-}
-
 guint
 g_node_n_nodes (GNode	      *root,
 		GTraverseFlags flags)
 {
+  GNode *node;
   guint n = 0;
   
   g_return_val_if_fail (root != NULL, 0);
   g_return_val_if_fail (flags <= G_TRAVERSE_MASK, 0);
   
-  g_node_count_func (root, flags, &n);
+  node = root;
+  while (TRUE)
+    {
+      if (node->children)
+	{
+	  if (flags & G_TRAVERSE_NON_LEAFS)
+	    n++;
+	  node = node->children;
+	  continue;
+	}
+      
+      if (flags & G_TRAVERSE_LEAFS)
+	n++;
+      while (node != root && !node->next)
+	node = node->parent;
+      if (node == root)
+	break;
+      node = node->next;
+    }
   
   return n;
 }
@@ -843,6 +1006,9 @@ g_node_last_child (GNode *node)
 {
   g_return_val_if_fail (node != NULL, NULL);
   
+  if (G_NODE_BLOCK (node))
+    return G_NODE_LAST_CHILD (node);
+  
   node = node->children;
   if (node)
     while (node->next)
@@ -857,6 +1023,14 @@ g_node_nth_child (GNode *node,
 {
   g_return_val_if_fail (node != NULL, NULL);
   
+  if (G_NODE_BLOCK (node) &&
+      G_NODE_N_CHILDREN (node) > G_NODE_INDEX_THRESHOLD)
+    {
+      GPtrArray *index = g_node_index_get (node);
+      
+      return n < index->len ? index->pdata[n] : NULL;
+    }
+  
   node = node->children;
   if (node)
     while ((n-- > 0) && node)
@@ -872,6 +1046,9 @@ g_node_n_children (GNode *node)
   
   g_return_val_if_fail (node != NULL, 0);
   
+  if (G_NODE_BLOCK (node))
+    return G_NODE_N_CHILDREN (node);
+  
   node = node->children;
   while (node)
     {
@@ -973,6 +1150,9 @@ g_node_last_sibling (GNode *node)
 {
   g_return_val_if_fail (node != NULL, NULL);
   
+  if (node->parent && G_NODE_BLOCK (node->parent))
+    return G_NODE_LAST_CHILD (node->parent);
+  
   while (node->next)
     node = node->next;
   
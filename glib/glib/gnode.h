@@ -32,6 +32,7 @@
 G_BEGIN_DECLS
 
 typedef struct _GNode		GNode;
+typedef struct _GNodeArena	GNodeArena;
 
 /* Tree traverse flags */
 typedef enum
@@ -75,6 +76,19 @@ struct _GNode
 void     g_node_push_allocator  (GAllocator       *allocator);
 void     g_node_pop_allocator   (void);
 GNode*	 g_node_new		(gpointer	   data);
+
+/* arenas hand out nodes from blocks of n_preallocs nodes (0 picks a
+ * default) and release all of them at once in g_node_arena_free().
+ * children of arena nodes must only be linked, unlinked and reordered
+ * through the functions below, which keep child counts, the last
+ * child and an index for g_node_nth_child() current.
+ * an arena may only be used by one thread at a time.
+ */
+GNodeArena* g_node_arena_new	  (guint	   n_preallocs);
+GNode*	    g_node_arena_new_node (GNodeArena	  *arena,
+				   gpointer	   data);
+void	    g_node_arena_free	  (GNodeArena	  *arena);
+
 void	 g_node_destroy		(GNode		  *root);
 void	 g_node_unlink		(GNode		  *node);
 GNode*   g_node_copy            (GNode            *node);
@@ -38,6 +38,13 @@
 
 #include "glib.h"
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef G_OS_WIN32
+#include <windows.h>
+#endif
 
 /* Byte-wise swap two items of size SIZE. */
 #define SWAP(a, b, size)						      \
@@ -96,24 +103,12 @@ stack_node;
  *    in this case)!
  */
 
-/**
- * g_qsort_with_data:
- * @pbase: start of array to sort
- * @total_elems: elements in the array
- * @size: size of each element
- * @compare_func: function to compare elements
- * @user_data: data to pass to @compare_func
- *
- * This is just like the standard C qsort() function, but
- * the comparison routine accepts a user data argument.
- * 
- **/
-void
-g_qsort_with_data (gconstpointer    pbase,
-		   gint             total_elems,
-		   size_t           size,
-		   GCompareDataFunc compare_func,
-		   gpointer         user_data)
+static void
+quicksort (gconstpointer    pbase,
+	   gint             total_elems,
+	   size_t           size,
+	   GCompareDataFunc compare_func,
+	   gpointer         user_data)
 {
   register char *base_ptr = (char *) pbase;
 
@@ -123,10 +118,6 @@ g_qsort_with_data (gconstpointer    pbase,
   char *pivot_buffer = (char *) g_alloca (size);
   const size_t max_thresh = MAX_THRESH * size;
 
-  g_return_if_fail (total_elems >= 0);
-  g_return_if_fail (pbase != NULL || total_elems == 0);
-  g_return_if_fail (compare_func != NULL);
-
   if (total_elems == 0)
     return;
 
@@ -286,3 +277,565 @@ g_qsort_with_data (gconstpointer    pbase,
       }
   }
 }
+
+
+/* Stable merge sort.  Runs shorter than MIN_RUN are extended with
+ * binary insertion sort; in adaptive mode the input is first split
+ * into its natural ascending (or strictly descending, which are
+ * reversed) runs, so already sorted and nearly sorted arrays cost
+ * little more than one pass of comparisons.  Merging only touches
+ * the part of two runs that actually overlaps and buffers the
+ * shorter side.
+ */
+#define MIN_RUN 16
+
+typedef struct
+{
+  char            *base;
+  size_t           size;
+  GCompareDataFunc compare_func;
+  gpointer         user_data;
+}
+sort_context;
+
+#define ELT(ctx, i)	((ctx)->base + (size_t) (i) * (ctx)->size)
+#define CMP(ctx, a, b)	((*(ctx)->compare_func) ((void *) (a), (void *) (b), \
+						 (ctx)->user_data))
+
+/* Returns the first index in [lo, hi) whose element sorts after KEY. */
+static gint
+upper_bound (sort_context *ctx,
+	     gint          lo,
+	     gint          hi,
+	     const char   *key)
+{
+  while (lo < hi)
+    {
+      gint mid = lo + (hi - lo) / 2;
+
+      if (CMP (ctx, key, ELT (ctx, mid)) < 0)
+	hi = mid;
+      else
+	lo = mid + 1;
+    }
+
+  return lo;
+}
+
+/* Returns the first index in [lo, hi) whose element does not sort
+ * before KEY. */
+static gint
+lower_bound (sort_context *ctx,
+	     gint          lo,
+	     gint          hi,
+	     const char   *key)
+{
+  while (lo < hi)
+    {
+      gint mid = lo + (hi - lo) / 2;
+
+      if (CMP (ctx, ELT (ctx, mid), key) < 0)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  return lo;
+}
+
+/* Sorts [lo, hi) given that [lo, start) is already sorted. TMP must
+ * have room for one element. */
+static void
+binary_insertion_sort (sort_context *ctx,
+		       gint          lo,
+		       gint          start,
+		       gint          hi,
+		       char         *tmp)
+{
+  const size_t size = ctx->size;
+  gint i;
+
+  for (i = start; i < hi; i++)
+    {
+      gint pos;
+
+      if (CMP (ctx, ELT (ctx, i - 1), ELT (ctx, i)) <= 0)
+	continue;
+
+      pos = upper_bound (ctx, lo, i - 1, ELT (ctx, i));
+      memcpy (tmp, ELT (ctx, i), size);
+      memmove (ELT (ctx, pos + 1), ELT (ctx, pos), (size_t) (i - pos) * size);
+      memcpy (ELT (ctx, pos), tmp, size);
+    }
+}
+
+/* Returns the end of the natural run starting at LO, reversing it
+ * in place if it is descending. */
+static gint
+count_run (sort_context *ctx,
+	   gint          lo,
+	   gint          hi)
+{
+  const size_t size = ctx->size;
+  gint end = lo + 1;
+
+  if (end >= hi)
+    return hi;
+
+  if (CMP (ctx, ELT (ctx, end), ELT (ctx, lo)) < 0)
+    {
+      char *a, *b;
+
+      /* Strictly descending, so reversing keeps the sort stable. */
+      while (end + 1 < hi && CMP (ctx, ELT (ctx, end + 1), ELT (ctx, end)) < 0)
+	end++;
+
+      for (a = ELT (ctx, lo), b = ELT (ctx, end); a < b; a += size, b -= size)
+	SWAP (a, b, size);
+    }
+  else
+    {
+      while (end + 1 < hi && CMP (ctx, ELT (ctx, end + 1), ELT (ctx, end)) >= 0)
+	end++;
+    }
+
+  return end + 1;
+}
+
+/* Merges the sorted runs [lo, mid) and [mid, hi). SCRATCH must have
+ * room for (hi - lo) / 2 elements. */
+static void
+merge_runs (sort_context *ctx,
+	    gint          lo,
+	    gint          mid,
+	    gint          hi,
+	    char         *scratch)
+{
+  const size_t size = ctx->size;
+  gint n_left, n_right;
+
+  if (lo == mid || mid == hi ||
+      CMP (ctx, ELT (ctx, mid - 1), ELT (ctx, mid)) <= 0)
+    return;
+
+  /* Elements of the left run that sort before the whole right run,
+   * and elements of the right run that sort after the whole left
+   * run, are in place already. */
+  lo = upper_bound (ctx, lo, mid - 1, ELT (ctx, mid));
+  hi = lower_bound (ctx, mid + 1, hi, ELT (ctx, mid - 1));
+
+  n_left = mid - lo;
+  n_right = hi - mid;
+
+  if (n_left <= n_right)
+    {
+      char *l = scratch;
+      char *l_end = scratch + (size_t) n_left * size;
+      char *r = ELT (ctx, mid);
+      char *r_end = ELT (ctx, hi);
+      char *dest = ELT (ctx, lo);
+
+      memcpy (scratch, ELT (ctx, lo), (size_t) n_left * size);
+
+      while (l < l_end && r < r_end)
+	{
+	  if (CMP (ctx, r, l) < 0)
+	    {
+	      memcpy (dest, r, size);
+	      r += size;
+	    }
+	  else
+	    {
+	      memcpy (dest, l, size);
+	      l += size;
+	    }
+	  dest += size;
+	}
+
+      /* Whatever remains of the right run is in place already. */
+      memcpy (dest, l, l_end - l);
+    }
+  else
+    {
+      gint l = mid - 1;
+      gint r = n_right - 1;
+      gint dest = hi - 1;
+
+      memcpy (scratch, ELT (ctx, mid), (size_t) n_right * size);
+
+      while (l >= lo && r >= 0)
+	{
+	  char *r_ptr = scratch + (size_t) r * size;
+
+	  if (CMP (ctx, r_ptr, ELT (ctx, l)) < 0)
+	    memcpy (ELT (ctx, dest), ELT (ctx, l--), size);
+	  else
+	    {
+	      memcpy (ELT (ctx, dest), r_ptr, size);
+	      r--;
+	    }
+	  dest--;
+	}
+
+      /* Whatever remains of the left run is in place already. */
+      memcpy (ELT (ctx, lo), scratch, (size_t) (r + 1) * size);
+    }
+}
+
+/* Sorts [lo, hi) stably. SCRATCH must have room for (hi - lo) / 2
+ * elements, and at least one. */
+static void
+merge_sort (sort_context *ctx,
+	    gint          lo,
+	    gint          hi,
+	    gboolean      adaptive,
+	    char         *scratch)
+{
+  gint *bounds;
+  gint n_runs = 0;
+  gint i;
+
+  if (hi - lo < 2)
+    return;
+
+  /* Every run but the last is at least MIN_RUN long. */
+  bounds = g_new (gint, (hi - lo) / MIN_RUN + 2);
+
+  i = lo;
+  while (i < hi)
+    {
+      gint end = adaptive ? count_run (ctx, i, hi) : i + 1;
+
+      if (end - i < MIN_RUN && end < hi)
+	{
+	  gint forced_end = MIN (hi, i + MIN_RUN);
+
+	  binary_insertion_sort (ctx, i, end, forced_end, scratch);
+	  end = forced_end;
+	}
+
+      bounds[n_runs++] = i;
+      i = end;
+    }
+  bounds[n_runs] = hi;
+
+  /* Merge neighbouring runs pairwise until one is left. */
+  while (n_runs > 1)
+    {
+      gint r, w;
+
+      for (r = 0, w = 0; r < n_runs; r += 2, w++)
+	{
+	  if (r + 1 < n_runs)
+	    merge_runs (ctx, bounds[r], bounds[r + 1], bounds[r + 2], scratch);
+	  bounds[w] = bounds[r];
+	}
+      bounds[w] = hi;
+      n_runs = w;
+    }
+
+  g_free (bounds);
+}
+
+/* Parallel sorting splits the array into one chunk per processor,
+ * sorts the chunks on a shared thread pool and then merges them
+ * pairwise, again on the pool. The calling thread claims work items
+ * itself as well, so a sort never waits for a work item nobody has
+ * started, even when it is issued from within the pool.
+ */
+#define PARALLEL_THRESHOLD 16384
+
+typedef struct
+{
+  sort_context ctx;
+  char        *scratch;
+  gboolean     stable;
+  gboolean     adaptive;
+  gint        *bounds;
+  gint         n_chunks;
+
+  /* HOLDS: mutex */
+  gint         step;		/* 0 while sorting chunks, else the
+				 * width in chunks of the runs merged */
+  gint         n_items;
+  gint         next_item;
+  gint         n_done;
+  gint         ref_count;
+  GMutex      *mutex;
+  GCond       *cond;
+}
+sort_job;
+
+G_LOCK_DEFINE_STATIC (sort_pool);
+static GThreadPool *sort_pool = NULL;
+
+static gint
+get_n_processors (void)
+{
+  static gint n_processors = 0;
+
+  if (n_processors == 0)
+    {
+      glong n = 1;
+
+#if defined (G_OS_WIN32)
+      SYSTEM_INFO info;
+
+      GetSystemInfo (&info);
+      n = info.dwNumberOfProcessors;
+#elif defined (_SC_NPROCESSORS_ONLN)
+      n = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+      n_processors = CLAMP (n, 1, 64);
+    }
+
+  return n_processors;
+}
+
+static void
+sort_job_run_item (sort_job *job,
+		   gint      step,
+		   gint      item)
+{
+  sort_context *ctx = &job->ctx;
+  gint lo, mid, hi;
+
+  if (step == 0)
+    {
+      lo = job->bounds[item];
+      hi = job->bounds[item + 1];
+
+      if (job->stable)
+	merge_sort (ctx, lo, hi, job->adaptive,
+		    job->scratch + (size_t) lo * ctx->size);
+      else
+	quicksort (ELT (ctx, lo), hi - lo, ctx->size,
+		   ctx->compare_func, ctx->user_data);
+    }
+  else
+    {
+      gint first = item * 2 * step;
+
+      lo = job->bounds[first];
+      mid = job->bounds[first + step];
+      hi = job->bounds[MIN (first + 2 * step, job->n_chunks)];
+
+      merge_runs (ctx, lo, mid, hi, job->scratch + (size_t) lo * ctx->size);
+    }
+}
+
+static void
+sort_job_process (sort_job *job)
+{
+  g_mutex_lock (job->mutex);
+  while (job->next_item < job->n_items)
+    {
+      gint item = job->next_item++;
+      gint step = job->step;
+
+      g_mutex_unlock (job->mutex);
+      sort_job_run_item (job, step, item);
+      g_mutex_lock (job->mutex);
+
+      if (++job->n_done == job->n_items)
+	g_cond_broadcast (job->cond);
+    }
+  g_mutex_unlock (job->mutex);
+}
+
+static void
+sort_job_unref (sort_job *job)
+{
+  gboolean last;
+
+  g_mutex_lock (job->mutex);
+  last = --job->ref_count == 0;
+  g_mutex_unlock (job->mutex);
+
+  if (last)
+    {
+      g_mutex_free (job->mutex);
+      g_cond_free (job->cond);
+      g_free (job);
+    }
+}
+
+static void
+sort_job_worker (gpointer data,
+		 gpointer user_data)
+{
+  sort_job *job = data;
+
+  sort_job_process (job);
+  sort_job_unref (job);
+}
+
+/* Runs N_ITEMS work items of the current round to completion. */
+static void
+sort_job_run_round (sort_job    *job,
+		    GThreadPool *pool,
+		    gint         step,
+		    gint         n_items)
+{
+  gint n_helpers = MIN (n_items, job->n_chunks) - 1;
+  gint i;
+
+  g_mutex_lock (job->mutex);
+  job->step = step;
+  job->n_items = n_items;
+  job->next_item = 0;
+  job->n_done = 0;
+  job->ref_count += n_helpers;
+  g_mutex_unlock (job->mutex);
+
+  for (i = 0; i < n_helpers; i++)
+    g_thread_pool_push (pool, job, NULL);
+
+  sort_job_process (job);
+
+  g_mutex_lock (job->mutex);
+  while (job->n_done < job->n_items)
+    g_cond_wait (job->cond, job->mutex);
+  g_mutex_unlock (job->mutex);
+}
+
+static gboolean
+parallel_sort (sort_context *ctx,
+	       gint          total_elems,
+	       GSortFlags    flags)
+{
+  gint n_chunks = get_n_processors ();
+  GThreadPool *pool;
+  sort_job *job;
+  gint step, i;
+
+  if (n_chunks < 2 || !g_thread_supported ())
+    return FALSE;
+
+  G_LOCK (sort_pool);
+  if (!sort_pool)
+    sort_pool = g_thread_pool_new (sort_job_worker, NULL,
+				   n_chunks - 1, FALSE, NULL);
+  pool = sort_pool;
+  G_UNLOCK (sort_pool);
+
+  if (!pool)
+    return FALSE;
+
+  job = g_new0 (sort_job, 1);
+  job->ctx = *ctx;
+  job->scratch = g_malloc ((size_t) total_elems * ctx->size);
+  job->stable = (flags & (G_SORT_STABLE | G_SORT_ADAPTIVE)) != 0;
+  job->adaptive = (flags & G_SORT_ADAPTIVE) != 0;
+  job->n_chunks = n_chunks;
+  job->bounds = g_new (gint, n_chunks + 1);
+  for (i = 0; i <= n_chunks; i++)
+    job->bounds[i] = (gint) ((gint64) total_elems * i / n_chunks);
+  job->ref_count = 1;
+  job->mutex = g_mutex_new ();
+  job->cond = g_cond_new ();
+
+  sort_job_run_round (job, pool, 0, n_chunks);
+  for (step = 1; step < n_chunks; step *= 2)
+    sort_job_run_round (job, pool, step,
+			(n_chunks - step + 2 * step - 1) / (2 * step));
+
+  /* Late helpers only touch the job's bookkeeping, which stays
+   * alive until they let go of it. */
+  g_free (job->scratch);
+  g_free (job->bounds);
+  sort_job_unref (job);
+
+  return TRUE;
+}
+
+/**
+ * g_sort_with_data:
+ * @pbase: start of array to sort
+ * @total_elems: elements in the array
+ * @size: size of each element
+ * @compare_func: function to compare elements
+ * @user_data: data to pass to @compare_func
+ * @flags: how to sort
+ *
+ * Sorts an array like g_qsort_with_data(), choosing the algorithm
+ * according to @flags.
+ *
+ * With %G_SORT_STABLE, a merge sort is used that keeps equal
+ * elements in their original order. %G_SORT_ADAPTIVE is stable as
+ * well, and additionally makes use of ascending and descending runs
+ * already present in the input; it is the best choice for re-sorting
+ * data of which only a few elements changed.
+ *
+ * With %G_SORT_PARALLEL, large arrays are split up and sorted on
+ * several threads if the thread system is initialized and more than
+ * one processor is available. @compare_func is then called from
+ * several threads at once and must be thread safe.
+ *
+ * The stable sorts need a temporary buffer of up to @total_elems
+ * elements.
+ **/
+void
+g_sort_with_data (gpointer         pbase,
+		  gint             total_elems,
+		  size_t           size,
+		  GCompareDataFunc compare_func,
+		  gpointer         user_data,
+		  GSortFlags       flags)
+{
+  sort_context ctx;
+
+  g_return_if_fail (total_elems >= 0);
+  g_return_if_fail (pbase != NULL || total_elems == 0);
+  g_return_if_fail (compare_func != NULL);
+
+  if (total_elems < 2)
+    return;
+
+  ctx.base = pbase;
+  ctx.size = size;
+  ctx.compare_func = compare_func;
+  ctx.user_data = user_data;
+
+  if ((flags & G_SORT_PARALLEL) && total_elems >= PARALLEL_THRESHOLD &&
+      parallel_sort (&ctx, total_elems, flags))
+    return;
+
+  if (flags & (G_SORT_STABLE | G_SORT_ADAPTIVE))
+    {
+      char *scratch = g_malloc ((size_t) (total_elems / 2 + 1) * size);
+
+      merge_sort (&ctx, 0, total_elems, (flags & G_SORT_ADAPTIVE) != 0,
+		  scratch);
+      g_free (scratch);
+    }
+  else
+    quicksort (pbase, total_elems, size, compare_func, user_data);
+}
+
+/**
+ * g_qsort_with_data:
+ * @pbase: start of array to sort
+ * @total_elems: elements in the array
+ * @size: size of each element
+ * @compare_func: function to compare elements
+ * @user_data: data to pass to @compare_func
+ *
+ * This is just like the standard C qsort() function, but
+ * the comparison routine accepts a user data argument.
+ * 
+ **/
+void
+g_qsort_with_data (gconstpointer    pbase,
+		   gint             total_elems,
+		   size_t           size,
+		   GCompareDataFunc compare_func,
+		   gpointer         user_data)
+{
+  g_return_if_fail (total_elems >= 0);
+  g_return_if_fail (pbase != NULL || total_elems == 0);
+  g_return_if_fail (compare_func != NULL);
+
+  quicksort (pbase, total_elems, size, compare_func, user_data);
+}
@@ -32,6 +32,20 @@
 
 G_BEGIN_DECLS
 
+typedef enum
+{
+  G_SORT_DEFAULT  = 0,
+  G_SORT_STABLE   = 1 << 0,
+  G_SORT_ADAPTIVE = 1 << 1,
+  G_SORT_PARALLEL = 1 << 2
+} GSortFlags;
+
+void g_sort_with_data  (gpointer         pbase,
+			gint             total_elems,
+			size_t           size,
+			GCompareDataFunc compare_func,
+			gpointer         user_data,
+			GSortFlags       flags);
 void g_qsort_with_data (gconstpointer    pbase,
 			gint             total_elems,
 			size_t           size,
@@ -0,0 +1,653 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * GRopeString: strings for large buffers with cheap edits.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * MT safe
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "glib.h"
+
+/* notes on the implementation:
+ * the text is cut into chunks of at most ROPE_CHUNK_SIZE bytes, kept
+ * in a treap ordered by position: every node holds one chunk, the
+ * length of its subtree and a random priority, no larger than that of
+ * its parent, which keeps the expected depth logarithmic. edits that
+ * fit into one chunk are done in place on the way down, everything
+ * else splits the tree at the edit position and merges the pieces
+ * back together. new text first fills up the chunk in front of it,
+ * and chunks that became small enough are joined when erasing, so
+ * chunks stay reasonably full.
+ */
+
+#define	ROPE_CHUNK_SIZE		(2048)
+
+typedef struct _GRopeNode	GRopeNode;
+
+struct _GRopeNode
+{
+  GRopeNode *left;
+  GRopeNode *right;
+  gsize	     total;	/* bytes in this subtree */
+  guint	     len;	/* bytes in this chunk */
+  guint	     priority;
+  gchar	     data[ROPE_CHUNK_SIZE];
+};
+
+struct _GRopeString
+{
+  GRopeNode *root;
+  guint32    seed;
+  gchar	    *flat;	/* contiguous copy, until the next change */
+};
+
+#define	ROPE_TOTAL(node)	((node) ? (node)->total : 0)
+
+
+/* --- nodes --- */
+static inline guint
+g_rope_priority (GRopeString *rope)
+{
+  /* xorshift, good enough to balance the tree */
+  rope->seed ^= rope->seed << 13;
+  rope->seed ^= rope->seed >> 17;
+  rope->seed ^= rope->seed << 5;
+
+  return rope->seed;
+}
+
+static inline void
+g_rope_node_update (GRopeNode *node)
+{
+  node->total = ROPE_TOTAL (node->left) + node->len + ROPE_TOTAL (node->right);
+}
+
+static GRopeNode*
+g_rope_node_new (guint	      priority,
+		 const gchar *data,
+		 guint	      len)
+{
+  GRopeNode *node = g_new (GRopeNode, 1);
+
+  node->left = NULL;
+  node->right = NULL;
+  node->total = len;
+  node->len = len;
+  node->priority = priority;
+  memcpy (node->data, data, len);
+
+  return node;
+}
+
+static void
+g_rope_node_free (GRopeNode *node)
+{
+  while (node)
+    {
+      GRopeNode *right = node->right;
+
+      g_rope_node_free (node->left);
+      g_free (node);
+      node = right;
+    }
+}
+
+/* puts the first @pos bytes of @node into *left_p and the rest into
+ * *right_p, splitting the chunk that @pos falls into
+ */
+static void
+g_rope_node_split (GRopeNode  *node,
+		   gsize       pos,
+		   GRopeNode **left_p,
+		   GRopeNode **right_p)
+{
+  gsize left_total;
+
+  if (!node)
+    {
+      *left_p = NULL;
+      *right_p = NULL;
+      return;
+    }
+
+  left_total = ROPE_TOTAL (node->left);
+  if (pos <= left_total)
+    {
+      g_rope_node_split (node->left, pos, left_p, &node->left);
+      g_rope_node_update (node);
+      *right_p = node;
+    }
+  else if (pos >= left_total + node->len)
+    {
+      g_rope_node_split (node->right, pos - left_total - node->len, &node->right, right_p);
+      g_rope_node_update (node);
+      *left_p = node;
+    }
+  else
+    {
+      guint offset = pos - left_total;
+      GRopeNode *tail;
+
+      /* the tail may share the priority, its children came from below node */
+      tail = g_rope_node_new (node->priority, node->data + offset, node->len - offset);
+      tail->right = node->right;
+      node->right = NULL;
+      node->len = offset;
+      g_rope_node_update (tail);
+      g_rope_node_update (node);
+      *left_p = node;
+      *right_p = tail;
+    }
+}
+
+static GRopeNode*
+g_rope_node_merge (GRopeNode *left,
+		   GRopeNode *right)
+{
+  if (!left)
+    return right;
+  if (!right)
+    return left;
+
+  if (left->priority > right->priority)
+    {
+      left->right = g_rope_node_merge (left->right, right);
+      g_rope_node_update (left);
+      return left;
+    }
+  else
+    {
+      right->left = g_rope_node_merge (left, right->left);
+      g_rope_node_update (right);
+      return right;
+    }
+}
+
+/* inserts into the chunk at @pos if it has room, preferring the end of
+ * the chunk in front of @pos
+ */
+static gboolean
+g_rope_node_insert (GRopeNode	*node,
+		    gsize	 pos,
+		    const gchar *val,
+		    gsize	 len)
+{
+  gsize left_total;
+  gboolean done;
+
+  if (!node)
+    return FALSE;
+
+  left_total = ROPE_TOTAL (node->left);
+  if (node->left && pos <= left_total)
+    done = g_rope_node_insert (node->left, pos, val, len);
+  else if (pos <= left_total + node->len)
+    {
+      guint offset = pos - left_total;
+
+      done = node->len + len <= ROPE_CHUNK_SIZE;
+      if (done)
+	{
+	  g_memmove (node->data + offset + len, node->data + offset, node->len - offset);
+	  memcpy (node->data + offset, val, len);
+	  node->len += len;
+	}
+    }
+  else
+    done = g_rope_node_insert (node->right, pos - left_total - node->len, val, len);
+
+  if (done)
+    node->total += len;
+
+  return done;
+}
+
+/* erases within the chunk at @pos if the range ends there and leaves
+ * something behind
+ */
+static gboolean
+g_rope_node_erase (GRopeNode *node,
+		   gsize      pos,
+		   gsize      len)
+{
+  gsize left_total;
+  gboolean done;
+
+  if (!node)
+    return FALSE;
+
+  left_total = ROPE_TOTAL (node->left);
+  if (pos < left_total)
+    done = g_rope_node_erase (node->left, pos, len);
+  else if (pos < left_total + node->len)
+    {
+      guint offset = pos - left_total;
+
+      done = offset + len <= node->len && len < node->len;
+      if (done)
+	{
+	  g_memmove (node->data + offset, node->data + offset + len,
+		     node->len - offset - len);
+	  node->len -= len;
+	}
+    }
+  else
+    done = g_rope_node_erase (node->right, pos - left_total - node->len, len);
+
+  if (done)
+    node->total -= len;
+
+  return done;
+}
+
+/* appends as much of @val as fits to the last chunk of @node and
+ * returns how much that was
+ */
+static gsize
+g_rope_node_fill_last (GRopeNode   *node,
+		       const gchar *val,
+		       gsize	    len)
+{
+  GRopeNode *last;
+  gsize n;
+
+  if (!node)
+    return 0;
+
+  for (last = node; last->right; last = last->right)
+    ;
+  n = MIN (len, ROPE_CHUNK_SIZE - last->len);
+  if (n == 0)
+    return 0;
+
+  memcpy (last->data + last->len, val, n);
+  last->len += n;
+  for (; node; node = node->right)
+    node->total += n;
+
+  return n;
+}
+
+static gchar*
+g_rope_node_copy (GRopeNode *node,
+		  gsize	     pos,
+		  gsize	     len,
+		  gchar	    *dest)
+{
+  while (node && len)
+    {
+      gsize left_total = ROPE_TOTAL (node->left);
+
+      if (pos < left_total)
+	{
+	  gsize n = MIN (len, left_total - pos);
+
+	  dest = g_rope_node_copy (node->left, pos, n, dest);
+	  len -= n;
+	  pos = left_total;
+	}
+      if (len && pos < left_total + node->len)
+	{
+	  gsize offset = pos - left_total;
+	  gsize n = MIN (len, node->len - offset);
+
+	  memcpy (dest, node->data + offset, n);
+	  dest += n;
+	  len -= n;
+	  pos += n;
+	}
+      pos -= left_total + node->len;
+      node = node->right;
+    }
+
+  return dest;
+}
+
+
+/* --- rope strings --- */
+static inline void
+g_rope_string_changed (GRopeString *rope)
+{
+  if (rope->flat)
+    {
+      g_free (rope->flat);
+      rope->flat = NULL;
+    }
+}
+
+GRopeString*
+g_rope_string_new (const gchar *init)
+{
+  return g_rope_string_new_len (init, -1);
+}
+
+GRopeString*
+g_rope_string_new_len (const gchar *init,
+		       gssize	    len)
+{
+  GRopeString *rope;
+
+  rope = g_new (GRopeString, 1);
+  rope->root = NULL;
+  rope->seed = GPOINTER_TO_UINT (rope) | 1;
+  rope->flat = NULL;
+
+  if (init)
+    g_rope_string_insert_len (rope, 0, init, len);
+
+  return rope;
+}
+
+gchar*
+g_rope_string_free (GRopeString *rope,
+		    gboolean	 free_segment)
+{
+  gchar *segment = NULL;
+
+  g_return_val_if_fail (rope != NULL, NULL);
+
+  if (!free_segment)
+    {
+      g_rope_string_flatten (rope);
+      segment = rope->flat;
+      rope->flat = NULL;
+    }
+
+  g_rope_node_free (rope->root);
+  g_free (rope->flat);
+  g_free (rope);
+
+  return segment;
+}
+
+gsize
+g_rope_string_length (GRopeString *rope)
+{
+  g_return_val_if_fail (rope != NULL, 0);
+
+  return ROPE_TOTAL (rope->root);
+}
+
+G_CONST_RETURN gchar*
+g_rope_string_flatten (GRopeString *rope)
+{
+  g_return_val_if_fail (rope != NULL, NULL);
+
+  if (!rope->flat)
+    {
+      gsize len = ROPE_TOTAL (rope->root);
+
+      rope->flat = g_new (gchar, len + 1);
+      g_rope_node_copy (rope->root, 0, len, rope->flat);
+      rope->flat[len] = 0;
+    }
+
+  return rope->flat;
+}
+
+gchar*
+g_rope_string_substring (GRopeString *rope,
+			 gsize	      pos,
+			 gsize	      len)
+{
+  gchar *string;
+
+  g_return_val_if_fail (rope != NULL, NULL);
+  g_return_val_if_fail (pos <= ROPE_TOTAL (rope->root), NULL);
+
+  len = MIN (len, ROPE_TOTAL (rope->root) - pos);
+  string = g_new (gchar, len + 1);
+  if (rope->flat)
+    memcpy (string, rope->flat + pos, len);
+  else
+    g_rope_node_copy (rope->root, pos, len, string);
+  string[len] = 0;
+
+  return string;
+}
+
+GRopeString*
+g_rope_string_assign (GRopeString *rope,
+		      const gchar *rval)
+{
+  GRopeNode *old_root;
+  gchar *old_flat;
+
+  g_return_val_if_fail (rope != NULL, NULL);
+  g_return_val_if_fail (rval != NULL, rope);
+
+  /* rval may point into the rope's flat copy */
+  old_root = rope->root;
+  old_flat = rope->flat;
+  rope->root = NULL;
+  rope->flat = NULL;
+  g_rope_string_insert_len (rope, 0, rval, -1);
+  g_rope_node_free (old_root);
+  g_free (old_flat);
+
+  return rope;
+}
+
+GRopeString*
+g_rope_string_truncate (GRopeString *rope,
+			gsize	     len)
+{
+  g_return_val_if_fail (rope != NULL, NULL);
+
+  if (len < ROPE_TOTAL (rope->root))
+    g_rope_string_erase (rope, len, -1);
+
+  return rope;
+}
+
+GRopeString*
+g_rope_string_insert_len (GRopeString *rope,
+			  gssize       pos,
+			  const gchar *val,
+			  gssize       len)
+{
+  g_return_val_if_fail (rope != NULL, NULL);
+  g_return_val_if_fail (val != NULL, rope);
+
+  if (len < 0)
+    len = strlen (val);
+
+  if (pos < 0)
+    pos = ROPE_TOTAL (rope->root);
+  else
+    g_return_val_if_fail (pos <= ROPE_TOTAL (rope->root), rope);
+
+  if (len == 0)
+    return rope;
+
+  if (!g_rope_node_insert (rope->root, pos, val, len))
+    {
+      GRopeNode *left, *right;
+      gsize n;
+
+      g_rope_node_split (rope->root, pos, &left, &right);
+      n = g_rope_node_fill_last (left, val, len);
+      while (n < len)
+	{
+	  guint chunk = MIN (len - n, ROPE_CHUNK_SIZE);
+
+	  left = g_rope_node_merge (left, g_rope_node_new (g_rope_priority (rope),
+							   val + n, chunk));
+	  n += chunk;
+	}
+      rope->root = g_rope_node_merge (left, right);
+    }
+
+  /* only now, val may point into the flat copy */
+  g_rope_string_changed (rope);
+
+  return rope;
+}
+
+GRopeString*
+g_rope_string_append (GRopeString *rope,
+		      const gchar *val)
+{
+  return g_rope_string_insert_len (rope, -1, val, -1);
+}
+
+GRopeString*
+g_rope_string_append_len (GRopeString *rope,
+			  const gchar *val,
+			  gssize       len)
+{
+  return g_rope_string_insert_len (rope, -1, val, len);
+}
+
+GRopeString*
+g_rope_string_append_c (GRopeString *rope,
+			gchar	     c)
+{
+  return g_rope_string_insert_len (rope, -1, &c, 1);
+}
+
+GRopeString*
+g_rope_string_prepend (GRopeString *rope,
+		       const gchar *val)
+{
+  return g_rope_string_insert_len (rope, 0, val, -1);
+}
+
+GRopeString*
+g_rope_string_prepend_len (GRopeString *rope,
+			   const gchar *val,
+			   gssize	len)
+{
+  return g_rope_string_insert_len (rope, 0, val, len);
+}
+
+GRopeString*
+g_rope_string_insert (GRopeString *rope,
+		      gssize	   pos,
+		      const gchar *val)
+{
+  return g_rope_string_insert_len (rope, pos, val, -1);
+}
+
+GRopeString*
+g_rope_string_insert_c (GRopeString *rope,
+			gssize	     pos,
+			gchar	     c)
+{
+  return g_rope_string_insert_len (rope, pos, &c, 1);
+}
+
+GRopeString*
+g_rope_string_erase (GRopeString *rope,
+		     gssize	  pos,
+		     gssize	  len)
+{
+  gsize total;
+
+  g_return_val_if_fail (rope != NULL, NULL);
+  g_return_val_if_fail (pos >= 0, rope);
+
+  total = ROPE_TOTAL (rope->root);
+  g_return_val_if_fail (pos <= total, rope);
+
+  if (len < 0)
+    len = total - pos;
+  else
+    g_return_val_if_fail (pos + len <= total, rope);
+
+  if (len == 0)
+    return rope;
+
+  if (!g_rope_node_erase (rope->root, pos, len))
+    {
+      GRopeNode *left, *middle, *right;
+
+      g_rope_node_split (rope->root, pos, &left, &right);
+      g_rope_node_split (right, len, &middle, &right);
+      g_rope_node_free (middle);
+
+      /* join the chunks on either side of the gap if they fit into one */
+      if (left && right)
+	{
+	  GRopeNode *last, *first;
+
+	  for (last = left; last->right; last = last->right)
+	    ;
+	  for (first = right; first->left; first = first->left)
+	    ;
+	  if (last->len + first->len <= ROPE_CHUNK_SIZE)
+	    {
+	      guint n = first->len;
+
+	      g_rope_node_split (right, n, &middle, &right);
+	      g_rope_node_fill_last (left, middle->data, n);
+	      g_rope_node_free (middle);
+	    }
+	}
+      rope->root = g_rope_node_merge (left, right);
+    }
+
+  g_rope_string_changed (rope);
+
+  return rope;
+}
+
+static void
+g_rope_string_append_printf_internal (GRopeString *rope,
+				      const gchar *fmt,
+				      va_list	   args)
+{
+  gchar *buffer;
+
+  buffer = g_strdup_vprintf (fmt, args);
+  g_rope_string_append (rope, buffer);
+  g_free (buffer);
+}
+
+void
+g_rope_string_printf (GRopeString *rope,
+		      const gchar *fmt,
+		      ...)
+{
+  va_list args;
+
+  g_rope_string_truncate (rope, 0);
+
+  va_start (args, fmt);
+  g_rope_string_append_printf_internal (rope, fmt, args);
+  va_end (args);
+}
+
+void
+g_rope_string_append_printf (GRopeString *rope,
+			     const gchar *fmt,
+			     ...)
+{
+  va_list args;
+
+  va_start (args, fmt);
+  g_rope_string_append_printf_internal (rope, fmt, args);
+  va_end (args);
+}
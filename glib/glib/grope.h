@@ -0,0 +1,83 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __G_ROPE_H__
+#define __G_ROPE_H__
+
+#include <glib/gtypes.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GRopeString	GRopeString;
+
+/* Rope strings keep their text in a balanced tree of chunks, so
+ * inserting and erasing anywhere takes time logarithmic in the
+ * length rather than moving the whole tail. a contiguous copy is
+ * only made on request, by g_rope_string_flatten(), and kept until
+ * the next change.
+ */
+GRopeString* g_rope_string_new		(const gchar	 *init);
+GRopeString* g_rope_string_new_len	(const gchar	 *init,
+					 gssize		  len);
+gchar*	     g_rope_string_free		(GRopeString	 *rope,
+					 gboolean	  free_segment);
+gsize	     g_rope_string_length	(GRopeString	 *rope);
+G_CONST_RETURN gchar* g_rope_string_flatten (GRopeString *rope);
+gchar*	     g_rope_string_substring	(GRopeString	 *rope,
+					 gsize		  pos,
+					 gsize		  len);
+GRopeString* g_rope_string_assign	(GRopeString	 *rope,
+					 const gchar	 *rval);
+GRopeString* g_rope_string_truncate	(GRopeString	 *rope,
+					 gsize		  len);
+GRopeString* g_rope_string_insert_len	(GRopeString	 *rope,
+					 gssize		  pos,
+					 const gchar	 *val,
+					 gssize		  len);
+GRopeString* g_rope_string_append	(GRopeString	 *rope,
+					 const gchar	 *val);
+GRopeString* g_rope_string_append_len	(GRopeString	 *rope,
+					 const gchar	 *val,
+					 gssize		  len);
+GRopeString* g_rope_string_append_c	(GRopeString	 *rope,
+					 gchar		  c);
+GRopeString* g_rope_string_prepend	(GRopeString	 *rope,
+					 const gchar	 *val);
+GRopeString* g_rope_string_prepend_len	(GRopeString	 *rope,
+					 const gchar	 *val,
+					 gssize		  len);
+GRopeString* g_rope_string_insert	(GRopeString	 *rope,
+					 gssize		  pos,
+					 const gchar	 *val);
+GRopeString* g_rope_string_insert_c	(GRopeString	 *rope,
+					 gssize		  pos,
+					 gchar		  c);
+GRopeString* g_rope_string_erase	(GRopeString	 *rope,
+					 gssize		  pos,
+					 gssize		  len);
+void	     g_rope_string_printf	(GRopeString	 *rope,
+					 const gchar	 *format,
+					 ...) G_GNUC_PRINTF (2, 3);
+void	     g_rope_string_append_printf (GRopeString	 *rope,
+					 const gchar	 *format,
+					 ...) G_GNUC_PRINTF (2, 3);
+
+G_END_DECLS
+
+#endif /* __G_ROPE_H__ */
@@ -59,9 +59,20 @@
 )
 #define	READ_BUFFER_SIZE	(4000)
 
+/* character classes, see g_scanner_build_cset_class() */
+#define	CSET_SKIP			(1 << 0)
+#define	CSET_SKIP_FAST			(1 << 1)
+#define	CSET_IDENTIFIER_FIRST		(1 << 2)
+#define	CSET_IDENTIFIER_NTH		(1 << 3)
+#define	CSET_IDENTIFIER_NTH_RUN		(1 << 4)
+#define	CSET_STRING_SQ_RUN		(1 << 5)
+#define	CSET_STRING_DQ_RUN		(1 << 6)
+#define	CSET_COMMENT_MULTI_RUN		(1 << 7)
+
 
 /* --- typedefs --- */
 typedef	struct	_GScannerKey	GScannerKey;
+typedef	struct	_GRealScanner	GRealScanner;
 
 struct	_GScannerKey
 {
@@ -70,6 +81,24 @@ struct	_GScannerKey
   gpointer	 value;
 };
 
+struct	_GRealScanner
+{
+  GScanner	 scanner;
+  
+  /* the config strings cset_class was built from; the config may
+   * be changed on the fly, so this is checked for every token
+   */
+  const gchar	*cset_skip_characters;
+  const gchar	*cset_identifier_first;
+  const gchar	*cset_identifier_nth;
+  guint8	 cset_class[256];
+  
+  /* tokens are assembled here and only copied out if handed
+   * to the caller
+   */
+  GString	*scratch;
+};
+
 
 /* --- variables --- */
 static GScannerConfig g_scanner_config_template =
@@ -144,6 +173,7 @@ static guchar	g_scanner_get_char	  (GScanner	*scanner,
 static void	g_scanner_msg_handler	  (GScanner	*scanner,
 					   gchar	*message,
 					   gboolean	 is_error);
+static void	g_scanner_build_cset_class (GRealScanner *rscanner);
 
 
 /* --- functions --- */
@@ -174,7 +204,7 @@ g_scanner_new (const GScannerConfig *config_templ)
   if (!config_templ)
     config_templ = &g_scanner_config_template;
   
-  scanner = g_new0 (GScanner, 1);
+  scanner = (GScanner*) g_new0 (GRealScanner, 1);
   
   scanner->user_data = NULL;
   scanner->max_parse_errors = 1;
@@ -232,9 +262,105 @@ g_scanner_new (const GScannerConfig *config_templ)
   
   scanner->msg_handler = g_scanner_msg_handler;
   
+  ((GRealScanner*) scanner)->scratch = g_string_sized_new (64);
+  g_scanner_build_cset_class ((GRealScanner*) scanner);
+  
   return scanner;
 }
 
+static void
+g_scanner_build_cset_class (GRealScanner *rscanner)
+{
+  GScannerConfig *config = rscanner->scanner.config;
+  guint8 *cset_class = rscanner->cset_class;
+  const gchar *c;
+  guint i;
+  
+  rscanner->cset_skip_characters = config->cset_skip_characters;
+  rscanner->cset_identifier_first = config->cset_identifier_first;
+  rscanner->cset_identifier_nth = config->cset_identifier_nth;
+  
+  for (i = 1; i < 256; i++)
+    cset_class[i] = CSET_STRING_SQ_RUN | CSET_STRING_DQ_RUN | CSET_COMMENT_MULTI_RUN;
+  cset_class[0] = 0;
+  
+  for (c = config->cset_skip_characters; c && *c; c++)
+    cset_class[(guchar) *c] |= CSET_SKIP;
+  for (c = config->cset_identifier_first; c && *c; c++)
+    cset_class[(guchar) *c] |= CSET_IDENTIFIER_FIRST;
+  for (c = config->cset_identifier_nth; c && *c; c++)
+    cset_class[(guchar) *c] |= CSET_IDENTIFIER_NTH | CSET_IDENTIFIER_NTH_RUN;
+  
+  /* runs are taken straight from the buffer, which is only right
+   * for characters that don't need special treatment
+   */
+  cset_class['\n'] &= ~(CSET_IDENTIFIER_NTH_RUN |
+			CSET_STRING_SQ_RUN | CSET_STRING_DQ_RUN | CSET_COMMENT_MULTI_RUN);
+  cset_class['\''] &= ~CSET_STRING_SQ_RUN;
+  cset_class['"'] &= ~CSET_STRING_DQ_RUN;
+  cset_class['\\'] &= ~CSET_STRING_DQ_RUN;
+  cset_class['*'] &= ~CSET_COMMENT_MULTI_RUN;
+  
+  /* skip characters that can't start any other token may be
+   * skipped before getting to g_scanner_get_token_ll()
+   */
+  for (i = 1; i < 256; i++)
+    if ((cset_class[i] & (CSET_SKIP | CSET_IDENTIFIER_FIRST)) == CSET_SKIP &&
+	!strchr ("/'\".$0123456789", i))
+      cset_class[i] |= CSET_SKIP_FAST;
+}
+
+static inline const guint8*
+g_scanner_cset_class (GScanner *scanner)
+{
+  GRealScanner *rscanner = (GRealScanner*) scanner;
+  GScannerConfig *config = scanner->config;
+  
+  if (rscanner->cset_skip_characters != config->cset_skip_characters ||
+      rscanner->cset_identifier_first != config->cset_identifier_first ||
+      rscanner->cset_identifier_nth != config->cset_identifier_nth)
+    g_scanner_build_cset_class (rscanner);
+  
+  return rscanner->cset_class;
+}
+
+/* Returns the emptied scratch buffer, or %NULL if the token's text
+ * would be thrown away anyway.
+ */
+static inline GString*
+g_scanner_scratch (GScanner *scanner,
+		   gboolean  discard)
+{
+  GString *scratch = ((GRealScanner*) scanner)->scratch;
+  
+  if (discard)
+    return NULL;
+  
+  return g_string_truncate (scratch, 0);
+}
+
+/* Moves a run of characters of class @mask from the read buffer to
+ * @gstring, which may be %NULL. None of them is a newline.
+ */
+static inline void
+g_scanner_take_run (GScanner	*scanner,
+		    guint8	 mask,
+		    GString	*gstring,
+		    guint	*position_p)
+{
+  const guint8 *cset_class = ((GRealScanner*) scanner)->cset_class;
+  const gchar *start = scanner->text;
+  const gchar *p = start;
+  
+  while (p < scanner->text_end && (cset_class[(guchar) *p] & mask))
+    p++;
+  
+  if (gstring)
+    g_string_append_len (gstring, start, p - start);
+  *position_p += p - start;
+  scanner->text = p;
+}
+
 static inline void
 g_scanner_free_value (GTokenType     *token_p,
 		      GTokenValue     *value_p)
@@ -280,6 +406,7 @@ g_scanner_destroy (GScanner	*scanner)
   g_scanner_free_value (&scanner->next_token, &scanner->next_value);
   g_free (scanner->config);
   g_free (scanner->buffer);
+  g_string_free (((GRealScanner*) scanner)->scratch, TRUE);
   g_free (scanner);
 }
 
@@ -382,15 +509,22 @@ g_scanner_lookup_internal (GScanner	*scanner,
   
   if (!scanner->config->case_sensitive)
     {
+      gchar buffer[64];
       gchar *d;
       const gchar *c;
+      gsize length = strlen (symbol);
       
-      key.symbol = g_new (gchar, strlen (symbol) + 1);
+      /* symbols are short, lower them on the stack */
+      if (length < sizeof (buffer))
+	key.symbol = buffer;
+      else
+	key.symbol = g_new (gchar, length + 1);
       for (d = key.symbol, c = symbol; *c; c++, d++)
 	*d = to_lower (*c);
       *d = 0;
       key_p = g_hash_table_lookup (scanner->symbol_table, &key);
-      g_free (key.symbol);
+      if (key.symbol != buffer)
+	g_free (key.symbol);
     }
   else
     {
@@ -1152,15 +1286,19 @@ g_scanner_get_token_i (GScanner	*scanner,
 		       guint		*line_p,
 		       guint		*position_p)
 {
+  const guint8 *cset_class;
+  
+  cset_class = g_scanner_cset_class (scanner);
+  
   do
     {
       g_scanner_free_value (token_p, value_p);
       g_scanner_get_token_ll (scanner, token_p, value_p, line_p, position_p);
     }
   while (((*token_p > 0 && *token_p < 256) &&
-	  strchr (scanner->config->cset_skip_characters, *token_p)) ||
+	  (cset_class[*token_p] & CSET_SKIP)) ||
 	 (*token_p == G_TOKEN_CHAR &&
-	  strchr (scanner->config->cset_skip_characters, value_p->v_char)) ||
+	  (cset_class[value_p->v_char] & CSET_SKIP)) ||
 	 (*token_p == G_TOKEN_COMMENT_MULTI &&
 	  scanner->config->skip_comment_multi) ||
 	 (*token_p == G_TOKEN_COMMENT_SINGLE &&
@@ -1218,12 +1356,36 @@ g_scanner_get_token_ll	(GScanner	*scanner,
   GString	  *gstring;
   GTokenValue	   value;
   guchar	   ch;
+  const guint8	  *cset_class;
   
   config = scanner->config;
+  cset_class = ((GRealScanner*) scanner)->cset_class;
   (*value_p).v_int64 = 0;
   
-  if ((scanner->text >= scanner->text_end && scanner->input_fd < 0) ||
-      scanner->token == G_TOKEN_EOF)
+  if (scanner->token == G_TOKEN_EOF)
+    {
+      *token_p = G_TOKEN_EOF;
+      return;
+    }
+  
+  /* skip characters would only come back as tokens to be dropped
+   * by g_scanner_get_token_i(), pass over them right away
+   */
+  while (scanner->text < scanner->text_end &&
+	 (cset_class[(guchar) *scanner->text] & CSET_SKIP_FAST) &&
+	 !(config->cpair_comment_single &&
+	   *scanner->text == config->cpair_comment_single[0]))
+    {
+      if (*scanner->text++ == '\n')
+	{
+	  (*position_p) = 0;
+	  (*line_p)++;
+	}
+      else
+	(*position_p)++;
+    }
+  
+  if (scanner->text >= scanner->text_end && scanner->input_fd < 0)
     {
       *token_p = G_TOKEN_EOF;
       return;
@@ -1249,7 +1411,7 @@ g_scanner_get_token_ll	(GScanner	*scanner,
        * might interfere with other key chars like slashes or numbers
        */
       if (config->scan_identifier &&
-	  ch && strchr (config->cset_identifier_first, ch))
+	  (cset_class[ch] & CSET_IDENTIFIER_FIRST))
 	goto identifier_precedence;
       
       switch (ch)
@@ -1267,7 +1429,7 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 	  g_scanner_get_char (scanner, line_p, position_p);
 	  token = G_TOKEN_COMMENT_MULTI;
 	  in_comment_multi = TRUE;
-	  gstring = g_string_new (NULL);
+	  gstring = g_scanner_scratch (scanner, config->skip_comment_multi);
 	  while ((ch = g_scanner_get_char (scanner, line_p, position_p)) != 0)
 	    {
 	      if (ch == '*' && g_scanner_peek_next_char (scanner) == '/')
@@ -1277,7 +1439,11 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 		  break;
 		}
 	      else
-		gstring = g_string_append_c (gstring, ch);
+		{
+		  if (gstring)
+		    gstring = g_string_append_c (gstring, ch);
+		  g_scanner_take_run (scanner, CSET_COMMENT_MULTI_RUN, gstring, position_p);
+		}
 	    }
 	  ch = 0;
 	  break;
@@ -1287,7 +1453,7 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 	    goto default_case;
 	  token = G_TOKEN_STRING;
 	  in_string_sq = TRUE;
-	  gstring = g_string_new (NULL);
+	  gstring = g_scanner_scratch (scanner, FALSE);
 	  while ((ch = g_scanner_get_char (scanner, line_p, position_p)) != 0)
 	    {
 	      if (ch == '\'')
@@ -1296,7 +1462,10 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 		  break;
 		}
 	      else
-		gstring = g_string_append_c (gstring, ch);
+		{
+		  gstring = g_string_append_c (gstring, ch);
+		  g_scanner_take_run (scanner, CSET_STRING_SQ_RUN, gstring, position_p);
+		}
 	    }
 	  ch = 0;
 	  break;
@@ -1306,7 +1475,7 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 	    goto default_case;
 	  token = G_TOKEN_STRING;
 	  in_string_dq = TRUE;
-	  gstring = g_string_new (NULL);
+	  gstring = g_scanner_scratch (scanner, FALSE);
 	  while ((ch = g_scanner_get_char (scanner, line_p, position_p)) != 0)
 	    {
 	      if (ch == '"')
@@ -1381,7 +1550,10 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 			}
 		    }
 		  else
-		    gstring = g_string_append_c (gstring, ch);
+		    {
+		      gstring = g_string_append_c (gstring, ch);
+		      g_scanner_take_run (scanner, CSET_STRING_DQ_RUN, gstring, position_p);
+		    }
 		}
 	    }
 	  ch = 0;
@@ -1468,7 +1640,9 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 	  if (token == G_TOKEN_NONE)
 	    token = G_TOKEN_INT;
 	  
-	  gstring = g_string_new (dotted_float ? "0." : NULL);
+	  gstring = g_scanner_scratch (scanner, FALSE);
+	  if (dotted_float)
+	    gstring = g_string_append (gstring, "0.");
 	  gstring = g_string_append_c (gstring, ch);
 	  
 	  do /* while (in_number) */
@@ -1598,7 +1772,6 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 	      else
 		value.v_error = G_ERR_DIGIT_RADIX;
 	    }
-	  g_string_free (gstring, TRUE);
 	  gstring = NULL;
 	  ch = 0;
 	} /* number_parsing:... */
@@ -1610,49 +1783,69 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 	  if (config->cpair_comment_single &&
 	      ch == config->cpair_comment_single[0])
 	    {
+	      guchar end_char = config->cpair_comment_single[1];
+	      
 	      token = G_TOKEN_COMMENT_SINGLE;
 	      in_comment_single = TRUE;
-	      gstring = g_string_new (NULL);
+	      gstring = g_scanner_scratch (scanner, config->skip_comment_single);
 	      ch = g_scanner_get_char (scanner, line_p, position_p);
 	      while (ch != 0)
 		{
-		  if (ch == config->cpair_comment_single[1])
+		  const gchar *p;
+		  
+		  if (ch == end_char)
 		    {
 		      in_comment_single = FALSE;
 		      ch = 0;
 		      break;
 		    }
 		  
-		  gstring = g_string_append_c (gstring, ch);
+		  if (gstring)
+		    gstring = g_string_append_c (gstring, ch);
+		  
+		  /* take the rest of the line from the buffer */
+		  p = scanner->text;
+		  while (p < scanner->text_end &&
+			 *p != end_char && *p != '\n' && *p != 0)
+		    p++;
+		  if (gstring)
+		    g_string_append_len (gstring, scanner->text, p - scanner->text);
+		  (*position_p) += p - scanner->text;
+		  scanner->text = p;
+		  
 		  ch = g_scanner_get_char (scanner, line_p, position_p);
 		}
 	    }
-	  else if (config->scan_identifier && ch &&
-		   strchr (config->cset_identifier_first, ch))
+	  else if (config->scan_identifier &&
+		   (cset_class[ch] & CSET_IDENTIFIER_FIRST))
 	    {
 	    identifier_precedence:
 	      
-	      if (config->cset_identifier_nth && ch &&
-		  strchr (config->cset_identifier_nth,
-			  g_scanner_peek_next_char (scanner)))
+	      /* the end of input has always matched here, since strchr()
+	       * finds the terminating nul of cset_identifier_nth
+	       */
+	      if (config->cset_identifier_nth &&
+		  ((cset_class[g_scanner_peek_next_char (scanner)] & CSET_IDENTIFIER_NTH) ||
+		   g_scanner_peek_next_char (scanner) == 0))
 		{
 		  token = G_TOKEN_IDENTIFIER;
-		  gstring = g_string_new (NULL);
+		  gstring = g_scanner_scratch (scanner, FALSE);
 		  gstring = g_string_append_c (gstring, ch);
 		  do
 		    {
 		      ch = g_scanner_get_char (scanner, line_p, position_p);
 		      gstring = g_string_append_c (gstring, ch);
+		      g_scanner_take_run (scanner, CSET_IDENTIFIER_NTH_RUN, gstring, position_p);
 		      ch = g_scanner_peek_next_char (scanner);
 		    }
-		  while (ch && strchr (config->cset_identifier_nth, ch));
+		  while (cset_class[ch] & CSET_IDENTIFIER_NTH);
 		  ch = 0;
 		}
 	      else if (config->scan_identifier_1char)
 		{
 		  token = G_TOKEN_IDENTIFIER;
-		  value.v_identifier = g_new0 (gchar, 2);
-		  value.v_identifier[0] = ch;
+		  gstring = g_scanner_scratch (scanner, FALSE);
+		  gstring = g_string_append_c (gstring, ch);
 		  ch = 0;
 		}
 	    }
@@ -1678,11 +1871,7 @@ g_scanner_get_token_ll	(GScanner	*scanner,
       in_string_sq || in_string_dq)
     {
       token = G_TOKEN_ERROR;
-      if (gstring)
-	{
-	  g_string_free (gstring, TRUE);
-	  gstring = NULL;
-	}
+      gstring = NULL;
       (*position_p)++;
       if (in_comment_multi || in_comment_single)
 	value.v_error = G_ERR_UNEXP_EOF_IN_COMMENT;
@@ -1690,60 +1879,59 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 	value.v_error = G_ERR_UNEXP_EOF_IN_STRING;
     }
   
+  if (token == G_TOKEN_IDENTIFIER && config->scan_symbols)
+    {
+      GScannerKey *key;
+      guint scope_id;
+      
+      /* symbols are looked up in the scratch buffer, only
+       * identifiers get their own copy
+       */
+      scope_id = scanner->scope_id;
+      key = g_scanner_lookup_internal (scanner, scope_id, gstring->str);
+      if (!key && scope_id && scanner->config->scope_0_fallback)
+	key = g_scanner_lookup_internal (scanner, 0, gstring->str);
+      
+      if (key)
+	{
+	  token = G_TOKEN_SYMBOL;
+	  value.v_symbol = key->value;
+	  gstring = NULL;
+	}
+    }
+  
   if (gstring)
     {
-      value.v_string = gstring->str;
-      g_string_free (gstring, FALSE);
+      value.v_string = g_strndup (gstring->str, gstring->len);
       gstring = NULL;
     }
   
-  if (token == G_TOKEN_IDENTIFIER)
+  if (token == G_TOKEN_IDENTIFIER &&
+      config->scan_identifier_NULL &&
+      strlen (value.v_identifier) == 4)
     {
-      if (config->scan_symbols)
+      gchar *null_upper = "NULL";
+      gchar *null_lower = "null";
+      
+      if (scanner->config->case_sensitive)
 	{
-	  GScannerKey *key;
-	  guint scope_id;
-	  
-	  scope_id = scanner->scope_id;
-	  key = g_scanner_lookup_internal (scanner, scope_id, value.v_identifier);
-	  if (!key && scope_id && scanner->config->scope_0_fallback)
-	    key = g_scanner_lookup_internal (scanner, 0, value.v_identifier);
-	  
-	  if (key)
-	    {
-	      g_free (value.v_identifier);
-	      token = G_TOKEN_SYMBOL;
-	      value.v_symbol = key->value;
-	    }
+	  if (value.v_identifier[0] == null_upper[0] &&
+	      value.v_identifier[1] == null_upper[1] &&
+	      value.v_identifier[2] == null_upper[2] &&
+	      value.v_identifier[3] == null_upper[3])
+	    token = G_TOKEN_IDENTIFIER_NULL;
 	}
-      
-      if (token == G_TOKEN_IDENTIFIER &&
-	  config->scan_identifier_NULL &&
-	  strlen (value.v_identifier) == 4)
+      else
 	{
-	  gchar *null_upper = "NULL";
-	  gchar *null_lower = "null";
-	  
-	  if (scanner->config->case_sensitive)
-	    {
-	      if (value.v_identifier[0] == null_upper[0] &&
-		  value.v_identifier[1] == null_upper[1] &&
-		  value.v_identifier[2] == null_upper[2] &&
-		  value.v_identifier[3] == null_upper[3])
-		token = G_TOKEN_IDENTIFIER_NULL;
-	    }
-	  else
-	    {
-	      if ((value.v_identifier[0] == null_upper[0] ||
-		   value.v_identifier[0] == null_lower[0]) &&
-		  (value.v_identifier[1] == null_upper[1] ||
-		   value.v_identifier[1] == null_lower[1]) &&
-		  (value.v_identifier[2] == null_upper[2] ||
-		   value.v_identifier[2] == null_lower[2]) &&
-		  (value.v_identifier[3] == null_upper[3] ||
-		   value.v_identifier[3] == null_lower[3]))
-		token = G_TOKEN_IDENTIFIER_NULL;
-	    }
+	  if ((value.v_identifier[0] == null_upper[0] ||
+	       value.v_identifier[0] == null_lower[0]) &&
+	      (value.v_identifier[1] == null_upper[1] ||
+	       value.v_identifier[1] == null_lower[1]) &&
+	      (value.v_identifier[2] == null_upper[2] ||
+	       value.v_identifier[2] == null_lower[2]) &&
+	      (value.v_identifier[3] == null_upper[3] ||
+	       value.v_identifier[3] == null_lower[3]))
+	    token = G_TOKEN_IDENTIFIER_NULL;
 	}
     }
   
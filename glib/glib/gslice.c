@@ -0,0 +1,452 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * GSlice: size-class slab allocator with per-thread magazines.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * MT safe
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "glib.h"
+
+/* notes on the implementation:
+ * small blocks are rounded up to a multiple of SLICE_ALIGN and served
+ * from one of SLICE_N_CLASSES size classes. memory for a class is
+ * carved out of SLICE_SLAB_SIZE sized slabs, and the resulting chunks
+ * are grouped into magazines, singly linked lists of free chunks.
+ * every thread owns a loaded and a spare magazine per class, so
+ * allocation and release only touch thread private data. the global
+ * depot (and its lock) is only consulted when both magazines of a
+ * thread run empty or full, i.e. at most once every magazine size
+ * operations. larger blocks are passed on to g_malloc()/g_free().
+ * with DISABLE_MEM_POOLS defined, all slices are plain g_malloc() blocks.
+ */
+
+#define SLICE_ALIGN		(2 * sizeof (gpointer))
+#define SLICE_MAX_SIZE		(512)
+#define SLICE_N_CLASSES		(SLICE_MAX_SIZE / SLICE_ALIGN)
+#define SLICE_SLAB_SIZE		(8192)
+#define SLICE_MAGAZINE_BYTES	(4096)
+#define SLICE_MAGAZINE_MIN	(8)
+#define SLICE_MAGAZINE_MAX	(64)
+
+#define SLICE_CLASS_INDEX(size)	(((size) + SLICE_ALIGN - 1) / SLICE_ALIGN - 1)
+#define SLICE_CLASS_SIZE(ix)	(((ix) + 1) * SLICE_ALIGN)
+
+
+/* --- structures --- */
+typedef struct _SliceChunk    SliceChunk;
+typedef struct _SliceMagazine SliceMagazine;
+typedef struct _SliceThread   SliceThread;
+typedef struct _SliceDepot    SliceDepot;
+
+struct _SliceChunk
+{
+  SliceChunk *next;		/* next free chunk in this magazine */
+  SliceChunk *magazine;		/* next magazine in the depot, heads only */
+};
+
+struct _SliceMagazine
+{
+  SliceChunk *chunks;
+  guint       count;
+};
+
+struct _SliceThread
+{
+  SliceMagazine loaded[SLICE_N_CLASSES];
+  SliceMagazine spare[SLICE_N_CLASSES];
+};
+
+struct _SliceDepot
+{
+  SliceChunk *magazines;	/* magazine heads, linked through ->magazine */
+  gulong      n_magazines;
+  gulong      n_slabs;
+  gulong      n_refills;
+  gulong      n_flushes;
+};
+
+
+/* --- variables --- */
+/* here we can't use StaticMutexes, as they depend upon a working
+ * g_malloc, same as the mem chunk list lock in gmem.c
+ */
+static GMutex      *slice_depot_lock = NULL;
+static GPrivate    *slice_thread_key = NULL;
+static SliceThread  slice_main_thread;
+static SliceDepot   slice_depots[SLICE_N_CLASSES];
+
+
+/* --- functions --- */
+static inline guint
+slice_magazine_size (guint ix)
+{
+  guint n = SLICE_MAGAZINE_BYTES / SLICE_CLASS_SIZE (ix);
+
+  return CLAMP (n, SLICE_MAGAZINE_MIN, SLICE_MAGAZINE_MAX);
+}
+
+/* HOLDS: slice_depot_lock */
+static void
+slice_depot_push (guint       ix,
+		  SliceChunk *chunks)
+{
+  SliceDepot *depot = &slice_depots[ix];
+
+  chunks->magazine = depot->magazines;
+  depot->magazines = chunks;
+  depot->n_magazines++;
+}
+
+/* HOLDS: slice_depot_lock */
+static void
+slice_depot_grow (guint ix)
+{
+  gsize chunk_size = SLICE_CLASS_SIZE (ix);
+  guint n_chunks = SLICE_SLAB_SIZE / chunk_size;
+  guint n_magazine = slice_magazine_size (ix);
+  gchar *slab;
+  guint i;
+
+  slab = g_malloc (SLICE_SLAB_SIZE);
+  slice_depots[ix].n_slabs++;
+
+  /* thread the slab into magazines, last chunk first and last
+   * magazine first, so that the slab is handed out in ascending
+   * address order
+   */
+  for (i = (n_chunks - 1) / n_magazine * n_magazine; ; i -= n_magazine)
+    {
+      guint n = MIN (n_magazine, n_chunks - i);
+      SliceChunk *head = NULL;
+      guint j;
+
+      for (j = n; j > 0; j--)
+	{
+	  SliceChunk *chunk = (SliceChunk*) (slab + (i + j - 1) * chunk_size);
+
+	  chunk->next = head;
+	  head = chunk;
+	}
+      slice_depot_push (ix, head);
+      if (i == 0)
+	break;
+    }
+}
+
+static void
+slice_magazine_reload (SliceThread *tmem,
+		       guint        ix)
+{
+  SliceMagazine *loaded = &tmem->loaded[ix];
+  SliceMagazine *spare = &tmem->spare[ix];
+  SliceDepot *depot = &slice_depots[ix];
+  SliceChunk *chunk;
+  guint count;
+
+  if (spare->chunks)
+    {
+      SliceMagazine tmp = *loaded;
+
+      *loaded = *spare;
+      *spare = tmp;
+      return;
+    }
+
+  g_mutex_lock (slice_depot_lock);
+  if (!depot->magazines)
+    slice_depot_grow (ix);
+  chunk = depot->magazines;
+  depot->magazines = chunk->magazine;
+  depot->n_magazines--;
+  depot->n_refills++;
+  g_mutex_unlock (slice_depot_lock);
+
+  /* magazines left behind by exiting threads may be partially
+   * filled, so count what we got
+   */
+  loaded->chunks = chunk;
+  for (count = 0; chunk; chunk = chunk->next)
+    count++;
+  loaded->count = count;
+}
+
+static void
+slice_magazine_unload (SliceThread *tmem,
+		       guint        ix)
+{
+  SliceMagazine *loaded = &tmem->loaded[ix];
+  SliceMagazine *spare = &tmem->spare[ix];
+
+  if (spare->chunks)
+    {
+      g_mutex_lock (slice_depot_lock);
+      slice_depot_push (ix, spare->chunks);
+      slice_depots[ix].n_flushes++;
+      g_mutex_unlock (slice_depot_lock);
+    }
+  *spare = *loaded;
+  loaded->chunks = NULL;
+  loaded->count = 0;
+}
+
+static void
+slice_thread_cleanup (gpointer data)
+{
+  SliceThread *tmem = data;
+  guint ix;
+
+  g_mutex_lock (slice_depot_lock);
+  for (ix = 0; ix < SLICE_N_CLASSES; ix++)
+    {
+      if (tmem->loaded[ix].chunks)
+	{
+	  slice_depot_push (ix, tmem->loaded[ix].chunks);
+	  slice_depots[ix].n_flushes++;
+	}
+      if (tmem->spare[ix].chunks)
+	{
+	  slice_depot_push (ix, tmem->spare[ix].chunks);
+	  slice_depots[ix].n_flushes++;
+	}
+    }
+  g_mutex_unlock (slice_depot_lock);
+
+  if (tmem != &slice_main_thread)
+    g_free (tmem);
+}
+
+static inline SliceThread*
+slice_thread_get (void)
+{
+  SliceThread *tmem;
+
+  if (!g_thread_supported ())
+    return &slice_main_thread;
+
+  tmem = g_private_get (slice_thread_key);
+  if (!tmem)
+    {
+      tmem = g_new0 (SliceThread, 1);
+      g_private_set (slice_thread_key, tmem);
+    }
+
+  return tmem;
+}
+
+static inline gpointer
+slice_chunk_alloc (SliceThread *tmem,
+		   guint        ix)
+{
+  SliceMagazine *loaded = &tmem->loaded[ix];
+  SliceChunk *chunk;
+
+  if (!loaded->chunks)
+    slice_magazine_reload (tmem, ix);
+
+  chunk = loaded->chunks;
+  loaded->chunks = chunk->next;
+  loaded->count--;
+
+  return chunk;
+}
+
+static inline void
+slice_chunk_free (SliceThread *tmem,
+		  guint        ix,
+		  gpointer     mem)
+{
+  SliceMagazine *loaded = &tmem->loaded[ix];
+  SliceChunk *chunk = mem;
+
+  if (loaded->count >= slice_magazine_size (ix))
+    slice_magazine_unload (tmem, ix);
+
+  chunk->next = loaded->chunks;
+  loaded->chunks = chunk;
+  loaded->count++;
+}
+
+/**
+ * g_slice_alloc:
+ * @block_size: the number of bytes to allocate
+ *
+ * Allocates a block of memory from the slice allocator. Blocks of up
+ * to 512 bytes are taken from a per-thread cache without locking, the
+ * memory has to be released with g_slice_free1() and the same
+ * @block_size. Larger blocks are allocated with g_malloc().
+ *
+ * Return value: a pointer to the allocated memory block, or %NULL
+ *   if @block_size is 0.
+ **/
+gpointer
+g_slice_alloc (gsize block_size)
+{
+#ifndef DISABLE_MEM_POOLS
+  if (block_size && block_size <= SLICE_MAX_SIZE)
+    return slice_chunk_alloc (slice_thread_get (), SLICE_CLASS_INDEX (block_size));
+#endif
+
+  return g_malloc (block_size);
+}
+
+/**
+ * g_slice_alloc0:
+ * @block_size: the number of bytes to allocate
+ *
+ * Allocates a block of memory like g_slice_alloc() and sets it to 0.
+ *
+ * Return value: a pointer to the allocated memory block, or %NULL
+ *   if @block_size is 0.
+ **/
+gpointer
+g_slice_alloc0 (gsize block_size)
+{
+  gpointer mem = g_slice_alloc (block_size);
+
+  if (mem)
+    memset (mem, 0, block_size);
+
+  return mem;
+}
+
+/**
+ * g_slice_free1:
+ * @block_size: the size of the block, as passed to g_slice_alloc()
+ * @mem_block: the memory to release, may be %NULL
+ *
+ * Returns a block of memory to the slice allocator.
+ **/
+void
+g_slice_free1 (gsize    block_size,
+	       gpointer mem_block)
+{
+  if (!mem_block)
+    return;
+
+#ifdef ENABLE_GC_FRIENDLY
+  memset (mem_block, 0, block_size);
+#endif /* ENABLE_GC_FRIENDLY */
+
+#ifndef DISABLE_MEM_POOLS
+  if (block_size && block_size <= SLICE_MAX_SIZE)
+    {
+      slice_chunk_free (slice_thread_get (), SLICE_CLASS_INDEX (block_size), mem_block);
+      return;
+    }
+#endif
+
+  g_free (mem_block);
+}
+
+/**
+ * g_slice_free_chain_with_offset:
+ * @block_size: the size of the blocks
+ * @mem_chain: the first block of the chain, may be %NULL
+ * @next_offset: the offset of the next pointer inside each block
+ *
+ * Releases a linked list of memory blocks, such as a #GList, which
+ * have all been allocated with g_slice_alloc() and @block_size.
+ * The pointer to the next block is read from @next_offset bytes into
+ * each block.
+ **/
+void
+g_slice_free_chain_with_offset (gsize    block_size,
+				gpointer mem_chain,
+				gsize    next_offset)
+{
+  gchar *slice = mem_chain;
+
+#ifndef DISABLE_MEM_POOLS
+  if (slice && block_size && block_size <= SLICE_MAX_SIZE)
+    {
+      SliceThread *tmem = slice_thread_get ();
+      guint ix = SLICE_CLASS_INDEX (block_size);
+
+      while (slice)
+	{
+	  gchar *current = slice;
+
+	  slice = *(gpointer*) (current + next_offset);
+#ifdef ENABLE_GC_FRIENDLY
+	  memset (current, 0, block_size);
+#endif /* ENABLE_GC_FRIENDLY */
+	  slice_chunk_free (tmem, ix, current);
+	}
+      return;
+    }
+#endif
+
+  while (slice)
+    {
+      gchar *current = slice;
+
+      slice = *(gpointer*) (current + next_offset);
+      g_free (current);
+    }
+}
+
+/**
+ * g_slice_get_stats:
+ * @stats: an array of @n_stats #GSliceStats to fill in, or %NULL
+ * @n_stats: the number of elements in @stats
+ *
+ * Retrieves usage counters for the size classes of the slice
+ * allocator, ordered by ascending chunk size. Chunks which are
+ * currently cached by threads are not accounted for.
+ *
+ * Return value: the number of size classes.
+ **/
+guint
+g_slice_get_stats (GSliceStats *stats,
+		   guint        n_stats)
+{
+  guint ix;
+
+  g_return_val_if_fail (stats != NULL || n_stats == 0, 0);
+
+  g_mutex_lock (slice_depot_lock);
+  for (ix = 0; ix < MIN (n_stats, SLICE_N_CLASSES); ix++)
+    {
+      stats[ix].chunk_size = SLICE_CLASS_SIZE (ix);
+      stats[ix].n_slabs = slice_depots[ix].n_slabs;
+      stats[ix].n_cached_magazines = slice_depots[ix].n_magazines;
+      stats[ix].n_refills = slice_depots[ix].n_refills;
+      stats[ix].n_flushes = slice_depots[ix].n_flushes;
+    }
+  g_mutex_unlock (slice_depot_lock);
+
+  return SLICE_N_CLASSES;
+}
+
+/* called from g_thread_init(), before g_thread_supported() is TRUE.
+ * the main thread keeps the magazines it filled so far.
+ */
+void
+g_slice_init (void)
+{
+  slice_depot_lock = g_mutex_new ();
+  slice_thread_key = g_private_new (slice_thread_cleanup);
+  G_THREAD_UF (private_set, (slice_thread_key, &slice_main_thread));
+}
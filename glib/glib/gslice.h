@@ -0,0 +1,71 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * GSlice: size-class slab allocator with per-thread magazines.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __G_SLICE_H__
+#define __G_SLICE_H__
+
+#include <glib/gtypes.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GSliceStats GSliceStats;
+
+struct _GSliceStats
+{
+  gsize  chunk_size;		/* size of the chunks in this class */
+  gulong n_slabs;		/* slabs carved for this class so far */
+  gulong n_cached_magazines;	/* full magazines waiting in the depot */
+  gulong n_refills;		/* magazines handed out to threads */
+  gulong n_flushes;		/* magazines handed back by threads */
+};
+
+/* slices are allocated from per-thread magazines, the size has to
+ * be passed back to g_slice_free1() when the memory is released
+ */
+gpointer g_slice_alloc			(gsize	       block_size);
+gpointer g_slice_alloc0			(gsize	       block_size);
+void	 g_slice_free1			(gsize	       block_size,
+					 gpointer      mem_block);
+void	 g_slice_free_chain_with_offset (gsize	       block_size,
+					 gpointer      mem_chain,
+					 gsize	       next_offset);
+
+#define  g_slice_new(type)		((type*) g_slice_alloc (sizeof (type)))
+#define  g_slice_new0(type)		((type*) g_slice_alloc0 (sizeof (type)))
+#define  g_slice_free(type, mem)	G_STMT_START {			\
+  if (1) g_slice_free1 (sizeof (type), (mem));				\
+  else   (void) ((type*) 0 == (mem));					\
+} G_STMT_END
+#define  g_slice_free_chain(type, mem_chain, next)	G_STMT_START {	\
+  if (1) g_slice_free_chain_with_offset (sizeof (type),			\
+		 (mem_chain), G_STRUCT_OFFSET (type, next));		\
+  else   (void) ((type*) 0 == (mem_chain));				\
+} G_STMT_END
+
+/* fills in at most n_stats entries, one per size class, and returns
+ * the number of size classes
+ */
+guint	 g_slice_get_stats		(GSliceStats  *stats,
+					 guint	       n_stats);
+
+G_END_DECLS
+
+#endif /* __G_SLICE_H__ */
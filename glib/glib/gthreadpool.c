@@ -30,7 +30,14 @@
 
 
 typedef struct _GRealThreadPool GRealThreadPool;
+typedef struct _GThreadPoolWorker GThreadPoolWorker;
 
+#define G_THREAD_POOL_N_LANES (G_THREAD_PRIORITY_URGENT + 1)
+
+/* The tasks itself are kept in the lanes and in the deques of the
+ * workers, @queue only holds a task_marker for every task, so that
+ * its length and the waiting threads keep track of the pool as
+ * before. All task lists are protected by the lock of @queue. */
 struct _GRealThreadPool
 {
   GThreadPool pool;
@@ -40,6 +47,17 @@ struct _GRealThreadPool
   gboolean running;
   gboolean immediate;
   gboolean waiting;
+  GQueue lanes[G_THREAD_POOL_N_LANES];
+  GSList *workers;
+};
+
+/* A thread, while it runs for a pool. Tasks pushed by the thread
+ * itself go to the head of its deque and are taken from there again,
+ * idle threads of the same pool steal from the tail. */
+struct _GThreadPoolWorker
+{
+  GRealThreadPool *pool;
+  GQueue deque;
 };
 
 /* The following is just an address to mark the stop order for a
@@ -47,6 +65,9 @@ struct _GRealThreadPool
  * GThreadPool address) */
 static const gpointer stop_this_thread_marker = (gpointer) &g_thread_pool_new;
 
+/* Pushed into the queue of a pool for every task, same as above */
+static const gpointer task_marker = (gpointer) &g_thread_pool_push;
+
 /* Here all unused threads are waiting  */
 static GAsyncQueue *unused_thread_queue;
 static gint unused_threads = 0;
@@ -56,6 +77,9 @@ G_LOCK_DEFINE_STATIC (unused_threads);
 static GMutex *inform_mutex = NULL;
 static GCond *inform_cond = NULL;
 
+/* The GThreadPoolWorker of the current thread */
+static GPrivate *current_worker = NULL;
+
 static void     g_thread_pool_free_internal (GRealThreadPool* pool);
 static gpointer g_thread_pool_thread_proxy (gpointer data);
 static void     g_thread_pool_start_thread (GRealThreadPool* pool, 
@@ -65,13 +89,97 @@ static void     g_thread_pool_wakeup_and_stop_all (GRealThreadPool* pool);
 #define g_thread_should_run(pool, len) \
   ((pool)->running || (!(pool)->immediate && (len) > 0))
 
+static void
+g_thread_pool_queue_task (GRealThreadPool *pool,
+			  gpointer         data,
+			  GThreadPriority  priority)
+{
+  GThreadPoolWorker *worker = NULL;
+
+  if (priority == G_THREAD_PRIORITY_NORMAL)
+    worker = g_private_get (current_worker);
+
+  if (worker && worker->pool == pool)
+    g_queue_push_head (&worker->deque, data);
+  else
+    g_queue_push_tail (&pool->lanes[priority], data);
+
+  g_async_queue_push_unlocked (pool->queue, task_marker);
+}
+
+/* Lanes are served from the most urgent one, but a worker runs its
+ * own tasks before other normal priority tasks, and steals before
+ * running low priority tasks */
+static gpointer
+g_thread_pool_next_task (GRealThreadPool   *pool,
+			 GThreadPoolWorker *self)
+{
+  gint priority;
+
+  for (priority = G_THREAD_POOL_N_LANES - 1; priority >= 0; priority--)
+    {
+      GQueue *lane = &pool->lanes[priority];
+
+      if (priority == G_THREAD_PRIORITY_NORMAL && self->deque.head)
+	return g_queue_pop_head (&self->deque);
+
+      if (lane->head)
+	return g_queue_pop_head (lane);
+
+      if (priority == G_THREAD_PRIORITY_NORMAL)
+	{
+	  GSList *list;
+
+	  for (list = pool->workers; list; list = list->next)
+	    {
+	      GThreadPoolWorker *victim = list->data;
+
+	      if (victim->deque.tail)
+		return g_queue_pop_tail (&victim->deque);
+	    }
+	}
+    }
+
+  return NULL;
+}
+
+static void
+g_thread_pool_worker_join (GThreadPoolWorker *worker,
+			   GRealThreadPool   *pool)
+{
+  worker->pool = pool;
+  pool->workers = g_slist_prepend (pool->workers, worker);
+}
+
+static void
+g_thread_pool_worker_leave (GThreadPoolWorker *worker)
+{
+  GRealThreadPool *pool = worker->pool;
+
+  /* Tasks left in the deque keep their markers, hand them over to
+   * the remaining threads oldest first */
+  while (worker->deque.tail)
+    g_queue_push_tail (&pool->lanes[G_THREAD_PRIORITY_NORMAL],
+		       g_queue_pop_tail (&worker->deque));
+
+  pool->workers = g_slist_remove (pool->workers, worker);
+  worker->pool = NULL;
+}
+
 static gpointer 
 g_thread_pool_thread_proxy (gpointer data)
 {
   GRealThreadPool *pool = data;
+  GThreadPoolWorker worker;
   gboolean watcher = FALSE;
 
+  worker.pool = NULL;
+  worker.deque.head = worker.deque.tail = NULL;
+  worker.deque.length = 0;
+  g_private_set (current_worker, &worker);
+
   g_async_queue_lock (pool->queue);
+  g_thread_pool_worker_join (&worker, pool);
   while (TRUE)
     {
       gpointer task; 
@@ -109,6 +217,7 @@ g_thread_pool_thread_proxy (gpointer data)
 		}
 	      else if (pool->running || !pool->immediate)
 		{
+		  task = g_thread_pool_next_task (pool, &worker);
 		  g_async_queue_unlock (pool->queue);
 		  pool->pool.func (task, pool->pool.user_data);
 		  g_async_queue_lock (pool->queue);
@@ -139,6 +248,7 @@ g_thread_pool_thread_proxy (gpointer data)
 
       if (goto_global_pool)
 	{
+	  g_thread_pool_worker_leave (&worker);
 	  pool->num_threads--;
 
 	  if (!pool->running && !pool->waiting)
@@ -186,6 +296,7 @@ g_thread_pool_thread_proxy (gpointer data)
 	    return NULL;
 	  
 	  g_async_queue_lock (pool->queue);
+	  g_thread_pool_worker_join (&worker, pool);
 
 	  /* pool->num_threads++ is not done here, but in
            * g_thread_pool_start_thread to make the new started thread
@@ -276,6 +387,7 @@ g_thread_pool_new (GFunc            func,
 		   GError         **error)
 {
   GRealThreadPool *retval;
+  guint i;
   G_LOCK_DEFINE_STATIC (init);
 
   g_return_val_if_fail (func, NULL);
@@ -292,6 +404,12 @@ g_thread_pool_new (GFunc            func,
   retval->max_threads = max_threads;
   retval->num_threads = 0;
   retval->running = TRUE;
+  for (i = 0; i < G_THREAD_POOL_N_LANES; i++)
+    {
+      retval->lanes[i].head = retval->lanes[i].tail = NULL;
+      retval->lanes[i].length = 0;
+    }
+  retval->workers = NULL;
 
   G_LOCK (init);
   
@@ -300,6 +418,7 @@ g_thread_pool_new (GFunc            func,
       inform_mutex = g_mutex_new ();
       inform_cond = g_cond_new ();
       unused_thread_queue = g_async_queue_new ();
+      current_worker = g_private_new (NULL);
     }
 
   G_UNLOCK (init);
@@ -338,6 +457,12 @@ g_thread_pool_new (GFunc            func,
  * in the queue until a thread in this pool finishes its previous task
  * and processes @data. 
  *
+ * When called from a task running in @pool, @data is put in front of
+ * the calling thread's own list of tasks. The thread processes that
+ * list from the front once its current task is done, while idle
+ * threads of @pool take tasks from the back of it. This keeps
+ * recursively split work local to the thread, that created it.
+ *
  * @error can be %NULL to ignore errors, or non-%NULL to report
  * errors. An error can only occur when a new thread couldn't be
  * created. In that case @data is simply appended to the queue of work
@@ -347,10 +472,47 @@ void
 g_thread_pool_push (GThreadPool     *pool,
 		    gpointer         data,
 		    GError         **error)
+{
+  g_thread_pool_push_with_priority (pool, data, 
+				    G_THREAD_PRIORITY_NORMAL, error);
+}
+
+static void
+g_thread_pool_push_unlocked (GRealThreadPool *pool,
+			     gpointer         data,
+			     GThreadPriority  priority,
+			     GError         **error)
+{
+  if (g_async_queue_length_unlocked (pool->queue) >= 0)
+    /* No thread is waiting in the queue */
+    g_thread_pool_start_thread (pool, error);
+
+  g_thread_pool_queue_task (pool, data, priority);
+}
+
+/**
+ * g_thread_pool_push_with_priority:
+ * @pool: a #GThreadPool
+ * @data: a new task for @pool
+ * @priority: the priority of @data
+ * @error: return location for error
+ * 
+ * Inserts @data into the list of tasks to be executed by @pool like
+ * g_thread_pool_push(). Waiting tasks are processed in the order of
+ * their @priority, tasks of the same priority in the order they were
+ * pushed. Tasks pushed with g_thread_pool_push() have the priority
+ * %G_THREAD_PRIORITY_NORMAL.
+ **/
+void 
+g_thread_pool_push_with_priority (GThreadPool     *pool,
+				  gpointer         data,
+				  GThreadPriority  priority,
+				  GError         **error)
 {
   GRealThreadPool *real = (GRealThreadPool*) pool;
 
   g_return_if_fail (real);
+  g_return_if_fail (priority <= G_THREAD_PRIORITY_URGENT);
 
   g_async_queue_lock (real->queue);
   
@@ -360,12 +522,55 @@ g_thread_pool_push (GThreadPool     *pool,
       g_return_if_fail (real->running);
     }
 
-  if (g_async_queue_length_unlocked (real->queue) >= 0)
-    /* No thread is waiting in the queue */
-    g_thread_pool_start_thread (real, error);
+  g_thread_pool_push_unlocked (real, data, priority, error);
+  g_async_queue_unlock (real->queue);
+}
+
+/**
+ * g_thread_pool_push_many:
+ * @pool: a #GThreadPool
+ * @data: an array of new tasks for @pool
+ * @n_data: the number of elements in @data
+ * @error: return location for error
+ * 
+ * Inserts the @n_data elements of @data into the list of tasks to be
+ * executed by @pool, as if g_thread_pool_push() was called for each
+ * of them, but takes the lock of @pool only once.
+ *
+ * @error can be %NULL to ignore errors, or non-%NULL to report
+ * errors. An error can only occur when a new thread couldn't be
+ * created. In that case all of @data is still appended to the queue
+ * of work to do.
+ **/
+void 
+g_thread_pool_push_many (GThreadPool     *pool,
+			 gpointer        *data,
+			 guint            n_data,
+			 GError         **error)
+{
+  GRealThreadPool *real = (GRealThreadPool*) pool;
+  GError *local_error = NULL;
+  guint i;
+
+  g_return_if_fail (real);
+  g_return_if_fail (data || n_data == 0);
+
+  g_async_queue_lock (real->queue);
+  
+  if (!real->running)
+    {
+      g_async_queue_unlock (real->queue);
+      g_return_if_fail (real->running);
+    }
+
+  for (i = 0; i < n_data; i++)
+    g_thread_pool_push_unlocked (real, data[i], G_THREAD_PRIORITY_NORMAL,
+				 local_error ? NULL : &local_error);
 
-  g_async_queue_push_unlocked (real->queue, data);
   g_async_queue_unlock (real->queue);
+
+  if (local_error)
+    g_propagate_error (error, local_error);
 }
 
 /**
@@ -574,12 +779,17 @@ g_thread_pool_free (GThreadPool     *pool,
 static void
 g_thread_pool_free_internal (GRealThreadPool* pool)
 {
+  guint i;
+
   g_return_if_fail (pool);
   g_return_if_fail (!pool->running);
   g_return_if_fail (pool->num_threads == 0);
 
   g_async_queue_unref (pool->queue);
 
+  for (i = 0; i < G_THREAD_POOL_N_LANES; i++)
+    g_list_free (pool->lanes[i].head);
+
   g_free (pool);
 }
 
@@ -64,6 +64,19 @@ void            g_thread_pool_push            (GThreadPool     *pool,
                                                gpointer         data,
                                                GError         **error);
 
+/* Push new data with the given priority, tasks with a higher priority
+ * are processed first */
+void            g_thread_pool_push_with_priority (GThreadPool     *pool,
+                                                  gpointer         data,
+                                                  GThreadPriority  priority,
+                                                  GError         **error);
+
+/* Push n_data new tasks at once */
+void            g_thread_pool_push_many       (GThreadPool     *pool,
+                                               gpointer        *data,
+                                               guint            n_data,
+                                               GError         **error);
+
 /* Set the number of threads, which can run concurrently for that pool, -1
  * means no limit. 0 means has the effect, that the pool won't process
  * requests until the limit is set higher again */
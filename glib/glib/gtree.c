@@ -33,8 +33,6 @@
 #include "glib.h"
 
 
-typedef struct _GTreeNode  GTreeNode;
-
 struct _GTree
 {
   GTreeNode *root;
@@ -42,6 +40,7 @@ struct _GTree
   GDestroyNotify   key_destroy_func;
   GDestroyNotify   value_destroy_func;
   gpointer         key_compare_data;
+  guint            nnodes;
 };
 
 struct _GTreeNode
@@ -49,10 +48,18 @@ struct _GTreeNode
   gint balance;      /* height (left) - height (right) */
   GTreeNode *left;   /* left subtree */
   GTreeNode *right;  /* right subtree */
+  GTreeNode *parent; /* parent node, NULL for the root */
   gpointer key;      /* key for this node */
   gpointer value;    /* value stored at this node */
 };
 
+/* Whoever stores a subtree returned by one of the recursive functions
+ * below in a child pointer, has to update the subtree's parent link */
+#define G_TREE_NODE_SET_PARENT(child, node)	G_STMT_START{	\
+  if (child)							\
+    (child)->parent = (node);					\
+}G_STMT_END
+
 
 static GTreeNode* g_tree_node_new                   (gpointer          key,
 						     gpointer          value);
@@ -68,7 +75,8 @@ static GTreeNode* g_tree_node_insert                (GTree            *tree,
 static GTreeNode* g_tree_node_remove                (GTree            *tree,
                                                      GTreeNode        *node,
 						     gconstpointer     key,
-                                                     gboolean          notify);
+                                                     gboolean          notify,
+						     gboolean         *removed);
 static GTreeNode* g_tree_node_balance               (GTreeNode        *node);
 static GTreeNode* g_tree_node_remove_leftmost       (GTreeNode        *node,
 						     GTreeNode       **leftmost);
@@ -80,7 +88,13 @@ static GTreeNode* g_tree_node_lookup                (GTreeNode        *node,
 						     GCompareDataFunc  compare,
 						     gpointer          comp_data,
 						     gconstpointer     key);
-static gint       g_tree_node_count                 (GTreeNode        *node);
+static GTreeNode* g_tree_node_bound                 (GTree            *tree,
+						     gconstpointer     key,
+						     gboolean          upper);
+static GTreeNode* g_tree_node_build                 (gpointer         *keys,
+						     gpointer         *values,
+						     guint             n_nodes,
+						     gint             *height);
 static gint       g_tree_node_pre_order             (GTreeNode        *node,
 						     GTraverseFunc     traverse_func,
 						     gpointer          data);
@@ -131,6 +145,7 @@ g_tree_node_new (gpointer key,
   node->balance = 0;
   node->left = NULL;
   node->right = NULL;
+  node->parent = NULL;
   node->key = key;
   node->value = value;
 
@@ -156,6 +171,7 @@ g_tree_node_destroy (GTreeNode      *node,
       
 #ifdef ENABLE_GC_FRIENDLY
       node->left = NULL;
+      node->parent = NULL;
       node->key = NULL;
       node->value = NULL;
 #endif /* ENABLE_GC_FRIENDLY */
@@ -242,6 +258,7 @@ g_tree_new_full (GCompareDataFunc key_compare_func,
   tree->key_destroy_func   = key_destroy_func;
   tree->value_destroy_func = value_destroy_func;
   tree->key_compare_data   = key_compare_data;
+  tree->nnodes             = 0;
   
   return tree;
 }
@@ -296,6 +313,10 @@ g_tree_insert (GTree    *tree,
                                    tree->root,
 				   key, value, 
 				   FALSE, &inserted);
+  tree->root->parent = NULL;
+
+  if (inserted)
+    tree->nnodes++;
 }
 
 /**
@@ -328,6 +349,10 @@ g_tree_replace (GTree    *tree,
                                    tree->root,
 				   key, value, 
 				   TRUE, &inserted);
+  tree->root->parent = NULL;
+
+  if (inserted)
+    tree->nnodes++;
 }
 
 /**
@@ -345,9 +370,16 @@ void
 g_tree_remove (GTree         *tree,
 	       gconstpointer  key)
 {
+  gboolean removed;
+
   g_return_if_fail (tree != NULL);
 
-  tree->root = g_tree_node_remove (tree, tree->root, key, TRUE);
+  removed = FALSE;
+  tree->root = g_tree_node_remove (tree, tree->root, key, TRUE, &removed);
+  G_TREE_NODE_SET_PARENT (tree->root, NULL);
+
+  if (removed)
+    tree->nnodes--;
 }
 
 /**
@@ -362,9 +394,16 @@ void
 g_tree_steal (GTree         *tree,
               gconstpointer  key)
 {
+  gboolean removed;
+
   g_return_if_fail (tree != NULL);
 
-  tree->root = g_tree_node_remove (tree, tree->root, key, FALSE);
+  removed = FALSE;
+  tree->root = g_tree_node_remove (tree, tree->root, key, FALSE, &removed);
+  G_TREE_NODE_SET_PARENT (tree->root, NULL);
+
+  if (removed)
+    tree->nnodes--;
 }
 
 /**
@@ -565,7 +604,9 @@ g_tree_height (GTree *tree)
  * g_tree_nnodes:
  * @tree: a #GTree.
  * 
- * Gets the number of nodes in a #GTree.
+ * Gets the number of nodes in a #GTree. The number is kept up to date
+ * while nodes are added and removed, so this is a constant time
+ * operation.
  * 
  * Return value: the number of nodes in the #GTree.
  **/
@@ -574,10 +615,246 @@ g_tree_nnodes (GTree *tree)
 {
   g_return_val_if_fail (tree != NULL, 0);
 
-  if (tree->root)
-    return g_tree_node_count (tree->root);
-  else
-    return 0;
+  return tree->nnodes;
+}
+
+/**
+ * g_tree_build_sorted:
+ * @tree: an empty #GTree.
+ * @keys: an array of @n_nodes keys, sorted in ascending order by the
+ *   comparison function of @tree, without duplicates.
+ * @values: an array of @n_nodes values corresponding to @keys, or
+ *   %NULL to store %NULL values.
+ * @n_nodes: the number of elements in @keys and @values.
+ * 
+ * Fills an empty #GTree with the given key/value pairs. As the input
+ * is already sorted, the balanced tree is built directly in O(n)
+ * time, instead of the O(n log n) time @n_nodes calls to
+ * g_tree_insert() would take.
+ **/
+void
+g_tree_build_sorted (GTree    *tree,
+		     gpointer *keys,
+		     gpointer *values,
+		     guint     n_nodes)
+{
+  gint height;
+
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (tree->root == NULL);
+  g_return_if_fail (keys != NULL || n_nodes == 0);
+
+#ifndef G_DISABLE_CHECKS
+  {
+    guint i;
+
+    for (i = 1; i < n_nodes; i++)
+      g_return_if_fail (tree->key_compare (keys[i - 1], keys[i], 
+					   tree->key_compare_data) < 0);
+  }
+#endif /* G_DISABLE_CHECKS */
+
+  tree->root = g_tree_node_build (keys, values, n_nodes, &height);
+  tree->nnodes = n_nodes;
+}
+
+/**
+ * g_tree_lookup_node:
+ * @tree: a #GTree.
+ * @key: the key to look up.
+ * 
+ * Gets the node of @tree holding @key. The node can be used as a
+ * cursor with g_tree_node_next() and g_tree_node_previous().
+ *
+ * Return value: the node corresponding to the key, or %NULL if the
+ * key was not found.
+ **/
+GTreeNode*
+g_tree_lookup_node (GTree         *tree,
+		    gconstpointer  key)
+{
+  g_return_val_if_fail (tree != NULL, NULL);
+
+  return g_tree_node_lookup (tree->root, 
+                             tree->key_compare, tree->key_compare_data, key);
+}
+
+/**
+ * g_tree_lower_bound:
+ * @tree: a #GTree.
+ * @key: the key to search for.
+ * 
+ * Gets the first node of @tree, in sorted order, whose key is not
+ * less than @key. Together with g_tree_node_next() this allows to
+ * scan all nodes in a range of keys.
+ *
+ * Return value: the lower bound node, or %NULL if all keys of @tree
+ * are less than @key.
+ **/
+GTreeNode*
+g_tree_lower_bound (GTree         *tree,
+		    gconstpointer  key)
+{
+  g_return_val_if_fail (tree != NULL, NULL);
+
+  return g_tree_node_bound (tree, key, FALSE);
+}
+
+/**
+ * g_tree_upper_bound:
+ * @tree: a #GTree.
+ * @key: the key to search for.
+ * 
+ * Gets the first node of @tree, in sorted order, whose key is
+ * greater than @key.
+ *
+ * Return value: the upper bound node, or %NULL if no key of @tree is
+ * greater than @key.
+ **/
+GTreeNode*
+g_tree_upper_bound (GTree         *tree,
+		    gconstpointer  key)
+{
+  g_return_val_if_fail (tree != NULL, NULL);
+
+  return g_tree_node_bound (tree, key, TRUE);
+}
+
+/**
+ * g_tree_node_first:
+ * @tree: a #GTree.
+ * 
+ * Gets the node of @tree with the smallest key.
+ *
+ * Return value: the first node in sorted order, or %NULL if @tree is
+ * empty.
+ **/
+GTreeNode*
+g_tree_node_first (GTree *tree)
+{
+  GTreeNode *node;
+
+  g_return_val_if_fail (tree != NULL, NULL);
+
+  node = tree->root;
+  if (node)
+    while (node->left)
+      node = node->left;
+
+  return node;
+}
+
+/**
+ * g_tree_node_last:
+ * @tree: a #GTree.
+ * 
+ * Gets the node of @tree with the largest key.
+ *
+ * Return value: the last node in sorted order, or %NULL if @tree is
+ * empty.
+ **/
+GTreeNode*
+g_tree_node_last (GTree *tree)
+{
+  GTreeNode *node;
+
+  g_return_val_if_fail (tree != NULL, NULL);
+
+  node = tree->root;
+  if (node)
+    while (node->right)
+      node = node->right;
+
+  return node;
+}
+
+/**
+ * g_tree_node_next:
+ * @node: a #GTreeNode.
+ * 
+ * Gets the node following @node in sorted order. Walking a whole
+ * tree with this function takes amortized constant time per node.
+ * The tree must not be modified while a node is used as a cursor.
+ *
+ * Return value: the next node, or %NULL if @node is the last node.
+ **/
+GTreeNode*
+g_tree_node_next (GTreeNode *node)
+{
+  g_return_val_if_fail (node != NULL, NULL);
+
+  if (node->right)
+    {
+      node = node->right;
+      while (node->left)
+	node = node->left;
+      return node;
+    }
+
+  while (node->parent && node == node->parent->right)
+    node = node->parent;
+
+  return node->parent;
+}
+
+/**
+ * g_tree_node_previous:
+ * @node: a #GTreeNode.
+ * 
+ * Gets the node preceding @node in sorted order.
+ *
+ * Return value: the previous node, or %NULL if @node is the first
+ * node.
+ **/
+GTreeNode*
+g_tree_node_previous (GTreeNode *node)
+{
+  g_return_val_if_fail (node != NULL, NULL);
+
+  if (node->left)
+    {
+      node = node->left;
+      while (node->right)
+	node = node->right;
+      return node;
+    }
+
+  while (node->parent && node == node->parent->left)
+    node = node->parent;
+
+  return node->parent;
+}
+
+/**
+ * g_tree_node_key:
+ * @node: a #GTreeNode.
+ * 
+ * Gets the key stored at @node.
+ *
+ * Return value: the key of @node.
+ **/
+gpointer
+g_tree_node_key (GTreeNode *node)
+{
+  g_return_val_if_fail (node != NULL, NULL);
+
+  return node->key;
+}
+
+/**
+ * g_tree_node_value:
+ * @node: a #GTreeNode.
+ * 
+ * Gets the value stored at @node.
+ *
+ * Return value: the value of @node.
+ **/
+gpointer
+g_tree_node_value (GTreeNode *node)
+{
+  g_return_val_if_fail (node != NULL, NULL);
+
+  return node->value;
 }
 
 static GTreeNode*
@@ -633,6 +910,7 @@ g_tree_node_insert (GTree     *tree,
                                            node->left,
 					   key, value,
 					   replace, inserted);
+	  node->left->parent = node;
 
 	  if ((old_balance != node->left->balance) && node->left->balance)
 	    node->balance -= 1;
@@ -641,6 +919,7 @@ g_tree_node_insert (GTree     *tree,
 	{
 	  *inserted = TRUE;
 	  node->left = g_tree_node_new (key, value);
+	  node->left->parent = node;
 	  node->balance -= 1;
 	}
     }
@@ -653,6 +932,7 @@ g_tree_node_insert (GTree     *tree,
                                             node->right,
 					    key, value, 
 					    replace, inserted);
+	  node->right->parent = node;
 
 	  if ((old_balance != node->right->balance) && node->right->balance)
 	    node->balance += 1;
@@ -661,6 +941,7 @@ g_tree_node_insert (GTree     *tree,
 	{
 	  *inserted = TRUE;
 	  node->right = g_tree_node_new (key, value);
+	  node->right->parent = node;
 	  node->balance += 1;
 	}
     }
@@ -678,7 +959,8 @@ static GTreeNode*
 g_tree_node_remove (GTree         *tree,
                     GTreeNode     *node,
 		    gconstpointer  key,
-                    gboolean       notify)
+                    gboolean       notify,
+		    gboolean      *removed)
 {
   GTreeNode *new_root;
   gint old_balance;
@@ -693,6 +975,7 @@ g_tree_node_remove (GTree         *tree,
       GTreeNode *garbage;
 
       garbage = node;
+      *removed = TRUE;
 
       if (!node->right)
 	{
@@ -704,6 +987,8 @@ g_tree_node_remove (GTree         *tree,
 	  node->right = g_tree_node_remove_leftmost (node->right, &new_root);
 	  new_root->left = node->left;
 	  new_root->right = node->right;
+	  G_TREE_NODE_SET_PARENT (new_root->left, new_root);
+	  G_TREE_NODE_SET_PARENT (new_root->right, new_root);
 	  new_root->balance = node->balance;
 	  node = g_tree_node_restore_right_balance (new_root, old_balance);
 	}
@@ -718,6 +1003,7 @@ g_tree_node_remove (GTree         *tree,
 
 #ifdef ENABLE_GC_FRIENDLY
       garbage->left = NULL;
+      garbage->parent = NULL;
       garbage->key = NULL;
       garbage->value = NULL;
 #endif /* ENABLE_GC_FRIENDLY */
@@ -732,7 +1018,9 @@ g_tree_node_remove (GTree         *tree,
       if (node->left)
 	{
 	  old_balance = node->left->balance;
-	  node->left = g_tree_node_remove (tree, node->left, key, notify);
+	  node->left = g_tree_node_remove (tree, node->left, key, notify, 
+					   removed);
+	  G_TREE_NODE_SET_PARENT (node->left, node);
 	  node = g_tree_node_restore_left_balance (node, old_balance);
 	}
     }
@@ -741,7 +1029,9 @@ g_tree_node_remove (GTree         *tree,
       if (node->right)
 	{
 	  old_balance = node->right->balance;
-	  node->right = g_tree_node_remove (tree, node->right, key, notify);
+	  node->right = g_tree_node_remove (tree, node->right, key, notify,
+					    removed);
+	  G_TREE_NODE_SET_PARENT (node->right, node);
 	  node = g_tree_node_restore_right_balance (node, old_balance);
 	}
     }
@@ -755,13 +1045,19 @@ g_tree_node_balance (GTreeNode *node)
   if (node->balance < -1)
     {
       if (node->left->balance > 0)
-	node->left = g_tree_node_rotate_left (node->left);
+	{
+	  node->left = g_tree_node_rotate_left (node->left);
+	  node->left->parent = node;
+	}
       node = g_tree_node_rotate_right (node);
     }
   else if (node->balance > 1)
     {
       if (node->right->balance < 0)
-	node->right = g_tree_node_rotate_right (node->right);
+	{
+	  node->right = g_tree_node_rotate_right (node->right);
+	  node->right->parent = node;
+	}
       node = g_tree_node_rotate_left (node);
     }
 
@@ -782,6 +1078,7 @@ g_tree_node_remove_leftmost (GTreeNode  *node,
 
   old_balance = node->left->balance;
   node->left = g_tree_node_remove_leftmost (node->left, leftmost);
+  G_TREE_NODE_SET_PARENT (node->left, node);
   return g_tree_node_restore_left_balance (node, old_balance);
 }
 
@@ -844,18 +1141,62 @@ g_tree_node_lookup (GTreeNode        *node,
   return NULL;
 }
 
-static gint
-g_tree_node_count (GTreeNode *node)
+static GTreeNode*
+g_tree_node_bound (GTree         *tree,
+		   gconstpointer  key,
+		   gboolean       upper)
 {
-  gint count;
+  GTreeNode *node = tree->root;
+  GTreeNode *bound = NULL;
 
-  count = 1;
-  if (node->left)
-    count += g_tree_node_count (node->left);
-  if (node->right)
-    count += g_tree_node_count (node->right);
+  while (node)
+    {
+      gint cmp = tree->key_compare (key, node->key, tree->key_compare_data);
+
+      if (cmp < 0 || (cmp == 0 && !upper))
+	{
+	  bound = node;
+	  node = node->left;
+	}
+      else
+	node = node->right;
+    }
+
+  return bound;
+}
+
+/* The left half gets the extra node, so that heights of the halves
+ * differ by at most one */
+static GTreeNode*
+g_tree_node_build (gpointer *keys,
+		   gpointer *values,
+		   guint     n_nodes,
+		   gint     *height)
+{
+  GTreeNode *node;
+  gint left_height, right_height;
+  guint mid;
+
+  if (n_nodes == 0)
+    {
+      *height = 0;
+      return NULL;
+    }
+
+  mid = n_nodes / 2;
+  node = g_tree_node_new (keys[mid], values ? values[mid] : NULL);
+
+  node->left = g_tree_node_build (keys, values, mid, &left_height);
+  node->right = g_tree_node_build (keys + mid + 1, 
+				   values ? values + mid + 1 : NULL,
+				   n_nodes - mid - 1, &right_height);
+  G_TREE_NODE_SET_PARENT (node->left, node);
+  G_TREE_NODE_SET_PARENT (node->right, node);
 
-  return count;
+  node->balance = right_height - left_height;
+  *height = MAX (left_height, right_height) + 1;
+
+  return node;
 }
 
 static gint
@@ -978,7 +1319,9 @@ g_tree_node_rotate_left (GTreeNode *node)
   right = node->right;
 
   node->right = right->left;
+  G_TREE_NODE_SET_PARENT (node->right, node);
   right->left = node;
+  node->parent = right;
 
   a_bal = node->balance;
   b_bal = right->balance;
@@ -1013,7 +1356,9 @@ g_tree_node_rotate_right (GTreeNode *node)
   left = node->left;
 
   node->left = left->right;
+  G_TREE_NODE_SET_PARENT (node->left, node);
   left->right = node;
+  node->parent = left;
 
   a_bal = node->balance;
   b_bal = left->balance;
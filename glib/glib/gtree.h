@@ -32,6 +32,7 @@
 G_BEGIN_DECLS
 
 typedef struct _GTree  GTree;
+typedef struct _GTreeNode GTreeNode;
 
 typedef gboolean (*GTraverseFunc) (gpointer  key,
                                    gpointer  value,
@@ -79,6 +80,25 @@ gpointer g_tree_search          (GTree            *tree,
                                  gconstpointer     user_data);
 gint     g_tree_height          (GTree            *tree);
 gint     g_tree_nnodes          (GTree            *tree);
+void     g_tree_build_sorted    (GTree            *tree,
+                                 gpointer         *keys,
+                                 gpointer         *values,
+                                 guint             n_nodes);
+
+/* Cursors, the tree must not be modified while a node is used
+ */
+GTreeNode* g_tree_lookup_node   (GTree            *tree,
+                                 gconstpointer     key);
+GTreeNode* g_tree_lower_bound   (GTree            *tree,
+                                 gconstpointer     key);
+GTreeNode* g_tree_upper_bound   (GTree            *tree,
+                                 gconstpointer     key);
+GTreeNode* g_tree_node_first    (GTree            *tree);
+GTreeNode* g_tree_node_last     (GTree            *tree);
+GTreeNode* g_tree_node_next     (GTreeNode        *node);
+GTreeNode* g_tree_node_previous (GTreeNode        *node);
+gpointer   g_tree_node_key      (GTreeNode        *node);
+gpointer   g_tree_node_value    (GTreeNode        *node);
 
 
 
@@ -258,6 +258,10 @@ gchar *g_utf8_strdown (const gchar *str,
 		       gssize       len);
 gchar *g_utf8_casefold (const gchar *str,
 			gssize       len);
+gsize  g_utf8_casefold_to_buffer (const gchar *str,
+				  gssize       len,
+				  gchar       *buffer,
+				  gsize        buffer_size);
 
 typedef enum {
   G_NORMALIZE_DEFAULT,
@@ -278,6 +282,7 @@ gint   g_utf8_collate     (const gchar *str1,
 			   const gchar *str2);
 gchar *g_utf8_collate_key (const gchar *str,
 			   gssize       len);
+void   g_utf8_collate_key_set_cache_size (guint max_keys);
 
 G_END_DECLS
 
@@ -32,6 +32,29 @@ extern gunichar *_g_utf8_normalize_wc (const gchar    *str,
 				       gssize          max_len,
 				       GNormalizeMode  mode);
 
+typedef struct _GCollateKeyEntry GCollateKeyEntry;
+
+/* An entry of the collate key cache, kept in a list from the most to
+ * the least recently used entry */
+struct _GCollateKeyEntry
+{
+  gchar *str;
+  gsize len;
+  gchar *key;
+  GCollateKeyEntry *prev;
+  GCollateKeyEntry *next;
+};
+
+G_LOCK_DEFINE_STATIC (collate_key_cache);
+static GHashTable *collate_key_cache = NULL;
+static GCollateKeyEntry *collate_key_mru = NULL;
+static GCollateKeyEntry *collate_key_lru = NULL;
+static guint collate_key_cache_size = 0;
+static guint collate_key_cache_max = 0;
+/* The collation locale and charset the cached keys were made for */
+static gchar *collate_key_locale = NULL;
+static gchar *collate_key_charset = NULL;
+
 /**
  * g_utf8_collate:
  * @str1: a UTF-8 encoded string
@@ -162,23 +185,9 @@ utf8_encode (char *buf, wchar_t val)
 }
 #endif /* __STDC_ISO_10646__ */
 
-/**
- * g_utf8_collate_key:
- * @str: a UTF-8 encoded string.
- * @len: length of @str, in bytes, or -1 if @str is nul-terminated.
- *
- * Converts a string into a collation key that can be compared
- * with other collation keys using <function>strcmp()</function>. 
- * The results of comparing the collation keys of two strings 
- * with <function>strcmp()</function> will always be the same as 
- * comparing the two original keys with g_utf8_collate().
- * 
- * Return value: a newly allocated string. This string should
- *   be freed with g_free() when you are done with it.
- **/
-gchar *
-g_utf8_collate_key (const gchar *str,
-		    gssize       len)
+static gchar *
+collate_key_real (const gchar *str,
+		  gssize       len)
 {
   gchar *result;
   size_t xfrm_len;
@@ -190,8 +199,6 @@ g_utf8_collate_key (const gchar *str,
   size_t i;
   size_t result_len = 0;
 
-  g_return_val_if_fail (str != NULL, NULL);
-
   str_norm = _g_utf8_normalize_wc (str, len, G_NORMALIZE_ALL_COMPOSE);
 
   setlocale (LC_COLLATE, "");
@@ -219,8 +226,6 @@ g_utf8_collate_key (const gchar *str,
   const gchar *charset;
   gchar *str_norm;
 
-  g_return_val_if_fail (str != NULL, NULL);
-
   str_norm = g_utf8_normalize (str, len, G_NORMALIZE_ALL_COMPOSE);
 
   if (g_get_charset (&charset))
@@ -258,3 +263,230 @@ g_utf8_collate_key (const gchar *str,
 
   return result;
 }
+
+/* HOLDS: collate_key_cache */
+static void
+collate_key_cache_unlink (GCollateKeyEntry *entry)
+{
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    collate_key_mru = entry->next;
+
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    collate_key_lru = entry->prev;
+}
+
+/* HOLDS: collate_key_cache */
+static void
+collate_key_cache_link (GCollateKeyEntry *entry)
+{
+  entry->prev = NULL;
+  entry->next = collate_key_mru;
+
+  if (collate_key_mru)
+    collate_key_mru->prev = entry;
+  else
+    collate_key_lru = entry;
+
+  collate_key_mru = entry;
+}
+
+/* The entries are their own keys in the hash table, hashed and
+ * compared on the bytes of the string, so a lookup can use the
+ * string passed in without copying it.
+ */
+static guint
+collate_key_entry_hash (gconstpointer key)
+{
+  const GCollateKeyEntry *entry = key;
+  const gchar *p = entry->str;
+  const gchar *end = entry->str + entry->len;
+  guint h = 0;
+
+  while (p < end)
+    h = (h << 5) - h + *p++;
+
+  return h;
+}
+
+static gboolean
+collate_key_entry_equal (gconstpointer a,
+			 gconstpointer b)
+{
+  const GCollateKeyEntry *entry_a = a;
+  const GCollateKeyEntry *entry_b = b;
+
+  return entry_a->len == entry_b->len &&
+    memcmp (entry_a->str, entry_b->str, entry_a->len) == 0;
+}
+
+/* HOLDS: collate_key_cache */
+static void
+collate_key_cache_trim (guint max_size)
+{
+  while (collate_key_cache_size > max_size)
+    {
+      GCollateKeyEntry *entry = collate_key_lru;
+
+      collate_key_cache_unlink (entry);
+      g_hash_table_remove (collate_key_cache, entry);
+      collate_key_cache_size--;
+
+      g_free (entry->str);
+      g_free (entry->key);
+      g_free (entry);
+    }
+}
+
+/* Empties the cache, if the keys in it were made for a different
+ * collation.
+ * HOLDS: collate_key_cache 
+ */
+static void
+collate_key_cache_check_locale (void)
+{
+  const gchar *locale = setlocale (LC_COLLATE, NULL);
+  const gchar *charset;
+
+  g_get_charset (&charset);
+
+  if (!locale)
+    locale = "C";
+
+  if (collate_key_locale && 
+      strcmp (locale, collate_key_locale) == 0 &&
+      strcmp (charset, collate_key_charset) == 0)
+    return;
+
+  collate_key_cache_trim (0);
+
+  g_free (collate_key_locale);
+  g_free (collate_key_charset);
+  collate_key_locale = g_strdup (locale);
+  collate_key_charset = g_strdup (charset);
+}
+
+/**
+ * g_utf8_collate_key:
+ * @str: a UTF-8 encoded string.
+ * @len: length of @str, in bytes, or -1 if @str is nul-terminated.
+ *
+ * Converts a string into a collation key that can be compared
+ * with other collation keys using <function>strcmp()</function>. 
+ * The results of comparing the collation keys of two strings 
+ * with <function>strcmp()</function> will always be the same as 
+ * comparing the two original keys with g_utf8_collate().
+ *
+ * If a cache size has been set with
+ * g_utf8_collate_key_set_cache_size(), recently computed keys are
+ * looked up in the cache first.
+ * 
+ * Return value: a newly allocated string. This string should
+ *   be freed with g_free() when you are done with it.
+ **/
+gchar *
+g_utf8_collate_key (const gchar *str,
+		    gssize       len)
+{
+  GCollateKeyEntry lookup;
+  GCollateKeyEntry *entry;
+  gchar *result;
+
+  g_return_val_if_fail (str != NULL, NULL);
+
+  /* Don't take the lock, unless the cache is in use */
+  if (g_atomic_int_get ((gint *) &collate_key_cache_max) == 0)
+    return collate_key_real (str, len);
+
+  lookup.str = (gchar *) str;
+  lookup.len = len < 0 ? strlen (str) : len;
+
+  G_LOCK (collate_key_cache);
+
+  if (collate_key_cache_max > 0)
+    {
+      collate_key_cache_check_locale ();
+
+      entry = g_hash_table_lookup (collate_key_cache, &lookup);
+      if (entry)
+	{
+	  collate_key_cache_unlink (entry);
+	  collate_key_cache_link (entry);
+	  result = g_strdup (entry->key);
+
+	  G_UNLOCK (collate_key_cache);
+
+	  return result;
+	}
+    }
+
+  G_UNLOCK (collate_key_cache);
+
+  /* Compute the key without holding the lock, so other threads
+   * can collate meanwhile
+   */
+  result = collate_key_real (str, len);
+
+  G_LOCK (collate_key_cache);
+
+  /* Computing the key may have set the collation locale, and
+   * another thread may have added the same string or disabled the
+   * cache meanwhile.
+   */
+  if (collate_key_cache_max > 0)
+    {
+      collate_key_cache_check_locale ();
+
+      if (!g_hash_table_lookup (collate_key_cache, &lookup))
+	{
+	  entry = g_new (GCollateKeyEntry, 1);
+	  entry->str = g_malloc (lookup.len + 1);
+	  memcpy (entry->str, str, lookup.len);
+	  entry->str[lookup.len] = '\0';
+	  entry->len = lookup.len;
+	  entry->key = g_strdup (result);
+
+	  g_hash_table_insert (collate_key_cache, entry, entry);
+	  collate_key_cache_link (entry);
+	  collate_key_cache_size++;
+	  collate_key_cache_trim (collate_key_cache_max);
+	}
+    }
+
+  G_UNLOCK (collate_key_cache);
+
+  return result;
+}
+
+/**
+ * g_utf8_collate_key_set_cache_size:
+ * @max_keys: the maximal number of collation keys to keep, 0 disables
+ *   the cache.
+ *
+ * Sets the number of collation keys g_utf8_collate_key() keeps for
+ * strings it has recently been called with. Keeping keys pays off,
+ * when the same strings are compared over and over again, like the
+ * entries of a list, that is sorted repeatedly. When the cache is
+ * full, the least recently used key is dropped. All keys are dropped,
+ * when the collation locale or the charset changes.
+ *
+ * The cache is disabled by default.
+ **/
+void
+g_utf8_collate_key_set_cache_size (guint max_keys)
+{
+  G_LOCK (collate_key_cache);
+
+  if (max_keys && !collate_key_cache)
+    collate_key_cache = g_hash_table_new (collate_key_entry_hash,
+					  collate_key_entry_equal);
+
+  collate_key_cache_max = max_keys;
+  if (collate_key_cache)
+    collate_key_cache_trim (max_keys);
+
+  G_UNLOCK (collate_key_cache);
+}
@@ -26,6 +26,7 @@
 #include "glib.h"
 #include "gunidecomp.h"
 #include "gunicomp.h"
+#include "gunicodeprivate.h"
 
 
 #define CC(Page, Char) \
@@ -241,11 +242,25 @@ _g_utf8_normalize_wc (const gchar    *str,
   gunichar *wc_buffer;
   const char *p;
   gsize last_start;
+  const gchar *ascii_end;
   gboolean do_compat = (mode == G_NORMALIZE_NFKC ||
 			mode == G_NORMALIZE_NFKD);
   gboolean do_compose = (mode == G_NORMALIZE_NFC ||
 			 mode == G_NORMALIZE_NFKC);
 
+  /* ASCII characters neither decompose nor combine, so every
+   * normalization mode leaves a pure ASCII string unchanged */
+  ascii_end = _g_utf8_skip_ascii (str, max_len < 0 ? NULL : str + max_len);
+  if ((max_len >= 0 && ascii_end == str + max_len) || !*ascii_end)
+    {
+      wc_buffer = g_new (gunichar, ascii_end - str + 1);
+      for (n_wc = 0; n_wc < (gsize) (ascii_end - str); n_wc++)
+	wc_buffer[n_wc] = (guchar) str[n_wc];
+      wc_buffer[n_wc] = 0;
+
+      return wc_buffer;
+    }
+
   n_wc = 0;
   p = str;
   while ((max_len < 0 || p < str + max_len) && *p)
@@ -400,9 +415,15 @@ g_utf8_normalize (const gchar    *str,
 		  gssize          len,
 		  GNormalizeMode  mode)
 {
-  gunichar *result_wc = _g_utf8_normalize_wc (str, len, mode);
+  gunichar *result_wc;
   gchar *result;
-  
+  const gchar *ascii_end;
+
+  ascii_end = _g_utf8_skip_ascii (str, len < 0 ? NULL : str + len);
+  if ((len >= 0 && ascii_end == str + len) || !*ascii_end)
+    return g_strndup (str, ascii_end - str);
+
+  result_wc = _g_utf8_normalize_wc (str, len, mode);
   result = g_ucs4_to_utf8 (result_wc, -1, NULL, NULL, NULL);
   g_free (result_wc);
 
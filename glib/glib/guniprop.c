@@ -27,6 +27,7 @@
 
 #include "glib.h"
 #include "gunichartables.h"
+#include "gunicodeprivate.h"
 
 
 #define ATTTABLE(Page, Char) \
@@ -736,6 +737,19 @@ g_utf8_strup (const gchar *str,
   return result;
 }
 
+static gchar *
+ascii_strdown (const gchar *str,
+	       gsize        len)
+{
+  gchar *result = g_strndup (str, len);
+  gsize i;
+
+  for (i = 0; i < len; i++)
+    result[i] = g_ascii_tolower (result[i]);
+
+  return result;
+}
+
 static gsize
 real_tolower (const gchar *str,
 	      gssize       max_len,
@@ -841,10 +855,19 @@ g_utf8_strdown (const gchar *str,
   gsize result_len;
   LocaleType locale_type;
   gchar *result;
+  const gchar *ascii_end;
 
   g_return_val_if_fail (str != NULL, NULL);
 
   locale_type = get_locale_type ();
+
+  /* Only the Turkic locales lower ASCII differently */
+  if (locale_type != LOCALE_TURKIC)
+    {
+      ascii_end = _g_utf8_skip_ascii (str, len < 0 ? NULL : str + len);
+      if ((len >= 0 && ascii_end == str + len) || !*ascii_end)
+	return ascii_strdown (str, ascii_end - str);
+    }
   
   /*
    * We use a two pass approach to keep memory management simple
@@ -857,37 +880,25 @@ g_utf8_strdown (const gchar *str,
   return result;
 }
 
-/**
- * g_utf8_casefold:
- * @str: a UTF-8 encoded string
- * @len: length of @str, in bytes, or -1 if @str is nul-terminated.
- * 
- * Converts a string into a form that is independent of case. The
- * result will not correspond to any particular case, but can be
- * compared for equality or ordered with the results of calling
- * g_utf8_casefold() on other strings.
- * 
- * Note that calling g_utf8_casefold() followed by g_utf8_collate() is
- * only an approximation to the correct linguistic case insensitive
- * ordering, though it is a fairly good one. Getting this exactly
- * right would require a more sophisticated collation function that
- * takes case sensitivity into account. GLib does not currently
- * provide such a function.
- * 
- * Return value: a newly allocated string, that is a
- *   case independent form of @str.
- **/
-gchar *
-g_utf8_casefold (const gchar *str,
-		 gssize       len)
+/* Stores the complete characters of the result, that fit in
+ * out_size - 1 bytes, in out_buffer and terminates them, returns the
+ * length of the complete result */
+static gsize
+real_casefold (const gchar *str,
+	       gssize       max_len,
+	       gchar       *out_buffer,
+	       gsize        out_size)
 {
-  GString *result = g_string_new (NULL);
-  const char *p;
+  const char *p = str;
+  gsize len = 0;
+  gsize out_len = 0;
 
-  p = str;
-  while ((len < 0 || p < str + len) && *p)
+  while ((max_len < 0 || p < str + max_len) && *p)
     {
       gunichar ch = g_utf8_get_char (p);
+      gchar buf[8];
+      const gchar *folded = NULL;
+      gsize folded_len;
 
       int start = 0;
       int end = G_N_ELEMENTS (casefold_table);
@@ -900,8 +911,8 @@ g_utf8_casefold (const gchar *str,
 	      int half = (start + end) / 2;
 	      if (ch == casefold_table[half].ch)
 		{
-		  g_string_append (result, casefold_table[half].data);
-		  goto next;
+		  folded = casefold_table[half].data;
+		  break;
 		}
 	      else if (half == start)
 		break;
@@ -912,11 +923,95 @@ g_utf8_casefold (const gchar *str,
 	    }
 	}
 
-      g_string_append_unichar (result, g_unichar_tolower (ch));
-      
-    next:
+      if (folded)
+	folded_len = strlen (folded);
+      else
+	{
+	  folded_len = g_unichar_to_utf8 (g_unichar_tolower (ch), buf);
+	  folded = buf;
+	}
+
+      if (out_len == len && len + folded_len < out_size)
+	{
+	  memcpy (out_buffer + out_len, folded, folded_len);
+	  out_len += folded_len;
+	}
+      len += folded_len;
+
       p = g_utf8_next_char (p);
     }
 
-  return g_string_free (result, FALSE); 
+  if (out_size > 0)
+    out_buffer[out_len] = '\0';
+
+  return len;
+}
+
+/**
+ * g_utf8_casefold:
+ * @str: a UTF-8 encoded string
+ * @len: length of @str, in bytes, or -1 if @str is nul-terminated.
+ * 
+ * Converts a string into a form that is independent of case. The
+ * result will not correspond to any particular case, but can be
+ * compared for equality or ordered with the results of calling
+ * g_utf8_casefold() on other strings.
+ * 
+ * Note that calling g_utf8_casefold() followed by g_utf8_collate() is
+ * only an approximation to the correct linguistic case insensitive
+ * ordering, though it is a fairly good one. Getting this exactly
+ * right would require a more sophisticated collation function that
+ * takes case sensitivity into account. GLib does not currently
+ * provide such a function.
+ * 
+ * Return value: a newly allocated string, that is a
+ *   case independent form of @str.
+ **/
+gchar *
+g_utf8_casefold (const gchar *str,
+		 gssize       len)
+{
+  gsize result_len;
+  gchar *result;
+  const gchar *ascii_end;
+
+  g_return_val_if_fail (str != NULL, NULL);
+
+  ascii_end = _g_utf8_skip_ascii (str, len < 0 ? NULL : str + len);
+  if ((len >= 0 && ascii_end == str + len) || !*ascii_end)
+    return ascii_strdown (str, ascii_end - str);
+
+  result_len = real_casefold (str, len, NULL, 0);
+  result = g_malloc (result_len + 1);
+  real_casefold (str, len, result, result_len + 1);
+
+  return result;
+}
+
+/**
+ * g_utf8_casefold_to_buffer:
+ * @str: a UTF-8 encoded string
+ * @len: length of @str, in bytes, or -1 if @str is nul-terminated.
+ * @buffer: the buffer to store the result in, or %NULL.
+ * @buffer_size: the size of @buffer in bytes.
+ * 
+ * Converts a string into a case independent form like
+ * g_utf8_casefold(), but stores the result in @buffer instead of
+ * allocating memory. At most @buffer_size - 1 bytes of complete
+ * characters are stored, followed by a nul byte.
+ * 
+ * Return value: the length of the complete case independent form
+ *   of @str in bytes, not counting the nul byte. If this is not less
+ *   than @buffer_size, the result has been truncated.
+ **/
+gsize
+g_utf8_casefold_to_buffer (const gchar *str,
+			   gssize       len,
+			   gchar       *buffer,
+			   gsize        buffer_size)
+{
+  g_return_val_if_fail (str != NULL, 0);
+  g_return_val_if_fail (buffer != NULL || buffer_size == 0, 0);
+
+  return real_casefold (str, len, buffer, buffer_size);
 }
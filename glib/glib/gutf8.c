@@ -28,6 +28,14 @@
 #include <string.h>
 
 #include "glib.h"
+#include "gunicodeprivate.h"
+
+#if defined (__SSE2__) || defined (_M_X64) || \
+    (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+/* SSE2 is part of the target's baseline, no runtime check is needed */
+#include <emmintrin.h>
+#define G_UTF8_USE_SSE2
+#endif
 
 #ifdef G_PLATFORM_WIN32
 #include <stdio.h>
@@ -115,6 +123,86 @@ static const gchar utf8_skip_data[256] = {
 
 const gchar * const g_utf8_skip = utf8_skip_data;
 
+/* Bytes 1..127, the bytes that are a complete character by themselves
+ * and don't terminate the string */
+#define IS_ASCII_NONZERO(c) ((guchar) ((c) - 1) < 127)
+
+#ifdef G_UTF8_USE_SSE2
+#define ASCII_BLOCK_SIZE 16
+#else
+#define ASCII_BLOCK_SIZE GLIB_SIZEOF_SIZE_T
+#define ASCII_ONES  ((gsize) -1 / 0xff)	/* 0x01 in every byte */
+#define ASCII_HIGHS (ASCII_ONES * 0x80)	/* 0x80 in every byte */
+#endif
+
+/* Returns the first position at or after @p, that holds a non-ASCII
+ * byte or a nul byte, or @end if all bytes up to @end are ASCII. If
+ * @end is %NULL, @p is nul-terminated.
+ *
+ * The bytes are checked a block at a time. Blocks are aligned, so a
+ * block never crosses a page boundary and it is safe to read the rest
+ * of a block beyond the terminating nul byte.
+ */
+const gchar *
+_g_utf8_skip_ascii (const gchar *p,
+		    const gchar *end)
+{
+  while ((gsize) p & (ASCII_BLOCK_SIZE - 1))
+    {
+      if ((end && p >= end) || !IS_ASCII_NONZERO (*p))
+	return p;
+      p++;
+    }
+
+  while (!end || end - p >= ASCII_BLOCK_SIZE)
+    {
+#ifdef G_UTF8_USE_SSE2
+      __m128i block = _mm_load_si128 ((const __m128i *) p);
+      __m128i zeros = _mm_cmpeq_epi8 (block, _mm_setzero_si128 ());
+
+      if (_mm_movemask_epi8 (_mm_or_si128 (block, zeros)))
+	break;
+#else
+      gsize word;
+
+      memcpy (&word, p, sizeof (word));
+      /* a byte of 0 borrows and sets its high bit, false positives
+       * after it don't matter */
+      if ((word | (word - ASCII_ONES)) & ASCII_HIGHS)
+	break;
+#endif
+      p += ASCII_BLOCK_SIZE;
+    }
+
+  while ((!end || p < end) && IS_ASCII_NONZERO (*p))
+    p++;
+
+  return p;
+}
+
+/* Short runs of ASCII, like the spaces between CJK words or the
+ * letters between accented ones, are cheaper to step over a byte at
+ * a time. Only hands longer runs to _g_utf8_skip_ascii(). */
+static inline const gchar *
+skip_ascii (const gchar *p,
+	    const gchar *end)
+{
+  const gchar *stop;
+
+  if (end && end - p < ASCII_BLOCK_SIZE)
+    stop = end;
+  else
+    stop = p + ASCII_BLOCK_SIZE;
+
+  while (p < stop && IS_ASCII_NONZERO (*p))
+    p++;
+
+  if (p == stop && p != end)
+    return _g_utf8_skip_ascii (p, end);
+
+  return p;
+}
+
 /**
  * g_utf8_find_prev_char:
  * @str: pointer to the beginning of a UTF-8 encoded string
@@ -220,28 +308,42 @@ g_utf8_strlen (const gchar *p,
     {
       while (*p)
         {
-          p = g_utf8_next_char (p);
-          ++len;
+	  if (IS_ASCII_NONZERO (*p))
+	    {
+	      const gchar *q = skip_ascii (p, NULL);
+
+	      len += q - p;
+	      p = q;
+	    }
+	  else
+	    {
+	      p = g_utf8_next_char (p);
+	      ++len;
+	    }
         }
     }
   else
     {
-      if (max == 0 || !*p)
-        return 0;
-      
-      p = g_utf8_next_char (p);          
+      const gchar *end = start + max;
 
-      while (p - start < max && *p)
+      while (p < end && *p)
         {
-          ++len;
-          p = g_utf8_next_char (p);          
-        }
+	  if (IS_ASCII_NONZERO (*p))
+	    {
+	      const gchar *q = skip_ascii (p, end);
 
-      /* only do the last len increment if we got a complete
-       * char (don't count partial chars)
-       */
-      if (p - start == max)
-        ++len;
+	      len += q - p;
+	      p = q;
+	    }
+	  else
+	    {
+	      p = g_utf8_next_char (p);
+
+	      /* only count complete chars */
+	      if (p <= end)
+		++len;
+	    }
+        }
     }
 
   return len;
@@ -289,8 +391,23 @@ g_utf8_offset_to_pointer  (const gchar *str,
 			   glong        offset)    
 {
   const gchar *s = str;
-  while (offset--)
-    s = g_utf8_next_char (s);
+
+  while (offset > 0)
+    {
+      if (IS_ASCII_NONZERO (*s))
+	{
+	  /* offset characters take at least offset bytes */
+	  const gchar *q = skip_ascii (s, s + offset);
+
+	  offset -= q - s;
+	  s = q;
+	}
+      else
+	{
+	  s = g_utf8_next_char (s);
+	  offset--;
+	}
+    }
   
   return (gchar *)s;
 }
@@ -314,8 +431,18 @@ g_utf8_pointer_to_offset (const gchar *str,
   
   while (s < pos)
     {
-      s = g_utf8_next_char (s);
-      offset++;
+      if (IS_ASCII_NONZERO (*s))
+	{
+	  const gchar *q = skip_ascii (s, pos);
+
+	  offset += q - s;
+	  s = q;
+	}
+      else
+	{
+	  s = g_utf8_next_char (s);
+	  offset++;
+	}
     }
 
   return offset;
@@ -1523,7 +1650,12 @@ fast_validate (const char *str)
   for (p = str; *p; p++)
     {
       if (*(guchar *)p < 128)
-	/* done */;
+	{
+	  /* skip runs of ASCII, the loop steps to the byte
+	   * _g_utf8_skip_ascii() stopped at */
+	  if (IS_ASCII_NONZERO (p[1]))
+	    p = skip_ascii (p + 1, NULL) - 1;
+	}
       else 
 	{
 	  const gchar *last;
@@ -1590,7 +1722,11 @@ fast_validate_len (const char *str,
   for (p = str; (max_len < 0 || (p - str) < max_len) && *p; p++)
     {
       if (*(guchar *)p < 128)
-	/* done */;
+	{
+	  if ((max_len < 0 || (p - str) + 1 < max_len) && 
+	      IS_ASCII_NONZERO (p[1]))
+	    p = skip_ascii (p + 1, max_len < 0 ? NULL : str + max_len) - 1;
+	}
       else 
 	{
 	  const gchar *last;
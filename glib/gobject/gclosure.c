@@ -18,6 +18,7 @@
  */
 
 #include	"gclosure.h"
+#include	"gclosureprivate.h"
 
 #include	"gvalue.h"
 #include	<string.h>
@@ -36,6 +37,84 @@
 #define	CLOSURE_N_NOTIFIERS(cl)		(CLOSURE_N_MFUNCS (cl) + \
                                          (cl)->n_fnotifiers + \
                                          (cl)->n_inotifiers)
+/* ref_count and the flags of a closure share one word, so all changes
+ * to them after creation are done as compare-and-exchange of the whole
+ * word; otherwise concurrent updates of neighbouring fields get lost */
+typedef union {
+  GClosure closure;
+  gint     vint;
+} ClosureInt;
+
+/* Without threads nothing can race with the update, and a plain store
+ * is much cheaper than the atomic exchange. The old value needs no
+ * barrier of its own, a stale one just makes the exchange fail */
+#define CLOSURE_INT_CAS(_atomic, _oldval, _newval)			\
+  (g_thread_supported () ?						\
+   g_atomic_int_compare_and_exchange ((_atomic), (_oldval), (_newval)) :	\
+   (*(_atomic) = (_newval), TRUE))
+
+#define CHANGE_FIELD(_closure, _field, _OP, _value, _SET_OLD, _SET_NEW)	\
+G_STMT_START {									\
+  ClosureInt *cunion = (ClosureInt*) (_closure);				\
+  gint new_int, old_int;							\
+  do {										\
+    ClosureInt tmp;								\
+    tmp.vint = old_int = *(volatile gint *) &cunion->vint;			\
+    _SET_OLD tmp.closure._field;						\
+    tmp.closure._field _OP _value;						\
+    _SET_NEW tmp.closure._field;						\
+    new_int = tmp.vint;								\
+  } while (!CLOSURE_INT_CAS (&cunion->vint, old_int, new_int));		\
+} G_STMT_END
+
+#define SET(_closure, _field, _value)          CHANGE_FIELD (_closure, _field, =, _value, (void), (void))
+#define INC(_closure, _field)                  CHANGE_FIELD (_closure, _field, +=, 1, (void), (void))
+#define INC_ASSIGN(_closure, _field, _newv)    CHANGE_FIELD (_closure, _field, +=, 1, (void), *(_newv) =)
+#define DEC(_closure, _field)                  CHANGE_FIELD (_closure, _field, -=, 1, (void), (void))
+#define DEC_ASSIGN(_closure, _field, _newv)    CHANGE_FIELD (_closure, _field, -=, 1, (void), *(_newv) =)
+#define SWAP(_closure, _field, _value, _oldv)  CHANGE_FIELD (_closure, _field, =, _value, *(_oldv) =, (void))
+
+/* g_closure_invoke() changes ref_count and in_marshal together, in
+ * one exchange instead of two */
+static inline void
+closure_ref_and_set_in_marshal (GClosure *closure)
+{
+  ClosureInt *cunion = (ClosureInt*) closure;
+  gint new_int, old_int;
+
+  do {
+    ClosureInt tmp;
+
+    tmp.vint = old_int = *(volatile gint *) &cunion->vint;
+    tmp.closure.ref_count += 1;
+    tmp.closure.in_marshal = TRUE;
+    new_int = tmp.vint;
+  } while (!CLOSURE_INT_CAS (&cunion->vint, old_int, new_int));
+}
+
+/* The reverse, unless the reference could be the last one, which
+ * g_closure_unref() has to drop */
+static inline gboolean
+closure_unref_and_set_in_marshal (GClosure *closure,
+				  gboolean  in_marshal)
+{
+  ClosureInt *cunion = (ClosureInt*) closure;
+  gint new_int, old_int;
+
+  do {
+    ClosureInt tmp;
+
+    tmp.vint = old_int = *(volatile gint *) &cunion->vint;
+    if (tmp.closure.ref_count <= 1)
+      return FALSE;
+    tmp.closure.ref_count -= 1;
+    tmp.closure.in_marshal = in_marshal;
+    new_int = tmp.vint;
+  } while (!CLOSURE_INT_CAS (&cunion->vint, old_int, new_int));
+
+  return TRUE;
+}
+
 enum {
   FNOTIFY,
   INOTIFY,
@@ -101,7 +180,9 @@ closure_invoke_notifiers (GClosure *closure,
     case FNOTIFY:
       while (closure->n_fnotifiers)
 	{
-	  register guint n = --closure->n_fnotifiers;
+	  guint n;
+
+	  DEC_ASSIGN (closure, n_fnotifiers, &n);
 
 	  ndata = closure->notifiers + CLOSURE_N_MFUNCS (closure) + n;
 	  closure->marshal = (GClosureMarshal) ndata->notify;
@@ -112,10 +193,12 @@ closure_invoke_notifiers (GClosure *closure,
       closure->data = NULL;
       break;
     case INOTIFY:
-      closure->in_inotify = TRUE;
+      SET (closure, in_inotify, TRUE);
       while (closure->n_inotifiers)
 	{
-          register guint n = --closure->n_inotifiers;
+	  guint n;
+
+	  DEC_ASSIGN (closure, n_inotifiers, &n);
 
 	  ndata = closure->notifiers + CLOSURE_N_MFUNCS (closure) + closure->n_fnotifiers + n;
 	  closure->marshal = (GClosureMarshal) ndata->notify;
@@ -124,7 +207,7 @@ closure_invoke_notifiers (GClosure *closure,
 	}
       closure->marshal = NULL;
       closure->data = NULL;
-      closure->in_inotify = FALSE;
+      SET (closure, in_inotify, FALSE);
       break;
     case PRE_NOTIFY:
       i = closure->n_guards;
@@ -174,7 +257,7 @@ g_closure_set_meta_marshal (GClosure       *closure,
     }
   closure->notifiers[0].data = marshal_data;
   closure->notifiers[0].notify = (GClosureNotify) meta_marshal;
-  closure->meta_marshal = 1;
+  SET (closure, meta_marshal, 1);
 }
 
 void
@@ -214,11 +297,12 @@ g_closure_add_marshal_guards (GClosure      *closure,
     closure->notifiers[(closure->meta_marshal +
 			closure->n_guards +
 			closure->n_guards + 1)] = closure->notifiers[closure->meta_marshal + closure->n_guards];
-  i = closure->n_guards++;
+  i = closure->n_guards;
   closure->notifiers[closure->meta_marshal + i].data = pre_marshal_data;
   closure->notifiers[closure->meta_marshal + i].notify = pre_marshal_notify;
   closure->notifiers[closure->meta_marshal + i + 1].data = post_marshal_data;
   closure->notifiers[closure->meta_marshal + i + 1].notify = post_marshal_notify;
+  INC (closure, n_guards);
 }
 
 void
@@ -238,9 +322,10 @@ g_closure_add_finalize_notifier (GClosure      *closure,
 			closure->n_fnotifiers +
 			closure->n_inotifiers)] = closure->notifiers[(CLOSURE_N_MFUNCS (closure) +
 								      closure->n_fnotifiers + 0)];
-  i = CLOSURE_N_MFUNCS (closure) + closure->n_fnotifiers++;
+  i = CLOSURE_N_MFUNCS (closure) + closure->n_fnotifiers;
   closure->notifiers[i].data = notify_data;
   closure->notifiers[i].notify = notify_func;
+  INC (closure, n_fnotifiers);
 }
 
 void
@@ -256,9 +341,10 @@ g_closure_add_invalidate_notifier (GClosure      *closure,
   g_return_if_fail (closure->n_inotifiers < CLOSURE_MAX_N_INOTIFIERS);
 
   closure->notifiers = g_renew (GClosureNotifyData, closure->notifiers, CLOSURE_N_NOTIFIERS (closure) + 1);
-  i = CLOSURE_N_MFUNCS (closure) + closure->n_fnotifiers + closure->n_inotifiers++;
+  i = CLOSURE_N_MFUNCS (closure) + closure->n_fnotifiers + closure->n_inotifiers;
   closure->notifiers[i].data = notify_data;
   closure->notifiers[i].notify = notify_func;
+  INC (closure, n_inotifiers);
 }
 
 static inline gboolean
@@ -272,7 +358,7 @@ closure_try_remove_inotify (GClosure       *closure,
   for (ndata = nlast + 1 - closure->n_inotifiers; ndata <= nlast; ndata++)
     if (ndata->notify == notify_func && ndata->data == notify_data)
       {
-	closure->n_inotifiers -= 1;
+	DEC (closure, n_inotifiers);
 	if (ndata < nlast)
 	  *ndata = *nlast;
 
@@ -292,7 +378,7 @@ closure_try_remove_fnotify (GClosure       *closure,
   for (ndata = nlast + 1 - closure->n_fnotifiers; ndata <= nlast; ndata++)
     if (ndata->notify == notify_func && ndata->data == notify_data)
       {
-	closure->n_fnotifiers -= 1;
+	DEC (closure, n_fnotifiers);
 	if (ndata < nlast)
 	  *ndata = *nlast;
 	if (closure->n_inotifiers)
@@ -308,11 +394,14 @@ closure_try_remove_fnotify (GClosure       *closure,
 GClosure*
 g_closure_ref (GClosure *closure)
 {
+  guint new_ref_count;
+
   g_return_val_if_fail (closure != NULL, NULL);
   g_return_val_if_fail (closure->ref_count > 0, NULL);
   g_return_val_if_fail (closure->ref_count < CLOSURE_MAX_REF_COUNT, NULL);
 
-  closure->ref_count += 1;
+  INC_ASSIGN (closure, ref_count, &new_ref_count);
+  g_return_val_if_fail (new_ref_count > 1, NULL);
 
   return closure;
 }
@@ -324,9 +413,13 @@ g_closure_invalidate (GClosure *closure)
 
   if (!closure->is_invalid)
     {
-      closure->ref_count += 1;	/* preserve floating flag */
-      closure->is_invalid = TRUE;
-      closure_invoke_notifiers (closure, INOTIFY);
+      gboolean was_invalid;
+
+      INC (closure, ref_count);	/* preserve floating flag */
+      SWAP (closure, is_invalid, TRUE, &was_invalid);
+      /* invalidate only once */
+      if (!was_invalid)
+	closure_invoke_notifiers (closure, INOTIFY);
       g_closure_unref (closure);
     }
 }
@@ -334,15 +427,17 @@ g_closure_invalidate (GClosure *closure)
 void
 g_closure_unref (GClosure *closure)
 {
+  guint new_ref_count;
+
   g_return_if_fail (closure != NULL);
   g_return_if_fail (closure->ref_count > 0);
 
   if (closure->ref_count == 1)	/* last unref, invalidate first */
     g_closure_invalidate (closure);
 
-  closure->ref_count -= 1;
+  DEC_ASSIGN (closure, ref_count, &new_ref_count);
 
-  if (closure->ref_count == 0)
+  if (new_ref_count == 0)
     {
       closure_invoke_notifiers (closure, FNOTIFY);
       g_free (closure->notifiers);
@@ -363,10 +458,11 @@ g_closure_sink (GClosure *closure)
    */
   if (closure->floating)
     {
-      closure->floating = FALSE;
-      if (closure->ref_count > 1)
-	closure->ref_count -= 1;
-      else
+      gboolean was_floating;
+
+      SWAP (closure, floating, FALSE, &was_floating);
+      /* unref the floating reference only once */
+      if (was_floating)
 	g_closure_unref (closure);
     }
 }
@@ -420,8 +516,7 @@ g_closure_invoke (GClosure       *closure,
 
       g_return_if_fail (closure->marshal || closure->meta_marshal);
 
-      closure->ref_count += 1;	/* preserve floating flag */
-      closure->in_marshal = TRUE;
+      closure_ref_and_set_in_marshal (closure);	/* preserve floating flag */
       if (closure->meta_marshal)
 	{
 	  marshal_data = closure->notifiers[0].data;
@@ -441,8 +536,11 @@ g_closure_invoke (GClosure       *closure,
 	       marshal_data);
       if (!in_marshal)
 	closure_invoke_notifiers (closure, POST_NOTIFY);
-      closure->in_marshal = in_marshal;
-      g_closure_unref (closure);
+      if (!closure_unref_and_set_in_marshal (closure, in_marshal))
+	{
+	  SET (closure, in_marshal, in_marshal);
+	  g_closure_unref (closure);
+	}
     }
 }
 
@@ -544,6 +642,27 @@ g_type_iface_meta_marshal (GClosure       *closure,
 		      callback);
 }
 
+gboolean
+_g_closure_is_void (GClosure *closure,
+		    gpointer  instance)
+{
+  GTypeClass *class;
+  guint offset;
+
+  if (closure->is_invalid)
+    return TRUE;
+
+  /* only class closures with no class handler are known to be void */
+  if (!closure->meta_marshal ||
+      closure->notifiers[0].notify != (GClosureNotify) g_type_class_meta_marshal)
+    return FALSE;
+
+  offset = GPOINTER_TO_UINT (closure->notifiers[0].data);
+  class = G_TYPE_INSTANCE_GET_CLASS (instance, (GType) closure->data, GTypeClass);
+
+  return G_STRUCT_MEMBER (gpointer, class, offset) == NULL;
+}
+
 GClosure*
 g_signal_type_cclosure_new (GType    itype,
 			    guint    struct_offset)
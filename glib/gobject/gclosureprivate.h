@@ -0,0 +1,32 @@
+/* GObject - GLib Type, Object, Parameter and Signal Library
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef __G_CLOSURE_PRIVATE_H__
+#define __G_CLOSURE_PRIVATE_H__
+
+#include        <gobject/gclosure.h>
+
+G_BEGIN_DECLS
+
+/* For the signal system, whether invoking @closure on @instance is a no-op */
+gboolean _g_closure_is_void			(GClosure	*closure,
+						 gpointer	 instance);
+
+G_END_DECLS
+
+#endif /* __G_CLOSURE_PRIVATE_H__ */
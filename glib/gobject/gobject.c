@@ -98,11 +98,26 @@ static inline void	   object_set_property		(GObject        *object,
 							 GObjectNotifyQueue *nqueue);
 
 
+/* --- property lookup cache --- */
+#define	PSPEC_CACHE_SIZE	(32)	/* power of 2 */
+typedef struct
+{
+  const gchar *name;
+  GParamSpec  *pspec;
+} PSpecCacheEntry;
+typedef struct
+{
+  gint            serial;
+  PSpecCacheEntry entries[PSPEC_CACHE_SIZE];
+} PSpecCache;
+
+
 /* --- variables --- */
 static GQuark	            quark_closure_array = 0;
 static GQuark	            quark_weak_refs = 0;
 static GParamSpecPool      *pspec_pool = NULL;
 static GObjectNotifyContext property_notify_context = { 0, };
+static gint		    pspec_cache_serial = 0;	/* atomic */
 static gulong	            gobject_signals[LAST_SIGNAL] = { 0, };
 
 
@@ -197,6 +212,7 @@ g_object_base_class_init (GObjectClass *class)
   class->construct_properties = pclass ? g_slist_copy (pclass->construct_properties) : NULL;
   class->get_property = NULL;
   class->set_property = NULL;
+  class->pspec_cache = NULL;
 }
 
 static void
@@ -208,6 +224,9 @@ g_object_base_class_finalize (GObjectClass *class)
 
   g_slist_free (class->construct_properties);
   class->construct_properties = NULL;
+  g_free (class->pspec_cache);
+  class->pspec_cache = NULL;
+  g_atomic_int_inc (&pspec_cache_serial);
   list = g_param_spec_pool_list_owned (pspec_pool, G_OBJECT_CLASS_TYPE (class));
   for (node = list; node; node = node->next)
     {
@@ -293,6 +312,8 @@ g_object_class_install_property (GObjectClass *class,
   g_param_spec_sink (pspec);
   PARAM_SPEC_SET_PARAM_ID (pspec, property_id);
   g_param_spec_pool_insert (pspec_pool, pspec, G_OBJECT_CLASS_TYPE (class));
+  /* this may override lookups cached by derived classes */
+  g_atomic_int_inc (&pspec_cache_serial);
   if (pspec->flags & (G_PARAM_CONSTRUCT | G_PARAM_CONSTRUCT_ONLY))
     class->construct_properties = g_slist_prepend (class->construct_properties, pspec);
 
@@ -304,6 +325,57 @@ g_object_class_install_property (GObjectClass *class,
     class->construct_properties = g_slist_remove (class->construct_properties, pspec);
 }
 
+static GParamSpec*
+object_class_lookup_pspec (GObjectClass *class,
+			   const gchar  *property_name)
+{
+  PSpecCache *cache = class->pspec_cache;
+  PSpecCacheEntry *entry;
+  GParamSpec *pspec;
+  gint serial = g_atomic_int_get (&pspec_cache_serial);
+  gsize hash;
+
+  if (!cache)
+    {
+      cache = g_new0 (PSpecCache, 1);
+      cache->serial = serial;
+      if (!g_atomic_pointer_compare_and_exchange (&class->pspec_cache, NULL, cache))
+	{
+	  g_free (cache);
+	  cache = class->pspec_cache;
+	}
+    }
+  else if (cache->serial != serial)
+    {
+      memset (cache->entries, 0, sizeof (cache->entries));
+      cache->serial = serial;
+    }
+
+  /* property names are mostly string literals, so the cache is keyed
+   * by the name's address. the name of a cached pspec is compared
+   * nevertheless, that catches reused addresses as well as entries
+   * torn up by concurrent updates, and a pspec is only cached under
+   * its own (canonical) name.
+   */
+  hash = (gsize) property_name;
+  entry = cache->entries + ((hash ^ hash >> 5) & (PSPEC_CACHE_SIZE - 1));
+  pspec = entry->pspec;
+  if (pspec && entry->name == property_name && strcmp (pspec->name, property_name) == 0)
+    return pspec;
+
+  pspec = g_param_spec_pool_lookup (pspec_pool,
+				    property_name,
+				    G_OBJECT_CLASS_TYPE (class),
+				    TRUE);
+  if (pspec && strcmp (pspec->name, property_name) == 0)
+    {
+      entry->pspec = pspec;
+      entry->name = property_name;
+    }
+
+  return pspec;
+}
+
 GParamSpec*
 g_object_class_find_property (GObjectClass *class,
 			      const gchar  *property_name)
@@ -311,10 +383,7 @@ g_object_class_find_property (GObjectClass *class,
   g_return_val_if_fail (G_IS_OBJECT_CLASS (class), NULL);
   g_return_val_if_fail (property_name != NULL, NULL);
   
-  return g_param_spec_pool_lookup (pspec_pool,
-				   property_name,
-				   G_OBJECT_CLASS_TYPE (class),
-				   TRUE);
+  return object_class_lookup_pspec (class, property_name);
 }
 
 GParamSpec** /* free result */
@@ -420,7 +489,7 @@ g_object_last_unref (GObject *object)
 {
   g_return_if_fail (object->ref_count > 0);
   
-  if (object->ref_count == 1)	/* may have been re-referenced meanwhile */
+  if (g_atomic_int_get ((gint*) &object->ref_count) == 1)	/* may have been re-referenced meanwhile */
     G_OBJECT_GET_CLASS (object)->dispose (object);
   
 #ifdef	G_ENABLE_DEBUG
@@ -428,9 +497,7 @@ g_object_last_unref (GObject *object)
     G_BREAKPOINT ();
 #endif	/* G_ENABLE_DEBUG */
 
-  object->ref_count -= 1;
-  
-  if (object->ref_count == 0)	/* may have been re-referenced meanwhile */
+  if (g_atomic_int_dec_and_test ((gint*) &object->ref_count))	/* may have been re-referenced meanwhile */
     {
       g_signal_handlers_destroy (object);
       g_datalist_id_set_data (&object->qdata, quark_weak_refs, NULL);
@@ -508,10 +575,7 @@ g_object_notify (GObject     *object,
     return;
   
   g_object_ref (object);
-  pspec = g_param_spec_pool_lookup (pspec_pool,
-				    property_name,
-				    G_OBJECT_TYPE (object),
-				    TRUE);
+  pspec = object_class_lookup_pspec (G_OBJECT_GET_CLASS (object), property_name);
   if (!pspec)
 {
  } else
@@ -634,10 +698,7 @@ g_object_newv (GType       object_type,
   for (i = 0; i < n_parameters; i++)
     {
       GValue *value = &parameters[i].value;
-      GParamSpec *pspec = g_param_spec_pool_lookup (pspec_pool,
-						    parameters[i].name,
-						    object_type,
-						    TRUE);
+      GParamSpec *pspec = object_class_lookup_pspec (class, parameters[i].name);
       if (!pspec)
 	{
 	  continue;
@@ -743,10 +804,7 @@ g_object_new_valist (GType	  object_type,
   while (name)
     {
       gchar *error = NULL;
-      GParamSpec *pspec = g_param_spec_pool_lookup (pspec_pool,
-						    name,
-						    object_type,
-						    TRUE);
+      GParamSpec *pspec = object_class_lookup_pspec (class, name);
       if (!pspec)
 	{
 	  break;
@@ -838,10 +896,7 @@ g_object_set_valist (GObject	 *object,
       GParamSpec *pspec;
       gchar *error = NULL;
       
-      pspec = g_param_spec_pool_lookup (pspec_pool,
-					name,
-					G_OBJECT_TYPE (object),
-					TRUE);
+      pspec = object_class_lookup_pspec (G_OBJECT_GET_CLASS (object), name);
       if (!pspec)
 	{
 	  break;
@@ -893,10 +948,7 @@ g_object_get_valist (GObject	 *object,
       GParamSpec *pspec;
       gchar *error;
       
-      pspec = g_param_spec_pool_lookup (pspec_pool,
-					name,
-					G_OBJECT_TYPE (object),
-					TRUE);
+      pspec = object_class_lookup_pspec (G_OBJECT_GET_CLASS (object), name);
       if (!pspec)
 	{
 	  break;
@@ -971,10 +1023,7 @@ g_object_set_property (GObject	    *object,
   g_object_ref (object);
   nqueue = g_object_notify_queue_freeze (object, &property_notify_context);
   
-  pspec = g_param_spec_pool_lookup (pspec_pool,
-				    property_name,
-				    G_OBJECT_TYPE (object),
-				    TRUE);
+  pspec = object_class_lookup_pspec (G_OBJECT_GET_CLASS (object), property_name);
   if (!pspec)
 {
  } else
@@ -984,6 +1033,59 @@ g_object_set_property (GObject	    *object,
   g_object_unref (object);
 }
 
+/**
+ * g_object_setv:
+ * @object: a #GObject
+ * @n_properties: the number of properties to set
+ * @pspecs: the #GParamSpec<!-- -->s of the properties, as returned by
+ *   g_object_class_find_property() for the class of @object or one of
+ *   its ancestors
+ * @values: the @n_properties values to set
+ * 
+ * Sets several properties on @object with a single notification
+ * freeze. Since the properties are already resolved, no name lookups
+ * are involved, which makes this the cheapest way to repeatedly set
+ * the same group of properties, e.g. on cell renderers.
+ **/
+void
+g_object_setv (GObject       *object,
+	       guint          n_properties,
+	       GParamSpec   **pspecs,
+	       const GValue  *values)
+{
+  GObjectNotifyQueue *nqueue;
+  guint i;
+  
+  g_return_if_fail (G_IS_OBJECT (object));
+  if (!n_properties)
+    return;
+  g_return_if_fail (pspecs != NULL);
+  g_return_if_fail (values != NULL);
+  
+  g_object_ref (object);
+  nqueue = g_object_notify_queue_freeze (object, &property_notify_context);
+  
+  for (i = 0; i < n_properties; i++)
+    {
+      GParamSpec *pspec = pspecs[i];
+      
+      if (!G_IS_PARAM_SPEC (pspec) ||
+	  !g_type_is_a (G_OBJECT_TYPE (object), pspec->owner_type))
+	{
+	  break;
+	}
+      if (!(pspec->flags & G_PARAM_WRITABLE))
+	{
+	  break;
+	}
+      
+      object_set_property (object, pspec, values + i, nqueue);
+    }
+  
+  g_object_notify_queue_thaw (object, nqueue);
+  g_object_unref (object);
+}
+
 void
 g_object_get_property (GObject	   *object,
 		       const gchar *property_name,
@@ -997,10 +1099,7 @@ g_object_get_property (GObject	   *object,
   
   g_object_ref (object);
   
-  pspec = g_param_spec_pool_lookup (pspec_pool,
-				    property_name,
-				    G_OBJECT_TYPE (object),
-				    TRUE);
+  pspec = object_class_lookup_pspec (G_OBJECT_GET_CLASS (object), property_name);
   if (!pspec)
 {
  } else
@@ -1260,7 +1359,7 @@ g_object_ref (gpointer _object)
     G_BREAKPOINT ();
 #endif  /* G_ENABLE_DEBUG */
 
-  object->ref_count += 1;
+  g_atomic_int_inc ((gint*) &object->ref_count);
   
   return object;
 }
@@ -1269,6 +1368,7 @@ void
 g_object_unref (gpointer _object)
 {
   GObject *object = _object;
+  gint old_ref;
 
   g_return_if_fail (G_IS_OBJECT (object));
   g_return_if_fail (object->ref_count > 0);
@@ -1278,8 +1378,17 @@ g_object_unref (gpointer _object)
     G_BREAKPOINT ();
 #endif  /* G_ENABLE_DEBUG */
 
-  if (object->ref_count > 1)
-    object->ref_count -= 1;
+  /* only the last reference is handed to g_object_last_unref(), so
+   * drop others with a compare-and-exchange that fails if the count
+   * changed in between; that also makes a barrier for the read
+   * unnecessary */
+ retry:
+  old_ref = *(volatile gint*) &object->ref_count;
+  if (old_ref > 1)
+    {
+      if (!g_atomic_int_compare_and_exchange ((gint*) &object->ref_count, old_ref, old_ref - 1))
+	goto retry;
+    }
   else
     g_object_last_unref (object);
 }
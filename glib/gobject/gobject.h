@@ -98,8 +98,11 @@ struct  _GObjectClass
   /* signals */
   void	     (*notify)			(GObject	*object,
 					 GParamSpec	*pspec);
+  /*< private >*/
+  gpointer	pspec_cache;
+
   /* padding */
-  gpointer	pdummy[8];
+  gpointer	pdummy[7];
 };
 struct _GObjectConstructParam
 {
@@ -149,6 +152,10 @@ void        g_object_set_property             (GObject        *object,
 void        g_object_get_property             (GObject        *object,
 					       const gchar    *property_name,
 					       GValue         *value);
+void        g_object_setv                     (GObject        *object,
+					       guint           n_properties,
+					       GParamSpec    **pspecs,
+					       const GValue   *values);
 void        g_object_freeze_notify            (GObject        *object);
 void        g_object_notify                   (GObject        *object,
 					       const gchar    *property_name);
@@ -34,6 +34,7 @@ typedef void (*GObjectNotifyQueueDispatcher) (GObject     *object,
 
 
 /* --- structures --- */
+#define G_OBJECT_NOTIFY_QUEUE_PREALLOC	(8)	/* also the dedup hashing threshold */
 struct _GObjectNotifyContext
 {
   GQuark                       quark_notify_queue;
@@ -43,12 +44,12 @@ struct _GObjectNotifyContext
 struct _GObjectNotifyQueue
 {
   GObjectNotifyContext *context;
-  GSList               *pspecs;
+  GParamSpec          **pspecs;		/* unique, in order of last notification */
   guint16               n_pspecs;
   guint16               freeze_count;
-  /* currently, this structure abuses the GList allocation chain and thus
-   * must be <= sizeof (GList)
-   */
+  guint16               n_alloced;
+  GHashTable           *pspec_set;	/* pspec -> position + 1, only for large queues */
+  GParamSpec           *pspecs_mem[G_OBJECT_NOTIFY_QUEUE_PREALLOC];
 };
 
 
@@ -58,8 +59,11 @@ g_object_notify_queue_free (gpointer data)
 {
   GObjectNotifyQueue *nqueue = data;
 
-  g_slist_free (nqueue->pspecs);
-  g_list_free_1 ((void*) nqueue);
+  if (nqueue->pspecs != nqueue->pspecs_mem)
+    g_free (nqueue->pspecs);
+  if (nqueue->pspec_set)
+    g_hash_table_destroy (nqueue->pspec_set);
+  g_slice_free (GObjectNotifyQueue, nqueue);
 }
 
 static inline GObjectNotifyQueue*
@@ -71,9 +75,10 @@ g_object_notify_queue_freeze (GObject		   *object,
   nqueue = g_datalist_id_get_data (&object->qdata, context->quark_notify_queue);
   if (!nqueue)
     {
-      nqueue = (void*) g_list_alloc ();
-      memset (nqueue, 0, sizeof (*nqueue));
+      nqueue = g_slice_new0 (GObjectNotifyQueue);
       nqueue->context = context;
+      nqueue->pspecs = nqueue->pspecs_mem;
+      nqueue->n_alloced = G_OBJECT_NOTIFY_QUEUE_PREALLOC;
       g_datalist_id_set_data_full (&object->qdata, context->quark_notify_queue,
 				   nqueue, g_object_notify_queue_free);
     }
@@ -90,8 +95,7 @@ g_object_notify_queue_thaw (GObject            *object,
 {
   GObjectNotifyContext *context = nqueue->context;
   GParamSpec *pspecs_mem[16], **pspecs, **free_me = NULL;
-  GSList *slist;
-  guint n_pspecs = 0;
+  guint i, n_pspecs;
 
   g_return_if_fail (nqueue->freeze_count > 0);
 
@@ -100,23 +104,15 @@ g_object_notify_queue_thaw (GObject            *object,
     return;
   g_return_if_fail (object->ref_count > 0);
 
+  /* the queue is already deduped, copy it out since removing it
+   * from the object frees it. like always, the most recently queued
+   * notifications get dispatched first.
+   */
   pspecs = nqueue->n_pspecs > 16 ? free_me = g_new (GParamSpec*, nqueue->n_pspecs) : pspecs_mem;
-  /* set first entry to NULL since it's checked unconditionally */
-  pspecs[0] = NULL;
-  for (slist = nqueue->pspecs; slist; slist = slist->next)
-    {
-      GParamSpec *pspec = slist->data;
-      gint i = 0;
-
-      /* dedup, make pspecs in the list unique */
-    redo_dedup_check:
-      if (pspecs[i] == pspec)
-	continue;
-      if (++i < n_pspecs)
-	goto redo_dedup_check;
-
-      pspecs[n_pspecs++] = pspec;
-    }
+  n_pspecs = 0;
+  for (i = nqueue->n_pspecs; i > 0; i--)
+    if (nqueue->pspecs[i - 1])
+      pspecs[n_pspecs++] = nqueue->pspecs[i - 1];
   g_datalist_id_set_data (&object->qdata, context->quark_notify_queue, NULL);
 
   if (n_pspecs)
@@ -130,11 +126,46 @@ g_object_notify_queue_clear (GObject            *object,
 {
   g_return_if_fail (nqueue->freeze_count > 0);
 
-  g_slist_free (nqueue->pspecs);
-  nqueue->pspecs = NULL;
+  if (nqueue->pspec_set)
+    {
+      g_hash_table_destroy (nqueue->pspec_set);
+      nqueue->pspec_set = NULL;
+    }
   nqueue->n_pspecs = 0;
 }
 
+/* squeezes out the holes left by repeated notifications and
+ * makes room for at least one more pspec
+ */
+static inline void
+g_object_notify_queue_grow (GObjectNotifyQueue *nqueue)
+{
+  guint i, n = 0;
+
+  if (nqueue->pspec_set)
+    {
+      g_hash_table_destroy (nqueue->pspec_set);
+      nqueue->pspec_set = g_hash_table_new (NULL, NULL);
+      for (i = 0; i < nqueue->n_pspecs; i++)
+	if (nqueue->pspecs[i])
+	  {
+	    nqueue->pspecs[n++] = nqueue->pspecs[i];
+	    g_hash_table_insert (nqueue->pspec_set, nqueue->pspecs[i], GUINT_TO_POINTER (n));
+	  }
+      nqueue->n_pspecs = n;
+    }
+
+  if (nqueue->n_pspecs >= nqueue->n_alloced / 2 && nqueue->n_alloced < 65535)
+    {
+      guint n_alloced = MIN (nqueue->n_alloced * 2, 65535);
+
+      if (nqueue->pspecs == nqueue->pspecs_mem)
+	nqueue->pspecs = g_memdup (nqueue->pspecs_mem, sizeof (nqueue->pspecs_mem));
+      nqueue->pspecs = g_renew (GParamSpec*, nqueue->pspecs, n_alloced);
+      nqueue->n_alloced = n_alloced;
+    }
+}
+
 static inline void
 g_object_notify_queue_add (GObject            *object,
 			   GObjectNotifyQueue *nqueue,
@@ -142,11 +173,47 @@ g_object_notify_queue_add (GObject            *object,
 {
   if (pspec->flags & G_PARAM_READABLE)
     {
-      g_return_if_fail (nqueue->n_pspecs < 65535);
-      
-      /* we do the deduping in _thaw */
-      nqueue->pspecs = g_slist_prepend (nqueue->pspecs, pspec);
-      nqueue->n_pspecs++;
+      guint i;
+
+      /* dedup right away, a repeated notification moves pspec to the
+       * end of the queue. small queues are scanned and shifted, large
+       * ones get a set so repeated notifications stay O(1), they leave
+       * a hole which is squeezed out once the array fills up.
+       */
+      if (nqueue->pspec_set)
+	{
+	  i = GPOINTER_TO_UINT (g_hash_table_lookup (nqueue->pspec_set, pspec));
+	  if (i == nqueue->n_pspecs)
+	    return;
+	  if (i)
+	    nqueue->pspecs[i - 1] = NULL;
+	}
+      else
+	for (i = 0; i < nqueue->n_pspecs; i++)
+	  if (nqueue->pspecs[i] == pspec)
+	    {
+	      if (i == nqueue->n_pspecs - 1)
+		return;
+	      g_memmove (nqueue->pspecs + i, nqueue->pspecs + i + 1,
+			 (nqueue->n_pspecs - i - 1) * sizeof (GParamSpec*));
+	      nqueue->n_pspecs--;
+	      break;
+	    }
+
+      if (nqueue->n_pspecs >= nqueue->n_alloced)
+	g_object_notify_queue_grow (nqueue);
+      g_return_if_fail (nqueue->n_pspecs < nqueue->n_alloced);
+
+      nqueue->pspecs[nqueue->n_pspecs++] = pspec;
+
+      if (nqueue->pspec_set)
+	g_hash_table_insert (nqueue->pspec_set, pspec, GUINT_TO_POINTER ((guint) nqueue->n_pspecs));
+      else if (nqueue->n_pspecs >= G_OBJECT_NOTIFY_QUEUE_PREALLOC)
+	{
+	  nqueue->pspec_set = g_hash_table_new (NULL, NULL);
+	  for (i = 0; i < nqueue->n_pspecs; i++)
+	    g_hash_table_insert (nqueue->pspec_set, nqueue->pspecs[i], GUINT_TO_POINTER (i + 1));
+	}
     }
 }
 
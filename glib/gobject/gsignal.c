@@ -27,6 +27,7 @@
 #include <config.h>
 
 #include        "gsignal.h"
+#include        "gclosureprivate.h"
 #include        "gbsearcharray.h"
 #include        "gvaluecollector.h"
 #include	"gvaluetypes.h"
@@ -41,6 +42,28 @@
 #define HANDLER_PRE_ALLOC       (48)
 
 #define REPORT_BUG      "please report occourance circumstances to gtk-devel-list@gnome.org"
+
+/* consumes the arguments G_VALUE_COLLECT() would collect for a value of type
+ * _type, without collecting them
+ */
+#define SIGNAL_SKIP_VALUE(_type, var_args)					\
+G_STMT_START {									\
+  GTypeValueTable *_vtable = g_type_value_table_peek (_type);			\
+  gchar *_collect_format = _vtable->collect_format;				\
+										\
+  while (*_collect_format)							\
+    switch (*_collect_format++)							\
+      {										\
+      case G_VALUE_COLLECT_INT:		(void) va_arg ((var_args), gint);	break;	\
+      case G_VALUE_COLLECT_LONG:	(void) va_arg ((var_args), glong);	break;	\
+      case G_VALUE_COLLECT_INT64:	(void) va_arg ((var_args), gint64);	break;	\
+      case G_VALUE_COLLECT_DOUBLE:	(void) va_arg ((var_args), gdouble);	break;	\
+      case G_VALUE_COLLECT_POINTER:	(void) va_arg ((var_args), gpointer);	break;	\
+      default:									\
+	g_assert_not_reached ();						\
+      }										\
+} G_STMT_END
+
 #ifdef	G_ENABLE_DEBUG
 #define IF_DEBUG(debug_type, cond)	if ((_g_type_debug_flags & G_TYPE_DEBUG_ ## debug_type) || cond)
 static volatile gpointer g_trace_instance_signals = NULL;
@@ -173,6 +196,7 @@ struct _SignalNode
   GType              itype;
   const gchar             *name;
   guint              destroyed : 1;
+  guint              has_handlers : 1;	/* a handler was ever connected */
   
   /* reinitializable portion */
   guint              flags : 8;
@@ -661,6 +685,8 @@ handler_insert (guint    signal_id,
 
   if (!handler->next)
     hlist->tail_after = handler;
+
+  LOOKUP_SIGNAL_NODE (signal_id)->has_handlers = TRUE;
 }
 
 static inline void
@@ -2361,6 +2387,42 @@ g_signal_has_handler_pending (gpointer instance,
   return has_pending;
 }
 
+/* HOLDS: g_signal_mutex */
+static inline gboolean
+signal_check_skip_emission (SignalNode *node,
+			    gpointer    instance,
+			    GQuark      detail)
+{
+  GClosure *class_closure;
+
+  /* emission hooks and debugging see every emission */
+  if (node->emission_hooks && node->emission_hooks->hooks)
+    return FALSE;
+#ifdef	G_ENABLE_DEBUG
+  IF_DEBUG (SIGNALS, g_trace_instance_signals == instance || g_trap_instance_signals == instance)
+    return FALSE;
+#endif	/* G_ENABLE_DEBUG */
+
+  class_closure = signal_lookup_closure (node, instance);
+  if (class_closure && !_g_closure_is_void (class_closure, instance))
+    return FALSE;
+
+  if (node->has_handlers)
+    {
+      HandlerList *hlist = handler_list_lookup (node->signal_id, instance);
+
+      if (hlist && hlist->handlers)
+	return FALSE;
+    }
+
+  /* an emission in progress would have to be restarted */
+  if ((node->flags & G_SIGNAL_NO_RECURSE) &&
+      emission_find (g_restart_emissions, node->signal_id, detail, instance))
+    return FALSE;
+
+  return TRUE;
+}
+
 /**
  * g_signal_emitv:
  * @instance_and_params: argument list for the signal emission. The first 
@@ -2447,6 +2509,12 @@ g_signal_emitv (const GValue *instance_and_params,
     return_value = NULL;
 #endif	/* G_ENABLE_DEBUG */
 
+  if (signal_check_skip_emission (node, instance, detail))
+    {
+      SIGNAL_UNLOCK ();
+      return;
+    }
+
   SIGNAL_UNLOCK ();
   signal_emit_unlocked_R (node, detail, instance, return_value, instance_and_params);
 }
@@ -2497,6 +2565,34 @@ g_signal_emit_valist (gpointer instance,
 
   n_params = node->n_params;
   signal_return_type = node->return_type;
+
+  /* Nothing would run, so skip collecting the parameters into
+   * GValues and only reset the return value. */
+  if (signal_check_skip_emission (node, instance, detail))
+    {
+      GType *param_types = node->param_types;
+      GValue return_value = { 0, };
+      gchar *error = NULL;
+
+      SIGNAL_UNLOCK ();
+      if (signal_return_type == G_TYPE_NONE)
+	return;
+
+      for (i = 0; i < n_params; i++)
+	SIGNAL_SKIP_VALUE (param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE, var_args);
+
+      g_value_init (&return_value, signal_return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
+      G_VALUE_LCOPY (&return_value,
+		     var_args,
+		     (signal_return_type & G_SIGNAL_TYPE_STATIC_SCOPE) ? G_VALUE_NOCOPY_CONTENTS : 0,
+		     &error);
+      if (!error)
+	g_value_unset (&return_value);
+      else
+	g_free (error);
+      return;
+    }
+
   if (node->n_params < MAX_STACK_VALUES)
     instance_and_params = stack_values;
   else
@@ -2714,6 +2810,8 @@ signal_emit_unlocked_R (SignalNode   *node,
   emission.chain_type = G_TYPE_NONE;
   emission_push ((node->flags & G_SIGNAL_NO_RECURSE) ? &g_restart_emissions : &g_recursive_emissions, &emission);
   class_closure = signal_lookup_closure (node, instance);
+  if (class_closure && _g_closure_is_void (class_closure, instance))
+    class_closure = NULL;
   
  EMIT_RESTART:
   
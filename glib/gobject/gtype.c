@@ -143,6 +143,7 @@ static gboolean				type_node_is_a_L		(TypeNode		*node,
 
 
 /* --- structures --- */
+#define IFACE_CACHE_SIZE			(4)	/* power of 2 */
 struct _TypeNode
 {
   GTypePlugin *plugin;
@@ -153,6 +154,7 @@ struct _TypeNode
   guint        is_instantiatable : 1;
   guint        mutatable_check_cache : 1;	/* combines some common path checks */
   GType       *children;
+  GType volatile iface_cache[IFACE_CACHE_SIZE];	/* positive conformity results, read unlocked */
   TypeData * volatile data;
   GQuark       qname;
   GData       *global_gdata;
@@ -181,6 +183,7 @@ struct _TypeNode
 #define	iface_node_get_dependants_array_L(n)	((GType*) type_get_qdata_L ((n), static_quark_dependants_array))
 #define	iface_node_set_dependants_array_W(n,d)	(type_set_qdata_W ((n), static_quark_dependants_array, (d)))
 #define	TYPE_ID_MASK				((GType) ((1 << G_TYPE_FUNDAMENTAL_SHIFT) - 1))
+#define	IFACE_CACHE_SLOT(node, itype)		((node)->iface_cache[((itype) >> 4 ^ (itype) >> 9) & (IFACE_CACHE_SIZE - 1)])
 
 
 struct _IFaceHolder
@@ -231,7 +234,6 @@ struct _InstanceData
   guint16            instance_size;
   guint16            n_preallocs;
   GInstanceInitFunc  instance_init;
-  GMemChunk        *mem_chunk;
 };
 union _TypeData
 {
@@ -837,7 +839,6 @@ type_data_make_W (TypeNode              *node,
       data->instance.n_preallocs = MIN (info->n_preallocs, 1024);
 #endif	/* !DISABLE_MEM_POOLS */
       data->instance.instance_init = info->instance_init;
-      data->instance.mem_chunk = NULL;
     }
   else if (node->is_classed) /* only classed */
     {
@@ -1290,20 +1291,7 @@ g_type_create_instance (GType type)
   
   class = g_type_class_ref (type);
   
-  if (node->data->instance.n_preallocs)
-    {
-      G_WRITE_LOCK (&type_rw_lock);
-      if (!node->data->instance.mem_chunk)
-	node->data->instance.mem_chunk = g_mem_chunk_new (NODE_NAME (node),
-							  node->data->instance.instance_size,
-							  (node->data->instance.instance_size *
-							   node->data->instance.n_preallocs),
-							  G_ALLOC_AND_FREE);
-      instance = g_chunk_new0 (GTypeInstance, node->data->instance.mem_chunk);
-      G_WRITE_UNLOCK (&type_rw_lock);
-    }
-  else
-    instance = g_malloc0 (node->data->instance.instance_size);	/* fine without read lock */
+  instance = g_slice_alloc0 (node->data->instance.instance_size);	/* fine without read lock */
   for (i = node->n_supers; i > 0; i--)
     {
       TypeNode *pnode;
@@ -1347,14 +1335,7 @@ g_type_free_instance (GTypeInstance *instance)
 #ifdef G_ENABLE_DEBUG  
   memset (instance, 0xaa, node->data->instance.instance_size);	/* debugging hack */
 #endif  
-  if (node->data->instance.n_preallocs)
-    {
-      G_WRITE_LOCK (&type_rw_lock);
-      g_chunk_free (instance, node->data->instance.mem_chunk);
-      G_WRITE_UNLOCK (&type_rw_lock);
-    }
-  else
-    g_free (instance);
+  g_slice_free1 (node->data->instance.instance_size, instance);
   
   g_type_class_unref (class);
 }
@@ -1618,12 +1599,6 @@ type_data_last_unref_Wm (GType    type,
       
       node->data->common.ref_count = 0;
       
-      if (node->is_instantiatable && node->data->instance.mem_chunk)
-	{
-	  g_mem_chunk_destroy (node->data->instance.mem_chunk);
-	  node->data->instance.mem_chunk = NULL;
-	}
-      
       tdata = node->data;
       if (node->is_classed && tdata->class.class)
 	{
@@ -2152,6 +2127,31 @@ g_type_next_base (GType type,
   return atype;
 }
 
+static gboolean
+type_node_check_iface_conformities_UorL (TypeNode *node,
+					 TypeNode *iface_node,
+					 gboolean  support_interfaces,
+					 gboolean  support_prerequisites,
+					 gboolean  have_lock)
+{
+  GType iface_type = NODE_TYPE (iface_node);
+  gboolean match = FALSE;
+
+  if (!have_lock)
+    G_READ_LOCK (&type_rw_lock);
+  if (support_interfaces && type_lookup_iface_entry_L (node, iface_node))
+    match = TRUE;
+  else if (support_prerequisites && type_lookup_prerequisite_L (node, iface_type))
+    match = TRUE;
+  if (!have_lock)
+    G_READ_UNLOCK (&type_rw_lock);
+
+  if (match)
+    IFACE_CACHE_SLOT (node, iface_type) = iface_type;
+
+  return match;
+}
+
 static inline gboolean
 type_node_check_conformities_UorL (TypeNode *node,
 				   TypeNode *iface_node,
@@ -2160,8 +2160,6 @@ type_node_check_conformities_UorL (TypeNode *node,
 				   gboolean  support_prerequisites,
 				   gboolean  have_lock)
 {
-  gboolean match;
-  
   if (/* support_inheritance && */
       iface_node->n_supers <= node->n_supers &&
       node->supers[node->n_supers - iface_node->n_supers] == NODE_TYPE (iface_node))
@@ -2169,19 +2167,20 @@ type_node_check_conformities_UorL (TypeNode *node,
   
   support_interfaces = support_interfaces && node->is_instantiatable && NODE_IS_IFACE (iface_node);
   support_prerequisites = support_prerequisites && NODE_IS_IFACE (node);
-  match = FALSE;
-  if (support_interfaces || support_prerequisites)
-    {
-      if (!have_lock)
-	G_READ_LOCK (&type_rw_lock);
-      if (support_interfaces && type_lookup_iface_entry_L (node, iface_node))
-	match = TRUE;
-      else if (support_prerequisites && type_lookup_prerequisite_L (node, NODE_TYPE (iface_node)))
-	match = TRUE;
-      if (!have_lock)
-	G_READ_UNLOCK (&type_rw_lock);
-    }
-  return match;
+  if (!support_interfaces && !support_prerequisites)
+    return FALSE;
+
+  /* interfaces and prerequisites are never taken away from a type,
+   * so a positive answer stays valid forever and is cached in the node
+   * for lookups without the lock. a slot holds a single GType, readers
+   * see either the old or the new entry, and both are correct matches.
+   * a node is either instantiatable or an interface, so the two kinds
+   * of conformity can't get mixed up in the same cache.
+   */
+  if (IFACE_CACHE_SLOT (node, NODE_TYPE (iface_node)) == NODE_TYPE (iface_node))
+    return TRUE;
+
+  return type_node_check_iface_conformities_UorL (node, iface_node, support_interfaces, support_prerequisites, have_lock);
 }
 
 static gboolean
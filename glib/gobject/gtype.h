@@ -408,10 +408,26 @@ G_CONST_RETURN gchar* g_type_name_from_class	(GTypeClass	*g_class);
 
 /* --- implementation bits --- */
 #ifndef G_DISABLE_CAST_CHECKS
+#  ifdef __GNUC__
+/* casts to the exact type of an instance or class are checked inline */
+#  define _G_TYPE_CIC(ip, gt, ct)       (G_GNUC_EXTENSION ({ \
+  GTypeInstance *__inst = (GTypeInstance*) ip; GType __t = gt; \
+  if (!__inst || !__inst->g_class || __inst->g_class->g_type != __t) \
+    __inst = g_type_check_instance_cast (__inst, __t); \
+  (ct*) __inst; \
+}))
+#  define _G_TYPE_CCC(cp, gt, ct)       (G_GNUC_EXTENSION ({ \
+  GTypeClass *__class = (GTypeClass*) cp; GType __t = gt; \
+  if (!__class || __class->g_type != __t) \
+    __class = g_type_check_class_cast (__class, __t); \
+  (ct*) __class; \
+}))
+#  else  /* !__GNUC__ */
 #  define _G_TYPE_CIC(ip, gt, ct) \
     ((ct*) g_type_check_instance_cast ((GTypeInstance*) ip, gt))
 #  define _G_TYPE_CCC(cp, gt, ct) \
     ((ct*) g_type_check_class_cast ((GTypeClass*) cp, gt))
+#  endif /* !__GNUC__ */
 #else /* G_DISABLE_CAST_CHECKS */
 #  define _G_TYPE_CIC(ip, gt, ct)       ((ct*) ip)
 #  define _G_TYPE_CCC(cp, gt, ct)       ((ct*) cp)
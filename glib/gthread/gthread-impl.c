@@ -64,6 +64,7 @@ static gint g_thread_priority_map [G_THREAD_PRIORITY_URGENT + 1];
 
 void g_mutex_init (void);
 void g_mem_init (void);
+void g_slice_init (void);
 void g_messages_init (void);
 void g_convert_init (void);
 void g_rand_init (void);
@@ -381,6 +382,7 @@ g_thread_init (GThreadFunctions* init)
    */
   g_mutex_init ();
   g_mem_init ();
+  g_slice_init ();
   g_messages_init ();
   g_convert_init ();
   g_rand_init ();
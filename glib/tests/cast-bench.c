@@ -0,0 +1,154 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures checked casts on an instance of a type that is 12 levels
+ * deep, as deep as the GTK+ widget hierarchy gets, and implements
+ * 5 interfaces added at different levels: casts to the exact type, to
+ * ancestors, to one interface over and over, to all 5 interfaces in
+ * turn, and g_type_is_a() with an interface the type doesn't
+ * implement. Threads are initialized, so that the type lock is a real
+ * lock.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+
+#include <glib-object.h>
+
+#define N_CASTS     10000000
+#define N_LEVELS    12
+#define N_IFACES    5
+
+static GType level_types[N_LEVELS];
+static GType iface_types[N_IFACES + 1];
+
+static void
+iface_init (gpointer g_iface,
+	    gpointer iface_data)
+{
+}
+
+static void
+register_types (void)
+{
+  static const GInterfaceInfo iface_info = { iface_init, NULL, NULL };
+  GTypeInfo info = { 0, };
+  guint i;
+
+  for (i = 0; i < N_IFACES + 1; i++)
+    {
+      gchar *name = g_strdup_printf ("BenchIface%u", i);
+
+      info.class_size = sizeof (GTypeInterface);
+      iface_types[i] = g_type_register_static (G_TYPE_INTERFACE, name,
+					       &info, 0);
+      g_free (name);
+    }
+
+  level_types[0] = G_TYPE_OBJECT;
+  for (i = 1; i < N_LEVELS; i++)
+    {
+      gchar *name = g_strdup_printf ("BenchLevel%u", i);
+
+      info.class_size = sizeof (GObjectClass);
+      info.instance_size = sizeof (GObject);
+      level_types[i] = g_type_register_static (level_types[i - 1], name,
+					       &info, 0);
+      g_free (name);
+
+      /* interfaces on every other level from 2 to 10, the last
+       * interface type is not implemented
+       */
+      if (i % 2 == 0)
+	g_type_add_interface_static (level_types[i], iface_types[i / 2 - 1],
+				     &iface_info);
+    }
+}
+
+static void
+report (const gchar *what,
+	GTimer      *timer,
+	gpointer     result,
+	gpointer     expected)
+{
+  printf ("%-32s %6.1f ns\n", what,
+	  g_timer_elapsed (timer, NULL) / N_CASTS * 1e9);
+  if (result != expected)
+    g_error ("%s: wrong result %p", what, result);
+  g_timer_start (timer);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GObject *object;
+  GTimer *timer;
+  gpointer volatile result;
+  guint i;
+
+  g_thread_init (NULL);
+  g_type_init ();
+
+  register_types ();
+  object = g_object_new (level_types[N_LEVELS - 1], NULL);
+  for (i = 0; i < N_IFACES; i++)
+    if (!G_TYPE_CHECK_INSTANCE_TYPE (object, iface_types[i]))
+      g_error ("object doesn't implement BenchIface%u", i);
+  if (G_TYPE_CHECK_INSTANCE_TYPE (object, iface_types[N_IFACES]))
+    g_error ("object implements BenchIface%u", N_IFACES);
+
+  printf ("ns per cast\n");
+  timer = g_timer_new ();
+
+  for (i = 0; i < N_CASTS; i++)
+    result = G_TYPE_CHECK_INSTANCE_CAST (object, level_types[N_LEVELS - 1],
+					 GObject);
+  report ("exact type", timer, result, object);
+
+  for (i = 0; i < N_CASTS; i++)
+    result = G_TYPE_CHECK_INSTANCE_CAST (object, level_types[N_LEVELS / 2],
+					 GObject);
+  report ("ancestor halfway up", timer, result, object);
+
+  for (i = 0; i < N_CASTS; i++)
+    result = G_TYPE_CHECK_INSTANCE_CAST (object, G_TYPE_OBJECT, GObject);
+  report ("GObject", timer, result, object);
+
+  for (i = 0; i < N_CASTS; i++)
+    result = G_TYPE_CHECK_INSTANCE_CAST (object, iface_types[0], GObject);
+  report ("one interface", timer, result, object);
+
+  for (i = 0; i < N_CASTS; i++)
+    result = G_TYPE_CHECK_INSTANCE_CAST (object, iface_types[i % N_IFACES],
+					 GObject);
+  report ("5 interfaces in turn", timer, result, object);
+
+  for (i = 0; i < N_CASTS; i++)
+    result = GINT_TO_POINTER (g_type_is_a (level_types[N_LEVELS - 1],
+					   iface_types[N_IFACES]));
+  report ("g_type_is_a, not implemented", timer, result, NULL);
+
+  g_timer_destroy (timer);
+  g_object_unref (object);
+
+  return 0;
+}
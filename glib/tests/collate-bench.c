@@ -0,0 +1,210 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Sorts a list of 50000 nicknames the way a chat client sorts its
+ * user list: case-insensitively and in the order of the current
+ * locale. Most nicknames are ASCII, some have accented letters or
+ * are in Cyrillic, Greek or Japanese.
+ *
+ * The list is sorted three ways:
+ *
+ *  - comparing with g_utf8_casefold() and g_utf8_collate_key() on
+ *    every comparison;
+ *  - the same, with the collate key cache of
+ *    g_utf8_collate_key_set_cache_size() large enough for all nicks;
+ *  - computing one key per nick up front with
+ *    g_utf8_casefold_to_buffer() and g_utf8_collate_key(), and
+ *    comparing the keys with strcmp().
+ *
+ * Run it in a UTF-8 locale, the collation of the C locale is trivial.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#define N_NICKS      50000
+#define NICK_BUFFER  64
+
+typedef struct
+{
+  const gchar *nick;
+  gchar *key;
+} Nick;
+
+static const gchar *nick_parts[] = {
+  "alex", "Bob", "chris", "DAVE", "eve", "Frank", "gnome", "Hacker", "irc",
+  "Jo", "kde", "Linus", "mike", "nina", "OPER", "paul", "quux", "Rob", "sam",
+  "_", "-", "|", "^", "[away]", "0", "42", "99"
+};
+
+static const gchar *non_ascii_parts[] = {
+  "J\xc3\xb6rg", "Ren\xc3\xa9", "\xc3\x89lodie", "Bj\xc3\xb8rn",
+  "\xd0\x9c\xd0\xb8\xd1\x88\xd0\xb0",
+  "\xce\x9d\xce\xaf\xce\xba\xce\xbf\xcf\x82",
+  "\xe3\x81\x95\xe3\x81\x8f\xe3\x82\x89", "Stra\xc3\x9f" "e"
+};
+
+static gint
+compare_nicks (gconstpointer a,
+	       gconstpointer b,
+	       gpointer      data)
+{
+  const Nick *nick_a = a;
+  const Nick *nick_b = b;
+  gchar *folded_a = g_utf8_casefold (nick_a->nick, -1);
+  gchar *folded_b = g_utf8_casefold (nick_b->nick, -1);
+  gchar *key_a = g_utf8_collate_key (folded_a, -1);
+  gchar *key_b = g_utf8_collate_key (folded_b, -1);
+  gint result = strcmp (key_a, key_b);
+
+  g_free (key_a);
+  g_free (key_b);
+  g_free (folded_a);
+  g_free (folded_b);
+
+  return result;
+}
+
+static gint
+compare_keys (gconstpointer a,
+	      gconstpointer b,
+	      gpointer      data)
+{
+  const Nick *nick_a = a;
+  const Nick *nick_b = b;
+
+  return strcmp (nick_a->key, nick_b->key);
+}
+
+static void
+make_keys (Nick *nicks)
+{
+  gchar buffer[NICK_BUFFER];
+  gint i;
+
+  for (i = 0; i < N_NICKS; i++)
+    {
+      gsize length = g_utf8_casefold_to_buffer (nicks[i].nick, -1,
+						buffer, sizeof (buffer));
+
+      if (length < sizeof (buffer))
+	nicks[i].key = g_utf8_collate_key (buffer, length);
+      else
+	{
+	  gchar *folded = g_utf8_casefold (nicks[i].nick, -1);
+
+	  nicks[i].key = g_utf8_collate_key (folded, -1);
+	  g_free (folded);
+	}
+    }
+}
+
+static void
+check_sorted (const Nick *nicks)
+{
+  gint i;
+
+  for (i = 1; i < N_NICKS; i++)
+    if (compare_nicks (&nicks[i - 1], &nicks[i], NULL) > 0)
+      g_error ("%s sorted before %s", nicks[i - 1].nick, nicks[i].nick);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  GTimer *timer = g_timer_new ();
+  Nick *original = g_new0 (Nick, N_NICKS);
+  Nick *nicks = g_new0 (Nick, N_NICKS);
+  gdouble t;
+  gint i, n_ascii = 0;
+
+  setlocale (LC_ALL, "");
+
+  for (i = 0; i < N_NICKS; i++)
+    {
+      GString *nick = g_string_new (NULL);
+      gint n_parts = g_rand_int_range (rand, 1, 4);
+
+      while (n_parts--)
+	{
+	  const gchar **parts = nick_parts;
+	  gint n = G_N_ELEMENTS (nick_parts);
+
+	  if (g_rand_int_range (rand, 0, 20) == 0)
+	    {
+	      parts = non_ascii_parts;
+	      n = G_N_ELEMENTS (non_ascii_parts);
+	    }
+	  g_string_append (nick, parts[g_rand_int_range (rand, 0, n)]);
+	}
+      g_string_append_printf (nick, "%d", i);
+
+      original[i].nick = g_string_free (nick, FALSE);
+      if (g_utf8_strlen (original[i].nick, -1) == strlen (original[i].nick))
+	n_ascii++;
+    }
+
+  printf ("%d nicks, %d of them ASCII, LC_COLLATE is %s\n",
+	  N_NICKS, n_ascii, setlocale (LC_COLLATE, NULL));
+
+  memcpy (nicks, original, sizeof (Nick) * N_NICKS);
+  g_timer_start (timer);
+  g_qsort_with_data (nicks, N_NICKS, sizeof (Nick), compare_nicks, NULL);
+  t = g_timer_elapsed (timer, NULL);
+  printf ("casefold and collate key per comparison:  %8.1f ms\n", t * 1e3);
+  check_sorted (nicks);
+
+  g_utf8_collate_key_set_cache_size (2 * N_NICKS);
+  memcpy (nicks, original, sizeof (Nick) * N_NICKS);
+  g_timer_start (timer);
+  g_qsort_with_data (nicks, N_NICKS, sizeof (Nick), compare_nicks, NULL);
+  t = g_timer_elapsed (timer, NULL);
+  printf ("the same with the collate key cache:      %8.1f ms\n", t * 1e3);
+  check_sorted (nicks);
+  g_utf8_collate_key_set_cache_size (0);
+
+  memcpy (nicks, original, sizeof (Nick) * N_NICKS);
+  g_timer_start (timer);
+  make_keys (nicks);
+  g_qsort_with_data (nicks, N_NICKS, sizeof (Nick), compare_keys, NULL);
+  t = g_timer_elapsed (timer, NULL);
+  printf ("one key per nick, then strcmp():          %8.1f ms\n", t * 1e3);
+  check_sorted (nicks);
+
+  for (i = 0; i < N_NICKS; i++)
+    {
+      g_free (nicks[i].key);
+      g_free ((gchar *) original[i].nick);
+    }
+  g_free (nicks);
+  g_free (original);
+  g_timer_destroy (timer);
+  g_rand_free (rand);
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Converts a mix of chat-sized messages to UTF-8 and back, the way an
+ * IRC client or mail reader decodes per-connection traffic. The
+ * messages are plain ASCII, Latin-1, CP1252, UTF-8 and KOI8-R (which
+ * still goes through iconv). Each message is converted once with
+ * g_convert(), and once through a GIConv kept open per charset,
+ * feeding the input in 64-byte chunks into a fixed output buffer.
+ * Both ways are checked to round-trip every message.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <glib.h>
+
+#define N_MESSAGES 200000
+#define N_ROUNDS 5
+#define CHUNK_SIZE 64
+
+typedef struct
+{
+  const gchar *charset;
+  const gchar *text;
+} Sample;
+
+static const Sample samples[] = {
+  { "ISO-8859-1", "PRIVMSG #chan :just plain ascii text, nothing to see" },
+  { "UTF-8", "PRIVMSG #chan :another plain line, 42 bytes or so of it" },
+  { "ISO-8859-1",
+    "PRIVMSG #chan :caf\xe9 na\xefve r\xe9sum\xe9 \xfc" "ber Stra\xdf" "e" },
+  { "CP1252", "PRIVMSG #chan :\x93quoted\x94 \x80" "5 \x96 it\x92s fine\x85" },
+  { "UTF-8", "PRIVMSG #chan :caf\xc3\xa9 \xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e "
+    "\xe3\x81\xa7\xe3\x81\x99 \xe2\x82\xac" },
+  { "KOI8-R", "PRIVMSG #chan :\xf0\xd2\xc9\xd7\xc5\xd4, \xcd\xc9\xd2!" },
+  { "CP1252", "PRIVMSG #chan :plain ascii from a windows client" },
+  { "UTF-8",
+    "PRIVMSG #chan :\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82" },
+};
+
+static gsize
+convert_chunked (GIConv       converter,
+		 const gchar *text,
+		 gsize        length,
+		 gchar       *outbuf,
+		 gsize        outbuf_size)
+{
+  gchar *inp = (gchar *) text;
+  gchar *outp = outbuf;
+  gsize outbytes_left = outbuf_size;
+  gsize inbytes_left = 0;
+  gsize remaining = length;
+
+  while (remaining > 0 || inbytes_left > 0)
+    {
+      gsize chunk = MIN (remaining, CHUNK_SIZE);
+
+      inbytes_left += chunk;
+      remaining -= chunk;
+      if (g_iconv (converter, &inp, &inbytes_left,
+		   &outp, &outbytes_left) == (gsize) -1)
+	{
+	  /* a character split across chunks waits for the next one */
+	  if (errno != EINVAL || remaining == 0)
+	    g_error ("g_iconv() failed: %s", g_strerror (errno));
+	}
+    }
+
+  return outp - outbuf;
+}
+
+static void
+run_convert (const guint *messages)
+{
+  GTimer *timer = g_timer_new ();
+  guint round, i;
+
+  for (round = 0; round < N_ROUNDS; round++)
+    for (i = 0; i < N_MESSAGES; i++)
+      {
+	const Sample *msg = &samples[messages[i]];
+	gsize length = strlen (msg->text);
+	gsize utf8_len, back_len;
+	gchar *utf8, *back;
+
+	utf8 = g_convert (msg->text, length, "UTF-8", msg->charset,
+			  NULL, &utf8_len, NULL);
+	back = g_convert (utf8, utf8_len, msg->charset, "UTF-8",
+			  NULL, &back_len, NULL);
+	if (!back || back_len != length || memcmp (back, msg->text, length))
+	  g_error ("g_convert() did not round-trip \"%s\"", msg->text);
+	g_free (utf8);
+	g_free (back);
+      }
+
+  printf ("g_convert()             %6.2f Mmsgs/s\n",
+	  N_ROUNDS * N_MESSAGES / g_timer_elapsed (timer, NULL) / 1e6);
+  g_timer_destroy (timer);
+}
+
+static void
+run_streaming (const guint *messages)
+{
+  GIConv decoders[G_N_ELEMENTS (samples)];
+  GIConv encoders[G_N_ELEMENTS (samples)];
+  GTimer *timer = g_timer_new ();
+  gchar utf8[4096];
+  gchar back[4096];
+  guint round, i;
+
+  for (i = 0; i < G_N_ELEMENTS (samples); i++)
+    {
+      decoders[i] = g_iconv_open ("UTF-8", samples[i].charset);
+      encoders[i] = g_iconv_open (samples[i].charset, "UTF-8");
+    }
+
+  g_timer_start (timer);
+  for (round = 0; round < N_ROUNDS; round++)
+    for (i = 0; i < N_MESSAGES; i++)
+      {
+	guint conn = messages[i];
+	const Sample *msg = &samples[conn];
+	gsize length = strlen (msg->text);
+	gsize utf8_len, back_len;
+
+	utf8_len = convert_chunked (decoders[conn], msg->text, length,
+				    utf8, sizeof (utf8));
+	back_len = convert_chunked (encoders[conn], utf8, utf8_len,
+				    back, sizeof (back));
+	if (back_len != length || memcmp (back, msg->text, length))
+	  g_error ("GIConv did not round-trip \"%s\"", msg->text);
+      }
+
+  printf ("GIConv per connection   %6.2f Mmsgs/s\n",
+	  N_ROUNDS * N_MESSAGES / g_timer_elapsed (timer, NULL) / 1e6);
+
+  for (i = 0; i < G_N_ELEMENTS (samples); i++)
+    {
+      g_iconv_close (decoders[i]);
+      g_iconv_close (encoders[i]);
+    }
+  g_timer_destroy (timer);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  guint *messages = g_new (guint, N_MESSAGES);
+  GRand *rand = g_rand_new_with_seed (42);
+  guint i;
+
+  for (i = 0; i < N_MESSAGES; i++)
+    messages[i] = g_rand_int_range (rand, 0, G_N_ELEMENTS (samples));
+
+  run_convert (messages);
+  run_streaming (messages);
+
+  g_rand_free (rand);
+  g_free (messages);
+
+  return 0;
+}
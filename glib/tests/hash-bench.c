@@ -0,0 +1,275 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Times g_hash_table_insert(), lookups that hit and miss, and
+ * g_hash_table_remove() for key sets shaped like the ones GTK+ uses:
+ * canonical property and signal names, rc style paths, sequential
+ * integers and pointers. Also checks that the destroy notifiers run
+ * by g_hash_table_foreach_remove() no longer find the removed key.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+typedef struct
+{
+  const gchar *name;
+  GHashFunc    hash_func;
+  GEqualFunc   equal_func;
+  gpointer    *keys;
+  gpointer    *misses;
+  gpointer    *shuffled;	/* keys in a different order */
+} KeySet;
+
+static const gchar *prefixes[] = {
+  "gtk", "gnome", "bonobo", "pango", "atk", "gdk", "egg", "nautilus"
+};
+static const gchar *widgets[] = {
+  "button", "label", "tree-view", "entry", "window", "menu-item",
+  "scrolled-window", "combo", "check-button", "notebook", "toolbar"
+};
+static const gchar *props[] = {
+  "label", "visible", "sensitive", "has-focus", "can-default",
+  "width-request", "xalign", "yalign", "use-underline", "relief",
+  "focus-padding", "interior-focus", "shadow-type", "icon-name"
+};
+
+static gpointer *
+make_string_keys (GRand   *rand,
+		  guint    n_keys,
+		  gboolean paths)
+{
+  gpointer *keys = g_new (gpointer, n_keys);
+  guint i;
+
+  for (i = 0; i < n_keys; i++)
+    {
+      const gchar *prefix = prefixes[g_rand_int_range (rand, 0, G_N_ELEMENTS (prefixes))];
+      const gchar *widget = widgets[g_rand_int_range (rand, 0, G_N_ELEMENTS (widgets))];
+      const gchar *prop = props[g_rand_int_range (rand, 0, G_N_ELEMENTS (props))];
+
+      if (paths)
+	keys[i] = g_strdup_printf ("%s-window.GtkVBox.%s-%s%u.%s", prefix, prefix, widget, i, prop);
+      else
+	keys[i] = g_strdup_printf ("%s-%s-%s-%u", prefix, widget, prop, i);
+    }
+
+  return keys;
+}
+
+static gpointer *
+make_int_keys (guint n_keys,
+	       guint first,
+	       guint step)
+{
+  gpointer *keys = g_new (gpointer, n_keys);
+  guint i;
+
+  for (i = 0; i < n_keys; i++)
+    keys[i] = GUINT_TO_POINTER (first + i * step);
+
+  return keys;
+}
+
+static void
+shuffle (GRand    *rand,
+	 gpointer *keys,
+	 guint     n_keys)
+{
+  guint i;
+
+  for (i = n_keys - 1; i > 0; i--)
+    {
+      guint j = g_rand_int_range (rand, 0, i + 1);
+      gpointer tmp = keys[i];
+
+      keys[i] = keys[j];
+      keys[j] = tmp;
+    }
+}
+
+static void
+bench (KeySet *set,
+       guint   n_keys)
+{
+  GHashTable *table = g_hash_table_new (set->hash_func, set->equal_func);
+  GTimer *timer = g_timer_new ();
+  gdouble insert, hit, miss, remove;
+  guint i, round, found = 0;
+
+  g_timer_start (timer);
+  for (i = 0; i < n_keys; i++)
+    g_hash_table_insert (table, set->keys[i], set->keys[i]);
+  insert = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (round = 0; round < 4; round++)
+    for (i = 0; i < n_keys; i++)
+      found += g_hash_table_lookup (table, set->shuffled[i]) != NULL;
+  hit = g_timer_elapsed (timer, NULL) / 4;
+
+  g_timer_start (timer);
+  for (round = 0; round < 4; round++)
+    for (i = 0; i < n_keys; i++)
+      found += g_hash_table_lookup (table, set->misses[i]) != NULL;
+  miss = g_timer_elapsed (timer, NULL) / 4;
+
+  g_timer_start (timer);
+  for (i = 0; i < n_keys; i++)
+    g_hash_table_remove (table, set->shuffled[i]);
+  remove = g_timer_elapsed (timer, NULL);
+
+  g_assert (found == 4 * n_keys);
+  g_assert (g_hash_table_size (table) == 0);
+
+  printf ("%-12s %8u  %9.1f  %7.1f  %7.1f  %9.1f\n", set->name, n_keys,
+	  insert * 1e9 / n_keys, hit * 1e9 / n_keys,
+	  miss * 1e9 / n_keys, remove * 1e9 / n_keys);
+
+  g_timer_destroy (timer);
+  g_hash_table_destroy (table);
+}
+
+static GHashTable *notify_table;
+static guint notify_errors;
+
+static void
+notify_value (gpointer value)
+{
+  if (notify_table == NULL)
+    return;
+
+  if (g_hash_table_lookup (notify_table, value) != NULL)
+    notify_errors++;
+  if (g_hash_table_remove (notify_table, value))
+    notify_errors++;
+}
+
+static gboolean
+is_even (gpointer key,
+	 gpointer value,
+	 gpointer user_data)
+{
+  return GPOINTER_TO_UINT (key) % 2 == 0;
+}
+
+static void
+check_foreach_remove (void)
+{
+  GHashTable *table;
+  guint i;
+
+  notify_table = g_hash_table_new_full (NULL, NULL, NULL, notify_value);
+  for (i = 1; i <= 1000; i++)
+    g_hash_table_insert (notify_table, GUINT_TO_POINTER (i), GUINT_TO_POINTER (i));
+
+  g_assert (g_hash_table_foreach_remove (notify_table, is_even, NULL) == 500);
+  g_assert (notify_errors == 0);
+  g_assert (g_hash_table_size (notify_table) == 500);
+  for (i = 1; i <= 1000; i++)
+    g_assert ((g_hash_table_lookup (notify_table, GUINT_TO_POINTER (i)) != NULL) == i % 2);
+
+  table = notify_table;
+  notify_table = NULL;
+  g_hash_table_destroy (table);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  static const guint sizes[] = { 100, 10000, 1000000 };
+  GRand *rand = g_rand_new_with_seed (42);
+  guint s, k;
+
+  check_foreach_remove ();
+
+  printf ("keys            count  insert/ns   hit/ns  miss/ns  remove/ns\n");
+  for (s = 0; s < G_N_ELEMENTS (sizes); s++)
+    {
+      guint n = sizes[s];
+      gpointer *pointers = g_new (gpointer, 2 * n);
+      KeySet sets[4];
+
+      for (k = 0; k < 2 * n; k++)
+	pointers[k] = g_malloc (24);
+
+      sets[0].name = "names";
+      sets[0].hash_func = g_str_hash;
+      sets[0].equal_func = g_str_equal;
+      sets[0].keys = make_string_keys (rand, n, FALSE);
+      sets[0].misses = make_string_keys (rand, n, FALSE);
+      for (k = 0; k < n; k++)
+	((gchar *) sets[0].misses[k])[0] = 'X';
+
+      sets[1].name = "rc paths";
+      sets[1].hash_func = g_str_hash;
+      sets[1].equal_func = g_str_equal;
+      sets[1].keys = make_string_keys (rand, n, TRUE);
+      sets[1].misses = make_string_keys (rand, n, TRUE);
+      for (k = 0; k < n; k++)
+	((gchar *) sets[1].misses[k])[0] = 'X';
+
+      sets[2].name = "sequential";
+      sets[2].hash_func = g_direct_hash;
+      sets[2].equal_func = g_direct_equal;
+      sets[2].keys = make_int_keys (n, 1, 1);
+      sets[2].misses = make_int_keys (n, n + 1, 1);
+      shuffle (rand, sets[2].keys, n);
+
+      sets[3].name = "pointers";
+      sets[3].hash_func = g_direct_hash;
+      sets[3].equal_func = g_direct_equal;
+      sets[3].keys = g_memdup (pointers, n * sizeof (gpointer));
+      sets[3].misses = g_memdup (pointers + n, n * sizeof (gpointer));
+
+      for (k = 0; k < G_N_ELEMENTS (sets); k++)
+	{
+	  sets[k].shuffled = g_memdup (sets[k].keys, n * sizeof (gpointer));
+	  shuffle (rand, sets[k].shuffled, n);
+	  bench (&sets[k], n);
+	}
+
+      for (k = 0; k < n; k++)
+	{
+	  g_free (sets[0].keys[k]);
+	  g_free (sets[0].misses[k]);
+	  g_free (sets[1].keys[k]);
+	  g_free (sets[1].misses[k]);
+	}
+      for (k = 0; k < G_N_ELEMENTS (sets); k++)
+	{
+	  g_free (sets[k].keys);
+	  g_free (sets[k].misses);
+	  g_free (sets[k].shuffled);
+	}
+      for (k = 0; k < 2 * n; k++)
+	g_free (pointers[k]);
+      g_free (pointers);
+    }
+
+  g_rand_free (rand);
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures lines per second through a GIOChannel on a socketpair. A
+ * writer thread sends 1000000 IRC-style lines terminated by "\r\n",
+ * one g_io_channel_write_chars() per line, and the main thread reads
+ * them with g_io_channel_read_line(), g_io_channel_read_line_string()
+ * and g_io_channel_peek_line()/g_io_channel_consume(), on a binary
+ * channel with the terminator autodetected, with the terminator set
+ * explicitly, and on a UTF-8 channel. The time includes the writer,
+ * which does the same work in every run.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#define N_LINES 1000000
+
+typedef enum
+{
+  READ_LINE,
+  READ_LINE_STRING,
+  PEEK_LINE
+} ReadMode;
+
+static gpointer
+writer_thread (gpointer data)
+{
+  GIOChannel *channel = g_io_channel_unix_new (GPOINTER_TO_INT (data));
+  gchar line[256];
+  guint i;
+
+  g_io_channel_set_encoding (channel, NULL, NULL);
+  g_io_channel_set_close_on_unref (channel, TRUE);
+
+  for (i = 0; i < N_LINES; i++)
+    {
+      gint length = g_snprintf (line, sizeof (line),
+				":nick%u!user@host.example.org PRIVMSG #channel "
+				":message number %u\r\n", i % 100, i);
+
+      if (g_io_channel_write_chars (channel, line, length,
+				    NULL, NULL) != G_IO_STATUS_NORMAL)
+	g_error ("write failed");
+    }
+  g_io_channel_flush (channel, NULL);
+  g_io_channel_unref (channel);
+
+  return NULL;
+}
+
+static void
+run (const gchar *name,
+     ReadMode     mode,
+     const gchar *encoding,
+     const gchar *line_term)
+{
+  GIOChannel *channel;
+  GThread *writer;
+  GString *string = g_string_new (NULL);
+  GTimer *timer;
+  GIOStatus status;
+  gint fds[2];
+  guint n_lines = 0;
+  gsize total = 0;
+  gdouble elapsed;
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    g_error ("socketpair() failed");
+
+  channel = g_io_channel_unix_new (fds[0]);
+  g_io_channel_set_encoding (channel, encoding, NULL);
+  if (line_term)
+    g_io_channel_set_line_term (channel, line_term, -1);
+
+  timer = g_timer_new ();
+  writer = g_thread_create (writer_thread, GINT_TO_POINTER (fds[1]),
+			    TRUE, NULL);
+
+  do
+    {
+      gchar *line;
+      const gchar *peeked;
+      gsize length, terminator_pos;
+
+      switch (mode)
+	{
+	case READ_LINE:
+	  status = g_io_channel_read_line (channel, &line, &length,
+					   &terminator_pos, NULL);
+	  if (status == G_IO_STATUS_NORMAL)
+	    g_free (line);
+	  break;
+	case READ_LINE_STRING:
+	  status = g_io_channel_read_line_string (channel, string,
+						  &terminator_pos, NULL);
+	  length = string->len;
+	  break;
+	case PEEK_LINE:
+	  status = g_io_channel_peek_line (channel, &peeked, &length,
+					   &terminator_pos, NULL);
+	  if (status == G_IO_STATUS_NORMAL)
+	    g_io_channel_consume (channel, length);
+	  break;
+	default:
+	  g_assert_not_reached ();
+	}
+
+      if (status == G_IO_STATUS_NORMAL)
+	{
+	  if (terminator_pos != length - 2)
+	    g_error ("line %u has its terminator at %lu of %lu", n_lines,
+		     (gulong) terminator_pos, (gulong) length);
+	  n_lines++;
+	  total += length;
+	}
+    }
+  while (status == G_IO_STATUS_NORMAL);
+
+  g_thread_join (writer);
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  if (status != G_IO_STATUS_EOF || n_lines != N_LINES)
+    g_error ("%s: read %u lines, status %d", name, n_lines, status);
+
+  printf ("%-44s %6.2f  %6.1f\n", name,
+	  n_lines / elapsed / 1e6, total / elapsed / 1e6);
+
+  g_timer_destroy (timer);
+  g_string_free (string, TRUE);
+  g_io_channel_unref (channel);
+  close (fds[0]);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_thread_init (NULL);
+
+  printf ("%-44s %6s  %6s\n", "", "Mlines/s", "MB/s");
+  run ("read_line, autodetected terminator", READ_LINE, NULL, NULL);
+  run ("read_line, \"\\r\\n\" terminator", READ_LINE, NULL, "\r\n");
+  run ("read_line, UTF-8", READ_LINE, "UTF-8", NULL);
+  run ("read_line_string, autodetected terminator",
+       READ_LINE_STRING, NULL, NULL);
+  run ("peek_line/consume, autodetected terminator", PEEK_LINE, NULL, NULL);
+  run ("peek_line/consume, \"\\r\\n\" terminator", PEEK_LINE, NULL, "\r\n");
+  run ("peek_line/consume, UTF-8", PEEK_LINE, "UTF-8", NULL);
+
+  return 0;
+}
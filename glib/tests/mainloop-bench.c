@@ -0,0 +1,101 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures what one main loop iteration costs when a context holds
+ * many timeouts that are not due, like the per-connection timeouts
+ * of a server, and what it costs to find and destroy a source by id.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#define N_ITERATIONS 2000
+
+static gboolean
+never_called (gpointer data)
+{
+  g_assert_not_reached ();
+  return FALSE;
+}
+
+static gboolean
+count_iteration (gpointer data)
+{
+  (*(guint *) data)++;
+  return TRUE;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  static const guint counts[] = { 10, 100, 1000, 10000, 100000 };
+  guint c;
+
+  printf ("timeouts  us/iteration  us/remove\n");
+  for (c = 0; c < G_N_ELEMENTS (counts); c++)
+    {
+      GMainContext *context = g_main_context_new ();
+      GSource *source;
+      GTimer *timer = g_timer_new ();
+      guint *ids = g_new (guint, counts[c]);
+      guint i, n_iterations = 0;
+      gdouble iteration, remove;
+
+      /* timeouts between 1 and 2 hours from now */
+      for (i = 0; i < counts[c]; i++)
+	{
+	  source = g_timeout_source_new (3600 * 1000 + i % 3600 * 1000);
+	  g_source_set_callback (source, never_called, NULL, NULL);
+	  ids[i] = g_source_attach (source, context);
+	  g_source_unref (source);
+	}
+
+      /* one ready source keeps the loop from blocking */
+      source = g_idle_source_new ();
+      g_source_set_callback (source, count_iteration, &n_iterations, NULL);
+      g_source_attach (source, context);
+      g_source_unref (source);
+
+      g_timer_start (timer);
+      for (i = 0; i < N_ITERATIONS; i++)
+	g_main_context_iteration (context, FALSE);
+      iteration = g_timer_elapsed (timer, NULL);
+      g_assert (n_iterations == N_ITERATIONS);
+
+      /* remove in a different order than attached */
+      g_timer_start (timer);
+      for (i = 0; i < counts[c]; i++)
+	g_source_destroy (g_main_context_find_source_by_id (context, ids[(i * 7 + 3) % counts[c]]));
+      remove = g_timer_elapsed (timer, NULL);
+
+      printf ("%8u  %12.2f  %9.3f\n", counts[c],
+	      iteration * 1e6 / N_ITERATIONS, remove * 1e6 / counts[c]);
+
+      g_timer_destroy (timer);
+      g_free (ids);
+      g_main_context_unref (context);
+    }
+
+  return 0;
+}
@@ -0,0 +1,206 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures GMarkup parsing throughput on two kinds of input: a large
+ * gconf-style configuration document, fed whole and in 4096-byte
+ * chunks, and many short pango-style markup strings, each parsed by
+ * a fresh context the way pango_parse_markup() does. The callbacks
+ * look at every name, attribute value and piece of text, and the
+ * totals are checked against the generated input.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#define N_ENTRIES 40000
+#define N_CONFIG_ROUNDS 5
+#define N_SHORT_STRINGS 200000
+#define CHUNK_SIZE 4096
+
+typedef struct
+{
+  guint n_elements;
+  gsize n_bytes;
+} Totals;
+
+static void
+start_element (GMarkupParseContext *context,
+	       const gchar         *element_name,
+	       const gchar        **attribute_names,
+	       const gchar        **attribute_values,
+	       gpointer             user_data,
+	       GError             **error)
+{
+  Totals *totals = user_data;
+
+  totals->n_elements++;
+  totals->n_bytes += strlen (element_name);
+  for (; *attribute_names; attribute_names++, attribute_values++)
+    totals->n_bytes += strlen (*attribute_names) + strlen (*attribute_values);
+}
+
+static void
+text (GMarkupParseContext *context,
+      const gchar         *text,
+      gsize                text_len,
+      gpointer             user_data,
+      GError             **error)
+{
+  Totals *totals = user_data;
+
+  totals->n_bytes += text_len;
+}
+
+static GMarkupParser parser = {
+  start_element,
+  NULL,
+  text,
+  NULL,
+  NULL
+};
+
+static void
+parse (const gchar *document,
+       gsize        length,
+       gsize        chunk_size,
+       Totals      *totals)
+{
+  GMarkupParseContext *context;
+  GError *error = NULL;
+  gsize offset;
+
+  context = g_markup_parse_context_new (&parser, 0, totals, NULL);
+  for (offset = 0; offset < length; offset += chunk_size)
+    if (!g_markup_parse_context_parse (context, document + offset,
+				       MIN (chunk_size, length - offset),
+				       &error))
+      g_error ("%s", error->message);
+  if (!g_markup_parse_context_end_parse (context, &error))
+    g_error ("%s", error->message);
+  g_markup_parse_context_free (context);
+}
+
+static void
+run_config (const GString *document,
+	    const gchar   *name,
+	    gsize          chunk_size,
+	    Totals        *expected)
+{
+  GTimer *timer = g_timer_new ();
+  Totals totals;
+  guint i;
+
+  for (i = 0; i < N_CONFIG_ROUNDS; i++)
+    {
+      memset (&totals, 0, sizeof (totals));
+      parse (document->str, document->len, chunk_size, &totals);
+    }
+
+  printf ("%-32s %7.1f MB/s\n", name,
+	  N_CONFIG_ROUNDS * document->len / g_timer_elapsed (timer, NULL) / 1e6);
+
+  if (expected->n_elements == 0)
+    *expected = totals;
+  else if (totals.n_elements != expected->n_elements ||
+	   totals.n_bytes != expected->n_bytes)
+    g_error ("%s: saw %u elements and %lu bytes instead of %u and %lu",
+	     name, totals.n_elements, (gulong) totals.n_bytes,
+	     expected->n_elements, (gulong) expected->n_bytes);
+
+  if (totals.n_elements != 1 + 3 * N_ENTRIES)
+    g_error ("%s: saw %u elements", name, totals.n_elements);
+
+  g_timer_destroy (timer);
+}
+
+static void
+run_short_strings (void)
+{
+  static const gchar *strings[] = {
+    "<markup><span foreground=\"red\" weight=\"bold\">Hello</span>, "
+    "<i>world</i> &amp; friends</markup>",
+    "<markup>plain status text without tags</markup>",
+    "<markup><b>Bold</b> <span size=\"small\" font_family=\"Sans\">"
+    "small &lt;sans&gt;</span></markup>",
+    "<markup><span lang=\"ja\">\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e</span>"
+    "</markup>"
+  };
+  GTimer *timer = g_timer_new ();
+  Totals totals = { 0, 0 };
+  gsize length[G_N_ELEMENTS (strings)];
+  gsize total_length = 0;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (strings); i++)
+    length[i] = strlen (strings[i]);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_SHORT_STRINGS; i++)
+    {
+      guint n = i % G_N_ELEMENTS (strings);
+
+      parse (strings[n], length[n], length[n], &totals);
+      total_length += length[n];
+    }
+
+  printf ("%-32s %7.2f Mstrings/s (%.1f MB/s)\n", "short pango-style strings",
+	  N_SHORT_STRINGS / g_timer_elapsed (timer, NULL) / 1e6,
+	  total_length / g_timer_elapsed (timer, NULL) / 1e6);
+
+  /* 3 + 1 + 3 + 2 elements per 4 strings */
+  if (totals.n_elements != N_SHORT_STRINGS / 4 * 9)
+    g_error ("short strings: saw %u elements", totals.n_elements);
+
+  g_timer_destroy (timer);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GString *document = g_string_new ("<?xml version=\"1.0\"?>\n<config>\n");
+  Totals expected = { 0, 0 };
+  guint i;
+
+  for (i = 0; i < N_ENTRIES; i++)
+    g_string_append_printf (document,
+			    "  <entry key=\"/apps/panel/item_%u\" "
+			    "type=\"string\" mtime=\"1050000%u\">\n"
+			    "    <stringvalue>Some value &amp; text for item %u"
+			    "</stringvalue>\n"
+			    "    <description>A longer description of what "
+			    "this setting does, number %u.</description>\n"
+			    "  </entry>\n", i, i, i, i);
+  g_string_append (document, "</config>\n");
+
+  printf ("%.1f MB configuration document\n", document->len / 1e6);
+  run_config (document, "whole document", document->len, &expected);
+  run_config (document, "4096-byte chunks", CHUNK_SIZE, &expected);
+  run_config (document, "7-byte chunks", 7, &expected);
+  run_short_strings ();
+
+  g_string_free (document, TRUE);
+
+  return 0;
+}
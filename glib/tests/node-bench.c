@@ -0,0 +1,126 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Builds, walks and destroys a tree of 1000000 nodes, 1000 parents of
+ * 999 appended children each under one root, the shape of a large
+ * GtkTreeStore or channel list. The tree is built once from
+ * g_node_new() and once from a GNodeArena. The walks are pre-order,
+ * post-order and level-order traversals, g_node_n_nodes() and
+ * g_node_nth_child() on every child of 100 parents; node counts and
+ * the data found are checked.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#define N_PARENTS 1000
+#define N_CHILDREN 999
+#define N_NODES (1 + N_PARENTS * (1 + N_CHILDREN))
+#define N_NTH_PARENTS 100
+
+static gboolean
+count_node (GNode    *node,
+	    gpointer  data)
+{
+  guint *count = data;
+
+  (*count)++;
+
+  return FALSE;
+}
+
+static void
+run (const gchar *name,
+     gboolean     use_arena)
+{
+  static const GTraverseType orders[] = {
+    G_PRE_ORDER, G_POST_ORDER, G_LEVEL_ORDER
+  };
+  GNodeArena *arena = use_arena ? g_node_arena_new (0) : NULL;
+  GTimer *timer = g_timer_new ();
+  GNode *root, *parent;
+  gdouble build, walk, nth, destroy;
+  guint count, i, j;
+
+  root = use_arena ? g_node_arena_new_node (arena, NULL) : g_node_new (NULL);
+  for (i = 0; i < N_PARENTS; i++)
+    {
+      gpointer data = GUINT_TO_POINTER (i);
+
+      parent = use_arena ? g_node_arena_new_node (arena, data)
+			 : g_node_new (data);
+      g_node_append (root, parent);
+      for (j = 0; j < N_CHILDREN; j++)
+	{
+	  data = GUINT_TO_POINTER (j);
+	  g_node_append (parent, use_arena ? g_node_arena_new_node (arena, data)
+					   : g_node_new (data));
+	}
+    }
+  build = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < G_N_ELEMENTS (orders); i++)
+    {
+      count = 0;
+      g_node_traverse (root, orders[i], G_TRAVERSE_ALL, -1,
+		       count_node, &count);
+      if (count != N_NODES)
+	g_error ("%s: traversal %u visited %u nodes", name, i, count);
+    }
+  if (g_node_n_nodes (root, G_TRAVERSE_LEAFS) != N_PARENTS * N_CHILDREN)
+    g_error ("%s: wrong number of leaves", name);
+  walk = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (parent = root->children, i = 0; i < N_NTH_PARENTS;
+       parent = parent->next, i++)
+    for (j = 0; j < N_CHILDREN; j++)
+      if (GPOINTER_TO_UINT (g_node_nth_child (parent, j)->data) != j)
+	g_error ("%s: wrong nth child", name);
+  nth = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  if (use_arena)
+    g_node_arena_free (arena);
+  else
+    g_node_destroy (root);
+  destroy = g_timer_elapsed (timer, NULL);
+
+  printf ("%-10s %8.3f %8.3f %8.3f %8.3f\n",
+	  name, build, walk, nth, destroy);
+
+  g_timer_destroy (timer);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  printf ("%-10s %8s %8s %8s %8s\n", "seconds", "build", "walk",
+	  "nth", "destroy");
+  run ("g_node_new", FALSE);
+  run ("arena", TRUE);
+
+  return 0;
+}
@@ -0,0 +1,229 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Watches 10000 idle fds and one pipe that another thread writes a
+ * timestamp into, and reports how long the main loop takes to
+ * dispatch each write and how much CPU it spends per wakeup. The
+ * writer waits for each write to be dispatched and then sleeps for a
+ * millisecond, so wakeups don't pile up.
+ *
+ * The idle fds are watched once with one IO watch per fd, where
+ * every iteration still runs the prepare and check functions of all
+ * the watches, and once with a single source polling all of them.
+ * They are duplicates of the read end of a pipe that nobody writes
+ * to, so they don't need 10000 pipes.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#define N_WAKEUPS 1000
+
+typedef struct
+{
+  GSource source;
+  GPollFD *fds;
+  gint n_fds;
+} IdleSource;
+
+static GMainLoop *loop;
+static GAsyncQueue *acks;
+static gint active_pipe[2];
+static guint n_wakeups;
+static gdouble total_latency, max_latency;
+
+static gboolean
+idle_fd_ready (GIOChannel   *channel,
+	       GIOCondition  condition,
+	       gpointer      data)
+{
+  g_error ("idle fd reported ready");
+  return FALSE;
+}
+
+static gboolean
+idle_source_prepare (GSource *source,
+		     gint    *timeout)
+{
+  *timeout = -1;
+  return FALSE;
+}
+
+static gboolean
+idle_source_check (GSource *source)
+{
+  IdleSource *idle_source = (IdleSource *) source;
+  gint i;
+
+  for (i = 0; i < idle_source->n_fds; i++)
+    if (idle_source->fds[i].revents)
+      return TRUE;
+
+  return FALSE;
+}
+
+static gboolean
+idle_source_dispatch (GSource     *source,
+		      GSourceFunc  callback,
+		      gpointer     user_data)
+{
+  g_error ("idle fd reported ready");
+  return FALSE;
+}
+
+static GSourceFuncs idle_source_funcs = {
+  idle_source_prepare,
+  idle_source_check,
+  idle_source_dispatch,
+  NULL
+};
+
+static gboolean
+active_fd_ready (GIOChannel   *channel,
+		 GIOCondition  condition,
+		 gpointer      data)
+{
+  GTimeVal sent, now;
+  gdouble latency;
+
+  if (read (active_pipe[0], &sent, sizeof (sent)) != sizeof (sent))
+    g_error ("short read");
+
+  g_get_current_time (&now);
+  latency = (now.tv_sec - sent.tv_sec) * 1e6 + (now.tv_usec - sent.tv_usec);
+  total_latency += latency;
+  max_latency = MAX (max_latency, latency);
+
+  g_async_queue_push (acks, GUINT_TO_POINTER (1));
+  if (++n_wakeups == N_WAKEUPS)
+    g_main_loop_quit (loop);
+
+  return TRUE;
+}
+
+static gpointer
+writer_thread (gpointer data)
+{
+  guint i;
+
+  for (i = 0; i < N_WAKEUPS; i++)
+    {
+      GTimeVal now;
+
+      g_usleep (1000);
+      g_get_current_time (&now);
+      if (write (active_pipe[1], &now, sizeof (now)) != sizeof (now))
+	g_error ("short write");
+      g_async_queue_pop (acks);
+    }
+
+  return NULL;
+}
+
+static void
+run (const gchar *name,
+     gint         n_idle)
+{
+  GThread *writer;
+  clock_t cpu;
+
+  n_wakeups = 0;
+  total_latency = max_latency = 0;
+
+  cpu = clock ();
+  writer = g_thread_create (writer_thread, NULL, TRUE, NULL);
+  g_main_loop_run (loop);
+  cpu = clock () - cpu;
+  g_thread_join (writer);
+
+  /* the writer thread's CPU time is included, it is the same
+   * for both runs
+   */
+  printf ("%d idle fds, %s: latency %.1f us average, %.1f us max; %.1f us CPU per wakeup\n",
+	  n_idle, name, total_latency / N_WAKEUPS, max_latency,
+	  (gdouble) cpu / CLOCKS_PER_SEC * 1e6 / N_WAKEUPS);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  gint n_idle = argc > 1 ? atoi (argv[1]) : 10000;
+  gint idle_pipe[2];
+  GIOChannel *channel;
+  GSource *source;
+  IdleSource *idle_source;
+  guint *watches;
+  gint i;
+
+  g_thread_init (NULL);
+
+  acks = g_async_queue_new ();
+  loop = g_main_loop_new (NULL, FALSE);
+
+  if (pipe (idle_pipe) < 0 || pipe (active_pipe) < 0)
+    g_error ("pipe() failed");
+
+  channel = g_io_channel_unix_new (active_pipe[0]);
+  g_io_add_watch (channel, G_IO_IN, active_fd_ready, NULL);
+  g_io_channel_unref (channel);
+
+  source = g_source_new (&idle_source_funcs, sizeof (IdleSource));
+  idle_source = (IdleSource *) source;
+  idle_source->fds = g_new0 (GPollFD, n_idle);
+  watches = g_new (guint, n_idle);
+
+  for (i = 0; i < n_idle; i++)
+    {
+      gint fd = dup (idle_pipe[0]);
+
+      if (fd < 0)
+	{
+	  printf ("could only open %d fds\n", i);
+	  n_idle = i;
+	  break;
+	}
+      idle_source->fds[i].fd = fd;
+      idle_source->fds[i].events = G_IO_IN;
+      idle_source->n_fds++;
+
+      channel = g_io_channel_unix_new (fd);
+      watches[i] = g_io_add_watch (channel, G_IO_IN, idle_fd_ready, NULL);
+      g_io_channel_unref (channel);
+    }
+
+  run ("one watch per fd", n_idle);
+
+  for (i = 0; i < n_idle; i++)
+    g_source_remove (watches[i]);
+  for (i = 0; i < n_idle; i++)
+    g_source_add_poll (source, &idle_source->fds[i]);
+  g_source_attach (source, NULL);
+
+  run ("one source", n_idle);
+
+  return 0;
+}
@@ -0,0 +1,371 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Reproduces the property churn of the cell renderers of a tree view:
+ * for every row, a renderer three classes deep gets the 2 properties
+ * of its base class and 8 of its own set inside one notification
+ * freeze, the way gtk_tree_view_column_cell_set_cell_data() does.
+ * The properties are a mix of strings, booleans, integers and floats.
+ *
+ * The rows are set with g_object_set(), with one
+ * g_object_set_property() per property, and with g_object_setv() and
+ * properties resolved once up front, each with no "notify" handler
+ * connected and with one.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib-object.h>
+
+#define N_ROWS 300000
+
+typedef struct
+{
+  GObject parent_instance;
+
+  gboolean is_expander;
+  gboolean is_expanded;
+  gchar *text;
+  gchar *foreground;
+  gfloat xalign, yalign;
+  gint xpad, weight;
+  gboolean visible, editable;
+} BenchRenderer;
+
+typedef GObjectClass BenchRendererClass;
+
+enum
+{
+  PROP_0,
+  PROP_IS_EXPANDER,
+  PROP_IS_EXPANDED,
+  PROP_TEXT,
+  PROP_FOREGROUND,
+  PROP_XALIGN,
+  PROP_YALIGN,
+  PROP_XPAD,
+  PROP_WEIGHT,
+  PROP_VISIBLE,
+  PROP_EDITABLE,
+  N_PROPS
+};
+
+static const gchar *prop_names[N_PROPS] = {
+  NULL, "is-expander", "is-expanded", "text", "foreground", "xalign",
+  "yalign", "xpad", "weight", "visible", "editable"
+};
+
+static guint n_notifies;
+
+static void
+bench_renderer_set_property (GObject      *object,
+			     guint         prop_id,
+			     const GValue *value,
+			     GParamSpec   *pspec)
+{
+  BenchRenderer *renderer = (BenchRenderer *) object;
+
+  switch (prop_id)
+    {
+    case PROP_IS_EXPANDER:
+      renderer->is_expander = g_value_get_boolean (value);
+      break;
+    case PROP_IS_EXPANDED:
+      renderer->is_expanded = g_value_get_boolean (value);
+      break;
+    case PROP_TEXT:
+      g_free (renderer->text);
+      renderer->text = g_value_dup_string (value);
+      break;
+    case PROP_FOREGROUND:
+      g_free (renderer->foreground);
+      renderer->foreground = g_value_dup_string (value);
+      break;
+    case PROP_XALIGN:
+      renderer->xalign = g_value_get_float (value);
+      break;
+    case PROP_YALIGN:
+      renderer->yalign = g_value_get_float (value);
+      break;
+    case PROP_XPAD:
+      renderer->xpad = g_value_get_int (value);
+      break;
+    case PROP_WEIGHT:
+      renderer->weight = g_value_get_int (value);
+      break;
+    case PROP_VISIBLE:
+      renderer->visible = g_value_get_boolean (value);
+      break;
+    case PROP_EDITABLE:
+      renderer->editable = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+bench_renderer_get_property (GObject    *object,
+			     guint       prop_id,
+			     GValue     *value,
+			     GParamSpec *pspec)
+{
+  G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+}
+
+static void
+bench_renderer_class_init (BenchRendererClass *class)
+{
+  class->set_property = bench_renderer_set_property;
+  class->get_property = bench_renderer_get_property;
+
+  g_object_class_install_property (class, PROP_IS_EXPANDER,
+    g_param_spec_boolean ("is-expander", NULL, NULL, FALSE,
+			  G_PARAM_READWRITE));
+  g_object_class_install_property (class, PROP_IS_EXPANDED,
+    g_param_spec_boolean ("is-expanded", NULL, NULL, FALSE,
+			  G_PARAM_READWRITE));
+}
+
+static void
+bench_renderer_text_class_init (BenchRendererClass *class)
+{
+  class->set_property = bench_renderer_set_property;
+  class->get_property = bench_renderer_get_property;
+
+  g_object_class_install_property (class, PROP_TEXT,
+    g_param_spec_string ("text", NULL, NULL, NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (class, PROP_FOREGROUND,
+    g_param_spec_string ("foreground", NULL, NULL, NULL, G_PARAM_READWRITE));
+  g_object_class_install_property (class, PROP_XALIGN,
+    g_param_spec_float ("xalign", NULL, NULL, 0, 1, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (class, PROP_YALIGN,
+    g_param_spec_float ("yalign", NULL, NULL, 0, 1, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (class, PROP_XPAD,
+    g_param_spec_int ("xpad", NULL, NULL, 0, G_MAXINT, 0, G_PARAM_READWRITE));
+  g_object_class_install_property (class, PROP_WEIGHT,
+    g_param_spec_int ("weight", NULL, NULL, 100, 900, 400, G_PARAM_READWRITE));
+  g_object_class_install_property (class, PROP_VISIBLE,
+    g_param_spec_boolean ("visible", NULL, NULL, TRUE, G_PARAM_READWRITE));
+  g_object_class_install_property (class, PROP_EDITABLE,
+    g_param_spec_boolean ("editable", NULL, NULL, FALSE, G_PARAM_READWRITE));
+}
+
+static GType
+bench_renderer_get_type (void)
+{
+  static GType types[3] = { 0, };
+
+  if (!types[0])
+    {
+      GTypeInfo info = {
+	sizeof (BenchRendererClass),
+	NULL,		/* base_init */
+	NULL,		/* base_finalize */
+	(GClassInitFunc) bench_renderer_class_init,
+	NULL,		/* class_finalize */
+	NULL,		/* class_data */
+	sizeof (BenchRenderer),
+	0,		/* n_preallocs */
+	NULL		/* instance_init */
+      };
+
+      types[0] = g_type_register_static (G_TYPE_OBJECT, "BenchRenderer",
+					 &info, 0);
+      info.class_init = (GClassInitFunc) bench_renderer_text_class_init;
+      types[1] = g_type_register_static (types[0], "BenchRendererText",
+					 &info, 0);
+      info.class_init = NULL;
+      types[2] = g_type_register_static (types[1], "BenchRendererCombo",
+					 &info, 0);
+    }
+
+  return types[2];
+}
+
+static void
+count_notify (GObject    *object,
+	      GParamSpec *pspec,
+	      gpointer    data)
+{
+  n_notifies++;
+}
+
+static const gchar *row_texts[] = {
+  "Inbox", "Sent", "Drafts", "a rather longer folder name", "Trash"
+};
+
+static gdouble
+run_set (GObject *renderer)
+{
+  GTimer *timer = g_timer_new ();
+  gdouble elapsed;
+  guint row;
+
+  for (row = 0; row < N_ROWS; row++)
+    {
+      g_object_freeze_notify (renderer);
+      g_object_set (renderer,
+		    "is-expander", row % 8 == 0,
+		    "is-expanded", FALSE,
+		    NULL);
+      g_object_set (renderer,
+		    "text", row_texts[row % G_N_ELEMENTS (row_texts)],
+		    "foreground", row % 2 ? "black" : "red",
+		    "xalign", 0.0,
+		    "yalign", 0.5,
+		    "xpad", 2,
+		    "weight", row % 3 ? 400 : 700,
+		    "visible", TRUE,
+		    "editable", FALSE,
+		    NULL);
+      g_object_thaw_notify (renderer);
+    }
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed;
+}
+
+static void
+set_row_values (GValue *values,
+		guint   row)
+{
+  g_value_set_boolean (&values[PROP_IS_EXPANDER], row % 8 == 0);
+  g_value_set_boolean (&values[PROP_IS_EXPANDED], FALSE);
+  g_value_set_static_string (&values[PROP_TEXT],
+			     row_texts[row % G_N_ELEMENTS (row_texts)]);
+  g_value_set_static_string (&values[PROP_FOREGROUND],
+			     row % 2 ? "black" : "red");
+  g_value_set_float (&values[PROP_XALIGN], 0.0);
+  g_value_set_float (&values[PROP_YALIGN], 0.5);
+  g_value_set_int (&values[PROP_XPAD], 2);
+  g_value_set_int (&values[PROP_WEIGHT], row % 3 ? 400 : 700);
+  g_value_set_boolean (&values[PROP_VISIBLE], TRUE);
+  g_value_set_boolean (&values[PROP_EDITABLE], FALSE);
+}
+
+static gdouble
+run_set_property (GObject *renderer,
+		  GValue  *values)
+{
+  GTimer *timer = g_timer_new ();
+  gdouble elapsed;
+  guint row, i;
+
+  for (row = 0; row < N_ROWS; row++)
+    {
+      set_row_values (values, row);
+      g_object_freeze_notify (renderer);
+      for (i = 1; i < N_PROPS; i++)
+	g_object_set_property (renderer, prop_names[i], &values[i]);
+      g_object_thaw_notify (renderer);
+    }
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed;
+}
+
+static gdouble
+run_setv (GObject *renderer,
+	  GValue  *values)
+{
+  GParamSpec *pspecs[N_PROPS];
+  GTimer *timer;
+  gdouble elapsed;
+  guint row, i;
+
+  for (i = 1; i < N_PROPS; i++)
+    pspecs[i] = g_object_class_find_property (G_OBJECT_GET_CLASS (renderer),
+					      prop_names[i]);
+
+  timer = g_timer_new ();
+  for (row = 0; row < N_ROWS; row++)
+    {
+      set_row_values (values, row);
+      g_object_setv (renderer, N_PROPS - 1, pspecs + 1, values + 1);
+    }
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GValue values[N_PROPS];
+  GObject *renderer;
+  gboolean with_handler;
+  guint i;
+
+  g_type_init ();
+
+  renderer = g_object_new (bench_renderer_get_type (), NULL);
+
+  memset (values, 0, sizeof (values));
+  for (i = 1; i < N_PROPS; i++)
+    {
+      GParamSpec *pspec =
+	g_object_class_find_property (G_OBJECT_GET_CLASS (renderer),
+				      prop_names[i]);
+
+      g_value_init (&values[i], G_PARAM_SPEC_VALUE_TYPE (pspec));
+    }
+
+  printf ("us per row         g_object_set  g_object_set_property"
+	  "  g_object_setv\n");
+  for (with_handler = FALSE; with_handler <= TRUE; with_handler++)
+    {
+      gdouble set, set_property, setv;
+
+      if (with_handler)
+	g_signal_connect (renderer, "notify", G_CALLBACK (count_notify), NULL);
+
+      n_notifies = 0;
+      set = run_set (renderer);
+      set_property = run_set_property (renderer, values);
+      setv = run_setv (renderer, values);
+
+      if (with_handler && n_notifies != 3 * N_ROWS * (N_PROPS - 1))
+	g_error ("%u notifications instead of %u", n_notifies,
+		 3 * N_ROWS * (N_PROPS - 1));
+
+      printf ("%-17s  %12.2f  %21.2f  %13.2f\n",
+	      with_handler ? "notify handler" : "no handler",
+	      set / N_ROWS * 1e6, set_property / N_ROWS * 1e6,
+	      setv / N_ROWS * 1e6);
+    }
+
+  for (i = 1; i < N_PROPS; i++)
+    g_value_unset (&values[i]);
+  g_object_unref (renderer);
+
+  return 0;
+}
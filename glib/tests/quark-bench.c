@@ -0,0 +1,148 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures quark lookups per second from 1 to 8 threads. Every thread
+ * looks up random names out of 2000 interned ones with
+ * g_quark_try_string() and maps the quark back with
+ * g_quark_to_string(), the way signal and property lookup by name
+ * does. Each thread count is run once with readers only, and once
+ * with another thread interning new strings at the same time.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#define N_NAMES       2000
+#define N_LOOKUPS     1000000
+#define MAX_THREADS   8
+
+static gchar *names[N_NAMES];
+static volatile gboolean stop_interning;
+
+static gpointer
+lookup_thread (gpointer data)
+{
+  GRand *rand = g_rand_new_with_seed (GPOINTER_TO_UINT (data));
+  guint i;
+
+  for (i = 0; i < N_LOOKUPS; i++)
+    {
+      const gchar *name = names[g_rand_int_range (rand, 0, N_NAMES)];
+      GQuark quark = g_quark_try_string (name);
+
+      if (!quark || g_quark_to_string (quark)[0] != name[0])
+	g_error ("lookup of %s failed", name);
+    }
+
+  g_rand_free (rand);
+
+  return NULL;
+}
+
+static gpointer
+intern_thread (gpointer data)
+{
+  guint i = 0;
+
+  while (!stop_interning)
+    {
+      gchar *name = g_strdup_printf ("new-signal-%u", i++);
+
+      g_quark_from_string (name);
+      g_free (name);
+    }
+
+  return GUINT_TO_POINTER (i);
+}
+
+static gdouble
+run (guint     n_threads,
+     gboolean  interning,
+     guint    *n_interned)
+{
+  GThread *threads[MAX_THREADS];
+  GThread *interner = NULL;
+  GTimer *timer;
+  gdouble elapsed;
+  guint i;
+
+  if (interning)
+    {
+      stop_interning = FALSE;
+      interner = g_thread_create (intern_thread, NULL, TRUE, NULL);
+    }
+
+  timer = g_timer_new ();
+  for (i = 0; i < n_threads; i++)
+    threads[i] = g_thread_create (lookup_thread, GUINT_TO_POINTER (i + 1),
+				  TRUE, NULL);
+  for (i = 0; i < n_threads; i++)
+    g_thread_join (threads[i]);
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  if (interning)
+    {
+      stop_interning = TRUE;
+      *n_interned += GPOINTER_TO_UINT (g_thread_join (interner));
+    }
+
+  return elapsed;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  guint n_threads, n_interned = 0;
+  guint i;
+
+  g_thread_init (NULL);
+
+  for (i = 0; i < N_NAMES; i++)
+    {
+      names[i] = g_strdup_printf ("%s::property-%u",
+				  i % 2 ? "notify" : "changed", i);
+      g_quark_from_string (names[i]);
+    }
+
+  printf ("threads  lookups/s (millions)  with an interning thread\n");
+  for (n_threads = 1; n_threads <= MAX_THREADS; n_threads *= 2)
+    {
+      gdouble readers, interning;
+
+      readers = run (n_threads, FALSE, NULL);
+      interning = run (n_threads, TRUE, &n_interned);
+
+      printf ("%7u  %20.2f  %24.2f\n", n_threads,
+	      n_threads * N_LOOKUPS / readers / 1e6,
+	      n_threads * N_LOOKUPS / interning / 1e6);
+    }
+  printf ("%u strings interned meanwhile\n", n_interned);
+
+  for (i = 0; i < N_NAMES; i++)
+    g_free (names[i]);
+
+  return 0;
+}
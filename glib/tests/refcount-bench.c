@@ -0,0 +1,203 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures the cost of a reference and unreference pair on a GObject,
+ * a GClosure and a GParamSpec with 1 to 8 threads working on the same
+ * instance, and checks that every count ends where it started. Then
+ * it creates objects in one thread and drops the last reference in
+ * another, the way a worker thread hands a rendered layout back, and
+ * checks that each object was finalized exactly once.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+
+#include <glib-object.h>
+
+#define N_ROUNDS     1000000
+#define N_HANDOFFS   200000
+#define MAX_THREADS  8
+
+typedef enum
+{
+  REF_OBJECT,
+  REF_CLOSURE,
+  REF_PSPEC,
+  N_KINDS
+} RefKind;
+
+static const gchar *kind_names[N_KINDS] = {
+  "GObject", "GClosure", "GParamSpec"
+};
+
+static GObject *object;
+static GClosure *closure;
+static GParamSpec *pspec;
+static RefKind ref_kind;
+static gint n_finalized;
+
+static gpointer
+ref_thread (gpointer data)
+{
+  guint i;
+
+  switch (ref_kind)
+    {
+    case REF_OBJECT:
+      for (i = 0; i < N_ROUNDS; i++)
+	{
+	  g_object_ref (object);
+	  g_object_unref (object);
+	}
+      break;
+    case REF_CLOSURE:
+      for (i = 0; i < N_ROUNDS; i++)
+	{
+	  g_closure_ref (closure);
+	  g_closure_unref (closure);
+	}
+      break;
+    case REF_PSPEC:
+      for (i = 0; i < N_ROUNDS; i++)
+	{
+	  g_param_spec_ref (pspec);
+	  g_param_spec_unref (pspec);
+	}
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  return NULL;
+}
+
+static gdouble
+run (RefKind kind,
+     guint   n_threads)
+{
+  GThread *threads[MAX_THREADS];
+  GTimer *timer = g_timer_new ();
+  gdouble elapsed;
+  guint i;
+
+  ref_kind = kind;
+  for (i = 0; i < n_threads; i++)
+    threads[i] = g_thread_create (ref_thread, NULL, TRUE, NULL);
+  for (i = 0; i < n_threads; i++)
+    g_thread_join (threads[i]);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed / (n_threads * N_ROUNDS) * 1e9;
+}
+
+static void
+object_finalized (gpointer  data,
+		  GObject  *where_the_object_was)
+{
+  g_atomic_int_inc (&n_finalized);
+}
+
+static gpointer
+handoff_thread (gpointer data)
+{
+  GAsyncQueue *queue = data;
+  guint i;
+
+  for (i = 0; i < N_HANDOFFS; i++)
+    {
+      GObject *handed = g_async_queue_pop (queue);
+
+      /* the creating thread may or may not have dropped its
+       * reference yet, either one of them is the last one
+       */
+      g_object_ref (handed);
+      g_object_unref (handed);
+      g_object_unref (handed);
+    }
+
+  return NULL;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GAsyncQueue *queue;
+  GThread *thread;
+  GTimer *timer;
+  guint n_threads, i;
+  RefKind kind;
+
+  g_thread_init (NULL);
+  g_type_init ();
+
+  object = g_object_new (G_TYPE_OBJECT, NULL);
+  closure = g_cclosure_new (G_CALLBACK (object_finalized), NULL, NULL);
+  g_closure_ref (closure);
+  g_closure_sink (closure);
+  pspec = g_param_spec_int ("bench", NULL, NULL, 0, 1, 0, G_PARAM_READWRITE);
+  g_param_spec_ref (pspec);
+  g_param_spec_sink (pspec);
+
+  printf ("ns per ref/unref pair on a shared instance\n");
+  printf ("threads  %10s  %10s  %10s\n",
+	  kind_names[REF_OBJECT], kind_names[REF_CLOSURE], kind_names[REF_PSPEC]);
+  for (n_threads = 1; n_threads <= MAX_THREADS; n_threads *= 2)
+    {
+      printf ("%7u", n_threads);
+      for (kind = 0; kind < N_KINDS; kind++)
+	printf ("  %10.1f", run (kind, n_threads));
+      printf ("\n");
+    }
+
+  if (object->ref_count != 1 || closure->ref_count != 1 ||
+      pspec->ref_count != 1)
+    g_error ("reference counts ended at %u, %u and %u instead of 1",
+	     object->ref_count, closure->ref_count, pspec->ref_count);
+
+  queue = g_async_queue_new ();
+  timer = g_timer_new ();
+  thread = g_thread_create (handoff_thread, queue, TRUE, NULL);
+  for (i = 0; i < N_HANDOFFS; i++)
+    {
+      GObject *created = g_object_new (G_TYPE_OBJECT, NULL);
+
+      g_object_weak_ref (created, object_finalized, NULL);
+      g_async_queue_push (queue, g_object_ref (created));
+      g_object_unref (created);
+    }
+  g_thread_join (thread);
+  printf ("handing objects to another thread: %.0f ns per object\n",
+	  g_timer_elapsed (timer, NULL) / N_HANDOFFS * 1e9);
+
+  if (n_finalized != N_HANDOFFS)
+    g_error ("%d of %d objects finalized", n_finalized, N_HANDOFFS);
+
+  g_timer_destroy (timer);
+  g_async_queue_unref (queue);
+  g_object_unref (object);
+  g_closure_unref (closure);
+  g_param_spec_unref (pspec);
+
+  return 0;
+}
@@ -0,0 +1,120 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Compares GString and GRopeString on 1 to 64 MB buffers of log
+ * lines: building the buffer by appending lines, inserting and erasing
+ * 20 bytes at random positions, and flattening the rope. Both get the
+ * same edits and must end up with the same text.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#define LINE "[12:34:56] <nick> a line of scrollback text to export, " \
+	     "0123456789\n"
+#define EDIT_SIZE 20
+
+static void
+run (gsize size,
+     guint n_edits)
+{
+  GString *string = g_string_new (NULL);
+  GRopeString *rope = g_rope_string_new (NULL);
+  GRand *rand = g_rand_new_with_seed (42);
+  GTimer *timer = g_timer_new ();
+  gsize line_len = strlen (LINE);
+  gdouble string_build, rope_build, string_edit, rope_edit, flatten;
+  const gchar *flat;
+  guint i;
+
+  while (string->len < size)
+    g_string_append (string, LINE);
+  string_build = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < string->len; i += line_len)
+    g_rope_string_append (rope, LINE);
+  rope_build = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < n_edits; i++)
+    {
+      gsize pos = g_rand_int_range (rand, 0, string->len - EDIT_SIZE);
+
+      if (i & 1)
+	g_string_erase (string, pos, EDIT_SIZE);
+      else
+	g_string_insert_len (string, pos, LINE, EDIT_SIZE);
+    }
+  string_edit = g_timer_elapsed (timer, NULL) / n_edits;
+
+  g_rand_set_seed (rand, 42);
+  g_timer_start (timer);
+  for (i = 0; i < n_edits; i++)
+    {
+      gsize pos = g_rand_int_range (rand, 0,
+				    g_rope_string_length (rope) - EDIT_SIZE);
+
+      if (i & 1)
+	g_rope_string_erase (rope, pos, EDIT_SIZE);
+      else
+	g_rope_string_insert_len (rope, pos, LINE, EDIT_SIZE);
+    }
+  rope_edit = g_timer_elapsed (timer, NULL) / n_edits;
+
+  g_timer_start (timer);
+  flat = g_rope_string_flatten (rope);
+  flatten = g_timer_elapsed (timer, NULL);
+
+  if (g_rope_string_length (rope) != string->len ||
+      memcmp (flat, string->str, string->len) != 0)
+    g_error ("%lu MB: the rope and the string differ",
+	     (gulong) (size >> 20));
+
+  printf ("%2lu MB %8.3f %8.3f %10.2f %8.3f %7.0fx %8.3f\n",
+	  (gulong) (size >> 20), string_build, rope_build,
+	  string_edit * 1e6, rope_edit * 1e6, string_edit / rope_edit,
+	  flatten);
+
+  g_timer_destroy (timer);
+  g_rand_free (rand);
+  g_rope_string_free (rope, TRUE);
+  g_string_free (string, TRUE);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  printf ("      %8s %8s %10s %8s %8s %8s\n", "build", "build",
+	  "edit us", "edit us", "", "flatten");
+  printf ("      %8s %8s %10s %8s %8s %8s\n", "GString", "rope",
+	  "GString", "rope", "speedup", "");
+  run (1 << 20, 4000);
+  run (4 << 20, 2000);
+  run (16 << 20, 500);
+  run (64 << 20, 200);
+
+  return 0;
+}
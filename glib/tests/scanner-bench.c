@@ -0,0 +1,227 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures GScanner on a large gtkrc-style theme, with the scanner
+ * configuration and symbols gtkrc.c uses. The theme is scanned from
+ * text and from a file descriptor, and once more with case-insensitive
+ * symbols. The number of tokens of each kind is checked against the
+ * generated input and must be the same for every way of scanning.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <glib.h>
+
+#define N_STYLES 20000
+#define N_ROUNDS 5
+#define STRINGS_PER_STYLE 8
+
+static const GScannerConfig rc_config = {
+  " \t\r\n",					/* cset_skip_characters */
+  G_CSET_a_2_z "_" G_CSET_A_2_Z,		/* cset_identifier_first */
+  G_CSET_a_2_z "_-0123456789" G_CSET_A_2_Z,	/* cset_identifier_nth */
+  "#\n",					/* cpair_comment_single */
+  TRUE,						/* case_sensitive */
+  TRUE,						/* skip_comment_multi */
+  TRUE,						/* skip_comment_single */
+  TRUE,						/* scan_comment_multi */
+  TRUE,						/* scan_identifier */
+  FALSE,					/* scan_identifier_1char */
+  TRUE,						/* scan_identifier_NULL */
+  TRUE,						/* scan_symbols */
+  TRUE,						/* scan_binary */
+  TRUE,						/* scan_octal */
+  TRUE,						/* scan_float */
+  TRUE,						/* scan_hex */
+  TRUE,						/* scan_hex_dollar */
+  TRUE,						/* scan_string_sq */
+  TRUE,						/* scan_string_dq */
+  TRUE,						/* numbers_2_int */
+  FALSE,					/* int_2_float */
+  FALSE,					/* identifier_2_string */
+  TRUE,						/* char_2_token */
+  TRUE,						/* symbol_2_token */
+  FALSE,					/* scope_0_fallback */
+};
+
+static const gchar *symbols[] = {
+  "include", "NORMAL", "ACTIVE", "PRELIGHT", "SELECTED", "INSENSITIVE",
+  "fg", "bg", "text", "base", "xthickness", "ythickness", "font",
+  "fontset", "font_name", "bg_pixmap", "pixmap_path", "style", "binding",
+  "bind", "widget", "widget_class", "class", "lowest", "gtk",
+  "application", "theme", "rc", "highest", "engine", "module_path",
+  "stock", "im_module_file", "LTR", "RTL", "image", "function", "file",
+  "stretch", "recolorable", "detail", "border", "overlay_file",
+  "overlay_border", "shadow", "state", "arrow_direction", "orientation"
+};
+
+typedef struct
+{
+  guint n_tokens;
+  guint n_symbols;
+  guint n_identifiers;
+  guint n_strings;
+  guint n_numbers;
+} Counts;
+
+static GString *
+make_theme (void)
+{
+  GString *theme = g_string_new (NULL);
+  guint i;
+
+  for (i = 0; i < N_STYLES; i++)
+    g_string_append_printf (theme,
+			    "# style number %u for the widgets of this theme\n"
+			    "style \"theme-button-%u\" = \"default\"\n"
+			    "{\n"
+			    "  xthickness = %u\n"
+			    "  ythickness = 2\n"
+			    "  bg[NORMAL] = { 0.85, 0.84, 0.%u }\n"
+			    "  fg[PRELIGHT] = \"#%06x\"\n"
+			    "  font_name = \"Sans Bold %u\"\n"
+			    "  GtkButton::child-displacement-x = 1\n"
+			    "  engine \"pixmap\" {\n"
+			    "    image {\n"
+			    "      function = BOX\n"
+			    "      state = NORMAL\n"
+			    "      file = \"buttons/button-%u.png\"\n"
+			    "      border = { 4, 4, 4, 4 }\n"
+			    "      stretch = TRUE\n"
+			    "    }\n"
+			    "  }\n"
+			    "}\n"
+			    "widget_class \"*GtkButton*\" style "
+			    "\"theme-button-%u\"\n",
+			    i, i, i % 4, i % 100 + 1, i * 77 & 0xffffff,
+			    8 + i % 5, i, i);
+
+  return theme;
+}
+
+static void
+scan (GScanner *scanner,
+      Counts   *counts)
+{
+  GTokenType token;
+
+  memset (counts, 0, sizeof (Counts));
+  while ((token = g_scanner_get_next_token (scanner)) != G_TOKEN_EOF)
+    {
+      counts->n_tokens++;
+      if (token > G_TOKEN_LAST)
+	counts->n_symbols++;
+      else if (token == G_TOKEN_IDENTIFIER)
+	counts->n_identifiers++;
+      else if (token == G_TOKEN_STRING)
+	counts->n_strings++;
+      else if (token == G_TOKEN_INT || token == G_TOKEN_FLOAT)
+	counts->n_numbers++;
+      else if (token == G_TOKEN_ERROR)
+	g_error ("scan error at line %u", g_scanner_cur_line (scanner));
+    }
+}
+
+static GScanner *
+new_scanner (gboolean case_sensitive)
+{
+  GScanner *scanner = g_scanner_new (&rc_config);
+  guint i;
+
+  scanner->config->case_sensitive = case_sensitive;
+  for (i = 0; i < G_N_ELEMENTS (symbols); i++)
+    g_scanner_scope_add_symbol (scanner, 0, symbols[i],
+				GINT_TO_POINTER (G_TOKEN_LAST + 1 + i));
+
+  return scanner;
+}
+
+static void
+run (const gchar   *name,
+     const GString *theme,
+     gint           fd,
+     gboolean       case_sensitive,
+     Counts        *expected)
+{
+  GTimer *timer = g_timer_new ();
+  Counts counts;
+  guint round;
+
+  for (round = 0; round < N_ROUNDS; round++)
+    {
+      GScanner *scanner = new_scanner (case_sensitive);
+
+      if (fd >= 0)
+	{
+	  lseek (fd, 0, SEEK_SET);
+	  g_scanner_input_file (scanner, fd);
+	}
+      else
+	g_scanner_input_text (scanner, theme->str, theme->len);
+
+      scan (scanner, &counts);
+      g_scanner_destroy (scanner);
+    }
+
+  printf ("%-24s %7.1f MB/s %6.2f Mtokens/s\n", name,
+	  N_ROUNDS * theme->len / g_timer_elapsed (timer, NULL) / 1e6,
+	  N_ROUNDS * counts.n_tokens / g_timer_elapsed (timer, NULL) / 1e6);
+
+  if (expected->n_tokens == 0)
+    *expected = counts;
+  else if (memcmp (&counts, expected, sizeof (Counts)) != 0)
+    g_error ("%s: token counts differ", name);
+
+  if (counts.n_strings != N_STYLES * STRINGS_PER_STYLE)
+    g_error ("%s: %u strings", name, counts.n_strings);
+
+  g_timer_destroy (timer);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GString *theme = make_theme ();
+  Counts expected = { 0, };
+  gchar *filename;
+  gint fd;
+
+  fd = g_file_open_tmp ("scanner-bench-XXXXXX", &filename, NULL);
+  if (fd < 0 || write (fd, theme->str, theme->len) != theme->len)
+    g_error ("can't write %s", filename);
+
+  printf ("%.1f MB theme\n", theme->len / 1e6);
+  run ("text", theme, -1, TRUE, &expected);
+  run ("file descriptor", theme, fd, TRUE, &expected);
+  run ("case-insensitive symbols", theme, -1, FALSE, &expected);
+
+  close (fd);
+  unlink (filename);
+  g_free (filename);
+  g_string_free (theme, TRUE);
+
+  return 0;
+}
@@ -0,0 +1,261 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures the cost of emitting a signal with 0, 1 and 10 handlers
+ * connected: a signal whose class closure points to a NULL class
+ * member, which is how most GTK+ signals look when the widget doesn't
+ * override them, a signal whose class member is implemented, and a
+ * signal with a boolean return value. Emission by name is measured
+ * too.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+
+#include <glib-object.h>
+
+#define N_EMISSIONS 2000000
+
+#define BENCH_TYPE_OBJECT (bench_object_get_type ())
+
+typedef struct _BenchObject      BenchObject;
+typedef struct _BenchObjectClass BenchObjectClass;
+
+struct _BenchObject
+{
+  GObject parent_instance;
+};
+
+struct _BenchObjectClass
+{
+  GObjectClass parent_class;
+
+  void     (*changed)     (BenchObject *object,
+			   gint         value);
+  void     (*implemented) (BenchObject *object,
+			   gint         value);
+  gboolean (*query)       (BenchObject *object,
+			   gpointer     data);
+};
+
+enum
+{
+  CHANGED,
+  IMPLEMENTED,
+  QUERY,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+static guint n_calls;
+
+static void
+bench_object_implemented (BenchObject *object,
+			  gint         value)
+{
+  n_calls++;
+}
+
+static void
+marshal_BOOLEAN__POINTER (GClosure     *closure,
+			  GValue       *return_value,
+			  guint         n_param_values,
+			  const GValue *param_values,
+			  gpointer      invocation_hint,
+			  gpointer      marshal_data)
+{
+  typedef gboolean (*MarshalFunc) (gpointer data1,
+				   gpointer arg_1,
+				   gpointer data2);
+  GCClosure *cc = (GCClosure *) closure;
+  MarshalFunc callback;
+  gpointer data1, data2;
+
+  if (G_CCLOSURE_SWAP_DATA (closure))
+    {
+      data1 = closure->data;
+      data2 = g_value_peek_pointer (param_values + 0);
+    }
+  else
+    {
+      data1 = g_value_peek_pointer (param_values + 0);
+      data2 = closure->data;
+    }
+  callback = (MarshalFunc) (marshal_data ? marshal_data : cc->callback);
+
+  g_value_set_boolean (return_value,
+		       callback (data1,
+				 g_value_get_pointer (param_values + 1),
+				 data2));
+}
+
+static void
+bench_object_class_init (BenchObjectClass *class)
+{
+  GType type = G_TYPE_FROM_CLASS (class);
+
+  class->implemented = bench_object_implemented;
+
+  signals[CHANGED] =
+    g_signal_new ("changed", type, G_SIGNAL_RUN_LAST,
+		  G_STRUCT_OFFSET (BenchObjectClass, changed),
+		  NULL, NULL, g_cclosure_marshal_VOID__INT,
+		  G_TYPE_NONE, 1, G_TYPE_INT);
+  signals[IMPLEMENTED] =
+    g_signal_new ("implemented", type, G_SIGNAL_RUN_LAST,
+		  G_STRUCT_OFFSET (BenchObjectClass, implemented),
+		  NULL, NULL, g_cclosure_marshal_VOID__INT,
+		  G_TYPE_NONE, 1, G_TYPE_INT);
+  signals[QUERY] =
+    g_signal_new ("query", type, G_SIGNAL_RUN_LAST,
+		  G_STRUCT_OFFSET (BenchObjectClass, query),
+		  NULL, NULL,
+		  marshal_BOOLEAN__POINTER,
+		  G_TYPE_BOOLEAN, 1, G_TYPE_POINTER);
+}
+
+static GType
+bench_object_get_type (void)
+{
+  static GType type = 0;
+
+  if (!type)
+    {
+      static const GTypeInfo info = {
+	sizeof (BenchObjectClass),
+	NULL,		/* base_init */
+	NULL,		/* base_finalize */
+	(GClassInitFunc) bench_object_class_init,
+	NULL,		/* class_finalize */
+	NULL,		/* class_data */
+	sizeof (BenchObject),
+	0,		/* n_preallocs */
+	NULL		/* instance_init */
+      };
+
+      type = g_type_register_static (G_TYPE_OBJECT, "BenchObject", &info, 0);
+    }
+
+  return type;
+}
+
+static void
+int_handler (BenchObject *object,
+	     gint         value,
+	     gpointer     data)
+{
+  n_calls++;
+}
+
+static gboolean
+query_handler (BenchObject *object,
+	       gpointer     query,
+	       gpointer     data)
+{
+  n_calls++;
+
+  return FALSE;
+}
+
+static void
+connect_handlers (BenchObject *object,
+		  guint        n_handlers)
+{
+  guint i;
+
+  for (i = 0; i < n_handlers; i++)
+    {
+      g_signal_connect (object, "changed", G_CALLBACK (int_handler), NULL);
+      g_signal_connect (object, "implemented", G_CALLBACK (int_handler), NULL);
+      g_signal_connect (object, "query", G_CALLBACK (query_handler), NULL);
+    }
+}
+
+static void
+run (BenchObject *object,
+     guint        n_handlers)
+{
+  GTimer *timer = g_timer_new ();
+  gdouble changed, implemented, query, by_name;
+  gboolean handled;
+  guint i;
+
+  g_timer_start (timer);
+  for (i = 0; i < N_EMISSIONS; i++)
+    g_signal_emit (object, signals[CHANGED], 0, i);
+  changed = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_EMISSIONS; i++)
+    g_signal_emit (object, signals[IMPLEMENTED], 0, i);
+  implemented = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_EMISSIONS; i++)
+    g_signal_emit (object, signals[QUERY], 0, NULL, &handled);
+  query = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_EMISSIONS; i++)
+    g_signal_emit_by_name (object, "changed", i);
+  by_name = g_timer_elapsed (timer, NULL);
+
+  printf ("%8u  %17.0f  %11.0f  %14.0f  %7.0f\n", n_handlers,
+	  changed / N_EMISSIONS * 1e9, implemented / N_EMISSIONS * 1e9,
+	  query / N_EMISSIONS * 1e9, by_name / N_EMISSIONS * 1e9);
+
+  g_timer_destroy (timer);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  BenchObject *object;
+  guint expected_calls;
+
+  g_type_init ();
+
+  object = g_object_new (BENCH_TYPE_OBJECT, NULL);
+
+  printf ("ns per emission\n");
+  printf ("handlers  NULL class member  implemented  boolean return  by name\n");
+
+  /* every round calls each handler once per emission, plus the
+   * implemented class member
+   */
+  expected_calls = 0;
+  run (object, 0);
+  expected_calls += N_EMISSIONS;
+  connect_handlers (object, 1);
+  run (object, 1);
+  expected_calls += N_EMISSIONS * (4 * 1 + 1);
+  connect_handlers (object, 9);
+  run (object, 10);
+  expected_calls += N_EMISSIONS * (4 * 10 + 1);
+
+  if (n_calls != expected_calls)
+    g_error ("%u handler calls instead of %u", n_calls, expected_calls);
+
+  g_object_unref (object);
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Compares g_slice_alloc()/g_slice_free1() with a G_ALLOC_AND_FREE
+ * GMemChunk behind a global lock, the way list, hash and instance
+ * nodes used to be allocated, on 1 to 8 threads. Every thread keeps
+ * a working set of blocks of list and hash node sizes and replaces
+ * random ones.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#define N_OPS        2000000
+#define WORKING_SET  1024
+#define N_SIZES      3
+
+static const gsize block_sizes[N_SIZES] = {
+  2 * sizeof (gpointer),	/* GSList */
+  3 * sizeof (gpointer),	/* GList */
+  4 * sizeof (gpointer)		/* hash node */
+};
+
+static GMemChunk *mem_chunks[N_SIZES];
+G_LOCK_DEFINE_STATIC (mem_chunks);
+
+static gboolean use_slices;
+
+static gpointer
+bench_alloc (guint size_class)
+{
+  gpointer mem;
+
+  if (use_slices)
+    return g_slice_alloc (block_sizes[size_class]);
+
+  G_LOCK (mem_chunks);
+  mem = g_mem_chunk_alloc (mem_chunks[size_class]);
+  G_UNLOCK (mem_chunks);
+
+  return mem;
+}
+
+static void
+bench_free (guint    size_class,
+	    gpointer mem)
+{
+  if (use_slices)
+    {
+      g_slice_free1 (block_sizes[size_class], mem);
+      return;
+    }
+
+  G_LOCK (mem_chunks);
+  g_mem_chunk_free (mem_chunks[size_class], mem);
+  G_UNLOCK (mem_chunks);
+}
+
+static gpointer
+bench_thread (gpointer data)
+{
+  GRand *rand = g_rand_new_with_seed (GPOINTER_TO_UINT (data));
+  gpointer blocks[WORKING_SET];
+  guint classes[WORKING_SET];
+  guint i;
+
+  for (i = 0; i < WORKING_SET; i++)
+    {
+      classes[i] = i % N_SIZES;
+      blocks[i] = bench_alloc (classes[i]);
+    }
+
+  for (i = 0; i < N_OPS; i++)
+    {
+      guint j = g_rand_int_range (rand, 0, WORKING_SET);
+
+      bench_free (classes[j], blocks[j]);
+      classes[j] = g_rand_int_range (rand, 0, N_SIZES);
+      blocks[j] = bench_alloc (classes[j]);
+      /* touch the block like a list node would */
+      *(gpointer *) blocks[j] = blocks[j];
+    }
+
+  for (i = 0; i < WORKING_SET; i++)
+    bench_free (classes[i], blocks[i]);
+
+  g_rand_free (rand);
+
+  return NULL;
+}
+
+static gdouble
+run (guint n_threads)
+{
+  GThread *threads[8];
+  GTimer *timer = g_timer_new ();
+  gdouble elapsed;
+  guint i;
+
+  for (i = 0; i < n_threads; i++)
+    threads[i] = g_thread_create (bench_thread, GUINT_TO_POINTER (i + 1), TRUE, NULL);
+  for (i = 0; i < n_threads; i++)
+    g_thread_join (threads[i]);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  guint n_threads, i;
+
+  g_thread_init (NULL);
+
+  for (i = 0; i < N_SIZES; i++)
+    mem_chunks[i] = g_mem_chunk_new ("bench chunk", block_sizes[i],
+				     block_sizes[i] * 128, G_ALLOC_AND_FREE);
+
+  printf ("threads  mem chunk (Mops/s)  slices (Mops/s)\n");
+  for (n_threads = 1; n_threads <= 8; n_threads *= 2)
+    {
+      gdouble chunk_time, slice_time;
+
+      use_slices = FALSE;
+      chunk_time = run (n_threads);
+      use_slices = TRUE;
+      slice_time = run (n_threads);
+
+      printf ("%7u  %19.2f  %15.2f\n", n_threads,
+	      n_threads * N_OPS / chunk_time / 1e6,
+	      n_threads * N_OPS / slice_time / 1e6);
+    }
+
+  for (i = 0; i < N_SIZES; i++)
+    g_mem_chunk_destroy (mem_chunks[i]);
+
+  return 0;
+}
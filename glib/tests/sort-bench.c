@@ -0,0 +1,186 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Times g_sort_with_data() with each GSortFlags mode on 1000000
+ * elements of random, sorted, reverse sorted and few-unique input,
+ * and on sorted input where one element changed, which is what
+ * re-sorting a list after one row was edited looks like. Also counts
+ * the comparisons and checks that the stable modes kept equal
+ * elements in their original order.
+ *
+ * G_SORT_PARALLEL falls back to a serial sort on a machine with a
+ * single processor.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#define N_ELEMS 1000000
+
+typedef struct
+{
+  gint key;
+  gint position;
+} Element;
+
+typedef enum
+{
+  INPUT_RANDOM,
+  INPUT_SORTED,
+  INPUT_REVERSE,
+  INPUT_FEW_UNIQUE,
+  INPUT_ONE_CHANGED,
+  N_INPUTS
+} Input;
+
+static const gchar *input_names[N_INPUTS] = {
+  "random", "sorted", "reverse", "few unique", "one changed"
+};
+
+static const struct
+{
+  const gchar *name;
+  GSortFlags flags;
+} modes[] = {
+  { "default", G_SORT_DEFAULT },
+  { "stable", G_SORT_STABLE },
+  { "adaptive", G_SORT_ADAPTIVE },
+  { "parallel", G_SORT_STABLE | G_SORT_PARALLEL }
+};
+
+static guint n_compares;
+
+static gint
+compare_elements (gconstpointer a,
+		  gconstpointer b,
+		  gpointer      data)
+{
+  const Element *ea = a;
+  const Element *eb = b;
+
+  /* only counted roughly in parallel mode, that doesn't matter here */
+  n_compares++;
+
+  return ea->key < eb->key ? -1 : ea->key > eb->key;
+}
+
+static void
+fill (Element *elems,
+      Input    input,
+      GRand   *rand)
+{
+  gint i;
+
+  for (i = 0; i < N_ELEMS; i++)
+    {
+      switch (input)
+	{
+	case INPUT_RANDOM:
+	  elems[i].key = g_rand_int (rand) >> 1;
+	  break;
+	case INPUT_SORTED:
+	case INPUT_ONE_CHANGED:
+	  elems[i].key = i;
+	  break;
+	case INPUT_REVERSE:
+	  elems[i].key = N_ELEMS - i;
+	  break;
+	case INPUT_FEW_UNIQUE:
+	  elems[i].key = g_rand_int_range (rand, 0, 16);
+	  break;
+	default:
+	  g_assert_not_reached ();
+	}
+      elems[i].position = i;
+    }
+
+  if (input == INPUT_ONE_CHANGED)
+    {
+      i = g_rand_int_range (rand, 0, N_ELEMS);
+      elems[i].key = g_rand_int_range (rand, 0, N_ELEMS);
+    }
+}
+
+static void
+check (const Element *elems,
+       GSortFlags     flags)
+{
+  gint i;
+
+  for (i = 1; i < N_ELEMS; i++)
+    {
+      if (elems[i - 1].key > elems[i].key)
+	g_error ("elements %d and %d out of order", i - 1, i);
+      if (flags != G_SORT_DEFAULT && elems[i - 1].key == elems[i].key &&
+	  elems[i - 1].position > elems[i].position)
+	g_error ("equal elements %d and %d swapped", i - 1, i);
+    }
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  GTimer *timer = g_timer_new ();
+  Element *elems = g_new (Element, N_ELEMS);
+  guint m;
+  Input input;
+
+  g_thread_init (NULL);
+
+  printf ("%-12s", "ms (Mcmp)");
+  for (m = 0; m < G_N_ELEMENTS (modes); m++)
+    printf ("%16s", modes[m].name);
+  printf ("\n");
+
+  for (input = 0; input < N_INPUTS; input++)
+    {
+      printf ("%-12s", input_names[input]);
+      for (m = 0; m < G_N_ELEMENTS (modes); m++)
+	{
+	  gdouble t;
+
+	  g_rand_set_seed (rand, input);
+	  fill (elems, input, rand);
+
+	  n_compares = 0;
+	  g_timer_start (timer);
+	  g_sort_with_data (elems, N_ELEMS, sizeof (Element),
+			    compare_elements, NULL, modes[m].flags);
+	  t = g_timer_elapsed (timer, NULL);
+
+	  check (elems, modes[m].flags);
+	  printf ("%9.1f (%4.1f)", t * 1e3, n_compares / 1e6);
+	}
+      printf ("\n");
+    }
+
+  g_free (elems);
+  g_timer_destroy (timer);
+  g_rand_free (rand);
+
+  return 0;
+}
@@ -0,0 +1,216 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures tasks per second through a GAsyncQueue and a GThreadPool
+ * with 1 to 8 producer threads.
+ *
+ * The queue part has the producers push into one queue that a single
+ * consumer thread drains, once with g_async_queue_new() and once with
+ * g_async_queue_new_bounded(). The pool part has the producers hand
+ * tasks to a pool of 4 threads one at a time with
+ * g_thread_pool_push(), in batches with g_thread_pool_push_many(),
+ * and one at a time alternating between two priority lanes with
+ * g_thread_pool_push_with_priority().
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#define N_TASKS      400000
+#define BATCH_SIZE   64
+#define POOL_THREADS 4
+#define MAX_THREADS  8
+
+typedef enum
+{
+  PUSH_ONE,
+  PUSH_MANY,
+  PUSH_PRIORITY
+} PushMode;
+
+static GAsyncQueue *queue;
+static GThreadPool *pool;
+static PushMode push_mode;
+static guint tasks_per_producer;
+static gint tasks_done;
+
+static gpointer
+queue_producer (gpointer data)
+{
+  guint i;
+
+  /* NULL can't be pushed, so count from 1 */
+  for (i = 1; i <= tasks_per_producer; i++)
+    g_async_queue_push (queue, GUINT_TO_POINTER (i));
+
+  return NULL;
+}
+
+static gpointer
+queue_consumer (gpointer data)
+{
+  guint n_tasks = GPOINTER_TO_UINT (data);
+  guint i;
+
+  for (i = 0; i < n_tasks; i++)
+    g_async_queue_pop (queue);
+
+  return NULL;
+}
+
+static void
+pool_task (gpointer data,
+	   gpointer user_data)
+{
+  g_atomic_int_inc (&tasks_done);
+}
+
+static gpointer
+pool_producer (gpointer data)
+{
+  gpointer batch[BATCH_SIZE];
+  guint i, j;
+
+  switch (push_mode)
+    {
+    case PUSH_ONE:
+      for (i = 1; i <= tasks_per_producer; i++)
+	g_thread_pool_push (pool, GUINT_TO_POINTER (i), NULL);
+      break;
+    case PUSH_MANY:
+      for (i = 1; i <= tasks_per_producer; i += BATCH_SIZE)
+	{
+	  guint n = MIN (BATCH_SIZE, tasks_per_producer - i + 1);
+
+	  for (j = 0; j < n; j++)
+	    batch[j] = GUINT_TO_POINTER (i + j);
+	  g_thread_pool_push_many (pool, batch, n, NULL);
+	}
+      break;
+    case PUSH_PRIORITY:
+      for (i = 1; i <= tasks_per_producer; i++)
+	g_thread_pool_push_with_priority (pool, GUINT_TO_POINTER (i),
+					  i % 2 ? G_THREAD_PRIORITY_HIGH
+						: G_THREAD_PRIORITY_NORMAL,
+					  NULL);
+      break;
+    }
+
+  return NULL;
+}
+
+static gdouble
+run_producers (GThreadFunc producer,
+	       guint       n_producers)
+{
+  GThread *threads[MAX_THREADS];
+  GTimer *timer = g_timer_new ();
+  gdouble elapsed;
+  guint i;
+
+  for (i = 0; i < n_producers; i++)
+    threads[i] = g_thread_create (producer, NULL, TRUE, NULL);
+  for (i = 0; i < n_producers; i++)
+    g_thread_join (threads[i]);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed;
+}
+
+static gdouble
+run_queue (GAsyncQueue *new_queue,
+	   guint        n_producers)
+{
+  GThread *consumer;
+  gdouble elapsed;
+
+  queue = new_queue;
+  tasks_per_producer = N_TASKS / n_producers;
+  consumer = g_thread_create (queue_consumer,
+			      GUINT_TO_POINTER (tasks_per_producer * n_producers),
+			      TRUE, NULL);
+  elapsed = run_producers (queue_producer, n_producers);
+  g_thread_join (consumer);
+  g_async_queue_unref (queue);
+
+  return elapsed;
+}
+
+static gdouble
+run_pool (PushMode mode,
+	  guint    n_producers)
+{
+  GTimer *timer = g_timer_new ();
+  gdouble elapsed;
+
+  push_mode = mode;
+  tasks_per_producer = N_TASKS / n_producers;
+  tasks_done = 0;
+  pool = g_thread_pool_new (pool_task, NULL, POOL_THREADS, TRUE, NULL);
+
+  run_producers (pool_producer, n_producers);
+  /* wait for the pool to run the tasks that are still queued */
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  if (tasks_done != tasks_per_producer * n_producers)
+    g_error ("pool ran %d tasks instead of %u",
+	     tasks_done, tasks_per_producer * n_producers);
+
+  return elapsed;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  guint n_producers;
+
+  g_thread_init (NULL);
+
+  printf ("                          tasks/s (millions)\n");
+  printf ("producers  locked queue  bounded queue  pool push  push_many  priority\n");
+  for (n_producers = 1; n_producers <= MAX_THREADS; n_producers *= 2)
+    {
+      guint n_tasks = N_TASKS / n_producers * n_producers;
+      gdouble locked, bounded, one, many, priority;
+
+      locked = run_queue (g_async_queue_new (), n_producers);
+      bounded = run_queue (g_async_queue_new_bounded (1024), n_producers);
+      one = run_pool (PUSH_ONE, n_producers);
+      many = run_pool (PUSH_MANY, n_producers);
+      priority = run_pool (PUSH_PRIORITY, n_producers);
+
+      printf ("%9u  %12.2f  %13.2f  %9.2f  %9.2f  %8.2f\n", n_producers,
+	      n_tasks / locked / 1e6, n_tasks / bounded / 1e6,
+	      n_tasks / one / 1e6, n_tasks / many / 1e6,
+	      n_tasks / priority / 1e6);
+    }
+
+  return 0;
+}
@@ -0,0 +1,187 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Times a GTree of 1000000 integer keys: building it with
+ * g_tree_insert() in random order and with g_tree_build_sorted(),
+ * random lookups, and scans over short key ranges, once with a
+ * cursor from g_tree_lower_bound() and once with g_tree_foreach()
+ * from the first node, which is how a range had to be found before
+ * there were cursors.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+#define N_KEYS          1000000
+#define N_LOOKUPS       1000000
+#define N_SCANS         10000
+#define N_FOREACH_SCANS 100
+#define SCAN_LENGTH     100
+
+typedef struct
+{
+  gint low, high;
+  gint sum;
+} Range;
+
+static gint
+compare_ints (gconstpointer a,
+	      gconstpointer b)
+{
+  gint ia = GPOINTER_TO_INT (a);
+  gint ib = GPOINTER_TO_INT (b);
+
+  return ia < ib ? -1 : ia > ib;
+}
+
+static gboolean
+sum_range (gpointer key,
+	   gpointer value,
+	   gpointer data)
+{
+  Range *range = data;
+  gint k = GPOINTER_TO_INT (key);
+
+  if (k >= range->high)
+    return TRUE;
+  if (k >= range->low)
+    range->sum += k;
+
+  return FALSE;
+}
+
+static gdouble
+elapsed (GTimer *timer)
+{
+  gdouble t = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+
+  return t;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  GTimer *timer = g_timer_new ();
+  gpointer *keys = g_new (gpointer, N_KEYS);
+  gint *shuffled = g_new (gint, N_KEYS);
+  GTree *tree, *sorted_tree;
+  gint i, found;
+  gdouble t;
+
+  /* even keys, so that odd ones miss */
+  for (i = 0; i < N_KEYS; i++)
+    {
+      keys[i] = GINT_TO_POINTER (2 * i);
+      shuffled[i] = 2 * i;
+    }
+  for (i = N_KEYS - 1; i > 0; i--)
+    {
+      gint j = g_rand_int_range (rand, 0, i + 1);
+      gint tmp = shuffled[i];
+
+      shuffled[i] = shuffled[j];
+      shuffled[j] = tmp;
+    }
+
+  tree = g_tree_new (compare_ints);
+  elapsed (timer);
+  for (i = 0; i < N_KEYS; i++)
+    g_tree_insert (tree, GINT_TO_POINTER (shuffled[i]), NULL);
+  t = elapsed (timer);
+  printf ("insert %d keys in random order:     %8.1f ms\n", N_KEYS, t * 1e3);
+
+  sorted_tree = g_tree_new (compare_ints);
+  elapsed (timer);
+  g_tree_build_sorted (sorted_tree, keys, NULL, N_KEYS);
+  t = elapsed (timer);
+  printf ("g_tree_build_sorted %d keys:        %8.1f ms\n", N_KEYS, t * 1e3);
+
+  if (g_tree_nnodes (tree) != N_KEYS || g_tree_nnodes (sorted_tree) != N_KEYS)
+    g_error ("wrong number of nodes");
+  printf ("heights: inserted %d, built %d\n",
+	  g_tree_height (tree), g_tree_height (sorted_tree));
+
+  found = 0;
+  elapsed (timer);
+  for (i = 0; i < N_LOOKUPS; i++)
+    {
+      gint key = g_rand_int_range (rand, 0, 2 * N_KEYS);
+
+      if (g_tree_lookup_node (tree, GINT_TO_POINTER (key)))
+	found++;
+    }
+  t = elapsed (timer);
+  printf ("%d random lookups (%d hits): %8.1f ms, %.0f ns each\n",
+	  N_LOOKUPS, found, t * 1e3, t / N_LOOKUPS * 1e9);
+
+  elapsed (timer);
+  for (i = 0; i < N_SCANS; i++)
+    {
+      gint low = g_rand_int_range (rand, 0, 2 * N_KEYS);
+      GTreeNode *node = g_tree_lower_bound (tree, GINT_TO_POINTER (low));
+      gint sum = 0, n;
+
+      for (n = 0; node && n < SCAN_LENGTH; n++)
+	{
+	  sum += GPOINTER_TO_INT (g_tree_node_key (node));
+	  node = g_tree_node_next (node);
+	}
+      found += sum;
+    }
+  t = elapsed (timer);
+  printf ("%d range scans with a cursor:         %8.2f us each\n",
+	  N_SCANS, t / N_SCANS * 1e6);
+
+  elapsed (timer);
+  for (i = 0; i < N_FOREACH_SCANS; i++)
+    {
+      Range range;
+
+      range.low = g_rand_int_range (rand, 0, 2 * N_KEYS);
+      range.high = range.low + 2 * SCAN_LENGTH;
+      range.sum = 0;
+      g_tree_foreach (tree, sum_range, &range);
+      found += range.sum;
+    }
+  t = elapsed (timer);
+  printf ("%d range scans with g_tree_foreach:     %8.2f us each\n",
+	  N_FOREACH_SCANS, t / N_FOREACH_SCANS * 1e6);
+
+  elapsed (timer);
+  g_tree_destroy (tree);
+  g_tree_destroy (sorted_tree);
+  t = elapsed (timer);
+  printf ("destroy both trees:                      %8.1f ms\n", t * 1e3);
+
+  g_free (keys);
+  g_free (shuffled);
+  g_timer_destroy (timer);
+  g_rand_free (rand);
+
+  return 0;
+}
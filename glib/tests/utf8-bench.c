@@ -0,0 +1,176 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 2003 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* Measures the throughput of g_utf8_validate(), g_utf8_strlen(),
+ * g_utf8_pointer_to_offset() and g_utf8_offset_to_pointer() on 4 MB
+ * of text made of lines like chat messages: plain ASCII, western
+ * European text with many Latin-1 letters, CJK mixed with some ASCII,
+ * and ASCII that is invalid at the very end, so that validation has
+ * to scan all of it before it reports the error.
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#define TEXT_SIZE (4 * 1024 * 1024)
+#define N_ROUNDS  10
+
+static const gchar *ascii_words[] = {
+  "hello", "world", "the", "build", "is", "broken", "again", "anyone", "seen",
+  "my", "patch", "for", "the", "release", "notes", "?", "ok,"
+};
+
+static const gchar *latin1_words[] = {
+  "tr\xc3\xa8s", "d\xc3\xa9j\xc3\xa0", "\xc3\xbc" "ber", "Stra\xc3\x9f" "e",
+  "na\xc3\xafve", "caf\xc3\xa9", "a\xc3\xb1o", "gr\xc3\xb6\xc3\x9f" "er",
+  "\xc3\xa9t\xc3\xa9", "\xc3\xa0", "la", "ma\xc3\xb1" "ana",
+  "fu\xc3\x9f" "ball", "gar\xc3\xa7on", "\xc3\x98rsted", "und", "et"
+};
+
+static const gchar *cjk_words[] = {
+  "\xe4\xbb\x8a\xe6\x97\xa5\xe3\x81\xaf", "\xe5\xa4\xa9\xe6\xb0\x97",
+  "\xe3\x81\x8c\xe3\x81\x84\xe3\x81\x84",
+  "\xe3\x81\xa7\xe3\x81\x99\xe3\x81\xad", "\xe6\x88\x91\xe4\xbb\xac",
+  "\xe6\x98\x8e\xe5\xa4\xa9", "\xe8\xa7\x81",
+  "\xed\x95\x9c\xea\xb5\xad\xec\x96\xb4",
+  "\xec\x95\x88\xeb\x85\x95\xed\x95\x98\xec\x84\xb8\xec\x9a\x94", "ok", "lol",
+  "\xe7\x9a\x84", "\xe3\x83\x93\xe3\x83\xab\xe3\x83\x89", "\xe3\x81\x8c",
+  "\xe5\xa3\x8a\xe3\x82\x8c\xe3\x81\x9f"
+};
+
+static gchar *
+make_text (const gchar **words,
+	   guint         n_words,
+	   GRand        *rand)
+{
+  GString *text = g_string_sized_new (TEXT_SIZE + 256);
+
+  while (text->len < TEXT_SIZE)
+    {
+      guint line_length = g_rand_int_range (rand, 20, 120);
+      guint start = text->len;
+
+      g_string_append (text, "<nick> ");
+      while (text->len - start < line_length)
+	{
+	  g_string_append (text, words[g_rand_int_range (rand, 0, n_words)]);
+	  g_string_append_c (text, ' ');
+	}
+      g_string_append_c (text, '\n');
+    }
+
+  return g_string_free (text, FALSE);
+}
+
+static void
+run (const gchar *name,
+     const gchar *text)
+{
+  gsize length = strlen (text);
+  GTimer *timer = g_timer_new ();
+  const gchar *end;
+  gboolean valid;
+  glong n_chars = 0, offset = 0;
+  const gchar *p = NULL;
+  gdouble validate_time, strlen_time, to_offset_time, to_pointer_time;
+  gint i;
+
+  g_timer_start (timer);
+  for (i = 0; i < N_ROUNDS; i++)
+    valid = g_utf8_validate (text, length, &end);
+  validate_time = g_timer_elapsed (timer, NULL);
+
+  if (valid)
+    {
+      g_timer_start (timer);
+      for (i = 0; i < N_ROUNDS; i++)
+	n_chars = g_utf8_strlen (text, length);
+      strlen_time = g_timer_elapsed (timer, NULL);
+
+      g_timer_start (timer);
+      for (i = 0; i < N_ROUNDS; i++)
+	offset = g_utf8_pointer_to_offset (text, text + length);
+      to_offset_time = g_timer_elapsed (timer, NULL);
+
+      g_timer_start (timer);
+      for (i = 0; i < N_ROUNDS; i++)
+	p = g_utf8_offset_to_pointer (text, n_chars);
+      to_pointer_time = g_timer_elapsed (timer, NULL);
+
+      if (offset != n_chars || p != text + length)
+	g_error ("%s: offsets don't match the length", name);
+
+      printf ("%-8s %9.0f %9.0f %10.0f %11.0f\n", name,
+	      N_ROUNDS * length / validate_time / 1e6,
+	      N_ROUNDS * length / strlen_time / 1e6,
+	      N_ROUNDS * length / to_offset_time / 1e6,
+	      N_ROUNDS * length / to_pointer_time / 1e6);
+    }
+  else
+    {
+      if (end != text + length - 1)
+	g_error ("%s: error reported at %ld instead of %lu", name,
+		 (glong) (end - text), (gulong) (length - 1));
+
+      printf ("%-8s %9.0f %9s %10s %11s\n", name,
+	      N_ROUNDS * length / validate_time / 1e6, "-", "-", "-");
+    }
+
+  g_timer_destroy (timer);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  gchar *text;
+  gsize length;
+
+  printf ("MB/s     validate    strlen  to_offset  to_pointer\n");
+
+  text = make_text (ascii_words, G_N_ELEMENTS (ascii_words), rand);
+  run ("ASCII", text);
+
+  /* the invalid text is the ASCII text with a stray Latin-1 byte at
+   * the end
+   */
+  length = strlen (text);
+  text[length - 1] = '\xe9';
+  run ("invalid", text);
+  g_free (text);
+
+  text = make_text (latin1_words, G_N_ELEMENTS (latin1_words), rand);
+  run ("Latin-1", text);
+  g_free (text);
+
+  text = make_text (cjk_words, G_N_ELEMENTS (cjk_words), rand);
+  run ("CJK", text);
+  g_free (text);
+
+  g_rand_free (rand);
+
+  return 0;
+}
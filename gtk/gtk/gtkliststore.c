@@ -2106,7 +2106,8 @@ gtk_list_store_sort (GtkListStore *list_store)
       list = list->next;
     }
 
-  g_array_sort_with_data (sort_array, gtk_list_store_compare_func, list_store);
+  g_sort_with_data (sort_array->data, sort_array->len, sizeof (SortTuple),
+		    gtk_list_store_compare_func, list_store, G_SORT_ADAPTIVE);
 
   for (i = 0; i < list_store->length - 1; i++)
       g_array_index (sort_array, SortTuple, i).el->next =
@@ -1562,14 +1562,16 @@ gtk_tree_model_sort_sort_level (GtkTreeModelSort *tree_model_sort,
 	data.sort_data = tree_model_sort->default_sort_data;
       }
 
+  /* Levels are usually re-sorted after a few rows changed, which
+   * the adaptive sort handles in close to linear time. */
   if (data.sort_func == NO_SORT_FUNC)
-    g_array_sort_with_data (sort_array,
-			    gtk_tree_model_sort_offset_compare_func,
-			    &data);
+    g_sort_with_data (sort_array->data, sort_array->len, sizeof (SortTuple),
+		      gtk_tree_model_sort_offset_compare_func,
+		      &data, G_SORT_ADAPTIVE);
   else
-    g_array_sort_with_data (sort_array,
-			    gtk_tree_model_sort_compare_func,
-			    &data);
+    g_sort_with_data (sort_array->data, sort_array->len, sizeof (SortTuple),
+		      gtk_tree_model_sort_compare_func,
+		      &data, G_SORT_ADAPTIVE);
 
   gtk_tree_path_free (data.parent_path);
 
@@ -2575,7 +2575,8 @@ gtk_tree_store_sort_helper (GtkTreeStore *tree_store,
     }
 
   /* Sort the array */
-  g_array_sort_with_data (sort_array, gtk_tree_store_compare_func, tree_store);
+  g_sort_with_data (sort_array->data, sort_array->len, sizeof (SortTuple),
+		    gtk_tree_store_compare_func, tree_store, G_SORT_ADAPTIVE);
 
   for (i = 0; i < list_length - 1; i++)
     {
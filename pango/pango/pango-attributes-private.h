@@ -0,0 +1,46 @@
+/* Pango
+ * pango-attributes-private.h: Internal attribute list functions
+ *
+ * Copyright (C) 2000 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __PANGO_ATTRIBUTES_PRIVATE_H__
+#define __PANGO_ATTRIBUTES_PRIVATE_H__
+
+#include <pango/pango-attributes.h>
+
+G_BEGIN_DECLS
+
+typedef void (*PangoAttrDiffFunc) (gint     start,
+				   gint     end,
+				   gpointer data);
+
+void _pango_attr_list_diff (PangoAttrList     *old_list,
+			    PangoAttrList     *new_list,
+			    gint               pos,
+			    gint               remove,
+			    gint               add,
+			    PangoAttrDiffFunc  func,
+			    gpointer           data);
+
+void _pango_attr_iterator_seek (PangoAttrIterator *iterator,
+				gint               index);
+
+G_END_DECLS
+
+#endif /* __PANGO_ATTRIBUTES_PRIVATE_H__ */
@@ -23,19 +23,45 @@
 #include <string.h>
 
 #include "pango-attributes.h"
+#include "pango-attributes-private.h"
 #include "pango-utils.h"
 
 struct _PangoAttrList
 {
   guint ref_count;
-  GSList *attributes;
-  GSList *attributes_tail;
+
+  /* Attributes, sorted by start index, in the slots of @attributes
+   * from @first on. The slots before @first are free, so attributes
+   * can be added at the front without moving the rest, which is how
+   * pango_parse_markup() builds its lists.
+   */
+  GPtrArray *attributes;
+  guint first;
+
+  /* Maximum end index over ranges of slots: a binary tree in an
+   * array, with node 1 the root, node i having children 2i and
+   * 2i + 1 and the slots as the @max_end_size leaves. Kept up to
+   * date for changes that don't move attributes around; otherwise
+   * the leaves from @max_end_dirty to @max_end_dirty_end are
+   * refreshed when next needed.
+   */
+  guint *max_end;
+  guint max_end_size;
+  guint max_end_dirty;
+  guint max_end_dirty_end;
 };
 
+#define N_ATTRS(list) ((list)->attributes->len - (list)->first)
+#define ATTR(list, i) ((PangoAttribute *)g_ptr_array_index ((list)->attributes, (list)->first + (i)))
+
 struct _PangoAttrIterator
 {
-  GSList *next_attribute;
-  GList *attribute_stack;
+  PangoAttrList *list;
+  guint next_attribute;		/* position in list */
+
+  /* Attributes covering the current range, in the order they start */
+  GPtrArray *attribute_stack;
+  
   int start_index;
   int end_index;
 };
@@ -736,8 +762,12 @@ pango_attr_list_new (void)
   PangoAttrList *list = g_new (PangoAttrList, 1);
 
   list->ref_count = 1;
-  list->attributes = NULL;
-  list->attributes_tail = NULL;
+  list->attributes = g_ptr_array_new ();
+  list->first = 0;
+  list->max_end = NULL;
+  list->max_end_size = 0;
+  list->max_end_dirty = 0;
+  list->max_end_dirty_end = 0;
   
   return list;
 }
@@ -767,7 +797,7 @@ pango_attr_list_ref (PangoAttrList *list)
 void
 pango_attr_list_unref (PangoAttrList *list)
 {
-  GSList *tmp_list;
+  guint i;
   
   g_return_if_fail (list != NULL);
   g_return_if_fail (list->ref_count > 0);
@@ -775,16 +805,15 @@ pango_attr_list_unref (PangoAttrList *list)
   list->ref_count--;
   if (list->ref_count == 0)
     {
-      tmp_list = list->attributes;
-      while (tmp_list)
+      for (i = list->first; i < list->attributes->len; i++)
 	{
-	  PangoAttribute *attr = tmp_list->data;
-	  tmp_list = tmp_list->next;
+	  PangoAttribute *attr = g_ptr_array_index (list->attributes, i);
 
 	  attr->klass->destroy (attr);
 	}
 
-      g_slist_free (list->attributes);
+      g_ptr_array_free (list->attributes, TRUE);
+      g_free (list->max_end);
 
       g_free (list);
     }
@@ -802,80 +831,282 @@ PangoAttrList *
 pango_attr_list_copy (PangoAttrList *list)
 {
   PangoAttrList *new;
-  GSList *iter;
-  GSList *new_attrs;
+  guint i;
   
   g_return_val_if_fail (list != NULL, NULL);
 
   new = pango_attr_list_new ();
 
-  iter = list->attributes;
-  new_attrs = NULL;
-  while (iter != NULL)
+  g_ptr_array_set_size (new->attributes, N_ATTRS (list));
+  for (i = 0; i < N_ATTRS (list); i++)
+    new->attributes->pdata[i] = pango_attribute_copy (ATTR (list, i));
+  
+  return new;
+}
+
+/* Marks the leaves of the max_end tree for the slots in [@from, @to)
+ * as out of date
+ */
+static void
+pango_attr_list_invalidate_max_end (PangoAttrList *list,
+				    guint          from,
+				    guint          to)
+{
+  list->max_end_dirty = MIN (list->max_end_dirty, from);
+  list->max_end_dirty_end = MAX (list->max_end_dirty_end, to);
+}
+
+static guint
+pango_attr_list_slot_end (PangoAttrList *list,
+			  guint          slot)
+{
+  if (slot < list->first || slot >= list->attributes->len)
+    return 0;
+  else
+    return ((PangoAttribute *)list->attributes->pdata[slot])->end_index;
+}
+
+static void
+pango_attr_list_update_max_end (PangoAttrList *list)
+{
+  guint size = 1;
+  guint from, to, lo, hi;
+  guint i;
+
+  while (size < list->attributes->len)
+    size <<= 1;
+
+  if (size != list->max_end_size)
     {
-      new_attrs = g_slist_prepend (new_attrs,
-                                   pango_attribute_copy (iter->data));
+      g_free (list->max_end);
+      list->max_end = g_new (guint, 2 * size);
+      list->max_end_size = size;
+      from = 0;
+      to = size;
+    }
+  else if (list->max_end_dirty >= list->max_end_dirty_end)
+    return;
+  else
+    {
+      from = list->max_end_dirty;
+      to = MIN (list->max_end_dirty_end, size);
+    }
 
-      iter = g_slist_next (iter);
+  for (i = from; i < to; i++)
+    list->max_end[size + i] = pango_attr_list_slot_end (list, i);
+
+  /* Only the ancestors of the refreshed leaves need recomputing */
+  lo = size + from;
+  hi = size + to;
+  while (lo > 1)
+    {
+      lo /= 2;
+      hi = (hi + 1) / 2;
+      for (i = lo; i < hi; i++)
+	list->max_end[i] = MAX (list->max_end[2 * i], list->max_end[2 * i + 1]);
     }
 
-  /* we're going to reverse the nodes, so head becomes tail */
-  new->attributes_tail = new_attrs;
-  new->attributes = g_slist_reverse (new_attrs);
-  
-  return new;
+  list->max_end_dirty = G_MAXUINT;
+  list->max_end_dirty_end = 0;
 }
 
+/* Called when the end index of the attribute in @slot changed,
+ * or the slot was filled or emptied without moving others.
+ */
 static void
-pango_attr_list_insert_internal (PangoAttrList  *list,
-				 PangoAttribute *attr,
-				 gboolean        before)
+pango_attr_list_end_changed (PangoAttrList *list,
+			     guint          slot)
 {
-  GSList *tmp_list, *prev, *link;
-  gint start_index = attr->start_index;
+  guint i;
+  
+  if (slot >= list->max_end_dirty && slot < list->max_end_dirty_end)
+    return;
 
-  if (!list->attributes)
+  if (slot >= list->max_end_size)
     {
-      list->attributes = g_slist_prepend (NULL, attr);
-      list->attributes_tail = list->attributes;
+      pango_attr_list_invalidate_max_end (list, slot, slot + 1);
+      return;
     }
-  else if (((PangoAttribute *)list->attributes_tail->data)->start_index < start_index ||
-	   (!before && ((PangoAttribute *)list->attributes_tail->data)->start_index == start_index))
+
+  i = list->max_end_size + slot;
+  list->max_end[i] = pango_attr_list_slot_end (list, slot);
+  for (i /= 2; i > 0; i /= 2)
+    list->max_end[i] = MAX (list->max_end[2 * i], list->max_end[2 * i + 1]);
+}
+
+/* Opens up as many free slots before the attributes as there are
+ * attributes, so that adding at the front is amortized constant time.
+ */
+static void
+pango_attr_list_grow_front (PangoAttrList *list)
+{
+  GPtrArray *attributes = list->attributes;
+  guint n_attrs = N_ATTRS (list);
+  guint room = MAX (n_attrs, 4);
+
+  g_ptr_array_set_size (attributes, attributes->len + room);
+  g_memmove (attributes->pdata + list->first + room, attributes->pdata + list->first,
+	     n_attrs * sizeof (gpointer));
+  list->first += room;
+  pango_attr_list_invalidate_max_end (list, 0, attributes->len);
+}
+
+/* Inserts @attr at position @pos, moving whichever of the
+ * attributes before and after it are fewer.
+ */
+static void
+pango_attr_list_insert_at (PangoAttrList  *list,
+			   guint           pos,
+			   PangoAttribute *attr)
+{
+  GPtrArray *attributes = list->attributes;
+  guint n_attrs = N_ATTRS (list);
+
+  if (pos < n_attrs - pos)
     {
-      g_slist_append (list->attributes_tail, attr);
-      list->attributes_tail = list->attributes_tail->next;
-      g_assert (list->attributes_tail);
+      if (list->first == 0)
+	pango_attr_list_grow_front (list);
+
+      list->first--;
+      g_memmove (attributes->pdata + list->first, attributes->pdata + list->first + 1,
+		 pos * sizeof (gpointer));
+      attributes->pdata[list->first + pos] = attr;
+      if (pos == 0)
+	pango_attr_list_end_changed (list, list->first);
+      else
+	pango_attr_list_invalidate_max_end (list, list->first, list->first + pos + 1);
     }
   else
     {
-      prev = NULL;
-      tmp_list = list->attributes;
-      while (1)
+      g_ptr_array_add (attributes, attr);
+      if (pos < n_attrs)
 	{
-	  PangoAttribute *tmp_attr = tmp_list->data;
-	  
-	  if (tmp_attr->start_index > start_index ||
-	      (before && tmp_attr->start_index == start_index))
-	    {
-	      link = g_slist_alloc ();
-	      link->next = tmp_list;
-	      link->data = attr;
+	  g_memmove (attributes->pdata + list->first + pos + 1,
+		     attributes->pdata + list->first + pos,
+		     (n_attrs - pos) * sizeof (gpointer));
+	  attributes->pdata[list->first + pos] = attr;
+	  pango_attr_list_invalidate_max_end (list, list->first + pos, attributes->len);
+	}
+      else
+	pango_attr_list_end_changed (list, attributes->len - 1);
+    }
+}
 
-	      if (prev)
-		prev->next = link;
-	      else
-		list->attributes = link;
+static void
+pango_attr_list_remove_at (PangoAttrList *list,
+			   guint          pos)
+{
+  GPtrArray *attributes = list->attributes;
+  guint n_attrs = N_ATTRS (list);
 
-	      if (!tmp_list)
-		list->attributes_tail = link;
+  if (pos < n_attrs - 1 - pos)
+    {
+      g_memmove (attributes->pdata + list->first + 1, attributes->pdata + list->first,
+		 pos * sizeof (gpointer));
+      attributes->pdata[list->first] = NULL;
+      list->first++;
+      if (pos == 0)
+	pango_attr_list_end_changed (list, list->first - 1);
+      else
+	pango_attr_list_invalidate_max_end (list, list->first - 1, list->first + pos);
+    }
+  else
+    {
+      g_ptr_array_remove_index (attributes, list->first + pos);
+      if (pos == n_attrs - 1)
+	pango_attr_list_end_changed (list, attributes->len);
+      else
+	pango_attr_list_invalidate_max_end (list, list->first + pos, attributes->len + 1);
+    }
+}
 
-	      break;
-	    }
-	  
-	  prev = tmp_list;
-	  tmp_list = tmp_list->next;
-	}
+/* Returns the first slot in [@from, @to) with an attribute that
+ * ends at or after @index, or -1.
+ */
+static gint
+find_first_ending_after (guint *max_end,
+			 guint  node,
+			 guint  lo,
+			 guint  hi,
+			 guint  from,
+			 guint  to,
+			 guint  index)
+{
+  guint mid;
+  gint result;
+  
+  if (hi <= from || lo >= to || max_end[node] < index)
+    return -1;
+
+  if (hi - lo == 1)
+    return lo;
+
+  mid = (lo + hi) / 2;
+  result = find_first_ending_after (max_end, 2 * node, lo, mid, from, to, index);
+  if (result < 0)
+    result = find_first_ending_after (max_end, 2 * node + 1, mid, hi, from, to, index);
+
+  return result;
+}
+
+static gint
+pango_attr_list_find_first_ending_after (PangoAttrList *list,
+					 guint          from,
+					 guint          to,
+					 guint          index)
+{
+  gint slot;
+
+  if (from >= to)
+    return -1;
+
+  pango_attr_list_update_max_end (list);
+
+  slot = find_first_ending_after (list->max_end, 1, 0, list->max_end_size,
+				  list->first + from, list->first + to, index);
+
+  return slot < 0 ? -1 : slot - (gint)list->first;
+}
+
+/* Returns the position of the first attribute starting after
+ * @start_index, or at it when @before.
+ */
+static guint
+pango_attr_list_bsearch (PangoAttrList *list,
+			 guint          start_index,
+			 gboolean       before)
+{
+  guint lo = 0;
+  guint hi = N_ATTRS (list);
+
+  while (lo < hi)
+    {
+      guint mid = (lo + hi) / 2;
+      guint mid_start = ATTR (list, mid)->start_index;
+
+      if (mid_start > start_index || (before && mid_start == start_index))
+	hi = mid;
+      else
+	lo = mid + 1;
     }
+
+  return lo;
+}
+
+static void
+pango_attr_list_insert_internal (PangoAttrList  *list,
+				 PangoAttribute *attr,
+				 gboolean        before)
+{
+  guint len = N_ATTRS (list);
+  guint start_index = attr->start_index;
+
+  if (len == 0 ||
+      ATTR (list, len - 1)->start_index < start_index ||
+      (!before && ATTR (list, len - 1)->start_index == start_index))
+    pango_attr_list_insert_at (list, len, attr);
+  else
+    pango_attr_list_insert_at (list, pango_attr_list_bsearch (list, start_index, before), attr);
 }
 
 /**
@@ -938,9 +1169,10 @@ void
 pango_attr_list_change (PangoAttrList  *list,
 			PangoAttribute *attr)
 {
-  GSList *tmp_list, *prev, *link;
   gint start_index = attr->start_index;
   gint end_index = attr->end_index;
+  guint insert_pos;
+  guint pos, prev;
   
   g_return_if_fail (list != NULL);
 
@@ -950,38 +1182,31 @@ pango_attr_list_change (PangoAttrList  *list,
     return;
   }
 
-  tmp_list = list->attributes;
-  prev = NULL;
+  /* The attributes starting at or before ours come first; of those,
+   * only the ones reaching our start can overlap us.
+   */
+  insert_pos = pango_attr_list_bsearch (list, start_index, FALSE);
+  
+  pos = 0;
   while (1)
     {
       PangoAttribute *tmp_attr;
+      gint found;
 
-      if (!tmp_list ||
-	  ((PangoAttribute *)tmp_list->data)->start_index > start_index)
+      found = pango_attr_list_find_first_ending_after (list, pos, insert_pos, start_index);
+      if (found < 0)
 	{
 	  /* We need to insert a new attribute
 	   */
-	  link = g_slist_alloc ();
-	  link->next = tmp_list;
-	  link->data = attr;
-	  
-	  if (prev)
-	    prev->next = link;
-	  else
-	    list->attributes = link;
-	  
-	  if (!tmp_list)
-	    list->attributes_tail = link;
-	  
-	  prev = link;
-	  tmp_list = prev->next;
+	  pango_attr_list_insert_at (list, insert_pos, attr);
+	  prev = insert_pos;
 	  break;
 	}
 
-      tmp_attr = tmp_list->data;
+      pos = found;
+      tmp_attr = ATTR (list, pos);
 
-      if (tmp_attr->klass->type == attr->klass->type &&
-	  tmp_attr->end_index >= start_index)
+      if (tmp_attr->klass->type == attr->klass->type)
 	{
 	  /* We overlap with an existing attribute */
 	  if (pango_attribute_equal (tmp_attr, attr))
@@ -997,12 +1222,11 @@ pango_attr_list_change (PangoAttrList  *list,
 		  return;
 		}
 	      tmp_attr->end_index = end_index;
+	      pango_attr_list_end_changed (list, list->first + pos);
 	      pango_attribute_destroy (attr);
 	      
 	      attr = tmp_attr;
-	      
-	      prev = tmp_list;
-	      tmp_list = tmp_list->next;
+	      prev = pos;
 	      
 	      break;
 	    }
@@ -1014,6 +1238,7 @@ pango_attr_list_change (PangoAttrList  *list,
 		{
 		  PangoAttribute *end_attr = pango_attribute_copy (tmp_attr);
 
+		  /* This goes after all the attributes we look at */
 		  end_attr->start_index = attr->end_index;
 		  pango_attr_list_insert (list, end_attr);
 		}
@@ -1021,34 +1246,33 @@ pango_attr_list_change (PangoAttrList  *list,
 	      if (tmp_attr->start_index == attr->start_index)
 		{
 		  pango_attribute_destroy (tmp_attr);
-		  tmp_list->data = attr;
+		  list->attributes->pdata[list->first + pos] = attr;
+		  pango_attr_list_end_changed (list, list->first + pos);
 
-		  prev = tmp_list;
-		  tmp_list = tmp_list->next;
+		  prev = pos;
 		  break;
 		}
 	      else
 		{
 		  tmp_attr->end_index = attr->start_index;
+		  pango_attr_list_end_changed (list, list->first + pos);
 		}
 	    }
 	}
-      prev = tmp_list;
-      tmp_list = tmp_list->next;
+      pos++;
     }
-  /* At this point, prev points to the list node with attr in it,
-   * tmp_list points to prev->next.
+  /* At this point, prev is the position of attr in the list.
    */
 
-  g_assert (prev->data == attr);
-  g_assert (prev->next == tmp_list);
+  g_assert (ATTR (list, prev) == attr);
   
   /* We now have the range inserted into the list one way or the
    * other. Fix up the remainder
    */
-  while (tmp_list)
+  pos = prev + 1;
+  while (pos < N_ATTRS (list))
     {
-      PangoAttribute *tmp_attr = tmp_list->data;
+      PangoAttribute *tmp_attr = ATTR (list, pos);
 
       if (tmp_attr->start_index > end_index)
 	break;
@@ -1060,15 +1284,10 @@ pango_attr_list_change (PangoAttrList  *list,
 	      /* We can merge the new attribute with this attribute.
 	       */
 	      attr->end_index = MAX (end_index, tmp_attr->end_index);
+	      pango_attr_list_end_changed (list, list->first + prev);
 	      
 	      pango_attribute_destroy (tmp_attr);
-	      prev->next = tmp_list->next;
-
-	      if (!prev->next)
-		list->attributes_tail = prev;
-	      
-	      g_slist_free_1 (tmp_list);
-	      tmp_list = prev->next;
+	      pango_attr_list_remove_at (list, pos);
 
 	      continue;
 	    }
@@ -1079,48 +1298,33 @@ pango_attr_list_change (PangoAttrList  *list,
 	       * it in the list to maintain the required non-decreasing
 	       * order of start indices
 	       */
-	      GSList *tmp_list2;
-	      GSList *prev2;
+	      guint pos2;
 	      
 	      tmp_attr->start_index = attr->end_index;
 
-	      tmp_list2 = tmp_list->next;
-	      prev2 = tmp_list;
-
-	      while (tmp_list2)
-		{
-		  PangoAttribute *tmp_attr2 = tmp_list2->data;
-
-		  if (tmp_attr2->start_index >= tmp_attr->start_index)
-		    break;
-
-                  prev2 = tmp_list2;
-		  tmp_list2 = tmp_list2->next;
-		}
+	      pos2 = pos + 1;
+	      while (pos2 < N_ATTRS (list) &&
+		     ATTR (list, pos2)->start_index < tmp_attr->start_index)
+		pos2++;
 
-	      /* Now remove and insert before tmp_list2. We'll
-	       * hit this attribute again later, but that's harmless.
+	      /* Now move it before pos2. We'll hit this attribute again
+	       * later, but that's harmless.
 	       */
-	      if (prev2 != tmp_list)
+	      if (pos2 != pos + 1)
 		{
-		  GSList *old_next = tmp_list->next;
-		  
-		  prev->next = old_next;
-		  prev2->next = tmp_list;
-		  tmp_list->next = tmp_list2;
-
-		  if (!tmp_list->next)
-		    list->attributes_tail = tmp_list;
-
-		  tmp_list = old_next;
+		  g_memmove (list->attributes->pdata + list->first + pos,
+			     list->attributes->pdata + list->first + pos + 1,
+			     (pos2 - pos - 1) * sizeof (gpointer));
+		  list->attributes->pdata[list->first + pos2 - 1] = tmp_attr;
+		  pango_attr_list_invalidate_max_end (list, list->first + pos,
+						      list->first + pos2);
 
 		  continue;
 		}
 	    }
 	}
       
-      prev = tmp_list;
-      tmp_list = tmp_list->next;
+      pos++;
     }
 }
 
@@ -1148,17 +1352,16 @@ pango_attr_list_splice (PangoAttrList *list,
 			gint           pos,
 			gint           len)
 {
-  GSList *tmp_list;
+  guint i;
   
   g_return_if_fail (list != NULL);
   g_return_if_fail (other != NULL); 
   g_return_if_fail (pos >= 0);
   g_return_if_fail (len >= 0);
  
-  tmp_list = list->attributes;
-  while (tmp_list)
+  for (i = 0; i < N_ATTRS (list); i++)
     {
-      PangoAttribute *attr = tmp_list->data;
+      PangoAttribute *attr = ATTR (list, i);
 
       if (attr->start_index <= pos)
 	{
@@ -1170,20 +1373,16 @@ pango_attr_list_splice (PangoAttrList *list,
 	  attr->start_index += len;
 	  attr->end_index += len;
 	}
-
-      tmp_list = tmp_list->next;
     }
+  pango_attr_list_invalidate_max_end (list, 0, list->attributes->len);
 
-  tmp_list = other->attributes;
-  while (tmp_list)
+  for (i = 0; i < N_ATTRS (other); i++)
     {
-      PangoAttribute *attr = pango_attribute_copy (tmp_list->data);
+      PangoAttribute *attr = pango_attribute_copy (ATTR (other, i));
       attr->start_index += pos;
       attr->end_index += pos;
 
       pango_attr_list_change (list, attr);
-      
-      tmp_list = tmp_list->next;
     }
 }
 
@@ -1204,8 +1403,9 @@ pango_attr_list_get_iterator (PangoAttrList  *list)
   g_return_val_if_fail (list != NULL, NULL);
 
   iterator = g_new (PangoAttrIterator, 1);
-  iterator->next_attribute = list->attributes;
-  iterator->attribute_stack = NULL;
+  iterator->list = list;
+  iterator->next_attribute = 0;
+  iterator->attribute_stack = g_ptr_array_new ();
 
   iterator->start_index = 0;
   iterator->end_index = 0;
@@ -1248,49 +1448,132 @@ pango_attr_iterator_range (PangoAttrIterator *iterator,
 gboolean
 pango_attr_iterator_next (PangoAttrIterator *iterator)
 {
-  GList *tmp_list;
+  PangoAttrList *list;
+  GPtrArray *stack;
+  guint i, j;
 
   g_return_val_if_fail (iterator != NULL, FALSE);
 
-  if (!iterator->next_attribute && !iterator->attribute_stack)
+  list = iterator->list;
+  stack = iterator->attribute_stack;
+  
+  if (iterator->next_attribute >= N_ATTRS (list) && stack->len == 0)
     return FALSE;
 
   iterator->start_index = iterator->end_index;
   iterator->end_index = G_MAXINT;
   
-  tmp_list = iterator->attribute_stack;
-  while (tmp_list)
+  for (i = 0, j = 0; i < stack->len; i++)
     {
-      GList *next = tmp_list->next;
-      PangoAttribute *attr = tmp_list->data;
+      PangoAttribute *attr = stack->pdata[i];
 
-      if (attr->end_index == iterator->start_index)
-	{
-	  iterator->attribute_stack = g_list_remove_link (iterator->attribute_stack, tmp_list);
-	  g_list_free_1 (tmp_list);
-	}
-      else
+      if (attr->end_index != iterator->start_index)
 	{
 	  iterator->end_index = MIN (iterator->end_index, attr->end_index);
+	  stack->pdata[j++] = attr;
 	}
-      
-      tmp_list = next;
     }
+  g_ptr_array_set_size (stack, j);
 
-  while (iterator->next_attribute &&
-	 ((PangoAttribute *)iterator->next_attribute->data)->start_index == iterator->start_index)
+  while (iterator->next_attribute < N_ATTRS (list) &&
+	 ATTR (list, iterator->next_attribute)->start_index == iterator->start_index)
     {
-      iterator->attribute_stack = g_list_prepend (iterator->attribute_stack, iterator->next_attribute->data);
-      iterator->end_index = MIN (iterator->end_index, ((PangoAttribute *)iterator->next_attribute->data)->end_index);
-      iterator->next_attribute = iterator->next_attribute->next;
+      PangoAttribute *attr = ATTR (list, iterator->next_attribute);
+      
+      g_ptr_array_add (stack, attr);
+      iterator->end_index = MIN (iterator->end_index, attr->end_index);
+      iterator->next_attribute++;
     }
 
-  if (iterator->next_attribute)
-    iterator->end_index = MIN (iterator->end_index, ((PangoAttribute *)iterator->next_attribute->data)->start_index);
+  if (iterator->next_attribute < N_ATTRS (list))
+    iterator->end_index = MIN (iterator->end_index, ATTR (list, iterator->next_attribute)->start_index);
 
   return TRUE;
 }
 
+/* Adds the attributes in the slots before @to that end after @index
+ * to @stack in order, and sets @boundary to the largest end not after
+ * @index of the others.
+ */
+static void
+collect_covering (PangoAttrList *list,
+		  guint          node,
+		  guint          lo,
+		  guint          hi,
+		  guint          to,
+		  guint          index,
+		  guint         *boundary,
+		  GPtrArray     *stack)
+{
+  guint mid;
+  
+  if (lo >= to)
+    return;
+
+  if (list->max_end[node] <= index && hi <= to)
+    {
+      *boundary = MAX (*boundary, list->max_end[node]);
+      return;
+    }
+
+  if (hi - lo == 1)
+    {
+      PangoAttribute *attr = g_ptr_array_index (list->attributes, lo);
+
+      if (attr->end_index > index)
+	g_ptr_array_add (stack, attr);
+      else
+	*boundary = MAX (*boundary, attr->end_index);
+      return;
+    }
+
+  mid = (lo + hi) / 2;
+  collect_covering (list, 2 * node, lo, mid, to, index, boundary, stack);
+  collect_covering (list, 2 * node + 1, mid, hi, to, index, boundary, stack);
+}
+
+/* Moves @iterator to the range containing @index, as if
+ * pango_attr_iterator_next() had been called until it was reached,
+ * without visiting the ranges in between.
+ */
+void
+_pango_attr_iterator_seek (PangoAttrIterator *iterator,
+			   gint               index)
+{
+  PangoAttrList *list = iterator->list;
+  GPtrArray *stack = iterator->attribute_stack;
+  guint boundary = 0;
+  guint next;
+  guint i;
+
+  g_return_if_fail (index >= 0);
+  
+  if (iterator->start_index <= index && index < iterator->end_index)
+    return;
+
+  next = pango_attr_list_bsearch (list, index, FALSE);
+
+  g_ptr_array_set_size (stack, 0);
+  if (next > 0)
+    {
+      pango_attr_list_update_max_end (list);
+
+      collect_covering (list, 1, 0, list->max_end_size, list->first + next,
+			index, &boundary, stack);
+      boundary = MAX (boundary, ATTR (list, next - 1)->start_index);
+    }
+
+  iterator->next_attribute = next;
+  iterator->start_index = boundary;
+  iterator->end_index = G_MAXINT;
+
+  for (i = 0; i < stack->len; i++)
+    iterator->end_index = MIN (iterator->end_index, ((PangoAttribute *)stack->pdata[i])->end_index);
+  
+  if (next < N_ATTRS (list))
+    iterator->end_index = MIN (iterator->end_index, ATTR (list, next)->start_index);
+}
+
 /**
  * pango_attr_iterator_copy:
  * @iterator: a #PangoAttrIterator.
@@ -1303,6 +1586,7 @@ PangoAttrIterator *
 pango_attr_iterator_copy (PangoAttrIterator *iterator)
 {
   PangoAttrIterator *copy;
+  GPtrArray *stack;
 
   g_return_val_if_fail (iterator != NULL, NULL);
 
@@ -1310,7 +1594,10 @@ pango_attr_iterator_copy (PangoAttrIterator *iterator)
 
   *copy = *iterator;
 
-  copy->attribute_stack = g_list_copy (iterator->attribute_stack);
+  stack = iterator->attribute_stack;
+  copy->attribute_stack = g_ptr_array_sized_new (stack->len);
+  g_ptr_array_set_size (copy->attribute_stack, stack->len);
+  memcpy (copy->attribute_stack->pdata, stack->pdata, stack->len * sizeof (gpointer));
 
   return copy;
 }
@@ -1326,7 +1613,7 @@ pango_attr_iterator_destroy (PangoAttrIterator *iterator)
 {
   g_return_if_fail (iterator != NULL);
   
-  g_list_free (iterator->attribute_stack);
+  g_ptr_array_free (iterator->attribute_stack, TRUE);
   g_free (iterator);
 }
 
@@ -1348,24 +1635,26 @@ PangoAttribute *
 pango_attr_iterator_get (PangoAttrIterator *iterator,
 			 PangoAttrType      type)
 {
-  GList *tmp_list;
+  GPtrArray *stack;
+  guint i;
 
   g_return_val_if_fail (iterator != NULL, NULL);
 
-  tmp_list = iterator->attribute_stack;
-  while (tmp_list)
+  stack = iterator->attribute_stack;
+  for (i = stack->len; i > 0; i--)
     {
-      PangoAttribute *attr = tmp_list->data;
+      PangoAttribute *attr = stack->pdata[i - 1];
 
       if (attr->klass->type == type)
 	return attr;
-
-      tmp_list = tmp_list->next;
     }
 
   return NULL;
 }
 
+#define ALL_FONT_FIELDS (PANGO_FONT_MASK_FAMILY | PANGO_FONT_MASK_STYLE | PANGO_FONT_MASK_VARIANT | \
+			 PANGO_FONT_MASK_WEIGHT | PANGO_FONT_MASK_STRETCH | PANGO_FONT_MASK_SIZE)
+
 /**
  * pango_attr_iterator_get_font:
  * @iterator: a #PangoAttrIterator
@@ -1391,12 +1680,16 @@ pango_attr_iterator_get_font (PangoAttrIterator     *iterator,
 			      PangoLanguage        **language,
 			      GSList               **extra_attrs)
 {
-  GList *tmp_list1;
+  GPtrArray *stack;
   GSList *tmp_list2;
+  guint i;
 
   PangoFontMask mask = 0;
   gboolean have_language = FALSE;
 
+  /* Types of the built-in attributes already in @extra_attrs */
+  guint32 extra_types = 0;
+
   g_return_if_fail (iterator != NULL);
   g_return_if_fail (desc != NULL);
   
@@ -1406,11 +1699,14 @@ pango_attr_iterator_get_font (PangoAttrIterator     *iterator,
   if (extra_attrs)
     *extra_attrs = NULL;
   
-  tmp_list1 = iterator->attribute_stack;
-  while (tmp_list1)
+  stack = iterator->attribute_stack;
+  for (i = stack->len; i > 0; i--)
     {
-      PangoAttribute *attr = tmp_list1->data;
-      tmp_list1 = tmp_list1->next;
+      PangoAttribute *attr = stack->pdata[i - 1];
+
+      /* Nothing more can be set once all font fields are */
+      if (mask == ALL_FONT_FIELDS && (have_language || !language) && !extra_attrs)
+	break;
 
       switch (attr->klass->type)
 	{
@@ -1487,18 +1783,26 @@ pango_attr_iterator_get_font (PangoAttrIterator     *iterator,
 	  if (extra_attrs)
 	    {
 	      gboolean found = FALSE;
-	  
-	      tmp_list2 = *extra_attrs;
-	      while (tmp_list2)
+
+	      if (attr->klass->type < 32)
 		{
-		  PangoAttribute *old_attr = tmp_list2->data;
-		  if (attr->klass->type == old_attr->klass->type)
+		  found = (extra_types & (1U << attr->klass->type)) != 0;
+		  extra_types |= 1U << attr->klass->type;
+		}
+	      else
+		{
+		  tmp_list2 = *extra_attrs;
+		  while (tmp_list2)
 		    {
-		      found = TRUE;
-		      break;
+		      PangoAttribute *old_attr = tmp_list2->data;
+		      if (attr->klass->type == old_attr->klass->type)
+			{
+			  found = TRUE;
+			  break;
+			}
+
+		      tmp_list2 = tmp_list2->next;
 		    }
-
-		  tmp_list2 = tmp_list2->next;
 		}
 
 	      if (!found)
@@ -1508,6 +1812,139 @@ pango_attr_iterator_get_font (PangoAttrIterator     *iterator,
     }
 }
 
+static guint
+pango_attr_index_update (guint index,
+			 gint  pos,
+			 gint  remove,
+			 gint  add)
+{
+  if (index >= G_MAXINT || index <= pos)
+    return index;
+  else if (index >= pos + remove)
+    return index - remove + add;
+  else
+    return pos + add;
+}
+
+/**
+ * pango_attr_list_update:
+ * @list: a #PangoAttrList
+ * @pos: the byte position of the change
+ * @remove: the number of bytes removed at @pos
+ * @add: the number of bytes inserted at @pos
+ * 
+ * Moves the attributes in @list along with a change to the text they
+ * apply to: @remove bytes at @pos were replaced by @add new bytes.
+ * As with pango_attr_list_splice(), attributes that cover @pos are
+ * stretched over the new text. Attributes that only covered removed
+ * text are dropped from the list.
+ **/
+void
+pango_attr_list_update (PangoAttrList *list,
+			gint           pos,
+			gint           remove,
+			gint           add)
+{
+  guint i, j;
+
+  g_return_if_fail (list != NULL);
+  g_return_if_fail (pos >= 0);
+  g_return_if_fail (remove >= 0);
+  g_return_if_fail (add >= 0);
+
+  for (i = 0, j = 0; i < N_ATTRS (list); i++)
+    {
+      PangoAttribute *attr = ATTR (list, i);
+      gboolean was_empty = attr->start_index >= attr->end_index;
+
+      attr->start_index = pango_attr_index_update (attr->start_index, pos, remove, add);
+      attr->end_index = pango_attr_index_update (attr->end_index, pos, remove, add);
+
+      if (!was_empty && attr->start_index >= attr->end_index)
+	pango_attribute_destroy (attr);
+      else
+	list->attributes->pdata[list->first + j++] = attr;
+    }
+
+  pango_attr_list_invalidate_max_end (list, 0, list->attributes->len);
+  g_ptr_array_set_size (list->attributes, list->first + j);
+}
+
+/* Calls @func with the range of each attribute that is in only one
+ * of the lists. @old_list is taken to be from before @remove bytes at
+ * @pos were replaced by @add bytes, so its attributes are moved as
+ * pango_attr_list_update() would move them and all ranges are given
+ * in the indices of @new_list. Both lists are sorted by start index,
+ * so they are compared a start index at a time.
+ */
+void
+_pango_attr_list_diff (PangoAttrList     *old_list,
+		       PangoAttrList     *new_list,
+		       gint               pos,
+		       gint               remove,
+		       gint               add,
+		       PangoAttrDiffFunc  func,
+		       gpointer           data)
+{
+  guint old_i = 0;
+  guint new_i = 0;
+  guint old_len = N_ATTRS (old_list);
+  guint new_len = N_ATTRS (new_list);
+  GPtrArray *old_group = g_ptr_array_new ();
+  GPtrArray *new_group = g_ptr_array_new ();
+  guint i, j;
+
+  while (old_i < old_len || new_i < new_len)
+    {
+      guint start = G_MAXUINT;
+
+      if (old_i < old_len)
+	start = pango_attr_index_update (ATTR (old_list, old_i)->start_index, pos, remove, add);
+      if (new_i < new_len)
+	start = MIN (start, ATTR (new_list, new_i)->start_index);
+
+      g_ptr_array_set_size (old_group, 0);
+      while (old_i < old_len &&
+	     pango_attr_index_update (ATTR (old_list, old_i)->start_index, pos, remove, add) == start)
+	g_ptr_array_add (old_group, ATTR (old_list, old_i++));
+
+      g_ptr_array_set_size (new_group, 0);
+      while (new_i < new_len && ATTR (new_list, new_i)->start_index == start)
+	g_ptr_array_add (new_group, ATTR (new_list, new_i++));
+
+      for (i = 0; i < new_group->len; i++)
+	{
+	  PangoAttribute *attr = new_group->pdata[i];
+
+	  for (j = 0; j < old_group->len; j++)
+	    {
+	      PangoAttribute *old_attr = old_group->pdata[j];
+
+	      if (old_attr &&
+		  pango_attr_index_update (old_attr->end_index, pos, remove, add) == attr->end_index &&
+		  pango_attribute_equal (old_attr, attr))
+		break;
+	    }
+
+	  if (j < old_group->len)
+	    old_group->pdata[j] = NULL;
+	  else
+	    (*func) (attr->start_index, attr->end_index, data);
+	}
+
+      for (j = 0; j < old_group->len; j++)
+	{
+	  PangoAttribute *old_attr = old_group->pdata[j];
+
+	  if (old_attr)
+	    (*func) (start, pango_attr_index_update (old_attr->end_index, pos, remove, add), data);
+	}
+    }
+
+  g_ptr_array_free (old_group, TRUE);
+  g_ptr_array_free (new_group, TRUE);
+}
+
 /**
  * pango_attr_list_filter:
  * @list: a #PangoAttrList
@@ -1529,50 +1966,29 @@ pango_attr_list_filter (PangoAttrList       *list,
 
 {
   PangoAttrList *new = NULL;
-  GSList *tmp_list;
-  GSList *prev;
-  GSList *new_attrs;
+  guint i, j;
   
   g_return_val_if_fail (list != NULL, NULL);
 
-  tmp_list = list->attributes;
-  prev = NULL;
-  new_attrs = NULL;
-  while (tmp_list)
+  for (i = 0, j = 0; i < N_ATTRS (list); i++)
     {
-      GSList *next = tmp_list->next;
-      PangoAttribute *tmp_attr = tmp_list->data;
+      PangoAttribute *tmp_attr = ATTR (list, i);
 
       if ((*func) (tmp_attr, data))
 	{
-	  if (!tmp_list->next)
-	    list->attributes_tail = prev;
-	  
-	  if (prev)
-	    prev->next = tmp_list->next;
-	  else
-	    list->attributes = tmp_list->next;
-	  
-	  tmp_list->next = NULL;
-	  
 	  if (!new)
-	    {
-	      new = pango_attr_list_new ();
-	      new->attributes = new->attributes_tail = tmp_list;
-	    }
-	  else
-	    {
-	      new->attributes_tail->next = tmp_list;
-	      new->attributes_tail = tmp_list;
-	    }
+	    new = pango_attr_list_new ();
 
-	  goto next_attr;
+	  g_ptr_array_add (new->attributes, tmp_attr);
 	}
+      else
+	list->attributes->pdata[list->first + j++] = tmp_attr;
+    }
 
-      prev = tmp_list;
-
-    next_attr:
-      tmp_list = next;
+  if (new)
+    {
+      pango_attr_list_invalidate_max_end (list, 0, list->attributes->len);
+      g_ptr_array_set_size (list->attributes, list->first + j);
     }
 
   return new;
@@ -1593,11 +2009,12 @@ GSList *
 pango_attr_iterator_get_attrs (PangoAttrIterator *iterator)
 {
   GSList *attrs = NULL;
-  GList *tmp_list;
+  GPtrArray *stack = iterator->attribute_stack;
+  guint i;
 
-  for (tmp_list = iterator->attribute_stack; tmp_list; tmp_list = tmp_list->next)
+  for (i = stack->len; i > 0; i--)
     {
-      PangoAttribute *attr = tmp_list->data;
+      PangoAttribute *attr = stack->pdata[i - 1];
       GSList *tmp_list2;
       gboolean found = FALSE;
 
@@ -196,6 +196,10 @@ void               pango_attr_list_splice        (PangoAttrList  *list,
 						  PangoAttrList  *other,
 						  gint            pos,
 						  gint            len);
+void               pango_attr_list_update        (PangoAttrList  *list,
+						  gint            pos,
+						  gint            remove,
+						  gint            add);
 
 PangoAttrList *pango_attr_list_filter (PangoAttrList       *list,
 				       PangoAttrFilterFunc  func,
@@ -24,6 +24,7 @@
 
 #include "pango/pango-context.h"
 #include "pango/pango-utils.h"
+#include "pango-attributes-private.h"
 
 #include "pango-modules.h"
 
@@ -459,7 +460,10 @@ pango_itemize (PangoContext      *context,
 	  item->analysis.shape_engine = analysis->shape_engine;
 	  item->analysis.lang_engine = analysis->lang_engine;
 
+	  /* add_engines() only referenced the first font of each run */
 	  item->analysis.font = analysis->font;
+	  if (i > 0 && analysis->font && analysis->font == last_analysis->font)
+	    g_object_ref (analysis->font);
 	  item->analysis.language = analysis->language;
 
 	  /* Copy the extra attribute list if necessary */
@@ -480,8 +484,6 @@ pango_itemize (PangoContext      *context,
 
 	  result = g_list_prepend (result, item);
 	}
-      else
-	g_object_unref (analysis->font);
 
       item->length = (next - text) - item->offset;
       item->num_chars++;
@@ -563,10 +565,9 @@ advance_iterator_to (PangoAttrIterator *iterator,
   
   pango_attr_iterator_range (iterator, &start_range, &end_range);
 
-  while (start_index >= end_range)
+  if (start_index >= end_range)
     {
-      if (!pango_attr_iterator_next (iterator))
-        return FALSE;
+      _pango_attr_iterator_seek (iterator, start_index);
       pango_attr_iterator_range (iterator, &start_range, &end_range);
     }
 
@@ -577,6 +578,37 @@ advance_iterator_to (PangoAttrIterator *iterator,
   return TRUE;
 }
 
+/* The engines and font last found for characters in the current
+ * font set, so that a run of text from a small set of characters
+ * only goes through the font set and engine maps once per distinct
+ * character. Entries without a font are unused.
+ */
+#define ENGINE_CACHE_SIZE 64
+
+typedef struct _EngineCacheEntry EngineCacheEntry;
+
+struct _EngineCacheEntry
+{
+  gunichar wc;
+  PangoEngineLang *lang_engine;
+  PangoEngineShape *shape_engine;
+  PangoFont *font;
+};
+
+static void
+engine_cache_clear (EngineCacheEntry *cache)
+{
+  int i;
+  
+  for (i = 0; i < ENGINE_CACHE_SIZE; i++)
+    {
+      if (cache[i].font)
+	g_object_unref (cache[i].font);
+      
+      cache[i].font = NULL;
+    }
+}
+
 static void
 add_engines (PangoContext      *context,
 	     const gchar       *text,
@@ -596,9 +628,14 @@ add_engines (PangoContext      *context,
   PangoFontset *current_fonts = NULL;
   PangoAttrIterator *iterator;
   gboolean first_iteration = TRUE;
+  EngineCacheEntry engine_cache[ENGINE_CACHE_SIZE];
+  EngineCacheEntry *entry;
   gunichar wc;
   int i = 0;
 
+  for (i = 0; i < ENGINE_CACHE_SIZE; i++)
+    engine_cache[i].font = NULL;
+
   if (cached_iter)
     iterator = cached_iter;
   else
@@ -660,6 +697,7 @@ add_engines (PangoContext      *context,
 	      if (current_fonts)
 		g_object_unref (current_fonts);
 	      
+	      engine_cache_clear (engine_cache);
 	      current_fonts = pango_font_map_load_fontset (context->font_map,
 							   context,
 							   current_desc,
@@ -671,25 +709,43 @@ add_engines (PangoContext      *context,
 
       wc = g_utf8_get_char (pos);
       pos = g_utf8_next_char (pos);
+
+      entry = &engine_cache[wc % ENGINE_CACHE_SIZE];
+      if (!entry->font || entry->wc != wc)
+	{
+	  if (entry->font)
+	    g_object_unref (entry->font);
+	  
+	  entry->wc = wc;
+	  entry->lang_engine = (PangoEngineLang *)pango_map_get_engine (lang_map, wc);
+	  entry->font = pango_fontset_get_font (current_fonts, wc);
       
-      analysis->lang_engine = (PangoEngineLang *)pango_map_get_engine (lang_map, wc);
-      analysis->font = pango_fontset_get_font (current_fonts, wc);
-      analysis->language = language;
-      
-      /* FIXME: handle reference counting properly on the shapers */
-      if (analysis->font)
-	analysis->shape_engine = pango_font_find_shaper (analysis->font, language, wc);
-      else
-	analysis->shape_engine = NULL;
+	  /* FIXME: handle reference counting properly on the shapers */
+	  if (entry->font)
+	    entry->shape_engine = pango_font_find_shaper (entry->font, language, wc);
+	  else
+	    entry->shape_engine = NULL;
       
-      if (analysis->shape_engine == NULL)
-        analysis->shape_engine = &fallback_shaper;
+	  if (entry->shape_engine == NULL)
+	    entry->shape_engine = &fallback_shaper;
+	}
       
+      /* A run of characters in the same font shares one reference,
+       * held by its first character.
+       */
+      analysis->lang_engine = entry->lang_engine;
+      analysis->font = entry->font;
+      if (analysis->font && (i == 0 || analysis->font != analyses[i - 1].font))
+	g_object_ref (analysis->font);
+      analysis->language = language;
+      analysis->shape_engine = entry->shape_engine;
       analysis->extra_attrs = extra_attrs;
     }
 
   g_assert (pos - text == start_index + length);
 
+  engine_cache_clear (engine_cache);
+  
   if (current_desc)
     pango_font_description_free (current_desc);
   if (current_fonts)
@@ -190,6 +190,14 @@ struct _PangoFontsetSimple
   GPtrArray *fonts;
   GPtrArray *coverages;
   PangoLanguage *language;
+
+  /* Fonts chosen for the characters looked up so far, by blocks of
+   * 256 codepoints: wc / 256 => guint16[256] of the font index + 1,
+   * or 0 for characters not looked up yet.
+   */
+  GHashTable *font_cache;
+  guint16 *last_block;
+  guint last_block_index;
 };
 
 struct _PangoFontsetSimpleClass
@@ -266,6 +274,19 @@ pango_fontset_simple_init (PangoFontsetSimple *fontset)
   fontset->fonts = g_ptr_array_new ();
   fontset->coverages = g_ptr_array_new ();
   fontset->language = NULL;
+  fontset->font_cache = NULL;
+  fontset->last_block = NULL;
+}
+
+static void
+pango_fontset_simple_clear_cache (PangoFontsetSimple *fontset)
+{
+  if (fontset->font_cache)
+    {
+      g_hash_table_destroy (fontset->font_cache);
+      fontset->font_cache = NULL;
+    }
+  fontset->last_block = NULL;
 }
 
 static void
@@ -289,6 +310,8 @@ pango_fontset_simple_finalize (GObject *object)
   
   g_ptr_array_free (fontset->coverages, TRUE);
 
+  pango_fontset_simple_clear_cache (fontset);
+
   G_OBJECT_CLASS (simple_parent_class)->finalize (object);
 }
 
@@ -305,6 +328,8 @@ pango_fontset_simple_append (PangoFontsetSimple *fontset,
 {
   g_ptr_array_add (fontset->fonts, font);
   g_ptr_array_add (fontset->coverages, NULL);
+
+  pango_fontset_simple_clear_cache (fontset);
 }
 
 /**
@@ -341,11 +366,10 @@ pango_fontset_simple_get_metrics (PangoFontset  *fontset)
   return PANGO_FONTSET_CLASS (simple_parent_class)->get_metrics (fontset);
 }
 
-static PangoFont *
-pango_fontset_simple_get_font (PangoFontset  *fontset,
-			       guint          wc)
+static int
+pango_fontset_simple_find_font (PangoFontsetSimple *simple,
+				guint               wc)
 {
-  PangoFontsetSimple *simple = PANGO_FONTSET_SIMPLE (fontset);
   PangoCoverageLevel best_level = PANGO_COVERAGE_NONE;
   PangoCoverageLevel level;
   PangoFont *font;
@@ -376,6 +400,54 @@ pango_fontset_simple_get_font (PangoFontset  *fontset,
 	}
     }
 
+  return result;
+}
+
+static guint16 *
+pango_fontset_simple_get_cache_block (PangoFontsetSimple *simple,
+				      guint               block_index)
+{
+  guint16 *block;
+  
+  if (simple->last_block && simple->last_block_index == block_index)
+    return simple->last_block;
+
+  if (!simple->font_cache)
+    simple->font_cache = g_hash_table_new_full (g_direct_hash, NULL, NULL, g_free);
+
+  block = g_hash_table_lookup (simple->font_cache, GUINT_TO_POINTER (block_index));
+  if (!block)
+    {
+      block = g_new0 (guint16, 256);
+      g_hash_table_insert (simple->font_cache, GUINT_TO_POINTER (block_index), block);
+    }
+
+  simple->last_block = block;
+  simple->last_block_index = block_index;
+
+  return block;
+}
+
+static PangoFont *
+pango_fontset_simple_get_font (PangoFontset  *fontset,
+			       guint          wc)
+{
+  PangoFontsetSimple *simple = PANGO_FONTSET_SIMPLE (fontset);
+  PangoFont *font;
+  int result;
+
+  if (simple->fonts->len < G_MAXUSHORT)
+    {
+      guint16 *block = pango_fontset_simple_get_cache_block (simple, wc / 256);
+
+      if (block[wc % 256] == 0)
+	block[wc % 256] = pango_fontset_simple_find_font (simple, wc) + 1;
+
+      result = block[wc % 256] - 1;
+    }
+  else
+    result = pango_fontset_simple_find_font (simple, wc);
+
   font = g_ptr_array_index(simple->fonts, result);
   return g_object_ref (font);
 }
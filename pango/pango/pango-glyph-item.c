@@ -23,6 +23,7 @@
 #include <string.h>
 
 #include "pango-glyph-item.h"
+#include "pango-attributes-private.h"
 
 #define LTR(glyph_item) (((glyph_item)->item->analysis.level % 2) == 0)
 
@@ -310,14 +311,8 @@ pango_glyph_item_apply_attrs (PangoGlyphItem   *glyph_item,
   
   /* Advance the attr iterator to the start of the item
    */
-  while (TRUE)
-    {
-      pango_attr_iterator_range (iter, &range_start, &range_end);
-      if (range_end > state.cluster_end)
-	break;
-
-      pango_attr_iterator_next (iter);
-    }
+  _pango_attr_iterator_seek (iter, state.cluster_end);
+  pango_attr_iterator_range (iter, &range_start, &range_end);
 
   state.segment_attrs = pango_attr_iterator_get_attrs (iter);
   
@@ -127,6 +127,12 @@ void pango_shape (const gchar      *text,
 		  PangoAnalysis    *analysis,
 		  PangoGlyphString *glyphs);
 
+void pango_shape_cache_clear        (void);
+void pango_shape_cache_set_max_size (gsize  max_size);
+void pango_shape_cache_get_stats    (guint *hits,
+				     guint *misses,
+				     gsize *size);
+
 GList *pango_reorder_items (GList *logical_items);
 
 G_END_DECLS
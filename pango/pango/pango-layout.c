@@ -24,12 +24,15 @@
 #include <pango/pango-break.h>
 #include <pango/pango-item.h>
 #include <pango/pango-engine.h>
+#include "pango-attributes-private.h"
+#include <stdlib.h>
 #include <string.h>
 
-#define LINE_IS_VALID(line) ((line)->layout != NULL)
+#define LINE_IS_VALID(line) pango_layout_line_is_valid (line)
 #define PANGO_IS_LAYOUT(l) (1)
 
 typedef struct _Extents Extents;
+typedef struct _LineTable LineTable;
 
 struct _Extents
 {
@@ -37,15 +40,40 @@ struct _Extents
   int baseline;
   
   /* Line extents in layout coords */
-  PangoRectangle ink_rect;
   PangoRectangle logical_rect;
 };
 
+/* The lines of a layout in an array, with their extents, so lines
+ * can be found by index or position with a binary search. Built when
+ * first needed after the lines change, and shared with iterators.
+ */
+struct _LineTable
+{
+  guint ref_count;
+  
+  int n_lines;
+  PangoLayoutLine **lines;
+  Extents *extents;
+
+  /* Layout state the table was built for */
+  guint lines_stamp;
+  PangoAlignment alignment;
+  
+  /* Logical extents of the layout as pango_layout_get_extents()
+   * returns them, and the union of @extents, which differs only
+   * in x for aligned layouts without a width.
+   */
+  PangoRectangle logical_rect;
+  PangoRectangle lines_logical_rect;
+};
+
 struct _PangoLayoutIter
 {
   PangoLayout *layout;
   GSList *line_list_link;
   PangoLayoutLine *line;
+  int line_index;
+  guint lines_stamp;
 
   /* If run is NULL, it means we're on a "virtual run"
    * at the end of the line with 0 width
@@ -57,9 +85,8 @@ struct _PangoLayoutIter
   /* layout extents in layout coordinates */
   PangoRectangle logical_rect;
 
-  /* list of Extents for each line in layout coordinates */
-  GSList *line_extents;
-  GSList *line_extents_link;
+  /* Extents for each line in layout coordinates */
+  LineTable *line_table;
   
   /* X position of the current run */
   int run_x;
@@ -86,11 +113,40 @@ struct _PangoLayoutIter
 };
 
 typedef struct _PangoLayoutLinePrivate PangoLayoutLinePrivate;
+typedef struct _PangoLayoutPara PangoLayoutPara;
+typedef struct _PangoLayoutRange PangoLayoutRange;
 
 struct _PangoLayoutLinePrivate
 {
   PangoLayoutLine line;
   guint ref_count;
+
+  /* Logical extents, once computed; runs don't change after layout */
+  guint logical_rect_cached : 1;
+  PangoRectangle logical_rect;
+};
+
+/* A paragraph of the text and the lines it was broken into. These are
+ * kept along with the lines so that after a change to the text,
+ * attributes or width only the paragraphs affected need to be laid
+ * out again.
+ */
+struct _PangoLayoutPara
+{
+  int start_index;		/* byte index of the paragraph in the text */
+  int length;			/* length in bytes, including the delimiter */
+  int delim_len;		/* length of the paragraph delimiter in bytes */
+  int start_offset;		/* character offset of the paragraph */
+  int n_chars;			/* length in characters, including the delimiter */
+  int n_lines;			/* number of lines in layout->lines */
+  int width;			/* width of its only line, or -1 if it wrapped */
+  PangoLogAttr end_attr;	/* log attr for the position after the paragraph */
+};
+
+struct _PangoLayoutRange
+{
+  int start;
+  int end;
 };
 
 struct _PangoLayout
@@ -125,8 +181,31 @@ struct _PangoLayout
   PangoTabArray *tabs;
   
   GSList *lines;
+  int n_lines;
+  LineTable *line_table;
 
   PangoWrapMode wrap;
+
+  /* State the lines were built from, for incremental relayout */
+  GArray *paras;		/* PangoLayoutPara for each paragraph */
+  PangoAttrList *lines_attrs;	/* effective attributes, without no-shape ones */
+  PangoAttrList *lines_no_shape_attrs;
+  int lines_width;
+  int lines_tab_width;
+  guint lines_dirty : 1;	/* text, attributes or width changed since */
+  guint lines_stamp;		/* changed whenever lines may change */
+
+  /* Since the lines were built, @edit_remove bytes of text at @edit_pos
+   * were replaced by @edit_add bytes
+   */
+  int edit_pos;
+  int edit_remove;
+  int edit_add;
+
+  /* Lines replaced since pango_layout_get_changed_lines() was last called */
+  int changed_first_line;
+  int changed_n_removed;
+  int changed_n_added;
 };
 
 struct _PangoLayoutClass
@@ -138,6 +217,19 @@ struct _PangoLayoutClass
 
 static void pango_layout_clear_lines (PangoLayout *layout);
 static void pango_layout_check_lines (PangoLayout *layout);
+static void pango_layout_lines_changed (PangoLayout *layout);
+static void pango_layout_text_changed (PangoLayout *layout,
+				       int          pos,
+				       int          remove,
+				       int          add);
+static gboolean pango_layout_line_is_valid (PangoLayoutLine *line);
+static int pango_layout_index_to_offset (PangoLayout *layout,
+					 int          index);
+
+static LineTable *pango_layout_get_line_table (PangoLayout *layout);
+static void       line_table_unref            (LineTable   *table);
+static int        line_table_find_index       (LineTable   *table,
+					       int          index);
 
 static PangoAttrList *pango_layout_get_effective_attributes (PangoLayout *layout);
 
@@ -206,10 +298,25 @@ pango_layout_init (PangoLayout *layout)
 
   layout->log_attrs = NULL;
   layout->lines = NULL;
+  layout->n_lines = 0;
+  layout->line_table = NULL;
 
   layout->tab_width = -1;
 
   layout->wrap = PANGO_WRAP_WORD;
+
+  layout->paras = NULL;
+  layout->lines_attrs = NULL;
+  layout->lines_no_shape_attrs = NULL;
+  layout->lines_dirty = FALSE;
+  layout->lines_stamp = 0;
+  layout->edit_pos = 0;
+  layout->edit_remove = 0;
+  layout->edit_add = 0;
+
+  layout->changed_first_line = 0;
+  layout->changed_n_removed = 0;
+  layout->changed_n_added = 0;
 }
 
 static void
@@ -352,7 +459,7 @@ pango_layout_set_width (PangoLayout *layout,
   if (width != layout->width)
     {
       layout->width = width;
-      pango_layout_clear_lines (layout);
+      pango_layout_lines_changed (layout);
     }
 }
 
@@ -503,7 +610,7 @@ pango_layout_set_attributes (PangoLayout   *layout,
   layout->attrs = attrs;
   if (layout->attrs)
     pango_attr_list_ref (layout->attrs);
-  pango_layout_clear_lines (layout);
+  pango_layout_lines_changed (layout);
 
   if (old_attrs)
     pango_attr_list_unref (old_attrs);
@@ -707,13 +814,59 @@ pango_layout_get_single_paragraph_mode (PangoLayout *layout)
   return layout->single_paragraph;
 }
 
+/* Records the change from @old_text to the current text of @layout
+ * as a single replaced range, found by trimming the common prefix and
+ * suffix, so that only the paragraphs touching it are laid out again.
+ * The text a static layout pointed to may have changed under us, so
+ * in that case everything is laid out again.
+ */
+static void
+pango_layout_compare_text (PangoLayout *layout,
+			   const char  *old_text,
+			   int          old_length,
+			   gboolean     old_is_static)
+{
+  const char *new_text = layout->text;
+  int new_length = layout->length;
+  int prefix, suffix, max_suffix;
+
+  if (old_is_static || !old_text || !new_text || !layout->lines)
+    {
+      pango_layout_clear_lines (layout);
+      return;
+    }
+
+  prefix = 0;
+  while (prefix + 64 <= old_length && prefix + 64 <= new_length &&
+	 memcmp (old_text + prefix, new_text + prefix, 64) == 0)
+    prefix += 64;
+  while (prefix < old_length && prefix < new_length &&
+	 old_text[prefix] == new_text[prefix])
+    prefix++;
+
+  max_suffix = MIN (old_length, new_length) - prefix;
+  suffix = 0;
+  while (suffix + 64 <= max_suffix &&
+	 memcmp (old_text + old_length - suffix - 64,
+		 new_text + new_length - suffix - 64, 64) == 0)
+    suffix += 64;
+  while (suffix < max_suffix &&
+	 old_text[old_length - suffix - 1] == new_text[new_length - suffix - 1])
+    suffix++;
+
+  pango_layout_text_changed (layout, prefix,
+			     old_length - prefix - suffix,
+			     new_length - prefix - suffix);
+}
+
 void __fastcall
 pango_layout_set_text_static (PangoLayout *layout,
 		       const char  *text,
 		       int          length)
 {
-  if (layout->text && !layout->is_static)
-    g_free (layout->text);
+  char *old_text = layout->text;
+  int old_length = layout->length;
+  gboolean old_is_static = layout->is_static;
 
   layout->text = text;
   layout->length = length;
@@ -725,7 +878,10 @@ pango_layout_set_text_static (PangoLayout *layout,
 
   layout->is_static = TRUE;
 
-  pango_layout_clear_lines (layout);
+  pango_layout_compare_text (layout, old_text, old_length, old_is_static);
+
+  if (old_text && !old_is_static)
+    g_free (old_text);
 }
 
 /**
@@ -745,11 +901,15 @@ pango_layout_set_text (PangoLayout *layout,
 {
   const char *end;
   char *old_text;
+  int old_length;
+  gboolean old_is_static;
   
   g_return_if_fail (layout != NULL);
   g_return_if_fail (length == 0 || text != NULL);
 
   old_text = layout->text;
+  old_length = layout->length;
+  old_is_static = layout->is_static;
 
   if (length == -1)
     length = strlen (text);
@@ -770,13 +930,152 @@ pango_layout_set_text (PangoLayout *layout,
 
   layout->n_chars = g_utf8_strlen (layout->text, -1);
   layout->length = length;
+  layout->is_static = FALSE;
 
-  pango_layout_clear_lines (layout);
+  pango_layout_compare_text (layout, old_text, old_length, old_is_static);
 
-  if (old_text && !layout->is_static)
+  if (old_text && !old_is_static)
     g_free (old_text);
+}
 
-  layout->is_static = FALSE;
+/* Replaces @remove bytes at @index_ with @length bytes of @text,
+ * which must be valid UTF-8. Attributes after the change move with
+ * the text; see pango_attr_list_update().
+ */
+static void
+pango_layout_replace_text (PangoLayout *layout,
+			   int          index_,
+			   int          remove,
+			   const char  *text,
+			   int          length)
+{
+  int new_length;
+  
+  if (!layout->text)
+    pango_layout_set_text (layout, NULL, 0);
+
+  if (remove == 0 && length == 0)
+    return;
+
+  new_length = layout->length - remove + length;
+  if (length)
+    layout->n_chars += g_utf8_strlen (text, length);
+  if (remove)
+    layout->n_chars -= g_utf8_strlen (layout->text + index_, remove);
+
+  if (layout->is_static)
+    {
+      char *new_text = g_malloc (new_length + 1);
+
+      memcpy (new_text, layout->text, index_);
+      memcpy (new_text + index_, text, length);
+      memcpy (new_text + index_ + length, layout->text + index_ + remove,
+	      layout->length - index_ - remove);
+      new_text[new_length] = '\0';
+
+      layout->text = new_text;
+      layout->is_static = FALSE;
+      pango_layout_clear_lines (layout);
+    }
+  else
+    {
+      if (new_length > layout->length)
+	layout->text = g_realloc (layout->text, new_length + 1);
+      g_memmove (layout->text + index_ + length, layout->text + index_ + remove,
+		 layout->length - index_ - remove + 1);
+      memcpy (layout->text + index_, text, length);
+      
+      pango_layout_text_changed (layout, index_, remove, length);
+    }
+
+  layout->length = new_length;
+
+  if (layout->attrs)
+    {
+      PangoAttrList *attrs = pango_attr_list_copy (layout->attrs);
+
+      pango_attr_list_update (attrs, index_, remove, length);
+      pango_attr_list_unref (layout->attrs);
+      layout->attrs = attrs;
+      layout->tab_width = -1;
+    }
+}
+
+/**
+ * pango_layout_insert_text:
+ * @layout: a #PangoLayout
+ * @index_: byte index in the text of @layout to insert at
+ * @text: a UTF8-string
+ * @length: the length of @text, in bytes. -1 indicates that
+ *          the string is nul-terminated and the length should be
+ *          calculated.
+ * 
+ * Inserts @text into the text of the layout. Attributes after
+ * @index_ are moved along with the text, and ones spanning it
+ * grow to cover the new text. Unlike replacing the whole text
+ * with pango_layout_set_text(), only the paragraphs around the
+ * change will be laid out again.
+ **/
+void
+pango_layout_insert_text (PangoLayout *layout,
+			  int          index_,
+			  const char  *text,
+			  int          length)
+{
+  g_return_if_fail (layout != NULL);
+  g_return_if_fail (length == 0 || text != NULL);
+  g_return_if_fail (index_ >= 0 && index_ <= layout->length);
+
+  if (length == -1)
+    length = strlen (text);
+
+  pango_layout_replace_text (layout, index_, 0, text, length);
+}
+
+/**
+ * pango_layout_append_text:
+ * @layout: a #PangoLayout
+ * @text: a UTF8-string
+ * @length: the length of @text, in bytes. -1 indicates that
+ *          the string is nul-terminated and the length should be
+ *          calculated.
+ * 
+ * Adds @text to the end of the text of the layout; see
+ * pango_layout_insert_text().
+ **/
+void
+pango_layout_append_text (PangoLayout *layout,
+			  const char  *text,
+			  int          length)
+{
+  g_return_if_fail (layout != NULL);
+
+  pango_layout_insert_text (layout, layout->length, text, length);
+}
+
+/**
+ * pango_layout_delete_text:
+ * @layout: a #PangoLayout
+ * @index_: byte index of the first byte to delete
+ * @length: number of bytes to delete, or -1 to delete to the end
+ * 
+ * Removes part of the text of the layout. Attributes after
+ * the removed text are moved back, and ones lying entirely
+ * inside it are removed. As with pango_layout_insert_text(),
+ * only the paragraphs around the change will be laid out again.
+ **/
+void
+pango_layout_delete_text (PangoLayout *layout,
+			  int          index_,
+			  int          length)
+{
+  g_return_if_fail (layout != NULL);
+  g_return_if_fail (index_ >= 0 && index_ <= layout->length);
+
+  if (length < 0 || length > layout->length - index_)
+    length = layout->length - index_;
+
+  pango_layout_replace_text (layout, index_, length, NULL, 0);
 }
 
 /**
@@ -929,7 +1228,7 @@ pango_layout_get_line_count (PangoLayout   *layout)
   g_return_val_if_fail (layout != NULL, 0);
 
   pango_layout_check_lines (layout);
-  return g_slist_length (layout->lines);
+  return layout->n_lines;
 }
 
 /**
@@ -967,17 +1266,17 @@ PangoLayoutLine *
 pango_layout_get_line (PangoLayout *layout,
 		       int          line)
 {
-  GSList *list_item;
+  LineTable *table;
+  
   g_return_val_if_fail (layout != NULL, NULL);
   g_return_val_if_fail (line >= 0, NULL);
 
   if (line < 0)
     return NULL;
 
-  pango_layout_check_lines (layout);
-  list_item = g_slist_nth (layout->lines, line);
-  if (list_item)
-    return list_item->data;
+  table = pango_layout_get_line_table (layout);
+  if (line < table->n_lines)
+    return table->lines[line];
   return NULL;
 }
 
@@ -1021,7 +1320,7 @@ pango_layout_line_index_to_x (PangoLayoutLine  *line,
 	    }
 	  else
 	    {
-	      int offset = g_utf8_pointer_to_offset (layout->text, layout->text + index);
+	      int offset = pango_layout_index_to_offset (layout, index);
 	      if (trailing)
 		{
 		  while (index < line->start_index + line->length &&
@@ -1075,41 +1374,24 @@ pango_layout_index_to_line (PangoLayout      *layout,
 			    PangoLayoutLine **line_before,
 			    PangoLayoutLine **line_after)
 {
-  GSList *tmp_list;
-  GSList *line_list;
-  PangoLayoutLine *line = NULL;
-  PangoLayoutLine *prev_line = NULL;
-  int i = 0;
-  
-  line_list = tmp_list = layout->lines;
-  while (tmp_list)
-    {
-      PangoLayoutLine *tmp_line = tmp_list->data;
-
-      if (tmp_line && tmp_line->start_index > index)
-        break; /* index was in paragraph delimiters */
-
-      prev_line = line;
-      line = tmp_line;
-      line_list = tmp_list;
-      i++;
-
-      if (line->start_index + line->length > index)
-        break;
-      
-      tmp_list = tmp_list->next;
-    }
+  LineTable *table = pango_layout_get_line_table (layout);
+  int i;
 
+  /* The last line starting at or before @index; if @index is in
+   * paragraph delimiters, that's the line before them.
+   */
+  i = line_table_find_index (table, index);
+  
   if (line_nr)
-    *line_nr = i;
+    *line_nr = i + 1;
   
   if (line_before)
-    *line_before = prev_line;
+    *line_before = i > 0 ? table->lines[i - 1] : NULL;
   
   if (line_after)
-    *line_after = (line_list && line_list->next) ? line_list->next->data : NULL;
+    *line_after = i + 1 < table->n_lines ? table->lines[i + 1] : NULL;
 
-  return line;
+  return i >= 0 ? table->lines[i] : NULL;
 }
 
 static PangoLayoutLine *
@@ -1117,32 +1399,16 @@ pango_layout_index_to_line_and_extents (PangoLayout     *layout,
 					int              index,
 					PangoRectangle  *line_rect)
 {
-  PangoLayoutIter *iter;
-  PangoLayoutLine *line = NULL;
-  
-  iter = pango_layout_get_iter (layout);
-
-  while (TRUE)
-    {
-      PangoLayoutLine *tmp_line = pango_layout_iter_get_line (iter);
-
-      if (tmp_line && tmp_line->start_index > index)
-          break; /* index was in paragraph delimiters */
-
-      line = tmp_line;
-      
-      pango_layout_iter_get_line_extents (iter, NULL, line_rect);
-      
-      if (line->start_index + line->length > index)
-        break;
-
-      if (!pango_layout_iter_next_line (iter))
-	break; /* Use end of last line */
-    }
+  LineTable *table = pango_layout_get_line_table (layout);
+  int i;
 
-  pango_layout_iter_free (iter);
+  i = line_table_find_index (table, index);
+  if (i < 0)
+    return NULL;
 
-  return line;
+  *line_rect = table->extents[i].logical_rect;
+  
+  return table->lines[i];
 }
 
 /**
@@ -1275,7 +1541,7 @@ pango_layout_move_cursor_visually (PangoLayout *layout,
   line = pango_layout_index_to_line (layout, old_index,
 				     NULL, &prev_line, &next_line);
   
-  start_offset = g_utf8_pointer_to_offset (layout->text, layout->text + line->start_index);
+  start_offset = pango_layout_index_to_offset (layout, line->start_index);
 
   while (old_trailing--)
     old_index = g_utf8_next_char (layout->text + old_index) - layout->text;
@@ -1407,70 +1673,74 @@ pango_layout_xy_to_index (PangoLayout *layout,
 			  int         *index,
 			  gint        *trailing)
 {
-  PangoLayoutIter *iter;
-  PangoLayoutLine *prev_line = NULL;
-  PangoLayoutLine *found = NULL;
-  int found_line_x = 0;
-  int prev_first = 0;
-  int prev_last = 0;
-  int prev_line_x = 0;
+  LineTable *table;
+  PangoLayoutLine *found;
+  int found_line_x;
+  int lo, hi;
+  int half_spacing;
   gboolean retval = FALSE;
   gboolean outside = FALSE;
   
   g_return_val_if_fail (PANGO_IS_LAYOUT (layout), FALSE);
   
-  iter = pango_layout_get_iter (layout);
+  table = pango_layout_get_line_table (layout);
+  half_spacing = layout->spacing / 2;
   
-  do
+  /* Find the first line whose y range, including half the spacing
+   * below it, ends after @y; see pango_layout_iter_get_line_yrange().
+   */
+  lo = 0;
+  hi = table->n_lines;
+  while (lo < hi)
     {
-      PangoRectangle line_logical;
-      int first_y, last_y;
-      
-      pango_layout_iter_get_line_extents (iter, NULL, &line_logical);
-      pango_layout_iter_get_line_yrange (iter, &first_y, &last_y);
+      int mid = (lo + hi) / 2;
+      PangoRectangle *rect = &table->extents[mid].logical_rect;
+      int last_y = rect->y + rect->height;
 
-      if (y < first_y)
-        {
-          if (prev_line && y < (prev_last + (first_y - prev_last) / 2))
-            {
-              found = prev_line;
-              found_line_x = prev_line_x;
-            }
-          else
-            {
-              if (prev_line == NULL)
-                outside = TRUE; /* off the top */
-              
-              found = pango_layout_iter_get_line (iter);
-              found_line_x = x - line_logical.x;
-            }
-        }
-      else if (y >= first_y &&
-               y < last_y)
-        {
-          found = pango_layout_iter_get_line (iter);
-          found_line_x = x - line_logical.x;
-        }
-
-      prev_line = pango_layout_iter_get_line (iter);
-      prev_first = first_y;
-      prev_last = last_y;
-      prev_line_x = x - line_logical.x;
+      if (mid + 1 < table->n_lines)
+	last_y += half_spacing;
 
-      if (found != NULL)
-        break;
+      if (y < last_y)
+	hi = mid;
+      else
+	lo = mid + 1;
     }
-  while (pango_layout_iter_next_line (iter));
-  
-  pango_layout_iter_free (iter);
 
-  if (found == NULL)
+  if (lo == table->n_lines)
     {
       /* Off the bottom of the layout */
       outside = TRUE;
       
-      found = prev_line;
-      found_line_x = prev_line_x;
+      found = table->lines[lo - 1];
+      found_line_x = x - table->extents[lo - 1].logical_rect.x;
+    }
+  else
+    {
+      PangoRectangle *rect = &table->extents[lo].logical_rect;
+      int first_y = rect->y;
+
+      if (lo > 0)
+	first_y -= layout->spacing - half_spacing;
+      
+      found = table->lines[lo];
+      found_line_x = x - rect->x;
+
+      if (y < first_y)
+	{
+	  if (lo > 0)
+	    {
+	      PangoRectangle *prev_rect = &table->extents[lo - 1].logical_rect;
+	      int prev_last = prev_rect->y + prev_rect->height + half_spacing;
+
+	      if (y < (prev_last + (first_y - prev_last) / 2))
+		{
+		  found = table->lines[lo - 1];
+		  found_line_x = x - prev_rect->x;
+		}
+	    }
+	  else
+	    outside = TRUE; /* off the top */
+	}
     }
   
   retval = pango_layout_line_x_to_index (found,
@@ -1502,42 +1772,27 @@ pango_layout_index_to_pos (PangoLayout    *layout,
 			   PangoRectangle *pos)
 {
   PangoRectangle logical_rect;
-  PangoLayoutIter *iter;
   PangoLayoutLine *layout_line = NULL;
+  LineTable *table;
   int x_pos;
+  int i;
   
   g_return_if_fail (layout != NULL);
   g_return_if_fail (index >= 0);
   g_return_if_fail (pos != NULL);
   
-  iter = pango_layout_get_iter (layout);
+  table = pango_layout_get_line_table (layout);
+  i = line_table_find_index (table, index);
+  g_assert (i >= 0);
 
-  while (TRUE)
-    {
-      PangoLayoutLine *tmp_line = pango_layout_iter_get_line (iter);
-
-      if (tmp_line && tmp_line->start_index > index)
-        {
-          /* index is in the paragraph delimiters, move to
-           * end of previous line
-           */
-          index = layout_line->start_index + layout_line->length;
-          break;
-        }
+  layout_line = table->lines[i];
+  logical_rect = table->extents[i].logical_rect;
 
-      layout_line = tmp_line;
-      
-      pango_layout_iter_get_line_extents (iter, NULL, &logical_rect);
-      
-      if (layout_line->start_index + layout_line->length > index)
-        break;
-
-      if (!pango_layout_iter_next_line (iter))
-        {
-	  index = layout_line->start_index + layout_line->length;
-          break;
-        }
-    }
+  /* If index is in the paragraph delimiters or past the end,
+   * move to the end of the line
+   */
+  if (layout_line->start_index + layout_line->length <= index)
+    index = layout_line->start_index + layout_line->length;
 
   pos->y = logical_rect.y;
   pos->height = logical_rect.height;
@@ -1552,8 +1807,6 @@ pango_layout_index_to_pos (PangoLayout    *layout,
     }
   else
     pos->width = 0;
-  
-  pango_layout_iter_free (iter);
 }
 
 static void
@@ -1895,124 +2148,233 @@ get_line_extents_layout_coords (PangoLayout     *layout,
     *baseline = y_offset - line_logical.y;
 }
 
-/* if non-NULL line_extents returns a list of line extents
- * in layout coordinates
+static void
+line_table_unref (LineTable *table)
+{
+  int i;
+  
+  table->ref_count--;
+  if (table->ref_count > 0)
+    return;
+
+  for (i = 0; i < table->n_lines; i++)
+    pango_layout_line_unref (table->lines[i]);
+
+  g_free (table->lines);
+  g_free (table->extents);
+  g_free (table);
+}
+
+/* Returns the index in @table of the last line starting at or
+ * before @index, or -1 if there are no lines.
  */
+static int
+line_table_find_index (LineTable *table,
+		       int        index)
+{
+  int lo = 0;
+  int hi = table->n_lines;
+
+  while (lo < hi)
+    {
+      int mid = (lo + hi) / 2;
+
+      if (table->lines[mid]->start_index <= index)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  if (lo == 0 && table->n_lines > 0)
+    return 0;
+
+  return lo - 1;
+}
+
 static void
-pango_layout_get_extents_internal (PangoLayout    *layout,
-                                   PangoRectangle *ink_rect,
-                                   PangoRectangle *logical_rect,
-                                   GSList        **line_extents)
+rect_union_x (PangoRectangle *dest,
+	      PangoRectangle *src)
 {
+  int new_pos = MIN (dest->x, src->x);
+  
+  dest->width = MAX (dest->x + dest->width, src->x + src->width) - new_pos;
+  dest->x = new_pos;
+}
+
+static LineTable *
+pango_layout_get_line_table (PangoLayout *layout)
+{
+  LineTable *table;
   GSList *line_list;
   int y_offset = 0;
   int width;
+  int i;
   
-  g_return_if_fail (layout != NULL);
-
   pango_layout_check_lines (layout);
 
-  /* When we are not wrapping, we need the overall width of the layout to 
-   * figure out the x_offsets of each line. However, we only need the 
-   * x_offsets if we are computing the ink_rect or individual line extents.
+  table = layout->line_table;
+  if (table)
+    {
+      if (table->lines_stamp == layout->lines_stamp &&
+	  table->alignment == layout->alignment)
+	return table;
+
+      line_table_unref (table);
+      layout->line_table = NULL;
+    }
+
+  table = g_new (LineTable, 1);
+  table->ref_count = 1;
+  table->n_lines = g_slist_length (layout->lines);
+  table->lines = g_new (PangoLayoutLine *, table->n_lines);
+  table->extents = g_new (Extents, table->n_lines);
+  table->lines_stamp = layout->lines_stamp;
+  table->alignment = layout->alignment;
+  table->logical_rect.x = 0;
+  table->logical_rect.y = 0;
+  table->logical_rect.width = 0;
+  table->logical_rect.height = 0;
+
+  /* The first pass stores the extents in line coordinates and finds
+   * the size of the layout, which the x offsets depend on when not
+   * wrapping.
    */
+  for (line_list = layout->lines, i = 0; line_list; line_list = line_list->next, i++)
+    {
+      PangoLayoutLine *line = line_list->data;
+      PangoLayoutLinePrivate *private = (PangoLayoutLinePrivate *)line;
+      Extents *ext = &table->extents[i];
+      PangoRectangle line_logical_layout;
+      int x_offset;
+      
+      table->lines[i] = line;
+      pango_layout_line_ref (line);
+      
+      pango_layout_line_get_extents (line, NULL, &ext->logical_rect);
+
+      /* Lines without runs take their height from the attributes, which
+       * can change without the line being laid out again.
+       */
+      if (line->runs && ext->logical_rect.height != 0)
+	{
+	  private->logical_rect = ext->logical_rect;
+	  private->logical_rect_cached = TRUE;
+	}
+      
+      ext->baseline = y_offset - ext->logical_rect.y;
+
+      get_x_offset (layout, line, layout->width, ext->logical_rect.width, &x_offset);
+      line_logical_layout = ext->logical_rect;
+      line_logical_layout.x += x_offset;
+      line_logical_layout.y = y_offset;
+      
+      if (i == 0)
+	table->logical_rect = line_logical_layout;
+      else
+	{
+	  rect_union_x (&table->logical_rect, &line_logical_layout);
+	  table->logical_rect.height += line_logical_layout.height;
+	}
+
+      /* No space after the last line, of course. */
+      if (line_list->next != NULL)
+	table->logical_rect.height += layout->spacing;
+      
+      y_offset += line_logical_layout.height + layout->spacing;
+    }
+
   width = layout->width;
-  if (width == -1 && layout->alignment != PANGO_ALIGN_LEFT && (ink_rect || line_extents))
+  if (width == -1 && layout->alignment != PANGO_ALIGN_LEFT)
+    width = table->logical_rect.width;
+
+  for (i = 0; i < table->n_lines; i++)
     {
-      PangoRectangle overall_logical;
+      Extents *ext = &table->extents[i];
+      int x_offset;
+
+      get_x_offset (layout, table->lines[i], width, ext->logical_rect.width, &x_offset);
+      ext->logical_rect.x += x_offset;
+      ext->logical_rect.y = ext->baseline + ext->logical_rect.y;
       
-      pango_layout_get_extents (layout, NULL, &overall_logical);
-      width = overall_logical.width;
+      if (i == 0)
+	table->lines_logical_rect = ext->logical_rect;
+      else
+	{
+	  rect_union_x (&table->lines_logical_rect, &ext->logical_rect);
+	  table->lines_logical_rect.height = table->logical_rect.height;
+	}
     }
+
+  layout->line_table = table;
+  
+  return table;
+}
+
+static void
+pango_layout_get_extents_internal (PangoLayout    *layout,
+                                   PangoRectangle *ink_rect,
+                                   PangoRectangle *logical_rect)
+{
+  LineTable *table;
+  int width;
+  int i;
   
-  line_list = layout->lines;
-  while (line_list)
+  g_return_if_fail (layout != NULL);
+
+  table = pango_layout_get_line_table (layout);
+
+  if (!ink_rect)
+    {
+      if (logical_rect)
+	*logical_rect = table->logical_rect;
+      return;
+    }
+
+  /* When we are not wrapping, we need the overall width of the layout to 
+   * figure out the x_offsets of each line.
+   */
+  width = layout->width;
+  if (width == -1 && layout->alignment != PANGO_ALIGN_LEFT)
+    width = table->logical_rect.width;
+
+  for (i = 0; i < table->n_lines; i++)
     {
-      PangoLayoutLine *line = line_list->data;
       /* Line extents in layout coords (origin at 0,0 of the layout) */
       PangoRectangle line_ink_layout;
-      PangoRectangle line_logical_layout;
-      
       int new_pos;
 
-      /* This block gets the line extents in layout coords */
-      {
-        int baseline;
-        
-        get_line_extents_layout_coords (layout, line,
-                                        width, y_offset,
-                                        &baseline,
-                                        ink_rect ? &line_ink_layout : NULL,
-                                        &line_logical_layout);
-        
-        if (line_extents)
-          {
-            Extents *ext = g_new (Extents, 1);
-            ext->baseline = baseline;
-            ext->ink_rect = line_ink_layout;
-            ext->logical_rect = line_logical_layout;
-            *line_extents = g_slist_prepend (*line_extents, ext);
-          }
-      }
+      get_line_extents_layout_coords (layout, table->lines[i],
+				      width, table->extents[i].logical_rect.y,
+				      NULL, &line_ink_layout, NULL);
       
-      if (ink_rect)
+      /* Compute the union of the current ink_rect with
+       * line_ink_layout
+       */
+      if (i == 0)
 	{
-          /* Compute the union of the current ink_rect with
-           * line_ink_layout
-           */
-          
-	  if (line_list == layout->lines)
-	    {
-              *ink_rect = line_ink_layout;
-	    }
-	  else
-	    {
-	      new_pos = MIN (ink_rect->x, line_ink_layout.x);
-	      ink_rect->width =
-                MAX (ink_rect->x + ink_rect->width,
-                     line_ink_layout.x + line_ink_layout.width) - new_pos;
-	      ink_rect->x = new_pos;
-
-	      new_pos = MIN (ink_rect->y, line_ink_layout.y);
-	      ink_rect->height =
-                MAX (ink_rect->y + ink_rect->height,
-                     line_ink_layout.y + line_ink_layout.height) - new_pos;
-	      ink_rect->y = new_pos;
-            }
+	  *ink_rect = line_ink_layout;
 	}
-
-      if (logical_rect)
+      else
 	{
-          /* Compute union of line_logical_layout with
-           * current logical_rect
-           */
-          
-	  if (line_list == layout->lines)
-	    {
-              *logical_rect = line_logical_layout;
-	    }
-	  else
-	    {
-	      new_pos = MIN (logical_rect->x, line_logical_layout.x);
-	      logical_rect->width =
-                MAX (logical_rect->x + logical_rect->width,
-                     line_logical_layout.x + line_logical_layout.width) - new_pos;
-	      logical_rect->x = new_pos;
-
-	      logical_rect->height += line_logical_layout.height;
-	    }
+	  new_pos = MIN (ink_rect->x, line_ink_layout.x);
+	  ink_rect->width =
+	    MAX (ink_rect->x + ink_rect->width,
+		 line_ink_layout.x + line_ink_layout.width) - new_pos;
+	  ink_rect->x = new_pos;
 
-          /* No space after the last line, of course. */
-          if (line_list->next != NULL)
-            logical_rect->height += layout->spacing;
+	  new_pos = MIN (ink_rect->y, line_ink_layout.y);
+	  ink_rect->height =
+	    MAX (ink_rect->y + ink_rect->height,
+		 line_ink_layout.y + line_ink_layout.height) - new_pos;
+	  ink_rect->y = new_pos;
 	}
-      
-      y_offset += line_logical_layout.height + layout->spacing;
-      line_list = line_list->next;
     }
 
-  if (line_extents)
-    *line_extents = g_slist_reverse (*line_extents);
+  /* The logical extents are unioned with the same x offsets as the
+   * ink extents here.
+   */
+  if (logical_rect)
+    *logical_rect = table->lines_logical_rect;
 }
 
 /**
@@ -2035,7 +2397,7 @@ pango_layout_get_extents (PangoLayout    *layout,
 {	  
   g_return_if_fail (layout != NULL);
 
-  pango_layout_get_extents_internal (layout, ink_rect, logical_rect, NULL);
+  pango_layout_get_extents_internal (layout, ink_rect, logical_rect);
 }
 
 /**
@@ -2133,6 +2495,12 @@ pango_layout_get_pixel_size (PangoLayout *layout,
 static void
 pango_layout_clear_lines (PangoLayout *layout)
 {
+  if (layout->line_table)
+    {
+      line_table_unref (layout->line_table);
+      layout->line_table = NULL;
+    }
+
   if (layout->lines)
     {
       GSList *tmp_list = layout->lines;
@@ -2148,15 +2516,127 @@ pango_layout_clear_lines (PangoLayout *layout)
       g_slist_free (layout->lines);
       layout->lines = NULL;
 
-      /* This could be handled separately, since we don't need to
-       * recompute log_attrs on a width change, but this is easiest
-       */
       g_free (layout->log_attrs);
       layout->log_attrs = NULL;
     }
+
+  if (layout->paras)
+    {
+      g_array_free (layout->paras, TRUE);
+      layout->paras = NULL;
+    }
+
+  if (layout->lines_attrs)
+    {
+      pango_attr_list_unref (layout->lines_attrs);
+      layout->lines_attrs = NULL;
+    }
+  if (layout->lines_no_shape_attrs)
+    {
+      pango_attr_list_unref (layout->lines_no_shape_attrs);
+      layout->lines_no_shape_attrs = NULL;
+    }
+
+  layout->lines_dirty = FALSE;
+  layout->lines_stamp++;
+  layout->edit_pos = 0;
+  layout->edit_remove = 0;
+  layout->edit_add = 0;
+}
+
+/* Called when the attributes or width change; the lines are kept so
+ * pango_layout_check_lines() can reuse the paragraphs not affected.
+ */
+static void
+pango_layout_lines_changed (PangoLayout *layout)
+{
+  if (layout->lines)
+    {
+      layout->lines_dirty = TRUE;
+      layout->lines_stamp++;
+    }
+}
+
+/* Records that @remove bytes of text at @pos were replaced by @add
+ * bytes, combining it with any change made since the lines were built.
+ */
+static void
+pango_layout_text_changed (PangoLayout *layout,
+			   int          pos,
+			   int          remove,
+			   int          add)
+{
+  if (!layout->lines || (remove == 0 && add == 0))
+    return;
+
+  if (layout->edit_remove == 0 && layout->edit_add == 0)
+    {
+      layout->edit_pos = pos;
+      layout->edit_remove = remove;
+      layout->edit_add = add;
+    }
+  else
+    {
+      /* Both changes, in terms of the current text, are covered by
+       * the range from the first start to the last end.
+       */
+      int new_pos = MIN (layout->edit_pos, pos);
+      int end = MAX (layout->edit_pos + layout->edit_add, pos + remove);
+
+      layout->edit_remove = end - layout->edit_add + layout->edit_remove - new_pos;
+      layout->edit_add = end + add - remove - new_pos;
+      layout->edit_pos = new_pos;
+    }
+
+  layout->lines_dirty = TRUE;
+  layout->lines_stamp++;
+}
+
+static gboolean
+pango_layout_line_is_valid (PangoLayoutLine *line)
+{
+  if (line->layout == NULL)
+    return FALSE;
+
+  /* Lines that were kept get laid out again in place */
+  if (line->layout->lines_dirty)
+    pango_layout_check_lines (line->layout);
+
+  return line->layout != NULL;
+}
+
+/* Converts a byte index in the text into a character offset, using
+ * the paragraph table so only the paragraph containing @index is
+ * scanned.
+ */
+static int
+pango_layout_index_to_offset (PangoLayout *layout,
+			      int          index)
+{
+  PangoLayoutPara *para;
+  int lo, hi;
+
+  if (!layout->paras || layout->paras->len == 0 || layout->lines_dirty)
+    return g_utf8_pointer_to_offset (layout->text, layout->text + index);
+
+  lo = 0;
+  hi = layout->paras->len;
+  while (hi - lo > 1)
+    {
+      int mid = (lo + hi) / 2;
+
+      if (g_array_index (layout->paras, PangoLayoutPara, mid).start_index <= index)
+	lo = mid;
+      else
+	hi = mid;
+    }
+
+  para = &g_array_index (layout->paras, PangoLayoutPara, lo);
+  
+  return para->start_offset +
+    g_utf8_pointer_to_offset (layout->text + para->start_index, layout->text + index);
 }
 
-
 /************************************************
  * Some functions for handling PANGO_ATTR_SHAPE *
  ************************************************/
@@ -2882,7 +3362,7 @@ pango_layout_get_effective_attributes (PangoLayout *layout)
     {
       PangoAttribute *attr = pango_attr_font_desc_new (layout->font_desc);
       attr->start_index = 0;
-      attr->end_index = layout->length;
+      attr->end_index = G_MAXINT;
 	  
       pango_attr_list_insert_before (attrs, attr);
     }
@@ -2921,11 +3401,13 @@ filter_no_shape_attributes (PangoAttrList *attrs)
 
 static void
 apply_no_shape_attributes (PangoLayout   *layout,
+			   GSList        *lines,
+			   int            n_lines,
 			   PangoAttrList *no_shape_attrs)
 {
   GSList *line_list;
 
-  for (line_list = layout->lines; line_list; line_list = line_list->next)
+  for (line_list = lines; n_lines > 0; line_list = line_list->next, n_lines--)
     {
       PangoLayoutLine *line = line_list->data;
       GSList *old_runs = g_slist_reverse (line->runs);
@@ -2948,6 +3430,174 @@ apply_no_shape_attributes (PangoLayout   *layout,
     }
 }
 
+static void
+add_dirty_range (gint     start,
+		 gint     end,
+		 gpointer data)
+{
+  GArray *ranges = data;
+  PangoLayoutRange range;
+
+  range.start = start;
+  range.end = end;
+  g_array_append_val (ranges, range);
+}
+
+static int
+compare_ranges (gconstpointer a,
+		gconstpointer b)
+{
+  const PangoLayoutRange *range_a = a;
+  const PangoLayoutRange *range_b = b;
+
+  if (range_a->start != range_b->start)
+    return range_a->start < range_b->start ? -1 : 1;
+  else
+    return 0;
+}
+
+/* Collects the ranges of text where @new_list differs from @old_list
+ * once the edit recorded in @layout is applied to it, sorted and with
+ * overlapping ranges merged. Either list may be %NULL, meaning empty.
+ */
+static void
+get_dirty_ranges (PangoLayout   *layout,
+		  PangoAttrList *old_list,
+		  PangoAttrList *new_list,
+		  GArray        *ranges)
+{
+  PangoAttrList *empty = NULL;
+  
+  if (!old_list && !new_list)
+    return;
+
+  if (!old_list || !new_list)
+    empty = pango_attr_list_new ();
+
+  _pango_attr_list_diff (old_list ? old_list : empty,
+			 new_list ? new_list : empty,
+			 layout->edit_pos, layout->edit_remove, layout->edit_add,
+			 add_dirty_range, ranges);
+
+  if (empty)
+    pango_attr_list_unref (empty);
+}
+
+static void
+merge_ranges (GArray *ranges)
+{
+  guint i, n;
+
+  if (ranges->len < 2)
+    return;
+
+  qsort (ranges->data, ranges->len, sizeof (PangoLayoutRange), compare_ranges);
+
+  n = 0;
+  for (i = 1; i < ranges->len; i++)
+    {
+      PangoLayoutRange *last = &g_array_index (ranges, PangoLayoutRange, n);
+      PangoLayoutRange *range = &g_array_index (ranges, PangoLayoutRange, i);
+
+      if (range->start <= last->end)
+	last->end = MAX (last->end, range->end);
+      else
+	g_array_index (ranges, PangoLayoutRange, ++n) = *range;
+    }
+  g_array_set_size (ranges, n + 1);
+}
+
+/* Maps the start of a paragraph in the text the lines were built for
+ * to the current text. Text inserted right at the start of a paragraph
+ * goes before it; anything starting in replaced text maps to the end
+ * of the replacement.
+ */
+static int
+map_old_para_start (PangoLayout *layout,
+		    int          index)
+{
+  if (index < layout->edit_pos)
+    return index;
+  else if (index >= layout->edit_pos + layout->edit_remove)
+    return index - layout->edit_remove + layout->edit_add;
+  else
+    return layout->edit_pos + layout->edit_add;
+}
+
+/* Whether the lines of an old paragraph, now starting at @start_index,
+ * are still what laying it out again would produce.
+ */
+static gboolean
+para_can_be_reused (PangoLayout     *layout,
+		    PangoLayoutPara *para,
+		    int              start_index,
+		    GArray          *ranges,
+		    guint           *range_i)
+{
+  int para_end = para->start_index + para->length;
+  int edit_pos = layout->edit_pos;
+  
+  if (map_old_para_start (layout, para->start_index) != start_index)
+    return FALSE;
+
+  /* The text of the paragraph must not have changed; a paragraph
+   * ending right at the change is only safe if its delimiter can't
+   * merge with what was inserted, as '\r' can with '\n'.
+   */
+  if (!(para->start_index >= edit_pos + layout->edit_remove ||
+	para_end < edit_pos ||
+	(para_end == edit_pos && para->delim_len > 0 &&
+	 !(para->delim_len == 1 && layout->text[para_end - 1] == '\r'))))
+    return FALSE;
+
+  if (ranges)
+    {
+      int end_index = start_index + para->length;
+      
+      while (*range_i < ranges->len &&
+	     g_array_index (ranges, PangoLayoutRange, *range_i).end <= start_index)
+	(*range_i)++;
+
+      if (*range_i < ranges->len &&
+	  g_array_index (ranges, PangoLayoutRange, *range_i).start < end_index)
+	return FALSE;
+    }
+
+  if (layout->width != layout->lines_width && para->n_lines == 1 && para->width >= 0)
+    {
+      int width = layout->width;
+
+      if (width >= 0 && layout->indent > 0)
+	width -= layout->indent;
+      
+      return width < 0 || para->width <= width;
+    }
+
+  return layout->width == layout->lines_width;
+}
+
+/* Frees the @n_lines lines starting at @lines, and returns the link
+ * following them.
+ */
+static GSList *
+free_lines (GSList *lines,
+	    int     n_lines)
+{
+  while (n_lines-- > 0)
+    {
+      GSList *next = lines->next;
+      PangoLayoutLine *line = lines->data;
+
+      line->layout = NULL;
+      pango_layout_line_unref (line);
+      g_slist_free_1 (lines);
+      
+      lines = next;
+    }
+
+  return lines;
+}
+
 static void
 pango_layout_check_lines (PangoLayout *layout)
 {
@@ -2957,11 +3607,24 @@ pango_layout_check_lines (PangoLayout *layout)
   PangoAttrList *attrs;
   PangoAttrList *no_shape_attrs;
   PangoAttrIterator *iter;
+  GSList *old_lines;
+  GArray *old_paras;
+  PangoLogAttr *old_log_attrs;
+  GArray *ranges = NULL;
+  guint old_para_i = 0;
+  guint range_i = 0;
+  int n_lines = 0;
+  int first_changed = -1;
+  int n_unchanged = 0;
   
-  if (layout->lines)
+  if (layout->lines && !layout->lines_dirty)
     return;
 
-  g_assert (!layout->log_attrs);
+  if (layout->line_table)
+    {
+      line_table_unref (layout->line_table);
+      layout->line_table = NULL;
+    }
 
   /* For simplicity, we make sure at this point that layout->text
    * is non-NULL even if it is zero length
@@ -2969,100 +3632,324 @@ pango_layout_check_lines (PangoLayout *layout)
   if (!layout->text)
     pango_layout_set_text (layout, NULL, 0);
 
+  /* Tab stops depend on the font, so if they are in use and
+   * the attributes changed them, everything has to go.
+   */
+  if (layout->lines && layout->lines_tab_width != -1)
+    {
+      ensure_tab_width (layout);
+      if (layout->tab_width != layout->lines_tab_width)
+	pango_layout_clear_lines (layout);
+    }
+
   attrs = pango_layout_get_effective_attributes (layout);
   no_shape_attrs = filter_no_shape_attributes (attrs);
-  iter = pango_attr_list_get_iterator (attrs);
+
+  old_lines = layout->lines;
+  old_paras = layout->paras;
+  old_log_attrs = layout->log_attrs;
   
-  layout->log_attrs = g_new (PangoLogAttr, layout->n_chars + 1);
+  if (old_lines)
+    {
+      ranges = g_array_new (FALSE, FALSE, sizeof (PangoLayoutRange));
+      get_dirty_ranges (layout, layout->lines_attrs, attrs, ranges);
+      get_dirty_ranges (layout, layout->lines_no_shape_attrs, no_shape_attrs, ranges);
+      merge_ranges (ranges);
+    }
+  else
+    g_assert (!layout->log_attrs);
+
+  iter = pango_attr_list_get_iterator (attrs);
+
+  layout->lines_dirty = FALSE;
+  layout->lines = NULL;
+  layout->paras = g_array_new (FALSE, FALSE, sizeof (PangoLayoutPara));
+  layout->log_attrs = g_new0 (PangoLogAttr, layout->n_chars + 1);
   
   start_offset = 0;
   start = layout->text;
 
   do
     {
-      int delim_len;
-      const char *end;
-      int delimiter_index, next_para_index;
-      ParaBreakState state;
+      PangoLayoutPara para;
+      PangoLayoutPara *old_para = NULL;
 
-      if (layout->single_paragraph)
-        {
-          delimiter_index = layout->length;
-          next_para_index = layout->length;
-        }
+      /* Skip past old paragraphs that were replaced or are in the way
+       */
+      while (old_paras && old_para_i < old_paras->len)
+	{
+	  PangoLayoutPara *tmp_para = &g_array_index (old_paras, PangoLayoutPara, old_para_i);
+
+	  if (map_old_para_start (layout, tmp_para->start_index) > start - layout->text)
+	    break;
+
+	  old_para_i++;
+	  
+	  if (para_can_be_reused (layout, tmp_para, start - layout->text, ranges, &range_i))
+	    {
+	      old_para = tmp_para;
+	      break;
+	    }
+
+	  old_lines = free_lines (old_lines, tmp_para->n_lines);
+	  if (first_changed < 0)
+	    first_changed = n_lines;
+	  n_unchanged = 0;
+	}
+
+      if (old_para)
+	{
+	  int shift = (start - layout->text) - old_para->start_index;
+	  int i;
+
+	  para = *old_para;
+	  para.start_index = start - layout->text;
+	  para.start_offset = start_offset;
+
+	  for (i = 0; i < para.n_lines; i++)
+	    {
+	      GSList *tmp_list = old_lines;
+	      PangoLayoutLine *line = tmp_list->data;
+
+	      old_lines = old_lines->next;
+
+	      if (shift != 0)
+		{
+		  GSList *run_list;
+
+		  line->start_index += shift;
+		  for (run_list = line->runs; run_list; run_list = run_list->next)
+		    {
+		      PangoLayoutRun *run = run_list->data;
+		      run->item->offset += shift;
+		    }
+		}
+
+	      tmp_list->next = layout->lines;
+	      layout->lines = tmp_list;
+	    }
+
+	  if (para.length > para.delim_len)
+	    {
+	      memcpy (layout->log_attrs + start_offset,
+		      old_log_attrs + old_para->start_offset,
+		      para.n_chars * sizeof (PangoLogAttr));
+	      layout->log_attrs[start_offset + para.n_chars] = para.end_attr;
+	    }
+
+	  done = para.delim_len == 0;
+	  n_unchanged += para.n_lines;
+	}
       else
-        {
-          pango_find_paragraph_boundary (start,
-                                         (layout->text + layout->length) - start,
-                                         &delimiter_index,
-                                         &next_para_index);
-        }
+	{
+	  const char *end;
+	  int delimiter_index, next_para_index;
+	  ParaBreakState state;
+	  GSList *para_lines = layout->lines;
+	  GSList *tmp_list;
+
+	  if (layout->single_paragraph)
+	    {
+	      delimiter_index = layout->length - (start - layout->text);
+	      next_para_index = delimiter_index;
+	    }
+	  else
+	    {
+	      pango_find_paragraph_boundary (start,
+					     (layout->text + layout->length) - start,
+					     &delimiter_index,
+					     &next_para_index);
+	    }
 
-      g_assert (next_para_index >= delimiter_index);
+	  g_assert (next_para_index >= delimiter_index);
       
-      end = start + delimiter_index;
+	  end = start + delimiter_index;
       
-      delim_len = next_para_index - delimiter_index;
+	  para.start_index = start - layout->text;
+	  para.start_offset = start_offset;
+	  para.length = next_para_index;
+	  para.delim_len = next_para_index - delimiter_index;
+	  para.n_chars = g_utf8_strlen (start, para.length);
       
-      if (end == (layout->text + layout->length))
-	done = TRUE;
-
-      g_assert (end <= (layout->text + layout->length));
-      g_assert (start <= (layout->text + layout->length));
-      g_assert (delim_len < 4);	/* PS is 3 bytes */
-      g_assert (delim_len >= 0);
-
-      state.items = pango_itemize (layout->context,
-				   layout->text,
-				   start - layout->text,
-				   end - start,
-				   attrs,
-				   iter);
-
-      get_items_log_attrs (start, state.items,
-                           layout->log_attrs + start_offset,
-                           delim_len);
-
-      if (state.items)
-	{
-	  state.first_line = TRUE;
-	  state.start_offset = start_offset;
-          state.line_start_index = start - layout->text;
+	  if (end == (layout->text + layout->length))
+	    done = TRUE;
+
+	  g_assert (end <= (layout->text + layout->length));
+	  g_assert (start <= (layout->text + layout->length));
+	  g_assert (para.delim_len < 4);	/* PS is 3 bytes */
+	  g_assert (para.delim_len >= 0);
+
+	  state.items = pango_itemize (layout->context,
+				       layout->text,
+				       start - layout->text,
+				       end - start,
+				       attrs,
+				       iter);
+
+	  get_items_log_attrs (start, state.items,
+			       layout->log_attrs + start_offset,
+			       para.delim_len);
+	  para.end_attr = layout->log_attrs[start_offset + para.n_chars];
+
+	  if (state.items)
+	    {
+	      state.first_line = TRUE;
+	      state.start_offset = start_offset;
+	      state.line_start_index = start - layout->text;
 
-	  state.glyphs = NULL;
-	  state.log_widths = NULL;
+	      state.glyphs = NULL;
+	      state.log_widths = NULL;
 	  
-	  while (state.items)
-            process_line (layout, &state);
-	}
-      else
-        {
-          PangoLayoutLine *empty_line;
+	      while (state.items)
+		process_line (layout, &state);
+	    }
+	  else
+	    {
+	      PangoLayoutLine *empty_line;
 
-          empty_line = pango_layout_line_new (layout);
-          empty_line->start_index = start - layout->text; 
+	      empty_line = pango_layout_line_new (layout);
+	      empty_line->start_index = start - layout->text; 
 
-          layout->lines = g_slist_prepend (layout->lines,
-                                           empty_line);
-        }
+	      layout->lines = g_slist_prepend (layout->lines,
+					       empty_line);
+	    }
+
+	  para.n_lines = 0;
+	  for (tmp_list = layout->lines; tmp_list != para_lines; tmp_list = tmp_list->next)
+	    para.n_lines++;
+
+	  para.width = -1;
+	  if (para.n_lines == 1)
+	    {
+	      PangoLayoutLine *line = layout->lines->data;
+
+	      para.width = 0;
+	      for (tmp_list = line->runs; tmp_list; tmp_list = tmp_list->next)
+		{
+		  PangoLayoutRun *run = tmp_list->data;
+		  int i;
+
+		  for (i = 0; i < run->glyphs->num_glyphs; i++)
+		    para.width += run->glyphs->glyphs[i].geometry.width;
+		}
+	    }
 
-      if (!done)
-        start_offset += g_utf8_strlen (start, (end - start) + delim_len);
+	  if (no_shape_attrs)
+	    apply_no_shape_attributes (layout, layout->lines, para.n_lines, no_shape_attrs);
+	  
+	  if (first_changed < 0)
+	    first_changed = n_lines;
+	  n_unchanged = 0;
+	}
 
-      start = end + delim_len;
+      g_array_append_val (layout->paras, para);
+      n_lines += para.n_lines;
+      start_offset += para.n_chars;
+      start += para.length;
     }
   while (!done);
 
+  /* Whatever is left over was replaced */
+  if (old_paras)
+    {
+      for (; old_para_i < old_paras->len; old_para_i++)
+	{
+	  PangoLayoutPara *tmp_para = &g_array_index (old_paras, PangoLayoutPara, old_para_i);
+
+	  old_lines = free_lines (old_lines, tmp_para->n_lines);
+	  if (first_changed < 0)
+	    first_changed = n_lines;
+	  n_unchanged = 0;
+	}
+      g_assert (old_lines == NULL);
+      
+      g_array_free (old_paras, TRUE);
+      g_free (old_log_attrs);
+      g_array_free (ranges, TRUE);
+    }
+
   pango_attr_iterator_destroy (iter);
-  pango_attr_list_unref (attrs);
 
-  if (no_shape_attrs)
+  layout->lines = g_slist_reverse (layout->lines);
+
+  if (first_changed >= 0)
     {
-      apply_no_shape_attributes (layout, no_shape_attrs);
-      pango_attr_list_unref (no_shape_attrs);
+      int n_removed = layout->n_lines - first_changed - n_unchanged;
+      int n_added = n_lines - first_changed - n_unchanged;
+
+      if (layout->changed_n_removed == 0 && layout->changed_n_added == 0)
+	{
+	  layout->changed_first_line = first_changed;
+	  layout->changed_n_removed = n_removed;
+	  layout->changed_n_added = n_added;
+	}
+      else
+	{
+	  /* Combine with the change not yet reported */
+	  int first = MIN (layout->changed_first_line, first_changed);
+	  int end = MAX (layout->changed_first_line + layout->changed_n_added,
+			 first_changed + n_removed);
+
+	  layout->changed_n_removed = end - layout->changed_n_added + layout->changed_n_removed - first;
+	  layout->changed_n_added = end + n_added - n_removed - first;
+	  layout->changed_first_line = first;
+	}
     }
+  layout->n_lines = n_lines;
+
+  if (layout->lines_attrs)
+    pango_attr_list_unref (layout->lines_attrs);
+  if (layout->lines_no_shape_attrs)
+    pango_attr_list_unref (layout->lines_no_shape_attrs);
+  layout->lines_attrs = attrs;
+  layout->lines_no_shape_attrs = no_shape_attrs;
+  layout->lines_width = layout->width;
+  layout->lines_tab_width = layout->tab_width;
+  layout->edit_pos = 0;
+  layout->edit_remove = 0;
+  layout->edit_add = 0;
+}
 
-  layout->lines = g_slist_reverse (layout->lines);
+/**
+ * pango_layout_get_changed_lines:
+ * @layout: a #PangoLayout
+ * @first_line: location to store the index of the first line that changed,
+ *              or %NULL
+ * @n_removed: location to store the number of lines removed, or %NULL
+ * @n_added: location to store the number of lines added in their place,
+ *           or %NULL
+ * 
+ * Lays out the text of @layout if needed, and reports which lines
+ * changed since the previous call: @n_removed lines starting at
+ * @first_line were replaced by @n_added new ones, and the lines
+ * around them are unchanged apart from their position in the
+ * text. This lets a widget showing the layout redraw only what
+ * changed after pango_layout_insert_text() and the like. If
+ * nothing changed, @first_line is the number of lines and the
+ * counts are zero.
+ **/
+void
+pango_layout_get_changed_lines (PangoLayout *layout,
+				int         *first_line,
+				int         *n_removed,
+				int         *n_added)
+{
+  g_return_if_fail (layout != NULL);
+
+  pango_layout_check_lines (layout);
+
+  if (layout->changed_n_removed == 0 && layout->changed_n_added == 0)
+    layout->changed_first_line = layout->n_lines;
+
+  if (first_line)
+    *first_line = layout->changed_first_line;
+  if (n_removed)
+    *n_removed = layout->changed_n_removed;
+  if (n_added)
+    *n_added = layout->changed_n_added;
+
+  layout->changed_n_removed = 0;
+  layout->changed_n_added = 0;
 }
 
 /**
@@ -3175,7 +4062,7 @@ pango_layout_line_x_to_index (PangoLayoutLine *line,
 
   g_assert (line->length > 0);
   
-  first_offset = g_utf8_pointer_to_offset (layout->text, layout->text + line->start_index);
+  first_offset = pango_layout_index_to_offset (layout, line->start_index);
 
   end_index = first_index + line->length;
   end_offset = first_offset + g_utf8_pointer_to_offset (layout->text + first_index, layout->text + end_index);
@@ -3279,7 +4166,8 @@ pango_layout_line_x_to_index (PangoLayoutLine *line,
 
 	  /* Convert from characters to graphemes */
 
-	  offset = g_utf8_pointer_to_offset (layout->text, layout->text + char_index);
+	  offset = first_offset + g_utf8_pointer_to_offset (layout->text + first_index,
+							    layout->text + char_index);
 
 	  grapheme_start_offset = offset;
 	  grapheme_start_index = char_index;
@@ -3502,34 +4390,22 @@ pango_layout_line_get_empty_extents (PangoLayoutLine *line,
       if (layout->attrs)
 	{
 	  PangoAttrIterator *iter = pango_attr_list_get_iterator (layout->attrs);
-	  int start, end;
-	  
-	  while (TRUE)
-	    {
-	      pango_attr_iterator_range (iter, &start, &end);
-	      
-	      if (start <= index && index < end)
-		{
-		  PangoFontDescription *base_font_desc;
+	  PangoFontDescription *base_font_desc;
 
-		  if (layout->font_desc)
-		    base_font_desc = layout->font_desc;
-		  else
-		    base_font_desc = pango_context_get_font_description (layout->context);
+	  _pango_attr_iterator_seek (iter, index);
+	  
+	  if (layout->font_desc)
+	    base_font_desc = layout->font_desc;
+	  else
+	    base_font_desc = pango_context_get_font_description (layout->context);
 
-		  font_desc = pango_font_description_copy_static (base_font_desc);
-		  free_font_desc = TRUE;
+	  font_desc = pango_font_description_copy_static (base_font_desc);
+	  free_font_desc = TRUE;
 		    
-		  pango_attr_iterator_get_font (iter,
-						font_desc,
-						NULL,
-						NULL);
-
-		  break;
-		}
-	      
-	      pango_attr_iterator_next (iter);
-	    }
+	  pango_attr_iterator_get_font (iter,
+					font_desc,
+					NULL,
+					NULL);
 	  
 	  pango_attr_iterator_destroy (iter);
 	}
@@ -3660,6 +4536,13 @@ pango_layout_line_get_extents (PangoLayoutLine *line,
   if (!LINE_IS_VALID (line))
     return;
 
+  if (!ink_rect && ((PangoLayoutLinePrivate *)line)->logical_rect_cached)
+    {
+      if (logical_rect)
+	*logical_rect = ((PangoLayoutLinePrivate *)line)->logical_rect;
+      return;
+    }
+
   if (ink_rect)
     {
       ink_rect->x = 0;
@@ -3735,6 +4618,7 @@ pango_layout_line_new (PangoLayout *layout)
   private->line.layout = layout;
   private->line.runs = 0;
   private->line.length = 0;
+  private->logical_rect_cached = FALSE;
 
   /* Note that we leave start_index uninitialized */
   
@@ -3933,7 +4817,8 @@ static gboolean
 check_invalid (PangoLayoutIter *iter,
                const char      *loc)
 {
-  if (iter->line->layout == NULL)
+  if (iter->line->layout == NULL ||
+      iter->lines_stamp != iter->layout->lines_stamp)
     {
       g_warning ("%s: PangoLayout changed since PangoLayoutIter was created, iterator invalid", loc);
       return TRUE;
@@ -3993,11 +4878,7 @@ static inline void
 offset_y (PangoLayoutIter *iter,
           int             *y)
 {
-  Extents *line_ext;
-
-  line_ext = (Extents*)iter->line_extents_link->data;
-
-  *y += line_ext->baseline;
+  *y += iter->line_table->extents[iter->line_index].baseline;
 }
 
 static void
@@ -4006,7 +4887,7 @@ update_run (PangoLayoutIter *iter,
 {
   Extents *line_ext;
 
-  line_ext = (Extents*)iter->line_extents_link->data;
+  line_ext = &iter->line_table->extents[iter->line_index];
   
   /* Note that in iter_new() the iter->run_logical_rect.width
    * is garbage but we don't use it since we're on the first run of
@@ -4090,10 +4971,13 @@ pango_layout_get_iter (PangoLayout *layout)
   iter->layout = layout;
   g_object_ref (iter->layout);
 
-  pango_layout_check_lines (layout);
+  iter->line_table = pango_layout_get_line_table (layout);
+  iter->line_table->ref_count++;
   
   iter->line_list_link = layout->lines;
   iter->line = iter->line_list_link->data;
+  iter->line_index = 0;
+  iter->lines_stamp = layout->lines_stamp;
   pango_layout_line_ref (iter->line);
 
   iter->run_list_link = iter->line->runs;
@@ -4103,13 +4987,7 @@ pango_layout_get_iter (PangoLayout *layout)
   else
     iter->run = NULL;
 
-  iter->line_extents = NULL;  
-  pango_layout_get_extents_internal (layout,
-                                     NULL,
-                                     &iter->logical_rect,
-                                     &iter->line_extents);  
-
-  iter->line_extents_link = iter->line_extents;
+  iter->logical_rect = iter->line_table->lines_logical_rect;
 
   update_run (iter, 0);
 
@@ -4127,8 +5005,7 @@ pango_layout_iter_free (PangoLayoutIter *iter)
 {
   g_return_if_fail (iter != NULL);
 
-  g_slist_foreach (iter->line_extents, (GFunc) g_free, NULL);
-  g_slist_free (iter->line_extents);
+  line_table_unref (iter->line_table);
   pango_layout_line_unref (iter->line);
   g_object_unref (iter->layout);
   g_free (iter);
@@ -4205,7 +5082,7 @@ pango_layout_iter_at_last_line (PangoLayoutIter *iter)
   if (IS_INVALID (iter))
     return FALSE;
 
-  return iter->line_extents_link->next == NULL;
+  return iter->line_index == iter->line_table->n_lines - 1;
 }
 
 /**
@@ -4394,8 +5271,8 @@ pango_layout_iter_next_line (PangoLayoutIter *iter)
   if (iter->run == NULL)
     iter->index += 1; /* 1 is the length of '\n' in UTF-8 */
 
-  iter->line_extents_link = iter->line_extents_link->next;
-  g_assert (iter->line_extents_link != NULL);  
+  iter->line_index++;
+  g_assert (iter->line_index < iter->line_table->n_lines);
 
   update_run (iter, iter->line->start_index);
   
@@ -4599,7 +5476,7 @@ pango_layout_iter_get_line_extents (PangoLayoutIter *iter,
   if (IS_INVALID (iter))
     return;
 
-  ext = iter->line_extents_link->data;
+  ext = &iter->line_table->extents[iter->line_index];
 
   if (ink_rect)
     {
@@ -4640,7 +5517,7 @@ pango_layout_iter_get_line_yrange (PangoLayoutIter *iter,
   
   IS_INVALID (iter);
 
-  ext = iter->line_extents_link->data;
+  ext = &iter->line_table->extents[iter->line_index];
 
   half_spacing = iter->layout->spacing / 2;
 
@@ -4652,7 +5529,7 @@ pango_layout_iter_get_line_yrange (PangoLayoutIter *iter,
     {
       /* No spacing above the first line */
       
-      if (iter->line_extents_link == iter->line_extents)
+      if (iter->line_index == 0)
         *y0 = ext->logical_rect.y;
       else
         *y0 = ext->logical_rect.y - (iter->layout->spacing - half_spacing);
@@ -4661,7 +5538,7 @@ pango_layout_iter_get_line_yrange (PangoLayoutIter *iter,
   if (y1)
     {
       /* No spacing below the last line */
-      if (iter->line_extents_link->next == NULL)
+      if (iter->line_index == iter->line_table->n_lines - 1)
         *y1 = ext->logical_rect.y + ext->logical_rect.height;
       else
         *y1 = ext->logical_rect.y + ext->logical_rect.height + half_spacing;
@@ -4685,7 +5562,7 @@ pango_layout_iter_get_baseline (PangoLayoutIter *iter)
   if (IS_INVALID (iter))
     return 0;
 
-  ext = iter->line_extents_link->data;
+  ext = &iter->line_table->extents[iter->line_index];
 
   return ext->baseline;
 }
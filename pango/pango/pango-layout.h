@@ -85,6 +85,16 @@ void           __fastcall pango_layout_set_text_static       (PangoLayout    *la
 					    const char     *text,
 					    int             length);
 const char    *pango_layout_get_text       (PangoLayout    *layout);
+void           pango_layout_insert_text    (PangoLayout    *layout,
+					    int             index_,
+					    const char     *text,
+					    int             length);
+void           pango_layout_append_text    (PangoLayout    *layout,
+					    const char     *text,
+					    int             length);
+void           pango_layout_delete_text    (PangoLayout    *layout,
+					    int             index_,
+					    int             length);
 
 void           pango_layout_set_markup     (PangoLayout    *layout,
                                             const char     *markup,
@@ -135,6 +145,11 @@ void     pango_layout_get_log_attrs (PangoLayout    *layout,
 void     pango_layout_index_to_pos         (PangoLayout    *layout,
 					    int             index_,
 					    PangoRectangle *pos);
+void     pango_layout_index_to_line_x      (PangoLayout    *layout,
+					    int             index_,
+					    gboolean        trailing,
+					    int            *line,
+					    int            *x_pos);
 void     pango_layout_get_cursor_pos       (PangoLayout    *layout,
 					    int             index_,
 					    PangoRectangle *strong_pos,
@@ -168,6 +183,10 @@ int              pango_layout_get_line_count       (PangoLayout    *layout);
 PangoLayoutLine *pango_layout_get_line             (PangoLayout    *layout,
 						    int             line);
 GSList *         pango_layout_get_lines            (PangoLayout    *layout);
+void             pango_layout_get_changed_lines    (PangoLayout    *layout,
+						    int            *first_line,
+						    int            *n_removed,
+						    int            *n_added);
 
 void     pango_layout_line_ref          (PangoLayoutLine  *line);
 void     pango_layout_line_unref        (PangoLayoutLine  *line);
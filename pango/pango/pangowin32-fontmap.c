@@ -279,6 +279,7 @@ pango_win32_shutdown_display (void)
   if (fontmap)
     {
       pango_win32_fontmap_cache_clear (fontmap);
+      pango_shape_cache_clear ();
       g_object_unref (fontmap);
 
       fontmap = NULL;
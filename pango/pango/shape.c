@@ -19,9 +19,314 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#include <string.h>
+
 #include <pango/pango-glyph.h>
 #include <pango/pango-engine.h>
 
+/* Shaped-run cache
+ *
+ * Layout reshapes every item each time its lines are rebuilt, and
+ * the same runs (nicknames, timestamps, labels, whole repeated lines)
+ * come back over and over. pango_shape() therefore remembers the
+ * glyphs produced for a run, keyed by the font, shape engine, language,
+ * bidi level and the UTF-8 bytes. Runs are cached whole, the shapers
+ * kern and form contexts across spaces, so the glyphs of a word depend
+ * on its neighbours.
+ *
+ * Entries live in a hash table and on a most-recently-used list; the
+ * oldest are dropped once the total size goes over shape_cache_max_size.
+ * A weak reference on each font drops its entries when it is finalized,
+ * and font maps call pango_shape_cache_clear() when their fonts may
+ * shape differently.
+ *
+ * Like the rest of Pango, the cache is global state without locking;
+ * pango_shape() and the functions below must not be called from
+ * several threads at once.
+ */
+#define PANGO_SHAPE_CACHE_DEFAULT_SIZE (1024 * 1024)
+#define PANGO_SHAPE_CACHE_MAX_TEXT     256
+
+typedef struct _PangoShapeCacheEntry PangoShapeCacheEntry;
+
+struct _PangoShapeCacheEntry
+{
+  PangoShapeCacheEntry *prev;
+  PangoShapeCacheEntry *next;
+
+  PangoFont *font;
+  PangoEngineShape *shape_engine;
+  PangoLanguage *language;
+  guint level;
+  gint length;
+  const gchar *text;
+  guint hash;
+
+  gint num_glyphs;
+  PangoGlyphInfo *glyphs;
+  gint *log_clusters;
+  gsize size;
+};
+
+static GHashTable *shape_cache = NULL;
+static GHashTable *shape_cache_fonts = NULL;	/* font -> number of entries */
+static PangoShapeCacheEntry *shape_cache_head = NULL;
+static PangoShapeCacheEntry *shape_cache_tail = NULL;
+static gsize shape_cache_size = 0;
+static gsize shape_cache_max_size = PANGO_SHAPE_CACHE_DEFAULT_SIZE;
+static guint shape_cache_hits = 0;
+static guint shape_cache_misses = 0;
+
+static guint
+shape_cache_entry_hash (gconstpointer key)
+{
+  return ((const PangoShapeCacheEntry *) key)->hash;
+}
+
+static gboolean
+shape_cache_entry_equal (gconstpointer a,
+			 gconstpointer b)
+{
+  const PangoShapeCacheEntry *entry1 = a;
+  const PangoShapeCacheEntry *entry2 = b;
+
+  return (entry1->font == entry2->font &&
+	  entry1->shape_engine == entry2->shape_engine &&
+	  entry1->language == entry2->language &&
+	  entry1->level == entry2->level &&
+	  entry1->length == entry2->length &&
+	  memcmp (entry1->text, entry2->text, entry1->length) == 0);
+}
+
+static void
+shape_cache_unlink (PangoShapeCacheEntry *entry)
+{
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    shape_cache_head = entry->next;
+
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    shape_cache_tail = entry->prev;
+}
+
+static void
+shape_cache_link_head (PangoShapeCacheEntry *entry)
+{
+  entry->prev = NULL;
+  entry->next = shape_cache_head;
+
+  if (shape_cache_head)
+    shape_cache_head->prev = entry;
+  else
+    shape_cache_tail = entry;
+
+  shape_cache_head = entry;
+}
+
+static void shape_cache_font_finalized (gpointer  data,
+					GObject  *where_the_object_was);
+
+/* Removes @entry from the cache; when @font_alive is FALSE the font
+ * is being finalized and its weak reference is already gone.
+ */
+static void
+shape_cache_remove (PangoShapeCacheEntry *entry,
+		    gboolean              font_alive)
+{
+  guint n_entries;
+
+  g_hash_table_remove (shape_cache, entry);
+  shape_cache_unlink (entry);
+  shape_cache_size -= entry->size;
+
+  n_entries = GPOINTER_TO_UINT (g_hash_table_lookup (shape_cache_fonts, entry->font)) - 1;
+  if (n_entries > 0)
+    g_hash_table_insert (shape_cache_fonts, entry->font, GUINT_TO_POINTER (n_entries));
+  else
+    {
+      g_hash_table_remove (shape_cache_fonts, entry->font);
+      if (font_alive)
+	g_object_weak_unref (G_OBJECT (entry->font), shape_cache_font_finalized, NULL);
+    }
+
+  g_free (entry);
+}
+
+static void
+shape_cache_font_finalized (gpointer  data,
+			    GObject  *where_the_object_was)
+{
+  PangoShapeCacheEntry *entry = shape_cache_head;
+
+  while (entry)
+    {
+      PangoShapeCacheEntry *next = entry->next;
+
+      if (entry->font == (PangoFont *) where_the_object_was)
+	shape_cache_remove (entry, FALSE);
+
+      entry = next;
+    }
+}
+
+static PangoShapeCacheEntry *
+shape_cache_insert (PangoShapeCacheEntry *key,
+		    PangoGlyphString     *glyphs)
+{
+  PangoShapeCacheEntry *entry;
+  gsize size;
+  guint n_entries;
+
+  size = (sizeof (PangoShapeCacheEntry) +
+	  glyphs->num_glyphs * (sizeof (PangoGlyphInfo) + sizeof (gint)) +
+	  key->length);
+  if (size > shape_cache_max_size)
+    return NULL;
+
+  while (shape_cache_size + size > shape_cache_max_size)
+    shape_cache_remove (shape_cache_tail, TRUE);
+
+  entry = g_malloc (size);
+  *entry = *key;
+  entry->num_glyphs = glyphs->num_glyphs;
+  entry->glyphs = (PangoGlyphInfo *) (entry + 1);
+  entry->log_clusters = (gint *) (entry->glyphs + entry->num_glyphs);
+  entry->text = (gchar *) (entry->log_clusters + entry->num_glyphs);
+  entry->size = size;
+
+  memcpy (entry->glyphs, glyphs->glyphs, entry->num_glyphs * sizeof (PangoGlyphInfo));
+  memcpy (entry->log_clusters, glyphs->log_clusters, entry->num_glyphs * sizeof (gint));
+  memcpy ((gchar *) entry->text, key->text, key->length);
+
+  g_hash_table_insert (shape_cache, entry, entry);
+  shape_cache_link_head (entry);
+  shape_cache_size += size;
+
+  n_entries = GPOINTER_TO_UINT (g_hash_table_lookup (shape_cache_fonts, entry->font));
+  if (n_entries == 0)
+    g_object_weak_ref (G_OBJECT (entry->font), shape_cache_font_finalized, NULL);
+  g_hash_table_insert (shape_cache_fonts, entry->font, GUINT_TO_POINTER (n_entries + 1));
+
+  return entry;
+}
+
+static void
+shape_cached (const gchar      *text,
+	      gint              length,
+	      PangoAnalysis    *analysis,
+	      PangoGlyphString *glyphs)
+{
+  PangoShapeCacheEntry key;
+  PangoShapeCacheEntry *entry = NULL;
+  const guchar *p;
+  guint hash;
+
+  if (length > PANGO_SHAPE_CACHE_MAX_TEXT)
+    {
+      analysis->shape_engine->script_shape (analysis->font, text, length, analysis, glyphs);
+      return;
+    }
+
+  if (!shape_cache)
+    {
+      shape_cache = g_hash_table_new (shape_cache_entry_hash, shape_cache_entry_equal);
+      shape_cache_fonts = g_hash_table_new (NULL, NULL);
+    }
+
+  hash = GPOINTER_TO_UINT (analysis->font) ^ (GPOINTER_TO_UINT (analysis->language) << 5) ^ analysis->level;
+  for (p = (const guchar *) text; p < (const guchar *) text + length; p++)
+    hash = (hash << 5) - hash + *p;
+
+  key.font = analysis->font;
+  key.shape_engine = analysis->shape_engine;
+  key.language = analysis->language;
+  key.level = analysis->level;
+  key.length = length;
+  key.text = text;
+  key.hash = hash;
+
+  entry = g_hash_table_lookup (shape_cache, &key);
+  if (!entry)
+    {
+      shape_cache_misses++;
+
+      analysis->shape_engine->script_shape (analysis->font, text, length, analysis, glyphs);
+      shape_cache_insert (&key, glyphs);
+      return;
+    }
+
+  shape_cache_hits++;
+  if (entry != shape_cache_head)
+    {
+      shape_cache_unlink (entry);
+      shape_cache_link_head (entry);
+    }
+
+  /* pango_glyph_string_set_size() reallocates even when there is room */
+  if (entry->num_glyphs > glyphs->space)
+    pango_glyph_string_set_size (glyphs, entry->num_glyphs);
+  else
+    glyphs->num_glyphs = entry->num_glyphs;
+
+  memcpy (glyphs->glyphs, entry->glyphs, entry->num_glyphs * sizeof (PangoGlyphInfo));
+  memcpy (glyphs->log_clusters, entry->log_clusters, entry->num_glyphs * sizeof (gint));
+}
+
+/**
+ * pango_shape_cache_clear:
+ *
+ * Drops all glyphs cached by pango_shape(). Font maps call this when
+ * fonts they have already handed out may start shaping differently,
+ * for example after a resolution or substitution change.
+ **/
+void
+pango_shape_cache_clear (void)
+{
+  while (shape_cache_tail)
+    shape_cache_remove (shape_cache_tail, TRUE);
+}
+
+/**
+ * pango_shape_cache_set_max_size:
+ * @max_size: the maximum number of bytes to use, or 0 to turn the
+ *            cache off
+ *
+ * Sets the memory budget of the cache used by pango_shape(). The
+ * default is one megabyte.
+ **/
+void
+pango_shape_cache_set_max_size (gsize max_size)
+{
+  shape_cache_max_size = max_size;
+
+  while (shape_cache_size > shape_cache_max_size)
+    shape_cache_remove (shape_cache_tail, TRUE);
+}
+
+/**
+ * pango_shape_cache_get_stats:
+ * @hits: location to store the number of lookups that found glyphs, or %NULL
+ * @misses: location to store the number of lookups that had to shape, or %NULL
+ * @size: location to store the number of bytes in use, or %NULL
+ *
+ * Retrieves the counters of the cache used by pango_shape().
+ **/
+void
+pango_shape_cache_get_stats (guint *hits,
+			     guint *misses,
+			     gsize *size)
+{
+  if (hits)
+    *hits = shape_cache_hits;
+  if (misses)
+    *misses = shape_cache_misses;
+  if (size)
+    *size = shape_cache_size;
+}
+
 /**
  * pango_shape:
  * @text:      the text to process
@@ -44,7 +349,12 @@ pango_shape (const gchar      *text,
   int last_cluster = -1;
   
   if (analysis->shape_engine)
-    analysis->shape_engine->script_shape (analysis->font, text, length, analysis, glyphs);
+    {
+      if (shape_cache_max_size > 0)
+	shape_cached (text, length, analysis, glyphs);
+      else
+	analysis->shape_engine->script_shape (analysis->font, text, length, analysis, glyphs);
+    }
   else
     {
       pango_glyph_string_set_size (glyphs, 1);
@@ -0,0 +1,244 @@
+/* Pango
+ * bench-attributes.c: Benchmark for long attribute lists
+ *
+ * Copyright (C) 2003 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+
+#include <pango/pango.h>
+
+#include "testfontmap.h"
+
+/* Builds attribute lists of 10000 short spans over 10000 words, the
+ * way heavily colourised text ends up: in order with
+ * pango_attr_list_insert() and pango_attr_list_change(), and at
+ * random places, followed by random changes. It then walks the
+ * random list with an iterator, itemizes the text with it and lays
+ * it out. The two lists built in order must give the same segments,
+ * and every attribute the iterator returns must cover its segment.
+ */
+
+#define N_SPANS 10000
+#define N_CHANGES 2000
+#define WIDTH 400000
+
+static PangoAttribute *
+make_span (int i,
+	   int start,
+	   int end)
+{
+  PangoAttribute *attr;
+
+  switch (i % 4)
+    {
+    case 0:
+      attr = pango_attr_foreground_new (i * 7, 0, 0);
+      break;
+    case 1:
+      attr = pango_attr_weight_new (PANGO_WEIGHT_BOLD);
+      break;
+    case 2:
+      attr = pango_attr_size_new ((8 + i % 5) * PANGO_SCALE);
+      break;
+    default:
+      attr = pango_attr_underline_new (PANGO_UNDERLINE_SINGLE);
+      break;
+    }
+
+  attr->start_index = start;
+  attr->end_index = end;
+
+  return attr;
+}
+
+static int
+check_segments (PangoAttrList *list)
+{
+  PangoAttrIterator *iter = pango_attr_list_get_iterator (list);
+  int failed = 0;
+
+  do
+    {
+      GSList *attrs = pango_attr_iterator_get_attrs (iter);
+      GSList *l;
+      int start, end;
+
+      pango_attr_iterator_range (iter, &start, &end);
+      for (l = attrs; l; l = l->next)
+	{
+	  PangoAttribute *attr = l->data;
+
+	  if (attr->start_index > start || attr->end_index < end)
+	    failed++;
+	  pango_attribute_destroy (attr);
+	}
+      g_slist_free (attrs);
+    }
+  while (pango_attr_iterator_next (iter));
+  pango_attr_iterator_destroy (iter);
+
+  return failed;
+}
+
+static gboolean
+same_segments (PangoAttrList *list1,
+	       PangoAttrList *list2)
+{
+  PangoAttrIterator *iter1 = pango_attr_list_get_iterator (list1);
+  PangoAttrIterator *iter2 = pango_attr_list_get_iterator (list2);
+  gboolean more1, more2;
+  gboolean same = TRUE;
+
+  do
+    {
+      GSList *attrs1 = pango_attr_iterator_get_attrs (iter1);
+      GSList *attrs2 = pango_attr_iterator_get_attrs (iter2);
+      int start1, end1, start2, end2;
+
+      pango_attr_iterator_range (iter1, &start1, &end1);
+      pango_attr_iterator_range (iter2, &start2, &end2);
+      if (start1 != start2 || end1 != end2 ||
+	  g_slist_length (attrs1) != g_slist_length (attrs2))
+	same = FALSE;
+
+      g_slist_foreach (attrs1, (GFunc) pango_attribute_destroy, NULL);
+      g_slist_foreach (attrs2, (GFunc) pango_attribute_destroy, NULL);
+      g_slist_free (attrs1);
+      g_slist_free (attrs2);
+
+      more1 = pango_attr_iterator_next (iter1);
+      more2 = pango_attr_iterator_next (iter2);
+    }
+  while (same && more1 && more2);
+  same = same && more1 == more2;
+
+  pango_attr_iterator_destroy (iter1);
+  pango_attr_iterator_destroy (iter2);
+
+  return same;
+}
+
+int
+main (int argc, char **argv)
+{
+  PangoContext *context;
+  PangoLayout *layout;
+  PangoAttrList *in_order, *changed_in_order, *random;
+  PangoAttrIterator *iter;
+  PangoRectangle extents;
+  GString *text = g_string_new (NULL);
+  GRand *rand = g_rand_new_with_seed (3);
+  GList *items;
+  double start;
+  int i, n_segments, start_index;
+  int failed = 0;
+
+  g_type_init ();
+
+  context = test_context_new ();
+  for (i = 0; i < N_SPANS; i++)
+    g_string_append (text, "word ");
+
+  start = test_time_ms ();
+  in_order = pango_attr_list_new ();
+  for (i = 0; i < N_SPANS; i++)
+    pango_attr_list_insert (in_order, make_span (i, i * 5, i * 5 + 4));
+  printf ("insert in order:        %8.2f ms\n", test_time_ms () - start);
+
+  start = test_time_ms ();
+  changed_in_order = pango_attr_list_new ();
+  for (i = 0; i < N_SPANS; i++)
+    pango_attr_list_change (changed_in_order, make_span (i, i * 5, i * 5 + 4));
+  printf ("change in order:        %8.2f ms\n", test_time_ms () - start);
+
+  if (!same_segments (in_order, changed_in_order))
+    {
+      printf ("lists built with insert and change differ\n");
+      failed++;
+    }
+
+  start = test_time_ms ();
+  random = pango_attr_list_new ();
+  for (i = 0; i < N_SPANS; i++)
+    {
+      start_index = g_rand_int_range (rand, 0, text->len);
+      pango_attr_list_insert (random,
+			      make_span (i, start_index,
+					 start_index + g_rand_int_range (rand, 1, 40)));
+    }
+  printf ("insert at random:       %8.2f ms\n", test_time_ms () - start);
+
+  start = test_time_ms ();
+  for (i = 0; i < N_CHANGES; i++)
+    {
+      start_index = g_rand_int_range (rand, 0, text->len);
+      pango_attr_list_change (random,
+			      make_span (i, start_index,
+					 start_index + g_rand_int_range (rand, 1, 40)));
+    }
+  printf ("%d changes at random: %8.2f ms\n", N_CHANGES, test_time_ms () - start);
+
+  start = test_time_ms ();
+  iter = pango_attr_list_get_iterator (random);
+  n_segments = 0;
+  do
+    {
+      PangoFontDescription *desc = pango_font_description_new ();
+      PangoLanguage *language;
+      GSList *extra_attrs;
+
+      pango_attr_iterator_get_font (iter, desc, &language, &extra_attrs);
+      g_slist_foreach (extra_attrs, (GFunc) pango_attribute_destroy, NULL);
+      g_slist_free (extra_attrs);
+      pango_font_description_free (desc);
+      n_segments++;
+    }
+  while (pango_attr_iterator_next (iter));
+  pango_attr_iterator_destroy (iter);
+  printf ("iterate with get_font:  %8.2f ms (%d segments)\n",
+	  test_time_ms () - start, n_segments);
+
+  failed += check_segments (random);
+
+  start = test_time_ms ();
+  items = pango_itemize (context, text->str, 0, text->len, random, NULL);
+  printf ("itemize:                %8.2f ms (%d items)\n",
+	  test_time_ms () - start, g_list_length (items));
+  g_list_foreach (items, (GFunc) pango_item_free, NULL);
+  g_list_free (items);
+
+  layout = pango_layout_new (context);
+  pango_layout_set_width (layout, WIDTH);
+  pango_layout_set_text (layout, text->str, text->len);
+  start = test_time_ms ();
+  pango_layout_set_attributes (layout, random);
+  pango_layout_get_extents (layout, NULL, &extents);
+  printf ("layout:                 %8.2f ms (%d lines)\n",
+	  test_time_ms () - start, pango_layout_get_line_count (layout));
+
+  g_object_unref (layout);
+  pango_attr_list_unref (in_order);
+  pango_attr_list_unref (changed_in_order);
+  pango_attr_list_unref (random);
+  g_object_unref (context);
+  g_string_free (text, TRUE);
+  g_rand_free (rand);
+
+  return failed ? 1 : 0;
+}
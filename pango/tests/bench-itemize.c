@@ -0,0 +1,247 @@
+/* Pango
+ * bench-itemize.c: Benchmark for itemizing mixed-script text
+ *
+ * Copyright (C) 2003 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <pango/pango.h>
+
+#include "testfontmap.h"
+
+/* Itemizes 100 KB of text mixing Latin, Greek, Cyrillic, Hebrew,
+ * Arabic, kana, CJK, Hangul and emoji that no font covers, through
+ * the fallback chain of all the test fonts, once as plain text and
+ * once with bold words every few characters, and times the lookups
+ * of pango_fontset_get_font() on their own. Every character must
+ * get the font that walking the chain and asking each font's
+ * coverage picks.
+ */
+
+#define TEXT_SIZE 100000
+#define N_ROUNDS 20
+
+static const char *snippets[] = {
+  "The quick brown fox ", "jumps over the lazy dog. ",
+  "\xce\x93\xce\xb5\xce\xb9\xce\xac \xcf\x83\xce\xbf\xcf\x85 \xce\xba\xcf\x8c\xcf\x83\xce\xbc\xce\xb5 ",
+  "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82 \xd0\xbc\xd0\xb8\xd1\x80 ",
+  "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d ",
+  "\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 ",
+  "\xe3\x81\x93\xe3\x82\x93\xe3\x81\xab\xe3\x81\xa1\xe3\x81\xaf\xe3\x82\xab\xe3\x82\xbf\xe3\x82\xab\xe3\x83\x8a ",
+  "\xe4\xbd\xa0\xe5\xa5\xbd\xef\xbc\x8c\xe4\xb8\x96\xe7\x95\x8c\xe3\x80\x82\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e ",
+  "\xec\x95\x88\xeb\x85\x95\xed\x95\x98\xec\x84\xb8\xec\x9a\x94 \xec\x84\xb8\xea\xb3\x84 ",
+  "\xf0\x9f\x98\x80\xf0\x9f\x8e\x89\xf0\x9f\x9a\x80 "
+};
+
+/* the font of the chain that covers @wc best, the first one of them */
+static PangoFont *
+chain_font (GPtrArray *fonts,
+	    GPtrArray *coverages,
+	    gunichar   wc)
+{
+  PangoCoverageLevel best_level = PANGO_COVERAGE_NONE;
+  PangoFont *best = NULL;
+  int i;
+
+  for (i = 0; i < fonts->len; i++)
+    {
+      PangoCoverageLevel level = pango_coverage_get (coverages->pdata[i], wc);
+
+      if (best == NULL || level > best_level)
+	{
+	  best = fonts->pdata[i];
+	  best_level = level;
+	}
+    }
+
+  return best;
+}
+
+static int
+check_items (GList      *items,
+	     const char *text,
+	     GPtrArray  *fonts[2],
+	     GPtrArray  *coverages[2])
+{
+  GList *l;
+  int failed = 0;
+
+  for (l = items; l; l = l->next)
+    {
+      PangoItem *item = l->data;
+      PangoFontDescription *desc = pango_font_describe (item->analysis.font);
+      gboolean bold = pango_font_description_get_weight (desc) >= PANGO_WEIGHT_BOLD;
+      const char *p;
+
+      for (p = text + item->offset;
+	   p < text + item->offset + item->length;
+	   p = g_utf8_next_char (p))
+	if (chain_font (fonts[bold], coverages[bold], g_utf8_get_char (p)) != item->analysis.font)
+	  {
+	    failed++;
+	    break;
+	  }
+
+      pango_font_description_free (desc);
+    }
+
+  return failed;
+}
+
+static double
+itemize (PangoContext  *context,
+	 const char    *text,
+	 int            length,
+	 PangoAttrList *attrs,
+	 int           *n_items)
+{
+  double start = test_time_ms ();
+  int round;
+
+  for (round = 0; round < N_ROUNDS; round++)
+    {
+      GList *items = pango_itemize (context, text, 0, length, attrs, NULL);
+
+      *n_items = g_list_length (items);
+      g_list_foreach (items, (GFunc) pango_item_free, NULL);
+      g_list_free (items);
+    }
+
+  return (test_time_ms () - start) / N_ROUNDS;
+}
+
+int
+main (int argc, char **argv)
+{
+  PangoContext *context;
+  PangoLanguage *language = pango_language_from_string ("en");
+  PangoFontDescription *desc;
+  PangoFontset *fontset;
+  PangoAttrList *plain, *bold;
+  GPtrArray *fonts[2], *coverages[2];
+  GString *text = g_string_new (NULL);
+  GRand *rand = g_rand_new_with_seed (5);
+  GList *items;
+  gunichar *ucs4;
+  char **families;
+  glong n_chars;
+  double start, elapsed;
+  int i, j, round, n_items;
+  int failed = 0;
+
+  g_type_init ();
+
+  context = test_context_new ();
+  while (text->len < TEXT_SIZE)
+    g_string_append (text, snippets[g_rand_int_range (rand, 0, G_N_ELEMENTS (snippets))]);
+
+  plain = pango_attr_list_new ();
+  bold = pango_attr_list_new ();
+  for (i = 0; i < text->len; i += 40)
+    {
+      PangoAttribute *attr = pango_attr_weight_new (PANGO_WEIGHT_BOLD);
+
+      attr->start_index = i;
+      attr->end_index = i + 20;
+      pango_attr_list_insert (bold, attr);
+    }
+
+  /* the fallback chain, in both weights */
+  desc = pango_font_description_copy (pango_context_get_font_description (context));
+  families = g_strsplit (pango_font_description_get_family (desc), ",", -1);
+  for (i = 0; i < 2; i++)
+    {
+      fonts[i] = g_ptr_array_new ();
+      coverages[i] = g_ptr_array_new ();
+      pango_font_description_set_weight (desc, i ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
+      for (j = 0; families[j]; j++)
+	{
+	  PangoFont *font;
+
+	  pango_font_description_set_family (desc, families[j]);
+	  font = pango_context_load_font (context, desc);
+	  g_ptr_array_add (fonts[i], font);
+	  g_ptr_array_add (coverages[i], pango_font_get_coverage (font, language));
+	}
+    }
+  g_strfreev (families);
+
+  items = pango_itemize (context, text->str, 0, text->len, plain, NULL);
+  failed += check_items (items, text->str, fonts, coverages);
+  g_list_foreach (items, (GFunc) pango_item_free, NULL);
+  g_list_free (items);
+
+  items = pango_itemize (context, text->str, 0, text->len, bold, NULL);
+  failed += check_items (items, text->str, fonts, coverages);
+  g_list_foreach (items, (GFunc) pango_item_free, NULL);
+  g_list_free (items);
+
+  if (failed)
+    printf ("%d items have a font that is not the first to cover them\n", failed);
+
+  elapsed = itemize (context, text->str, text->len, plain, &n_items);
+  printf ("%lu bytes, %d fonts: itemize %.2f ms (%d items)\n",
+	  (gulong) text->len, fonts[0]->len, elapsed, n_items);
+
+  elapsed = itemize (context, text->str, text->len, bold, &n_items);
+  printf ("with bold words:      itemize %.2f ms (%d items)\n", elapsed, n_items);
+
+  /* the fontset lookups alone */
+  fontset = pango_context_load_fontset (context,
+					pango_context_get_font_description (context),
+					language);
+  ucs4 = g_utf8_to_ucs4_fast (text->str, text->len, &n_chars);
+  for (i = 0; i < n_chars; i++)
+    {
+      PangoFont *font = pango_fontset_get_font (fontset, ucs4[i]);
+
+      if (font != chain_font (fonts[0], coverages[0], ucs4[i]))
+	failed++;
+      g_object_unref (font);
+    }
+
+  start = test_time_ms ();
+  for (round = 0; round < N_ROUNDS; round++)
+    for (i = 0; i < n_chars; i++)
+      g_object_unref (pango_fontset_get_font (fontset, ucs4[i]));
+  printf ("pango_fontset_get_font: %.1f ns per character\n",
+	  (test_time_ms () - start) * 1000000 / N_ROUNDS / n_chars);
+
+  for (i = 0; i < 2; i++)
+    {
+      for (j = 0; j < fonts[i]->len; j++)
+	{
+	  g_object_unref (fonts[i]->pdata[j]);
+	  pango_coverage_unref (coverages[i]->pdata[j]);
+	}
+      g_ptr_array_free (fonts[i], TRUE);
+      g_ptr_array_free (coverages[i], TRUE);
+    }
+  g_free (ucs4);
+  g_object_unref (fontset);
+  pango_font_description_free (desc);
+  pango_attr_list_unref (plain);
+  pango_attr_list_unref (bold);
+  g_object_unref (context);
+  g_string_free (text, TRUE);
+  g_rand_free (rand);
+
+  return failed ? 1 : 0;
+}
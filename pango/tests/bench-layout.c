@@ -0,0 +1,187 @@
+/* Pango
+ * bench-layout.c: Benchmark for incremental relayout of PangoLayout
+ *
+ * Copyright (C) 2003 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <pango/pango.h>
+
+#include "testfontmap.h"
+
+/* Edits a layout of 10000 paragraphs of chat text, laying it out again
+ * after every edit: appending lines with pango_layout_append_text()
+ * and pango_layout_set_text(), typing into a paragraph in the middle
+ * with pango_layout_insert_text() and pango_layout_set_text(), and
+ * changing the width by a little. The time of laying out the whole
+ * text from scratch, which every edit used to cost, is given for
+ * comparison, and the edited layout is checked against a fresh one.
+ */
+
+#define N_PARAGRAPHS 10000
+#define N_EDITS 200
+#define N_WIDTH_CHANGES 10
+#define WIDTH 400000
+
+static const char *words[] = {
+  "hello", "the", "build", "is", "green", "again", "lol", "ok", "thanks",
+  "see", "you", "tomorrow", "patch", "merged", "ping", "review", "please",
+  "works", "for", "me", "caf\xc3\xa9", "na\xc3\xafve", "deploy", "done"
+};
+
+static double
+full_layout (PangoContext *context,
+	     const char   *text,
+	     int           width,
+	     int          *n_lines)
+{
+  PangoLayout *layout = pango_layout_new (context);
+  double start = test_time_ms ();
+  double elapsed;
+
+  pango_layout_set_width (layout, width);
+  pango_layout_set_text (layout, text, -1);
+  *n_lines = pango_layout_get_line_count (layout);
+  elapsed = test_time_ms () - start;
+
+  g_object_unref (layout);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  PangoContext *context;
+  PangoLayout *layout;
+  GString *text = g_string_new (NULL);
+  GString *line = g_string_new (NULL);
+  GRand *rand = g_rand_new_with_seed (7);
+  PangoRectangle extents, fresh_extents;
+  double start, full;
+  int i, j, mid, n_lines, fresh_lines;
+  int failed = 0;
+
+  g_type_init ();
+
+  context = test_context_new ();
+  for (i = 0; i < N_PARAGRAPHS; i++)
+    {
+      int n_words = g_rand_int_range (rand, 3, 25);
+
+      for (j = 0; j < n_words; j++)
+	g_string_append_printf (text, "%s%s", j ? " " : "",
+				words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+      g_string_append_c (text, '\n');
+    }
+
+  full = full_layout (context, text->str, WIDTH, &n_lines);
+  printf ("%d paragraphs, %lu bytes, %d lines: full layout %.1f ms\n",
+	  N_PARAGRAPHS, (gulong) text->len, n_lines, full);
+
+  layout = pango_layout_new (context);
+  pango_layout_set_width (layout, WIDTH);
+  pango_layout_set_text (layout, text->str, text->len);
+  pango_layout_get_line_count (layout);
+
+  /* a chat log view appending lines, half through the append API
+   * and half through setting the whole text
+   */
+  for (j = 0; j < 2; j++)
+    {
+      start = test_time_ms ();
+      for (i = 0; i < N_EDITS; i++)
+	{
+	  g_string_truncate (line, 0);
+	  g_string_append_printf (line, "<user%d> %s %s %s\n", i, words[i % 24],
+				  words[(i * 7) % 24], words[(i * 5) % 24]);
+	  if (j == 0)
+	    pango_layout_append_text (layout, line->str, line->len);
+	  else
+	    {
+	      g_string_assign (text, pango_layout_get_text (layout));
+	      g_string_append_len (text, line->str, line->len);
+	      pango_layout_set_text (layout, text->str, text->len);
+	    }
+	  pango_layout_get_line_count (layout);
+	}
+      printf ("append a line, %-15s %6.2f ms\n",
+	      j == 0 ? "append_text:" : "set_text:", (test_time_ms () - start) / N_EDITS);
+    }
+
+  /* typing into a paragraph in the middle */
+  for (j = 0; j < 2; j++)
+    {
+      g_string_assign (text, pango_layout_get_text (layout));
+      mid = text->len / 2;
+      while (text->str[mid] != ' ')
+	mid++;
+
+      start = test_time_ms ();
+      for (i = 0; i < N_EDITS; i++)
+	{
+	  char c = 'a' + i % 26;
+
+	  if (j == 0)
+	    pango_layout_insert_text (layout, mid + i, &c, 1);
+	  else
+	    {
+	      g_string_insert_c (text, mid + i, c);
+	      pango_layout_set_text (layout, text->str, text->len);
+	    }
+	  pango_layout_get_line_count (layout);
+	}
+      printf ("keystroke,     %-15s %6.2f ms\n",
+	      j == 0 ? "insert_text:" : "set_text:", (test_time_ms () - start) / N_EDITS);
+    }
+
+  start = test_time_ms ();
+  for (i = 0; i < N_WIDTH_CHANGES; i++)
+    {
+      pango_layout_set_width (layout, WIDTH + (i % 2 ? 10000 : -10000));
+      pango_layout_get_line_count (layout);
+    }
+  printf ("width change by 10 pixels:    %6.2f ms\n",
+	  (test_time_ms () - start) / N_WIDTH_CHANGES);
+
+  full = full_layout (context, pango_layout_get_text (layout),
+		      pango_layout_get_width (layout), &fresh_lines);
+  printf ("full layout of the edited text: %.1f ms\n", full);
+
+  n_lines = pango_layout_get_line_count (layout);
+  pango_layout_get_extents (layout, NULL, &extents);
+  pango_layout_set_text (layout, pango_layout_get_text (layout), -1);
+  pango_layout_context_changed (layout);
+  pango_layout_get_extents (layout, NULL, &fresh_extents);
+  if (n_lines != fresh_lines ||
+      memcmp (&extents, &fresh_extents, sizeof (PangoRectangle)) != 0)
+    {
+      printf ("the edited layout differs from a fresh one\n");
+      failed++;
+    }
+
+  g_object_unref (layout);
+  g_object_unref (context);
+  g_string_free (text, TRUE);
+  g_string_free (line, TRUE);
+  g_rand_free (rand);
+
+  return failed ? 1 : 0;
+}
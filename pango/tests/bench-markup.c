@@ -0,0 +1,164 @@
+/* Pango
+ * bench-markup.c: Benchmark for pango_parse_markup()
+ *
+ * Copyright (C) 2003 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pango/pango.h>
+
+#include "testfontmap.h"
+
+/* Parses the kind of markup a chat client or a label hands to
+ * pango_parse_markup(): many short strings, and one long document
+ * made of the same strings, such as a tooltip or a log view. The
+ * text and the number of attributes are checked for every string.
+ */
+
+#define N_STRINGS 200000
+#define N_DOCUMENT_LINES 50000
+
+static const struct {
+  const char *markup;
+  const char *text;
+  int n_attrs;
+} samples[] = {
+  { "<span foreground=\"#c00000\" weight=\"bold\">Hello</span>, <i>world</i> "
+    "&amp; friends", "Hello, world & friends", 3 },
+  { "plain status text without tags", "plain status text without tags", 0 },
+  { "<b>Bold</b> <span size=\"small\" font_family=\"Sans\">small "
+    "&lt;sans&gt;</span>", "Bold small <sans>", 3 },
+  { "<span lang=\"ja\">\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e</span> "
+    "<tt>code</tt> <s>old</s>",
+    "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e code old", 3 },
+  { "[12:00] <b>&lt;nick&gt;</b> <u>see</u> <big>you</big> "
+    "<small>tomorrow</small>", "[12:00] <nick> see you tomorrow", 4 }
+};
+
+static int
+count_attrs (PangoAttrList *attrs)
+{
+  PangoAttrIterator *iter = pango_attr_list_get_iterator (attrs);
+  int n_attrs = 0;
+
+  do
+    {
+      GSList *list = pango_attr_iterator_get_attrs (iter);
+      GSList *l;
+
+      /* only count each attribute where it starts */
+      for (l = list; l; l = l->next)
+	{
+	  PangoAttribute *attr = l->data;
+	  int start;
+
+	  pango_attr_iterator_range (iter, &start, NULL);
+	  if (attr->start_index == start)
+	    n_attrs++;
+	  pango_attribute_destroy (attr);
+	}
+      g_slist_free (list);
+    }
+  while (pango_attr_iterator_next (iter));
+
+  pango_attr_iterator_destroy (iter);
+
+  return n_attrs;
+}
+
+static void
+parse (const char     *markup,
+       int             length,
+       PangoAttrList **attrs,
+       char          **text)
+{
+  GError *error = NULL;
+
+  if (!pango_parse_markup (markup, length, 0, attrs, text, NULL, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      exit (1);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  GString *document = g_string_new (NULL);
+  GString *document_text = g_string_new (NULL);
+  PangoAttrList *attrs;
+  char *text;
+  int lengths[G_N_ELEMENTS (samples)];
+  gsize total = 0;
+  double start, elapsed;
+  int i, failed = 0;
+
+  g_type_init ();
+
+  for (i = 0; i < G_N_ELEMENTS (samples); i++)
+    lengths[i] = strlen (samples[i].markup);
+
+  start = test_time_ms ();
+  for (i = 0; i < N_STRINGS; i++)
+    {
+      int n = i % G_N_ELEMENTS (samples);
+
+      parse (samples[n].markup, lengths[n], &attrs, &text);
+      if (i < G_N_ELEMENTS (samples) * 100 &&
+	  (strcmp (text, samples[n].text) != 0 ||
+	   count_attrs (attrs) != samples[n].n_attrs))
+	failed++;
+      total += lengths[n];
+      pango_attr_list_unref (attrs);
+      g_free (text);
+    }
+  elapsed = test_time_ms () - start;
+  printf ("%d short strings: %.1f ms, %.2f Mstrings/s, %.1f MB/s\n",
+	  N_STRINGS, elapsed, N_STRINGS / elapsed / 1e3, total / elapsed / 1e3);
+
+  for (i = 0; i < N_DOCUMENT_LINES; i++)
+    {
+      int n = i % G_N_ELEMENTS (samples);
+
+      g_string_append (document, samples[n].markup);
+      g_string_append_c (document, '\n');
+      g_string_append (document_text, samples[n].text);
+      g_string_append_c (document_text, '\n');
+    }
+
+  start = test_time_ms ();
+  parse (document->str, document->len, &attrs, &text);
+  elapsed = test_time_ms () - start;
+  printf ("%.1f MB document: %.1f ms, %.1f MB/s\n",
+	  document->len / 1e6, elapsed, document->len / elapsed / 1e3);
+
+  if (strcmp (text, document_text->str) != 0)
+    failed++;
+  pango_attr_list_unref (attrs);
+  g_free (text);
+
+  printf ("%d mismatches\n", failed);
+
+  g_string_free (document, TRUE);
+  g_string_free (document_text, TRUE);
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/* Pango
+ * bench-query.c: Benchmark for position queries on a long PangoLayout
+ *
+ * Copyright (C) 2003 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+
+#include <pango/pango.h>
+
+#include "testfontmap.h"
+
+/* Lays out 2500 paragraphs that wrap to 5000 lines and times random
+ * hit tests with pango_layout_xy_to_index() and cursor lookups with
+ * pango_layout_index_to_pos(), along with the other queries that find
+ * a line: pango_layout_index_to_line_x(), pango_layout_get_line(),
+ * pango_layout_get_extents() and pango_layout_get_iter(). Every hit
+ * test at a character's position has to give back that character.
+ */
+
+#define N_PARAGRAPHS 2500
+#define N_QUERIES 20000
+#define WIDTH 400000
+
+static const char paragraph[] =
+  "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+  "eiusmod tempor incididunt.\n";
+
+int
+main (int argc, char **argv)
+{
+  PangoContext *context;
+  PangoLayout *layout;
+  GString *text = g_string_new (NULL);
+  GRand *rand = g_rand_new_with_seed (7);
+  PangoRectangle extents, pos;
+  int *indices;
+  PangoRectangle *positions;
+  double start;
+  int i, n_lines, index, trailing, line, x;
+  int failed = 0;
+
+  g_type_init ();
+
+  context = test_context_new ();
+  layout = pango_layout_new (context);
+  for (i = 0; i < N_PARAGRAPHS; i++)
+    g_string_append (text, paragraph);
+  pango_layout_set_width (layout, WIDTH);
+  pango_layout_set_text (layout, text->str, text->len);
+  n_lines = pango_layout_get_line_count (layout);
+  pango_layout_get_extents (layout, NULL, &extents);
+  printf ("%lu bytes, %d lines\n", (gulong) text->len, n_lines);
+
+  indices = g_new (int, N_QUERIES);
+  positions = g_new (PangoRectangle, N_QUERIES);
+  for (i = 0; i < N_QUERIES; i++)
+    indices[i] = g_rand_int_range (rand, 0, text->len);
+
+  start = test_time_ms ();
+  for (i = 0; i < N_QUERIES; i++)
+    pango_layout_index_to_pos (layout, indices[i], &positions[i]);
+  printf ("index_to_pos:     %8.3f us\n",
+	  (test_time_ms () - start) * 1000 / N_QUERIES);
+
+  start = test_time_ms ();
+  for (i = 0; i < N_QUERIES; i++)
+    {
+      pango_layout_xy_to_index (layout,
+				g_rand_int_range (rand, 0, extents.width),
+				g_rand_int_range (rand, 0, extents.height),
+				&index, &trailing);
+    }
+  printf ("xy_to_index:      %8.3f us\n",
+	  (test_time_ms () - start) * 1000 / N_QUERIES);
+
+  /* hit test a quarter of the way into each character found above */
+  for (i = 0; i < N_QUERIES; i++)
+    {
+      pos = positions[i];
+      if (pos.width <= 0 || text->str[indices[i]] == '\n')
+	continue;
+
+      pango_layout_xy_to_index (layout, pos.x + pos.width / 4,
+				pos.y + pos.height / 2, &index, &trailing);
+      if (index != indices[i] || trailing != 0)
+	{
+	  if (failed++ < 10)
+	    printf ("index %d at %d,%d: xy_to_index gives %d,%d\n",
+		    indices[i], pos.x, pos.y, index, trailing);
+	}
+    }
+
+  start = test_time_ms ();
+  for (i = 0; i < N_QUERIES; i++)
+    {
+      pango_layout_index_to_line_x (layout, indices[i], FALSE, &line, &x);
+    }
+  printf ("index_to_line_x:  %8.3f us\n",
+	  (test_time_ms () - start) * 1000 / N_QUERIES);
+
+  start = test_time_ms ();
+  for (i = 0; i < N_QUERIES; i++)
+    pango_layout_get_line (layout, indices[i] % n_lines);
+  printf ("get_line:         %8.3f us\n",
+	  (test_time_ms () - start) * 1000 / N_QUERIES);
+
+  start = test_time_ms ();
+  for (i = 0; i < N_QUERIES; i++)
+    pango_layout_get_extents (layout, NULL, &pos);
+  printf ("get_extents:      %8.3f us\n",
+	  (test_time_ms () - start) * 1000 / N_QUERIES);
+
+  start = test_time_ms ();
+  for (i = 0; i < N_QUERIES; i++)
+    pango_layout_iter_free (pango_layout_get_iter (layout));
+  printf ("get_iter:         %8.3f us\n",
+	  (test_time_ms () - start) * 1000 / N_QUERIES);
+
+  g_free (indices);
+  g_free (positions);
+  g_object_unref (layout);
+  g_object_unref (context);
+  g_string_free (text, TRUE);
+  g_rand_free (rand);
+
+  return failed ? 1 : 0;
+}
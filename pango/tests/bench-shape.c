@@ -0,0 +1,218 @@
+/* Pango
+ * bench-shape.c: Benchmark for the glyph cache of pango_shape()
+ *
+ * Copyright (C) 2003 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pango/pango.h>
+
+#include "testfontmap.h"
+
+/* Shapes a chat log of short lines with heavy repetition, every line
+ * as the items pango_itemize() makes of it, with and without the
+ * cache, and checks that both give the same glyphs. Like in a chat
+ * client, timestamps and nicks have attributes of their own, so they
+ * are items of their own.
+ */
+
+#define N_LINES 100000
+#define N_NICKS 200
+
+static const char *words[] = {
+  "hello", "the", "build", "is", "green", "again", "lol", "ok", "Thanks",
+  "see", "you", "Tomorrow", "patch", "merged", "ping", "AVAIL", "Anyone",
+  "works", "for", "me", "caf\xc3\xa9", "na\xc3\xafve", "deploy", "done"
+};
+
+static GPtrArray *
+make_log (GPtrArray *attr_lists)
+{
+  GPtrArray *lines = g_ptr_array_new ();
+  GRand *rand = g_rand_new_with_seed (42);
+  char *nicks[N_NICKS];
+  int i, j;
+
+  for (i = 0; i < N_NICKS; i++)
+    nicks[i] = g_strdup_printf ("user%d", g_rand_int_range (rand, 0, 100000));
+
+  for (i = 0; i < N_LINES; i++)
+    {
+      GString *line = g_string_new (NULL);
+      PangoAttrList *attrs = pango_attr_list_new ();
+      PangoAttribute *attr;
+      int n_words = g_rand_int_range (rand, 1, 5);
+
+      g_string_append_printf (line, "[%02d:%02d] ", i / 3600 % 24, i / 60 % 60);
+      attr = pango_attr_foreground_new (0x8000, 0x8000, 0x8000);
+      attr->start_index = 0;
+      attr->end_index = line->len;
+      pango_attr_list_insert (attrs, attr);
+
+      attr = pango_attr_weight_new (PANGO_WEIGHT_BOLD);
+      attr->start_index = line->len;
+      g_string_append_printf (line, "<%s>", nicks[g_rand_int_range (rand, 0, N_NICKS)]);
+      attr->end_index = line->len;
+      pango_attr_list_insert (attrs, attr);
+
+      for (j = 0; j < n_words; j++)
+	g_string_append_printf (line, " %s", words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+      if (i % 97 == 0)
+	g_string_append (line, " e\xcc\x81 \xce\xb1\xce\xb2 \xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d");
+
+      g_ptr_array_add (lines, g_string_free (line, FALSE));
+      g_ptr_array_add (attr_lists, attrs);
+    }
+
+  for (i = 0; i < N_NICKS; i++)
+    g_free (nicks[i]);
+  g_rand_free (rand);
+
+  return lines;
+}
+
+static double
+shape_log (GPtrArray        *lines,
+	   GList           **items,
+	   PangoGlyphString *glyphs,
+	   gulong           *checksum)
+{
+  double start = test_time_ms ();
+  int i, j;
+
+  *checksum = 0;
+  for (i = 0; i < lines->len; i++)
+    {
+      const char *text = lines->pdata[i];
+      GList *l;
+
+      for (l = items[i]; l; l = l->next)
+	{
+	  PangoItem *item = l->data;
+
+	  pango_shape (text + item->offset, item->length, &item->analysis, glyphs);
+	  for (j = 0; j < glyphs->num_glyphs; j++)
+	    *checksum = *checksum * 31 + glyphs->glyphs[j].glyph + glyphs->glyphs[j].geometry.width +
+	      glyphs->glyphs[j].geometry.x_offset + glyphs->log_clusters[j];
+	}
+    }
+
+  return test_time_ms () - start;
+}
+
+int
+main (int argc, char **argv)
+{
+  PangoContext *context;
+  GPtrArray *attr_lists;
+  PangoGlyphString *glyphs, *cached_glyphs;
+  GPtrArray *lines;
+  GList **items;
+  gulong checksum, cached_checksum;
+  guint hits, misses;
+  gsize size;
+  double uncached, cached;
+  int i, round, failed = 0;
+
+  g_type_init ();
+
+  context = test_context_new ();
+  attr_lists = g_ptr_array_new ();
+  lines = make_log (attr_lists);
+  items = g_new (GList *, lines->len);
+  for (i = 0; i < lines->len; i++)
+    items[i] = pango_itemize (context, lines->pdata[i], 0, strlen (lines->pdata[i]),
+			      attr_lists->pdata[i], NULL);
+
+  glyphs = pango_glyph_string_new ();
+  cached_glyphs = pango_glyph_string_new ();
+
+  /* the cache must not change what the shaper produces, kerning
+   * across spaces included; a tiny budget forces evictions
+   */
+  for (i = 0; i < 20000; i++)
+    {
+      const char *text = lines->pdata[i];
+      GList *l;
+      int j;
+
+      for (l = items[i]; l; l = l->next)
+	{
+	  PangoItem *item = l->data;
+
+	  pango_shape_cache_set_max_size (0);
+	  pango_shape (text + item->offset, item->length, &item->analysis, glyphs);
+	  pango_shape_cache_set_max_size (i % 2 ? 4096 : 1024 * 1024);
+	  pango_shape (text + item->offset, item->length, &item->analysis, cached_glyphs);
+
+	  if (glyphs->num_glyphs != cached_glyphs->num_glyphs)
+	    failed++;
+	  else
+	    for (j = 0; j < glyphs->num_glyphs; j++)
+	      if (glyphs->log_clusters[j] != cached_glyphs->log_clusters[j] ||
+		  glyphs->glyphs[j].glyph != cached_glyphs->glyphs[j].glyph ||
+		  memcmp (&glyphs->glyphs[j].geometry, &cached_glyphs->glyphs[j].geometry,
+			  sizeof (PangoGlyphGeometry)) != 0 ||
+		  glyphs->glyphs[j].attr.is_cluster_start != cached_glyphs->glyphs[j].attr.is_cluster_start)
+		{
+		  failed++;
+		  break;
+		}
+	}
+    }
+  printf ("cached and uncached glyphs differ for %d items\n", failed);
+
+  for (round = 0; round < 3; round++)
+    {
+      pango_shape_cache_set_max_size (0);
+      uncached = shape_log (lines, items, glyphs, &checksum);
+
+      pango_shape_cache_set_max_size (1024 * 1024);
+      pango_shape_cache_clear ();
+      cached = shape_log (lines, items, glyphs, &cached_checksum);
+
+      if (checksum != cached_checksum)
+	failed++;
+
+      pango_shape_cache_get_stats (&hits, &misses, &size);
+      printf ("%d lines: uncached %.1f ms, cached %.1f ms (%.2fx), %u hits, %u misses, %lu bytes\n",
+	      lines->len, uncached, cached, uncached / cached, hits, misses, (gulong) size);
+    }
+
+  for (i = 0; i < lines->len; i++)
+    {
+      g_list_foreach (items[i], (GFunc) pango_item_free, NULL);
+      g_list_free (items[i]);
+      g_free (lines->pdata[i]);
+      pango_attr_list_unref (attr_lists->pdata[i]);
+    }
+  g_free (items);
+  g_ptr_array_free (lines, TRUE);
+  pango_glyph_string_free (glyphs);
+  pango_glyph_string_free (cached_glyphs);
+  g_ptr_array_free (attr_lists, TRUE);
+  g_object_unref (context);
+
+  pango_shape_cache_get_stats (NULL, NULL, &size);
+  printf ("%lu bytes cached after the fonts are gone\n", (gulong) size);
+
+  return failed || size ? 1 : 0;
+}
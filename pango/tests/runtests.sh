@@ -1,7 +1,7 @@
 #! /bin/sh
 
 LOGFILE=runtests.log
-POTENTIAL_TESTS='testboundaries testcolor'
+POTENTIAL_TESTS='testboundaries testcolor testlayout'
 
 ECHO_C=''
 ECHO_N='-n'
@@ -0,0 +1,406 @@
+/* Pango
+ * testfontmap.c: Font map for tests that don't depend on a backend
+ *
+ * Copyright (C) 2003 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#define PANGO_ENABLE_BACKEND
+#define PANGO_ENABLE_ENGINE
+
+#include <string.h>
+
+#include <pango/pango.h>
+#include <pango/pango-engine.h>
+
+#include "testfontmap.h"
+
+typedef struct _TestFont         TestFont;
+typedef struct _TestFontClass    TestFontClass;
+typedef struct _TestFontMap      TestFontMap;
+typedef struct _TestFontMapClass TestFontMapClass;
+
+typedef struct
+{
+  const char *name;
+  gunichar ranges[3][2];
+} TestFamily;
+
+static const TestFamily test_families[] = {
+  { "Latin",    { { 0x0020, 0x024f }, { 0x0300, 0x036f }, { 0x2000, 0x206f } } },
+  { "Greek",    { { 0x0370, 0x03ff }, { 0x0300, 0x036f }, { 0, 0 } } },
+  { "Cyrillic", { { 0x0400, 0x04ff }, { 0x0300, 0x036f }, { 0, 0 } } },
+  { "Hebrew",   { { 0x0590, 0x05ff }, { 0, 0 }, { 0, 0 } } },
+  { "Arabic",   { { 0x0600, 0x06ff }, { 0, 0 }, { 0, 0 } } },
+  { "Kana",     { { 0x3000, 0x30ff }, { 0, 0 }, { 0, 0 } } },
+  { "CJK",      { { 0x3000, 0x303f }, { 0x4e00, 0x9fff }, { 0xff00, 0xffef } } },
+  { "Hangul",   { { 0xac00, 0xd7a3 }, { 0, 0 }, { 0, 0 } } }
+};
+#define N_TEST_FAMILIES G_N_ELEMENTS (test_families)
+
+struct _TestFont
+{
+  PangoFont parent_instance;
+
+  guint family;
+  gboolean bold;
+};
+
+struct _TestFontClass
+{
+  PangoFontClass parent_class;
+};
+
+struct _TestFontMap
+{
+  PangoFontMap parent_instance;
+
+  PangoFont *fonts[N_TEST_FAMILIES][2];
+};
+
+struct _TestFontMapClass
+{
+  PangoFontMapClass parent_class;
+};
+
+static GType test_font_get_type     (void);
+static GType test_font_map_get_type (void);
+
+#define TEST_FONT(object) ((TestFont *) (object))
+
+static PangoCoverage *family_coverage[N_TEST_FAMILIES];
+
+/* a glyph is the character, shifted to leave room for the weight */
+#define TEST_GLYPH(wc, bold)   ((PangoGlyph) ((wc) * 2 + ((bold) ? 1 : 0)))
+#define TEST_GLYPH_WIDTH(glyph) ((5000 + ((glyph) / 2 % 7) * 1000) * (((glyph) & 1) ? 6 : 5) / 5)
+
+gint
+test_font_map_kerning (gunichar left,
+		       gunichar right)
+{
+  static const struct { gunichar left, right; gint kerning; } pairs[] = {
+    { ' ', 'A', -600 }, { ' ', 'T', -400 }, { 'A', 'T', -900 },
+    { 'A', 'V', -1000 }, { 'T', 'o', -800 }, { 'V', 'a', -700 },
+    { 'W', 'a', -600 }, { 'L', 'T', -900 }, { 'f', ' ', 300 }
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (pairs); i++)
+    if (pairs[i].left == left && pairs[i].right == right)
+      return pairs[i].kerning;
+
+  return 0;
+}
+
+static void
+test_font_shape (PangoFont        *font,
+		 const char       *text,
+		 gint              length,
+		 PangoAnalysis    *analysis,
+		 PangoGlyphString *glyphs)
+{
+  gboolean bold = TEST_FONT (font)->bold;
+  gint n_chars = g_utf8_strlen (text, length);
+  gunichar prev_wc = 0;
+  const char *p;
+  gint i;
+
+  pango_glyph_string_set_size (glyphs, MAX (n_chars, 1));
+
+  p = text;
+  for (i = 0; i < n_chars; i++)
+    {
+      gunichar wc = g_utf8_get_char (p);
+      PangoGlyph glyph = TEST_GLYPH (wc, bold);
+
+      glyphs->glyphs[i].glyph = glyph;
+      glyphs->glyphs[i].geometry.x_offset = 0;
+      glyphs->glyphs[i].geometry.y_offset = 0;
+      glyphs->glyphs[i].geometry.width = TEST_GLYPH_WIDTH (glyph);
+      glyphs->log_clusters[i] = p - text;
+
+      if (i > 0 && g_unichar_type (wc) == G_UNICODE_NON_SPACING_MARK)
+	{
+	  glyphs->glyphs[i].geometry.width = 0;
+	  glyphs->glyphs[i].geometry.x_offset = -glyphs->glyphs[i - 1].geometry.width;
+	  glyphs->log_clusters[i] = glyphs->log_clusters[i - 1];
+	}
+      else if (i > 0)
+	glyphs->glyphs[i - 1].geometry.width += test_font_map_kerning (prev_wc, wc);
+
+      prev_wc = wc;
+      p = g_utf8_next_char (p);
+    }
+
+  if (n_chars == 0)
+    {
+      glyphs->glyphs[0].glyph = 0;
+      glyphs->glyphs[0].geometry.x_offset = 0;
+      glyphs->glyphs[0].geometry.y_offset = 0;
+      glyphs->glyphs[0].geometry.width = 0;
+      glyphs->log_clusters[0] = 0;
+    }
+
+  /* glyphs of right-to-left runs come out in visual order */
+  if (analysis->level % 2)
+    for (i = 0; i < glyphs->num_glyphs / 2; i++)
+      {
+	gint j = glyphs->num_glyphs - 1 - i;
+	PangoGlyphInfo tmp_info = glyphs->glyphs[i];
+	gint tmp_cluster = glyphs->log_clusters[i];
+
+	glyphs->glyphs[i] = glyphs->glyphs[j];
+	glyphs->glyphs[j] = tmp_info;
+	glyphs->log_clusters[i] = glyphs->log_clusters[j];
+	glyphs->log_clusters[j] = tmp_cluster;
+      }
+}
+
+static PangoEngineShape test_shape_engine = {
+  { "TestShape", PANGO_ENGINE_TYPE_SHAPE, sizeof (PangoEngineShape) },
+  test_font_shape,
+  NULL
+};
+
+static PangoFontDescription *
+test_font_describe (PangoFont *font)
+{
+  PangoFontDescription *desc = pango_font_description_new ();
+
+  pango_font_description_set_family_static (desc, test_families[TEST_FONT (font)->family].name);
+  pango_font_description_set_weight (desc, TEST_FONT (font)->bold ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
+  pango_font_description_set_size (desc, 10 * PANGO_SCALE);
+
+  return desc;
+}
+
+static PangoCoverage *
+test_font_get_coverage (PangoFont     *font,
+			PangoLanguage *language)
+{
+  guint family = TEST_FONT (font)->family;
+
+  if (!family_coverage[family])
+    {
+      PangoCoverage *coverage = pango_coverage_new ();
+      guint i;
+      gunichar wc;
+
+      for (i = 0; i < G_N_ELEMENTS (test_families[family].ranges); i++)
+	if (test_families[family].ranges[i][1])
+	  for (wc = test_families[family].ranges[i][0]; wc <= test_families[family].ranges[i][1]; wc++)
+	    pango_coverage_set (coverage, wc, PANGO_COVERAGE_EXACT);
+
+      family_coverage[family] = coverage;
+    }
+
+  return pango_coverage_ref (family_coverage[family]);
+}
+
+static PangoEngineShape *
+test_font_find_shaper (PangoFont     *font,
+		       PangoLanguage *language,
+		       guint32        ch)
+{
+  return &test_shape_engine;
+}
+
+static void
+test_font_get_glyph_extents (PangoFont      *font,
+			     PangoGlyph      glyph,
+			     PangoRectangle *ink_rect,
+			     PangoRectangle *logical_rect)
+{
+  PangoRectangle rect;
+
+  rect.x = 0;
+  rect.y = -10 * PANGO_SCALE;
+  rect.width = TEST_GLYPH_WIDTH (glyph);
+  rect.height = 12 * PANGO_SCALE;
+
+  if (ink_rect)
+    *ink_rect = rect;
+  if (logical_rect)
+    *logical_rect = rect;
+}
+
+static PangoFontMetrics *
+test_font_get_metrics (PangoFont     *font,
+		       PangoLanguage *language)
+{
+  PangoFontMetrics *metrics = pango_font_metrics_new ();
+
+  metrics->ascent = 10 * PANGO_SCALE;
+  metrics->descent = 2 * PANGO_SCALE;
+  metrics->approximate_char_width = 7 * PANGO_SCALE;
+  metrics->approximate_digit_width = 7 * PANGO_SCALE;
+
+  return metrics;
+}
+
+static void
+test_font_class_init (TestFontClass *class)
+{
+  PangoFontClass *font_class = PANGO_FONT_CLASS (class);
+
+  font_class->describe = test_font_describe;
+  font_class->get_coverage = test_font_get_coverage;
+  font_class->find_shaper = test_font_find_shaper;
+  font_class->get_glyph_extents = test_font_get_glyph_extents;
+  font_class->get_metrics = test_font_get_metrics;
+}
+
+static GType
+test_font_get_type (void)
+{
+  static GType object_type = 0;
+
+  if (!object_type)
+    {
+      static const GTypeInfo object_info =
+      {
+	sizeof (TestFontClass),
+	(GBaseInitFunc) NULL,
+	(GBaseFinalizeFunc) NULL,
+	(GClassInitFunc) test_font_class_init,
+	NULL,           /* class_finalize */
+	NULL,           /* class_data */
+	sizeof (TestFont),
+	0,              /* n_preallocs */
+	(GInstanceInitFunc) NULL,
+      };
+
+      object_type = g_type_register_static (PANGO_TYPE_FONT, "TestFont", &object_info, 0);
+    }
+
+  return object_type;
+}
+
+static PangoFont *
+test_font_map_load_font (PangoFontMap               *fontmap,
+			 PangoContext               *context,
+			 const PangoFontDescription *desc)
+{
+  TestFontMap *test_fontmap = (TestFontMap *) fontmap;
+  const char *family_name = pango_font_description_get_family (desc);
+  gboolean bold = pango_font_description_get_weight (desc) >= PANGO_WEIGHT_BOLD;
+  guint family;
+
+  for (family = 0; family < N_TEST_FAMILIES; family++)
+    if (family_name && g_ascii_strcasecmp (family_name, test_families[family].name) == 0)
+      break;
+
+  /* anything else, "Sans" included, is Latin */
+  if (family == N_TEST_FAMILIES)
+    family = 0;
+
+  if (!test_fontmap->fonts[family][bold])
+    {
+      TestFont *font = g_object_new (test_font_get_type (), NULL);
+
+      font->family = family;
+      font->bold = bold;
+      test_fontmap->fonts[family][bold] = PANGO_FONT (font);
+    }
+
+  return g_object_ref (test_fontmap->fonts[family][bold]);
+}
+
+static void
+test_font_map_finalize (GObject *object)
+{
+  TestFontMap *test_fontmap = (TestFontMap *) object;
+  guint i;
+
+  for (i = 0; i < N_TEST_FAMILIES; i++)
+    {
+      if (test_fontmap->fonts[i][0])
+	g_object_unref (test_fontmap->fonts[i][0]);
+      if (test_fontmap->fonts[i][1])
+	g_object_unref (test_fontmap->fonts[i][1]);
+    }
+
+  G_OBJECT_CLASS (g_type_class_peek_parent (G_OBJECT_GET_CLASS (object)))->finalize (object);
+}
+
+static void
+test_font_map_class_init (TestFontMapClass *class)
+{
+  G_OBJECT_CLASS (class)->finalize = test_font_map_finalize;
+  PANGO_FONT_MAP_CLASS (class)->load_font = test_font_map_load_font;
+}
+
+static GType
+test_font_map_get_type (void)
+{
+  static GType object_type = 0;
+
+  if (!object_type)
+    {
+      static const GTypeInfo object_info =
+      {
+	sizeof (TestFontMapClass),
+	(GBaseInitFunc) NULL,
+	(GBaseFinalizeFunc) NULL,
+	(GClassInitFunc) test_font_map_class_init,
+	NULL,           /* class_finalize */
+	NULL,           /* class_data */
+	sizeof (TestFontMap),
+	0,              /* n_preallocs */
+	(GInstanceInitFunc) NULL,
+      };
+
+      object_type = g_type_register_static (PANGO_TYPE_FONT_MAP, "TestFontMap", &object_info, 0);
+    }
+
+  return object_type;
+}
+
+PangoFontMap *
+test_font_map_new (void)
+{
+  return g_object_new (test_font_map_get_type (), NULL);
+}
+
+PangoContext *
+test_context_new (void)
+{
+  PangoContext *context = pango_context_new ();
+  PangoFontMap *fontmap = test_font_map_new ();
+  PangoFontDescription *desc;
+
+  pango_context_set_font_map (context, fontmap);
+  g_object_unref (fontmap);
+
+  desc = pango_font_description_from_string (TEST_FONT_FAMILIES " 10");
+  pango_context_set_font_description (context, desc);
+  pango_font_description_free (desc);
+
+  pango_context_set_language (context, pango_language_from_string ("en"));
+
+  return context;
+}
+
+gdouble
+test_time_ms (void)
+{
+  GTimeVal now;
+
+  g_get_current_time (&now);
+
+  return now.tv_sec * 1000.0 + now.tv_usec / 1000.0;
+}
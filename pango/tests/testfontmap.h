@@ -0,0 +1,50 @@
+/* Pango
+ * testfontmap.h: Font map for tests that don't depend on a backend
+ *
+ * Copyright (C) 2003 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __TEST_FONT_MAP_H__
+#define __TEST_FONT_MAP_H__
+
+#include <pango/pango.h>
+
+G_BEGIN_DECLS
+
+/* The test font map has one family per script, "Latin", "Greek",
+ * "Cyrillic", "Hebrew", "Arabic", "Kana", "CJK" and "Hangul", each
+ * covering only its script, in a regular and a bold weight. The
+ * shaper maps every character to a glyph of its own, with widths
+ * that depend on the character and the weight, attaches combining
+ * marks to the preceding character and kerns a few pairs the way
+ * the FreeType backend does, by adjusting the width of the first
+ * glyph of the pair, so results depend on the neighbouring text.
+ */
+#define TEST_FONT_FAMILIES "Latin,Greek,Cyrillic,Hebrew,Arabic,Kana,CJK,Hangul"
+
+PangoFontMap *test_font_map_new   (void);
+PangoContext *test_context_new    (void);
+gint          test_font_map_kerning (gunichar left,
+				     gunichar right);
+
+/* milliseconds of wall clock time, for the benchmarks */
+gdouble       test_time_ms        (void);
+
+G_END_DECLS
+
+#endif /* __TEST_FONT_MAP_H__ */
@@ -0,0 +1,407 @@
+/* Pango
+ * testlayout.c: Test incremental relayout of PangoLayout
+ *
+ * Copyright (C) 2003 Red Hat Software
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pango/pango.h>
+
+#include "testfontmap.h"
+
+/* Applies random edits to layouts: inserting, deleting and appending
+ * text, replacing it with pango_layout_set_text(), changing the width,
+ * attributes, alignment and spacing. After each round of edits the
+ * layout, which only lays out the paragraphs the edits touched, is
+ * compared with a fresh layout of the same text: lines, runs, glyphs,
+ * log attrs, extents and positions. The lines outside the range
+ * reported by pango_layout_get_changed_lines() must be the same line
+ * objects as before the edits.
+ */
+
+#define N_LAYOUTS 150
+#define N_ROUNDS 30
+
+static PangoContext *context;
+
+static const char *snippets[] = {
+  "a", " ", "hello", "\n", "\r", "\r\n", "\t", "x y z ", "\xc3\xa9",
+  "\xd8\xb3\xd9\x84\xd8\xa7\xd9\x85", "\xe2\x80\xa9", "word\nword", "\n\n",
+  "long line of words that wraps around ", "1234", "AVAT To"
+};
+
+static gboolean
+compare_glyphs (PangoGlyphString *a,
+		PangoGlyphString *b)
+{
+  int i;
+
+  if (a->num_glyphs != b->num_glyphs)
+    return FALSE;
+
+  for (i = 0; i < a->num_glyphs; i++)
+    if (a->glyphs[i].glyph != b->glyphs[i].glyph ||
+	memcmp (&a->glyphs[i].geometry, &b->glyphs[i].geometry, sizeof (PangoGlyphGeometry)) != 0 ||
+	a->glyphs[i].attr.is_cluster_start != b->glyphs[i].attr.is_cluster_start ||
+	a->log_clusters[i] != b->log_clusters[i])
+      return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+compare_lines (PangoLayout *a,
+	       PangoLayout *b)
+{
+  GSList *la, *lb;
+
+  if (pango_layout_get_line_count (a) != pango_layout_get_line_count (b))
+    return FALSE;
+
+  for (la = pango_layout_get_lines (a), lb = pango_layout_get_lines (b);
+       la && lb;
+       la = la->next, lb = lb->next)
+    {
+      PangoLayoutLine *line_a = la->data;
+      PangoLayoutLine *line_b = lb->data;
+      GSList *ra, *rb;
+
+      if (line_a->layout != a ||
+	  line_a->start_index != line_b->start_index ||
+	  line_a->length != line_b->length)
+	return FALSE;
+
+      for (ra = line_a->runs, rb = line_b->runs; ra && rb; ra = ra->next, rb = rb->next)
+	{
+	  PangoLayoutRun *run_a = ra->data;
+	  PangoLayoutRun *run_b = rb->data;
+
+	  if (run_a->item->offset != run_b->item->offset ||
+	      run_a->item->length != run_b->item->length ||
+	      run_a->item->num_chars != run_b->item->num_chars ||
+	      run_a->item->analysis.font != run_b->item->analysis.font ||
+	      run_a->item->analysis.level != run_b->item->analysis.level ||
+	      g_slist_length (run_a->item->analysis.extra_attrs) !=
+	      g_slist_length (run_b->item->analysis.extra_attrs) ||
+	      !compare_glyphs (run_a->glyphs, run_b->glyphs))
+	    return FALSE;
+	}
+
+      if (ra || rb)
+	return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+compare_layouts (PangoLayout *a,
+		 PangoLayout *b)
+{
+  PangoLogAttr *attrs_a, *attrs_b;
+  int n_attrs_a, n_attrs_b;
+  PangoRectangle ink_a, ink_b, logical_a, logical_b;
+  PangoLayoutIter *iter_a, *iter_b;
+  const char *text;
+  int len, i;
+  gboolean same;
+
+  if (!compare_lines (a, b))
+    return FALSE;
+
+  pango_layout_get_log_attrs (a, &attrs_a, &n_attrs_a);
+  pango_layout_get_log_attrs (b, &attrs_b, &n_attrs_b);
+  same = n_attrs_a == n_attrs_b &&
+	 memcmp (attrs_a, attrs_b, n_attrs_a * sizeof (PangoLogAttr)) == 0;
+  g_free (attrs_a);
+  g_free (attrs_b);
+  if (!same)
+    return FALSE;
+
+  pango_layout_get_extents (a, &ink_a, &logical_a);
+  pango_layout_get_extents (b, &ink_b, &logical_b);
+  if (memcmp (&ink_a, &ink_b, sizeof (PangoRectangle)) != 0 ||
+      memcmp (&logical_a, &logical_b, sizeof (PangoRectangle)) != 0)
+    return FALSE;
+
+  text = pango_layout_get_text (a);
+  len = strlen (text);
+  for (i = 0; i <= len; i = g_utf8_next_char (text + i) - text)
+    {
+      pango_layout_index_to_pos (a, i, &logical_a);
+      pango_layout_index_to_pos (b, i, &logical_b);
+      if (memcmp (&logical_a, &logical_b, sizeof (PangoRectangle)) != 0)
+	return FALSE;
+      if (i == len)
+	break;
+    }
+
+  iter_a = pango_layout_get_iter (a);
+  iter_b = pango_layout_get_iter (b);
+  do
+    {
+      int y0_a, y1_a, y0_b, y1_b;
+
+      pango_layout_iter_get_run_extents (iter_a, &ink_a, &logical_a);
+      pango_layout_iter_get_run_extents (iter_b, &ink_b, &logical_b);
+      pango_layout_iter_get_line_yrange (iter_a, &y0_a, &y1_a);
+      pango_layout_iter_get_line_yrange (iter_b, &y0_b, &y1_b);
+      if (memcmp (&ink_a, &ink_b, sizeof (PangoRectangle)) != 0 ||
+	  memcmp (&logical_a, &logical_b, sizeof (PangoRectangle)) != 0 ||
+	  y0_a != y0_b || y1_a != y1_b ||
+	  pango_layout_iter_get_baseline (iter_a) != pango_layout_iter_get_baseline (iter_b))
+	{
+	  same = FALSE;
+	  break;
+	}
+      if (!pango_layout_iter_next_run (iter_b))
+	{
+	  same = !pango_layout_iter_next_run (iter_a);
+	  break;
+	}
+    }
+  while (pango_layout_iter_next_run (iter_a));
+  pango_layout_iter_free (iter_a);
+  pango_layout_iter_free (iter_b);
+
+  return same;
+}
+
+static PangoLayout *
+fresh_copy (PangoLayout *layout)
+{
+  PangoLayout *copy = pango_layout_new (context);
+
+  pango_layout_set_text (copy, pango_layout_get_text (layout), -1);
+  pango_layout_set_attributes (copy, pango_layout_get_attributes (layout));
+  pango_layout_set_width (copy, pango_layout_get_width (layout));
+  pango_layout_set_indent (copy, pango_layout_get_indent (layout));
+  pango_layout_set_alignment (copy, pango_layout_get_alignment (layout));
+  pango_layout_set_spacing (copy, pango_layout_get_spacing (layout));
+
+  return copy;
+}
+
+static const char *
+random_snippet (GRand *rand)
+{
+  return snippets[g_rand_int_range (rand, 0, G_N_ELEMENTS (snippets))];
+}
+
+static int
+random_index (GRand      *rand,
+	      const char *text)
+{
+  int n_chars = g_utf8_strlen (text, -1);
+
+  return g_utf8_offset_to_pointer (text, g_rand_int_range (rand, 0, n_chars + 1)) - text;
+}
+
+static int
+random_width (GRand *rand)
+{
+  return g_rand_boolean (rand) ? -1 : g_rand_int_range (rand, 20, 300) * 1000;
+}
+
+static void
+set_random_attributes (GRand       *rand,
+		       PangoLayout *layout)
+{
+  PangoAttrList *attrs = pango_attr_list_new ();
+  int len = strlen (pango_layout_get_text (layout));
+  int n_attrs = g_rand_int_range (rand, 0, 6);
+  int i;
+
+  for (i = 0; i < n_attrs; i++)
+    {
+      PangoAttribute *attr;
+      int start = g_rand_int_range (rand, 0, len + 1);
+      int end = g_rand_int_range (rand, start, len + 1);
+
+      switch (g_rand_int_range (rand, 0, 3))
+	{
+	case 0:
+	  attr = pango_attr_weight_new (PANGO_WEIGHT_BOLD);
+	  break;
+	case 1:
+	  attr = pango_attr_foreground_new (65535, 0, 0);
+	  break;
+	default:
+	  attr = pango_attr_underline_new (PANGO_UNDERLINE_SINGLE);
+	  break;
+	}
+      attr->start_index = start;
+      attr->end_index = end;
+      pango_attr_list_change (attrs, attr);
+    }
+
+  pango_layout_set_attributes (layout, attrs);
+  pango_attr_list_unref (attrs);
+}
+
+static void
+edit_randomly (GRand       *rand,
+	       PangoLayout *layout)
+{
+  const char *text = pango_layout_get_text (layout);
+  int start, end;
+  GString *string;
+
+  switch (g_rand_int_range (rand, 0, 10))
+    {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+      pango_layout_insert_text (layout, random_index (rand, text), random_snippet (rand), -1);
+      break;
+    case 4:
+    case 5:
+      start = random_index (rand, text);
+      end = random_index (rand, text);
+      pango_layout_delete_text (layout, MIN (start, end), ABS (end - start));
+      break;
+    case 6:
+      pango_layout_append_text (layout, random_snippet (rand), -1);
+      break;
+    case 7:
+      pango_layout_set_width (layout, random_width (rand));
+      break;
+    case 8:
+      if (g_rand_boolean (rand))
+	set_random_attributes (rand, layout);
+      else if (g_rand_boolean (rand))
+	pango_layout_set_alignment (layout, g_rand_int_range (rand, 0, 3));
+      else
+	pango_layout_set_spacing (layout, g_rand_int_range (rand, 0, 5000));
+      break;
+    default:
+      /* a close variant of the text, as an editor would set it */
+      string = g_string_new (text);
+      g_string_insert (string, random_index (rand, string->str), random_snippet (rand));
+      pango_layout_set_text (layout, string->str, -1);
+      g_string_free (string, TRUE);
+      break;
+    }
+}
+
+/* Checks that the lines outside the changed range are the ones that
+ * were there before, in @old_lines
+ */
+static gboolean
+check_changed_lines (PangoLayout *layout,
+		     GPtrArray   *old_lines)
+{
+  int first, n_removed, n_added;
+  int n_old = old_lines->len;
+  GSList *l;
+  int i;
+
+  pango_layout_get_changed_lines (layout, &first, &n_removed, &n_added);
+  if (first < 0 || n_removed < 0 || n_added < 0 || first + n_removed > n_old ||
+      n_old - n_removed + n_added != pango_layout_get_line_count (layout))
+    return FALSE;
+
+  for (l = pango_layout_get_lines (layout), i = 0; l; l = l->next, i++)
+    {
+      if (i < first && l->data != old_lines->pdata[i])
+	return FALSE;
+      if (i >= first + n_added && l->data != old_lines->pdata[i - n_added + n_removed])
+	return FALSE;
+    }
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GRand *rand = g_rand_new_with_seed (argc > 1 ? atoi (argv[1]) : 42);
+  int i, round, failed = 0;
+
+  g_type_init ();
+
+  context = test_context_new ();
+
+  for (i = 0; i < N_LAYOUTS; i++)
+    {
+      PangoLayout *layout = pango_layout_new (context);
+      GString *text = g_string_new (NULL);
+      int n;
+
+      for (n = g_rand_int_range (rand, 0, 12); n > 0; n--)
+	g_string_append (text, random_snippet (rand));
+      pango_layout_set_text (layout, text->str, -1);
+      g_string_free (text, TRUE);
+      if (g_rand_boolean (rand))
+	set_random_attributes (rand, layout);
+      pango_layout_set_width (layout, random_width (rand));
+      if (g_rand_int_range (rand, 0, 4) == 0)
+	pango_layout_set_indent (layout, g_rand_int_range (rand, -30, 30) * 1000);
+
+      for (round = 0; round < N_ROUNDS; round++)
+	{
+	  GPtrArray *old_lines = g_ptr_array_new ();
+	  PangoLayout *copy;
+	  GSList *l;
+	  int j;
+
+	  pango_layout_get_changed_lines (layout, NULL, NULL, NULL);
+	  for (l = pango_layout_get_lines (layout); l; l = l->next)
+	    {
+	      pango_layout_line_ref (l->data);
+	      g_ptr_array_add (old_lines, l->data);
+	    }
+
+	  for (n = g_rand_int_range (rand, 1, 4); n > 0; n--)
+	    edit_randomly (rand, layout);
+
+	  if (!check_changed_lines (layout, old_lines))
+	    {
+	      printf ("layout %d, round %d: wrong changed lines\n", i, round);
+	      failed++;
+	    }
+
+	  copy = fresh_copy (layout);
+	  if (!compare_layouts (layout, copy))
+	    {
+	      char *escaped = g_strescape (pango_layout_get_text (layout), NULL);
+
+	      printf ("layout %d, round %d: differs from a fresh layout of \"%s\", width %d\n",
+		      i, round, escaped, pango_layout_get_width (layout));
+	      g_free (escaped);
+	      failed++;
+	    }
+	  g_object_unref (copy);
+
+	  for (j = 0; j < old_lines->len; j++)
+	    pango_layout_line_unref (old_lines->pdata[j]);
+	  g_ptr_array_free (old_lines, TRUE);
+	}
+
+      g_object_unref (layout);
+    }
+
+  g_rand_free (rand);
+  g_object_unref (context);
+
+  return failed ? 1 : 0;
+}